@@ -0,0 +1,272 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Allocation profiler runtime for ASTER_ALLOC_PROFILE=1 builds.
+//
+// asterc rewrites every `malloc`/`calloc`/`realloc`/`free` call in Aster code
+// to `aster_allocprof_<fn>(..., site)`, where `site` is a static label
+// "file:line:col caller callee". This file attributes each allocation to its
+// site (count, bytes, live, peak live) and prints the top sites at exit.
+//
+// Auto-linked into Aster binaries built with ASTER_ALLOC_PROFILE=1.
+//
+// Runtime knobs:
+// - ASTER_ALLOC_PROFILE_OUT=<path>  write the report to a file (default stderr)
+// - ASTER_ALLOC_PROFILE_TOP=<n>     rows per table (default 15)
+
+typedef struct {
+  const char* label; // NULL = empty slot
+  uint64_t allocs;
+  uint64_t nulls; // allocs that returned NULL (never live, never leaked)
+  uint64_t frees;
+  uint64_t bytes;
+  uint64_t live;
+  uint64_t peak_live;
+} AsterAllocSite;
+
+typedef struct {
+  uintptr_t ptr; // 0 = empty
+  const char* label; // allocating site (site slots move on rehash)
+  uint64_t size;
+} AsterAllocLive;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static AsterAllocSite* g_sites;
+static size_t g_sites_cap;
+static size_t g_nsites;
+static AsterAllocLive* g_live;
+static size_t g_live_cap;
+static size_t g_live_len;
+static uint64_t g_total_live;
+static uint64_t g_total_peak;
+static uint64_t g_untracked_frees;
+static uint64_t g_null_allocs;
+static int g_registered;
+
+static inline uint64_t aster_allocprof_hash(uintptr_t x) {
+  uint64_t h = (uint64_t)x;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  return h;
+}
+
+static void aster_allocprof_report(void);
+
+static uint32_t aster_allocprof_site_locked(const char* label) {
+  if (!g_registered) {
+    g_registered = 1;
+    atexit(aster_allocprof_report);
+  }
+  if ((g_nsites + 1) * 2 > g_sites_cap) {
+    size_t ncap = g_sites_cap ? g_sites_cap * 2 : 256;
+    AsterAllocSite* ns = (AsterAllocSite*)calloc(ncap, sizeof(AsterAllocSite));
+    if (!ns) abort();
+    for (size_t i = 0; i < g_sites_cap; i++) {
+      if (!g_sites[i].label) continue;
+      size_t j = aster_allocprof_hash((uintptr_t)g_sites[i].label) & (ncap - 1);
+      while (ns[j].label) j = (j + 1) & (ncap - 1);
+      ns[j] = g_sites[i];
+    }
+    free(g_sites);
+    g_sites = ns;
+    g_sites_cap = ncap;
+  }
+  size_t j = aster_allocprof_hash((uintptr_t)label) & (g_sites_cap - 1);
+  while (g_sites[j].label && g_sites[j].label != label) j = (j + 1) & (g_sites_cap - 1);
+  if (!g_sites[j].label) {
+    g_sites[j].label = label;
+    g_nsites++;
+  }
+  return (uint32_t)j;
+}
+
+static void aster_allocprof_live_insert_locked(uintptr_t p, const char* label, uint64_t size) {
+  if ((g_live_len + 1) * 2 > g_live_cap) {
+    size_t ncap = g_live_cap ? g_live_cap * 2 : 1024;
+    AsterAllocLive* nl = (AsterAllocLive*)calloc(ncap, sizeof(AsterAllocLive));
+    if (!nl) abort();
+    for (size_t i = 0; i < g_live_cap; i++) {
+      if (!g_live[i].ptr) continue;
+      size_t j = aster_allocprof_hash(g_live[i].ptr) & (ncap - 1);
+      while (nl[j].ptr) j = (j + 1) & (ncap - 1);
+      nl[j] = g_live[i];
+    }
+    free(g_live);
+    g_live = nl;
+    g_live_cap = ncap;
+  }
+  size_t j = aster_allocprof_hash(p) & (g_live_cap - 1);
+  while (g_live[j].ptr && g_live[j].ptr != p) j = (j + 1) & (g_live_cap - 1);
+  if (!g_live[j].ptr) g_live_len++;
+  g_live[j] = (AsterAllocLive){.ptr = p, .label = label, .size = size};
+}
+
+// Remove `p` from the live table (backward-shift deletion keeps probes short).
+static bool aster_allocprof_live_remove_locked(uintptr_t p, AsterAllocLive* out) {
+  if (!g_live_cap) return false;
+  size_t mask = g_live_cap - 1;
+  size_t j = aster_allocprof_hash(p) & mask;
+  while (g_live[j].ptr && g_live[j].ptr != p) j = (j + 1) & mask;
+  if (!g_live[j].ptr) return false;
+  *out = g_live[j];
+  size_t hole = j;
+  size_t k = (j + 1) & mask;
+  while (g_live[k].ptr) {
+    size_t home = aster_allocprof_hash(g_live[k].ptr) & mask;
+    if (((k - home) & mask) >= ((k - hole) & mask)) {
+      g_live[hole] = g_live[k];
+      hole = k;
+    }
+    k = (k + 1) & mask;
+  }
+  g_live[hole].ptr = 0;
+  g_live_len--;
+  return true;
+}
+
+static void aster_allocprof_on_alloc_locked(void* p, uint64_t size, const char* label) {
+  uint32_t s = aster_allocprof_site_locked(label);
+  AsterAllocSite* site = &g_sites[s];
+  site->allocs++;
+  if (!p) {
+    site->nulls++;
+    g_null_allocs++;
+    return;
+  }
+  site->bytes += size;
+  aster_allocprof_live_insert_locked((uintptr_t)p, label, size);
+  site->live += size;
+  if (site->live > site->peak_live) site->peak_live = site->live;
+  g_total_live += size;
+  if (g_total_live > g_total_peak) g_total_peak = g_total_live;
+}
+
+static void aster_allocprof_on_free_locked(uintptr_t p) {
+  AsterAllocLive rec;
+  if (!aster_allocprof_live_remove_locked(p, &rec)) {
+    g_untracked_frees++;
+    return;
+  }
+  AsterAllocSite* site = &g_sites[aster_allocprof_site_locked(rec.label)];
+  site->frees++;
+  site->live -= rec.size;
+  g_total_live -= rec.size;
+}
+
+void* aster_allocprof_malloc(uint64_t size, const char* site) {
+  void* p = malloc((size_t)size);
+  pthread_mutex_lock(&g_lock);
+  aster_allocprof_on_alloc_locked(p, size, site);
+  pthread_mutex_unlock(&g_lock);
+  return p;
+}
+
+void* aster_allocprof_calloc(uint64_t n, uint64_t size, const char* site) {
+  void* p = calloc((size_t)n, (size_t)size);
+  pthread_mutex_lock(&g_lock);
+  aster_allocprof_on_alloc_locked(p, n * size, site);
+  pthread_mutex_unlock(&g_lock);
+  return p;
+}
+
+void* aster_allocprof_realloc(void* old, uint64_t size, const char* site) {
+  // Hold the lock across realloc so a concurrent malloc cannot reuse `old`
+  // before its live record is retired.
+  pthread_mutex_lock(&g_lock);
+  uintptr_t old_addr = (uintptr_t)old;
+  void* p = realloc(old, (size_t)size);
+  if (old_addr && (p || size == 0)) aster_allocprof_on_free_locked(old_addr);
+  aster_allocprof_on_alloc_locked(p, size, site);
+  pthread_mutex_unlock(&g_lock);
+  return p;
+}
+
+void aster_allocprof_free(void* p, const char* site) {
+  if (!p) return;
+  pthread_mutex_lock(&g_lock);
+  (void)site;
+  aster_allocprof_on_free_locked((uintptr_t)p);
+  pthread_mutex_unlock(&g_lock);
+  free(p);
+}
+
+typedef enum { ASTER_SORT_COUNT, ASTER_SORT_BYTES, ASTER_SORT_PEAK } AsterAllocSort;
+static AsterAllocSort g_sort_key;
+
+static uint64_t aster_allocprof_key(const AsterAllocSite* s) {
+  switch (g_sort_key) {
+    case ASTER_SORT_COUNT: return s->allocs;
+    case ASTER_SORT_BYTES: return s->bytes;
+    case ASTER_SORT_PEAK: return s->peak_live;
+  }
+  return 0;
+}
+
+static int aster_allocprof_cmp(const void* a, const void* b) {
+  const AsterAllocSite* x = *(const AsterAllocSite* const*)a;
+  const AsterAllocSite* y = *(const AsterAllocSite* const*)b;
+  uint64_t kx = aster_allocprof_key(x), ky = aster_allocprof_key(y);
+  if (kx != ky) return kx < ky ? 1 : -1;
+  return strcmp(x->label, y->label);
+}
+
+static void aster_allocprof_table(FILE* fp, AsterAllocSite** rows, size_t n, size_t top, AsterAllocSort key,
+                                  const char* title) {
+  g_sort_key = key;
+  qsort(rows, n, sizeof(AsterAllocSite*), aster_allocprof_cmp);
+  fprintf(fp, "top sites by %s:\n", title);
+  fprintf(fp, "%12s %14s %14s %10s  %s\n", "allocs", "bytes", "peak_live", "leaked", "site");
+  for (size_t i = 0; i < n && i < top; i++) {
+    const AsterAllocSite* s = rows[i];
+    fprintf(fp, "%12llu %14llu %14llu %10llu  %s\n", (unsigned long long)s->allocs, (unsigned long long)s->bytes,
+            (unsigned long long)s->peak_live, (unsigned long long)(s->allocs - s->nulls - s->frees), s->label);
+  }
+}
+
+static void aster_allocprof_report(void) {
+  pthread_mutex_lock(&g_lock);
+  size_t n = 0;
+  AsterAllocSite** rows = (AsterAllocSite**)calloc(g_nsites ? g_nsites : 1, sizeof(AsterAllocSite*));
+  if (!rows) {
+    pthread_mutex_unlock(&g_lock);
+    return;
+  }
+  uint64_t allocs = 0, bytes = 0;
+  for (size_t i = 0; i < g_sites_cap; i++) {
+    if (!g_sites[i].label) continue;
+    rows[n++] = &g_sites[i];
+    allocs += g_sites[i].allocs;
+    bytes += g_sites[i].bytes;
+  }
+
+  FILE* fp = stderr;
+  const char* path = getenv("ASTER_ALLOC_PROFILE_OUT");
+  if (path && path[0]) {
+    FILE* f = fopen(path, "w");
+    if (f) fp = f;
+  }
+  size_t top = 15;
+  const char* top_env = getenv("ASTER_ALLOC_PROFILE_TOP");
+  if (top_env && top_env[0]) top = (size_t)strtoull(top_env, NULL, 10);
+
+  fprintf(fp, "aster alloc profile: %zu sites, %llu allocs, %llu bytes, peak live %llu bytes, live at exit %llu bytes\n",
+          n, (unsigned long long)allocs, (unsigned long long)bytes, (unsigned long long)g_total_peak,
+          (unsigned long long)g_total_live);
+  if (g_untracked_frees) {
+    fprintf(fp, "untracked frees (allocated outside profiled sites): %llu\n", (unsigned long long)g_untracked_frees);
+  }
+  if (g_null_allocs) {
+    fprintf(fp, "allocs that returned NULL: %llu\n", (unsigned long long)g_null_allocs);
+  }
+  aster_allocprof_table(fp, rows, n, top, ASTER_SORT_COUNT, "count");
+  aster_allocprof_table(fp, rows, n, top, ASTER_SORT_BYTES, "bytes");
+  aster_allocprof_table(fp, rows, n, top, ASTER_SORT_PEAK, "peak live");
+  if (fp != stderr) fclose(fp);
+  free(rows);
+  pthread_mutex_unlock(&g_lock);
+}
@@ -0,0 +1,51 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Thread-local arena slot for `core.arena` (`arena_tls`).
+//
+// Aster has no thread-local storage of its own, so each thread's scratch
+// arena lives here. The Aster side initializes it lazily on first use; this
+// file only hands out the per-thread block and frees its chunk chain when the
+// thread exits.
+//
+// Auto-linked into Aster binaries that import core.arena.
+
+// Mirrors `struct Arena` in src/core/arena.as.
+typedef struct {
+  uint8_t* base; // current chunk; its first word links to the previous chunk
+  uint64_t cap;
+  uint64_t off;
+  uint64_t chunk;
+  uint64_t nchunks;
+} AsterArena;
+
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_key;
+static __thread AsterArena t_arena;
+static __thread int t_registered;
+
+static void aster_arena_rt_release(void* p) {
+  AsterArena* a = (AsterArena*)p;
+  uint8_t* c = a->base;
+  while (c) {
+    uint8_t* prev = *(uint8_t**)c;
+    free(c);
+    c = prev;
+  }
+  a->base = NULL;
+  a->cap = a->off = a->chunk = a->nchunks = 0;
+}
+
+static void aster_arena_rt_key_init(void) {
+  pthread_key_create(&g_key, aster_arena_rt_release);
+}
+
+AsterArena* aster_arena_tls(void) {
+  if (!t_registered) {
+    t_registered = 1;
+    pthread_once(&g_once, aster_arena_rt_key_init);
+    pthread_setspecific(g_key, &t_arena);
+  }
+  return &t_arena;
+}
@@ -10,7 +10,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #ifdef __APPLE__
@@ -18,7 +20,6 @@
 #include <mach-o/dyld.h>
 #include <sys/attr.h>
 #include <sys/vnode.h>
-#include <time.h>
 #endif
 
 // Reuse the assembly lexer (token kinds are kept in sync with asm/macros/lexer.inc).
@@ -98,6 +99,7 @@ enum {
   TOK_KW_TRUE = 57,
   TOK_KW_FALSE = 58,
   TOK_KW_NOALLOC = 59,
+  TOK_UNKNOWN = 255,
 };
 
 typedef enum {
@@ -171,6 +173,15 @@ typedef struct {
   Type* type;
 } Param;
 
+struct FuncDef;
+
+// A call site recorded for ASTER_REPORT=alloc.
+typedef struct {
+  struct FuncDef* callee;
+  size_t tok;     // token index of the call's `(`
+  int loop_depth; // enclosing `while` nesting at the call
+} CallSite;
+
 typedef struct FuncDef {
   size_t id; // stable index within Compiler.funcs
   const char* name;
@@ -188,8 +199,13 @@ typedef struct FuncDef {
   size_t decl_tok;   // token index for diagnostics (start of decl)
   size_t* calls;     // callee func ids
   size_t call_count, call_cap;
+  CallSite* sites;   // every call, in source order (ASTER_REPORT=alloc only)
+  size_t nsites, capsites;
   size_t body_start; // token index (inclusive), only for defs
   size_t body_end;   // token index (exclusive), only for defs
+  bool has_trace;    // `@trace("probe")` annotation
+  uint32_t trace_probe;
+  bool is_noreturn;  // `@noreturn` annotation, or a libc exit/abort extern
 } FuncDef;
 
 typedef struct {
@@ -222,6 +238,8 @@ typedef struct {
   size_t src_len;
   AsterTok* toks;
   size_t ntoks;
+  uint32_t* line_starts; // offsets of line starts (see line_index_find)
+  size_t nline_starts;
   size_t i; // cursor for module parse
   bool had_error;
 
@@ -248,8 +266,32 @@ typedef struct {
 
   Type** ptr_types; // interner for pointer types
   size_t nptr_types, capptr_types;
+
+  // Codegen options (read from env once per unit).
+  bool frame_pointers; // ASTER_FRAME_POINTERS=1
+  bool trace;          // ASTER_TRACE=1: lower trace probes (otherwise compiled out)
+  bool alloc_profile;  // ASTER_ALLOC_PROFILE=1: route allocator calls through counting shims
+  bool alloc_report;   // ASTER_REPORT=alloc: record call sites, print the static alloc report
+
+  // Trace probe names (deduped; index == probe id).
+  StrConst** trace_probes;
+  size_t ntrace_probes, captrace_probes;
+
+  // Per-call-token side tables (ntoks entries, allocated on first use), so a
+  // call parsed twice (scan_locals pre-pass) is found without a scan.
+  StrConst** alloc_site_of_tok; // ASTER_ALLOC_PROFILE: site label, NULL = none yet
+  uint32_t* call_site_of_tok;   // ASTER_REPORT=alloc: 1 + index in the caller's `sites`
+
+  // Intrinsic support emitted at the end of the module when used.
+  bool uses_fail;    // assert/unreachable: @aster_rt_fail
+  bool uses_assume;  // assume: @llvm.assume
 } Compiler;
 
+typedef struct {
+  uint32_t probe;
+  int start_tmp; // SSA temp holding the cycle counter at scope entry
+} TraceScope;
+
 typedef struct {
   Compiler* c;
   FuncDef* f;
@@ -259,7 +301,12 @@ typedef struct {
   int next_label;
   int loop_cond[32];
   int loop_end[32];
+  bool loop_broken[32];     // a `break` targeted loop_end (makes `while 1` fall through)
+  int loop_trace_depth[32]; // trace_depth at loop entry (break/continue unwind to it)
   int loop_depth;
+  TraceScope trace_scopes[32];
+  int trace_depth;
+  int cold_bb; // conditional branches to this block are marked unlikely (-1: none)
   bool terminated;
 } FuncCtx;
 
@@ -272,6 +319,15 @@ static void* xmalloc(size_t n) {
   return p;
 }
 
+static void* xcalloc(size_t n, size_t size) {
+  void* p = calloc(n ? n : 1, size);
+  if (!p) {
+    fprintf(stderr, "asterc: OOM\n");
+    exit(1);
+  }
+  return p;
+}
+
 static void* xrealloc(void* p, size_t n) {
   void* q = realloc(p, n);
   if (!q) {
@@ -311,44 +367,39 @@ static bool accept(Compiler* c, uint32_t kind) {
   return true;
 }
 
-static void compute_line_col(const uint8_t* src, size_t src_len, size_t off, size_t* out_line, size_t* out_col) {
-  if (off > src_len) off = src_len;
-  size_t line = 1;
-  size_t col = 1;
-  for (size_t i = 0; i < off; i++) {
-    if (src[i] == '\n') {
-      line++;
-      col = 1;
-    } else {
-      col++;
-    }
+// Line index: sorted byte offsets of every line start in the unit (built once
+// by lex_unit). 0-based line containing `off`, by binary search.
+static size_t line_index_find(const Compiler* c, size_t off) {
+  size_t lo = 0, hi = c->nline_starts; // invariant: line_starts[lo] <= off
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (c->line_starts[mid] <= off) lo = mid;
+    else hi = mid;
   }
-  *out_line = line;
-  *out_col = col;
+  return lo;
 }
 
-static void compute_line_col_from(const uint8_t* src, size_t src_len, size_t base_off, size_t off, size_t* out_line,
-                                  size_t* out_col) {
-  if (base_off > src_len) base_off = src_len;
-  if (off > src_len) off = src_len;
+// 1-based (line, col) of `off`, counted from `base_off` (a line start: 0 for the
+// unit, or a module's unit_start).
+static void line_index_lookup(const Compiler* c, size_t base_off, size_t off, size_t* out_line, size_t* out_col) {
+  if (base_off > c->src_len) base_off = c->src_len;
+  if (off > c->src_len) off = c->src_len;
   if (off < base_off) off = base_off;
-  size_t line = 1;
-  size_t col = 1;
-  for (size_t i = base_off; i < off; i++) {
-    if (src[i] == '\n') {
-      line++;
-      col = 1;
-    } else {
-      col++;
-    }
+  if (!c->nline_starts) { // before lex_unit: single-line view
+    *out_line = 1;
+    *out_col = off - base_off + 1;
+    return;
   }
-  *out_line = line;
-  *out_col = col;
+  size_t li = line_index_find(c, off);
+  *out_line = li - line_index_find(c, base_off) + 1;
+  *out_col = off - c->line_starts[li] + 1;
 }
 
-static void error_at_tok(Compiler* c, const AsterTok* t, const char* fmt, ...) {
-  c->had_error = true;
-  size_t line = 1, col = 1;
+
+// Source location of a token: module-relative when the unit carries module
+// markers (`*out_file` set), unit-relative otherwise (`*out_file` = NULL).
+static void tok_location(const Compiler* c, const AsterTok* t, const char** out_file, size_t* out_line,
+                         size_t* out_col) {
   size_t off = t ? (size_t)t->start : 0;
   const char* file = NULL;
   size_t base = 0;
@@ -357,11 +408,18 @@ static void error_at_tok(Compiler* c, const AsterTok* t, const char* fmt, ...) {
     file = c->mods[mod_id].rel_path;
     base = c->mods[mod_id].unit_start;
   }
+  line_index_lookup(c, base, off, out_line, out_col);
+  *out_file = file;
+}
+
+static void error_at_tok(Compiler* c, const AsterTok* t, const char* fmt, ...) {
+  c->had_error = true;
+  size_t line = 1, col = 1;
+  const char* file = NULL;
+  tok_location(c, t, &file, &line, &col);
   if (file) {
-    compute_line_col_from(c->src, c->src_len, base, off, &line, &col);
     fprintf(stderr, "asterc: %s:%zu:%zu: ", file, line, col);
   } else {
-    compute_line_col(c->src, c->src_len, off, &line, &col);
     fprintf(stderr, "asterc: error:%zu:%zu: ", line, col);
   }
   va_list ap;
@@ -553,6 +611,18 @@ static bool is_known_nonalloc_extern(const char* name, size_t name_len) {
          str_eq(name, name_len, "clock_gettime") || str_eq(name, name_len, "getenv") || str_eq(name, name_len, "atoi");
 }
 
+// core.arena entry points that only touch an existing arena. Called on an arena
+// the caller passed in, they are charged to the arena's owner, so `noalloc`
+// code may use them (arena_init/arena_reset/arena_tls still allocate).
+static bool is_arena_scoped_fn(const Compiler* c, const FuncDef* fn) {
+  if (fn->id == (size_t)-1 || !c->mods || fn->module_id >= c->nfile_mods) return false;
+  const ModInfo* m = &c->mods[fn->module_id];
+  if (!m->name || !str_eq(m->name, m->name_len, "core.arena")) return false;
+  return str_eq(fn->name, fn->name_len, "arena_alloc") || str_eq(fn->name, fn->name_len, "arena_alloc_zeroed") ||
+         str_eq(fn->name, fn->name_len, "arena_mark") || str_eq(fn->name, fn->name_len, "arena_reset_to") ||
+         str_eq(fn->name, fn->name_len, "arena_used");
+}
+
 static void record_call(FuncDef* caller, FuncDef* callee) {
   if (!caller || !callee) return;
   // Avoid degenerate growth if a file contains repeated calls to the same callee.
@@ -566,10 +636,166 @@ static void record_call(FuncDef* caller, FuncDef* callee) {
   caller->calls[caller->call_count++] = callee->id;
 }
 
+static void record_call_site(Compiler* c, FuncDef* caller, FuncDef* callee, size_t tok, int loop_depth) {
+  if (!caller || !callee || tok >= c->ntoks) return;
+  // The local type-inference pre-pass (scan_locals) parses initializers once
+  // outside any loop; keep the deepest nesting seen for a given call token.
+  if (!c->call_site_of_tok) c->call_site_of_tok = (uint32_t*)xcalloc(c->ntoks, sizeof(uint32_t));
+  uint32_t seen = c->call_site_of_tok[tok];
+  if (seen) {
+    CallSite* s = &caller->sites[seen - 1];
+    if (loop_depth > s->loop_depth) s->loop_depth = loop_depth;
+    return;
+  }
+  if (caller->nsites == caller->capsites) {
+    caller->capsites = caller->capsites ? caller->capsites * 2 : 16;
+    caller->sites = (CallSite*)xrealloc(caller->sites, caller->capsites * sizeof(CallSite));
+  }
+  caller->sites[caller->nsites++] = (CallSite){.callee = callee, .tok = tok, .loop_depth = loop_depth};
+  c->call_site_of_tok[tok] = (uint32_t)caller->nsites;
+}
+
+static void report_func_name(const Compiler* c, FILE* fp, const FuncDef* f) {
+  if (c->mods && f->module_id < c->nfile_mods && c->mods[f->module_id].name) {
+    fprintf(fp, "%s.", c->mods[f->module_id].name);
+  }
+  fprintf(fp, "%.*s", (int)f->name_len, f->name);
+}
+
+static void report_callee_name(const Compiler* c, FILE* fp, const FuncDef* callee) {
+  if (callee->id < c->nfuncs) report_func_name(c, fp, callee);
+  else fprintf(fp, "%.*s", (int)callee->name_len, callee->name); // builtin (calloc/memcpy)
+}
+
+static void report_site_loc(const Compiler* c, FILE* fp, const CallSite* s) {
+  const AsterTok* t = &c->toks[s->tok];
+  if (s->tok > 0 && c->toks[s->tok - 1].kind == TOK_IDENT) t = &c->toks[s->tok - 1];
+  const char* file = NULL;
+  size_t line = 1, col = 1;
+  tok_location(c, t, &file, &line, &col);
+  fprintf(fp, "%s:%zu:%zu", file ? file : "<unit>", line, col);
+}
+
+// A site allocates if it calls an allocator directly or calls something that may.
+static bool site_allocates(const CallSite* s, const bool* may_alloc, size_t n) {
+  if (is_known_alloc_fn(s->callee->name, s->callee->name_len)) return true;
+  return s->callee->id < n && may_alloc[s->callee->id];
+}
+
+typedef struct {
+  const FuncDef* f;
+  const CallSite* s;
+} HotSite;
+
+static int hot_site_cmp(const void* a, const void* b) {
+  const HotSite* x = (const HotSite*)a;
+  const HotSite* y = (const HotSite*)b;
+  if (x->s->loop_depth != y->s->loop_depth) return x->s->loop_depth < y->s->loop_depth ? 1 : -1;
+  if (x->f->id != y->f->id) return x->f->id < y->f->id ? -1 : 1;
+  return x->s->tok < y->s->tok ? -1 : (x->s->tok > y->s->tok);
+}
+
+// ASTER_REPORT=alloc: deterministic text report built from the noalloc call
+// graph. `via[id]` is the callee that made `id` may-alloc during the fixpoint
+// (n for roots), so following it always terminates at a direct allocator or a
+// non-whitelisted extern.
+static void report_alloc(const Compiler* c, FILE* fp, const bool* may_alloc, const size_t* via) {
+  const size_t n = c->nfuncs;
+  size_t ndefs = 0, nalloc = 0, nsites = 0, nhot = 0;
+  for (size_t i = 0; i < n; i++) {
+    const FuncDef* f = c->funcs[i];
+    if (f->is_extern) continue;
+    ndefs++;
+    if (may_alloc[f->id]) nalloc++;
+    for (size_t j = 0; j < f->nsites; j++) {
+      if (!site_allocates(&f->sites[j], may_alloc, n)) continue;
+      nsites++;
+      if (f->sites[j].loop_depth > 0) nhot++;
+    }
+  }
+  fprintf(fp, "aster_alloc_report v1\n");
+  fprintf(fp, "funcs %zu may_alloc %zu alloc_sites %zu in_loops %zu\n", ndefs, nalloc, nsites, nhot);
+
+  HotSite* hot = (HotSite*)xmalloc((nhot ? nhot : 1) * sizeof(HotSite));
+  size_t nh = 0;
+  for (size_t i = 0; i < n; i++) {
+    const FuncDef* f = c->funcs[i];
+    if (f->is_extern) continue;
+    fprintf(fp, "func ");
+    report_func_name(c, fp, f);
+    fprintf(fp, " may_alloc=%d noalloc=%d", (int)may_alloc[f->id], (int)f->is_noalloc);
+    if (may_alloc[f->id]) {
+      fprintf(fp, " chain=");
+      const FuncDef* g = f;
+      for (size_t hops = 0; hops <= n; hops++) {
+        report_func_name(c, fp, g);
+        if (via[g->id] >= n) break;
+        fprintf(fp, " -> ");
+        g = c->funcs[via[g->id]];
+      }
+      if (g->is_extern) {
+        fprintf(fp, " (extern)");
+      } else {
+        for (size_t j = 0; j < g->nsites; j++) {
+          const FuncDef* callee = g->sites[j].callee;
+          if (!is_known_alloc_fn(callee->name, callee->name_len)) continue;
+          fprintf(fp, " -> %.*s", (int)callee->name_len, callee->name);
+          break;
+        }
+      }
+    }
+    fputc('\n', fp);
+    for (size_t j = 0; j < f->nsites; j++) {
+      const CallSite* s = &f->sites[j];
+      if (!site_allocates(s, may_alloc, n)) continue;
+      fprintf(fp, "  site ");
+      report_site_loc(c, fp, s);
+      fprintf(fp, " callee=");
+      report_callee_name(c, fp, s->callee);
+      const char* kind = "call";
+      if (is_known_alloc_fn(s->callee->name, s->callee->name_len)) kind = "alloc";
+      else if (s->callee->is_extern) kind = "extern";
+      fprintf(fp, " kind=%s loop_depth=%d\n", kind, s->loop_depth);
+      if (s->loop_depth > 0) hot[nh++] = (HotSite){.f = f, .s = s};
+    }
+  }
+
+  qsort(hot, nh, sizeof(HotSite), hot_site_cmp);
+  fprintf(fp, "hot_sites %zu\n", nh);
+  for (size_t i = 0; i < nh; i++) {
+    fprintf(fp, "  loop_depth=%d ", hot[i].s->loop_depth);
+    report_site_loc(c, fp, hot[i].s);
+    fprintf(fp, " in ");
+    report_func_name(c, fp, hot[i].f);
+    fprintf(fp, " calls ");
+    report_callee_name(c, fp, hot[i].s->callee);
+    fputc('\n', fp);
+  }
+  free(hot);
+
+  size_t ncand = 0;
+  for (size_t i = 0; i < n; i++) {
+    const FuncDef* f = c->funcs[i];
+    if (!f->is_extern && !f->is_noalloc && !may_alloc[f->id]) ncand++;
+  }
+  fprintf(fp, "noalloc_candidates %zu\n", ncand);
+  for (size_t i = 0; i < n; i++) {
+    const FuncDef* f = c->funcs[i];
+    if (f->is_extern || f->is_noalloc || may_alloc[f->id]) continue;
+    fprintf(fp, "  ");
+    report_func_name(c, fp, f);
+    fputc('\n', fp);
+  }
+}
+
+static FILE* open_dump(const char* env_name, bool* out_should_close);
+
 static void analyze_noalloc(Compiler* c) {
   const size_t n = c->nfuncs;
-  bool* may_alloc = (bool*)xmalloc(n);
+  bool* may_alloc = (bool*)xmalloc(n ? n : 1);
   memset(may_alloc, 0, n);
+  size_t* via = (size_t*)xmalloc((n ? n : 1) * sizeof(size_t));
+  for (size_t i = 0; i < n; i++) via[i] = n;
 
   for (size_t i = 0; i < n; i++) {
     FuncDef* f = c->funcs[i];
@@ -593,6 +819,7 @@ static void analyze_noalloc(Compiler* c) {
         size_t cid = f->calls[j];
         if (cid < n && may_alloc[cid]) {
           may_alloc[f->id] = true;
+          via[f->id] = cid;
           changed = true;
           break;
         }
@@ -607,6 +834,15 @@ static void analyze_noalloc(Compiler* c) {
     }
   }
 
+  if (c->alloc_report) {
+    bool close_fp = false;
+    FILE* fp = open_dump("ASTER_REPORT_OUT", &close_fp);
+    if (!fp) fp = stderr;
+    report_alloc(c, fp, may_alloc, via);
+    if (close_fp) fclose(fp);
+  }
+
+  free(via);
   free(may_alloc);
 }
 
@@ -686,12 +922,6 @@ static bool builtin_const(const char* name, size_t name_len, Type** out_ty, uint
     return true;
   }
 
-  if (str_eq(name, name_len, "CLOCK_MONOTONIC")) {
-    *out_ty = ty_i32();
-    *out_u = (uint64_t)CLOCK_MONOTONIC;
-    return true;
-  }
-
   if (str_eq(name, name_len, "FTS_NOCHDIR")) {
     *out_ty = ty_i32();
     *out_u = (uint64_t)FTS_NOCHDIR;
@@ -728,6 +958,11 @@ static bool builtin_const(const char* name, size_t name_len, Type** out_ty, uint
     return true;
   }
 #endif
+  if (str_eq(name, name_len, "CLOCK_MONOTONIC")) {
+    *out_ty = ty_i32();
+    *out_u = (uint64_t)CLOCK_MONOTONIC;
+    return true;
+  }
   (void)name;
   (void)name_len;
   (void)out_ty;
@@ -1181,6 +1416,10 @@ static bool is_varargs_name(const char* name, size_t name_len) {
   return str_eq(name, name_len, "printf") || str_eq(name, name_len, "open") || str_eq(name, name_len, "openat");
 }
 
+static bool is_noreturn_name(const char* name, size_t name_len) {
+  return str_eq(name, name_len, "exit") || str_eq(name, name_len, "_exit") || str_eq(name, name_len, "abort");
+}
+
 static bool parse_extern_decl(Compiler* c) {
   size_t decl_tok = c->i;
   uint32_t mod_id = (decl_tok < c->ntoks) ? c->toks[decl_tok]._pad : 0;
@@ -1220,14 +1459,81 @@ static bool parse_extern_decl(Compiler* c) {
   f->param_count = nparams;
   f->is_extern = true;
   f->is_varargs = is_varargs_name(name, name_len);
+  f->is_noreturn = is_noreturn_name(name, name_len);
   f->decl_tok = decl_tok;
   push_func(c, f);
   return true;
 }
 
+static bool tok_is_at_sign(const Compiler* c, const AsterTok* t) {
+  return t->kind == TOK_UNKNOWN && tok_len(t) == 1 && tok_ptr(c, t)[0] == '@';
+}
+
+// Probe ids are shared by name across the unit, so the same `trace "x"` in
+// several places accumulates into one row.
+static uint32_t trace_probe_id(Compiler* c, const uint8_t* name, size_t len) {
+  for (size_t i = 0; i < c->ntrace_probes; i++) {
+    StrConst* p = c->trace_probes[i];
+    if (p->len == len && memcmp(p->bytes, name, len) == 0) return (uint32_t)i;
+  }
+  if (c->ntrace_probes == c->captrace_probes) {
+    c->captrace_probes = c->captrace_probes ? c->captrace_probes * 2 : 16;
+    c->trace_probes = (StrConst**)xrealloc(c->trace_probes, c->captrace_probes * sizeof(StrConst*));
+  }
+  c->trace_probes[c->ntrace_probes] = new_str_const(c, name, len);
+  return (uint32_t)c->ntrace_probes++;
+}
+
+// `@trace("probe")` or `@noreturn` on its own line before `def`. When
+// ASTER_TRACE is off the trace annotation is parsed and dropped.
+static bool parse_def_annotation(Compiler* c, bool* has_trace, uint32_t* trace_probe, bool* is_noreturn) {
+  AsterTok* at = cur(c);
+  c->i++;
+  if (cur(c)->kind == TOK_IDENT && str_eq(tok_ptr(c, cur(c)), tok_len(cur(c)), "noreturn")) {
+    c->i++;
+    if (!expect(c, TOK_NEWLINE, "newline")) return false;
+    skip_newlines(c);
+    *is_noreturn = true;
+    return true;
+  }
+  if (cur(c)->kind != TOK_IDENT || !str_eq(tok_ptr(c, cur(c)), tok_len(cur(c)), "trace")) {
+    error_at_tok(c, at, "unknown annotation (expected `@trace(\"name\")` or `@noreturn`)");
+    return false;
+  }
+  c->i++;
+  if (!expect(c, TOK_LPAREN, "`(`")) return false;
+  AsterTok* name_tok = cur(c);
+  uint8_t* bytes = NULL;
+  size_t blen = 0;
+  if (name_tok->kind != TOK_STRING || !unescape_string(tok_ptr(c, name_tok), tok_len(name_tok), &bytes, &blen)) {
+    error_at_tok(c, name_tok, "expected probe name string in `@trace(...)`");
+    return false;
+  }
+  c->i++;
+  if (!expect(c, TOK_RPAREN, "`)`")) {
+    free(bytes);
+    return false;
+  }
+  if (!expect(c, TOK_NEWLINE, "newline")) {
+    free(bytes);
+    return false;
+  }
+  skip_newlines(c);
+  *has_trace = c->trace;
+  if (c->trace) *trace_probe = trace_probe_id(c, bytes, blen);
+  free(bytes);
+  return true;
+}
+
 static bool parse_def_decl(Compiler* c) {
   size_t decl_tok = c->i;
   uint32_t mod_id = (decl_tok < c->ntoks) ? c->toks[decl_tok]._pad : 0;
+  bool has_trace = false;
+  uint32_t trace_probe = 0;
+  bool is_noreturn = false;
+  while (tok_is_at_sign(c, cur(c))) {
+    if (!parse_def_annotation(c, &has_trace, &trace_probe, &is_noreturn)) return false;
+  }
   bool is_noalloc = accept(c, TOK_KW_NOALLOC);
   if (!expect(c, TOK_KW_DEF, "`def`")) return false;
   if (cur(c)->kind != TOK_IDENT) {
@@ -1247,6 +1553,10 @@ static bool parse_def_decl(Compiler* c) {
     if (!parse_type(c, &ret)) return false;
   }
 
+  if (is_noreturn && ret->kind != TY_VOID) {
+    error_at_tok(c, &c->toks[decl_tok], "`@noreturn` function must return `()`");
+    return false;
+  }
   if (!expect(c, TOK_NEWLINE, "newline")) return false;
   if (!expect(c, TOK_INDENT, "indent")) return false;
 
@@ -1276,6 +1586,9 @@ static bool parse_def_decl(Compiler* c) {
   f->decl_tok = decl_tok;
   f->body_start = body_start;
   f->body_end = body_end;
+  f->has_trace = has_trace;
+  f->trace_probe = trace_probe;
+  f->is_noreturn = is_noreturn;
   push_func(c, f);
   accept(c, TOK_NEWLINE);
   return true;
@@ -1508,6 +1821,185 @@ static void assign_tok_modules(Compiler* c) {
   }
 }
 
+// Parallel front-end lexing.
+//
+// Module boundaries are known before lexing (compiler_scan_unit_meta) and every
+// module body starts at column 0 right after its `# --- module:` marker, so each
+// [unit_start, next unit_start) slice lexes independently: indentation closes
+// at the slice end exactly as it would at the next module's first line. Workers
+// lex slices, rebase offsets, tag tokens with their module id, and count
+// top-level declarations; the main thread concatenates the slices in order.
+//
+// Parsing itself stays serial (it interns types/strings into shared tables);
+// the per-module declaration counts only pre-size the declaration arrays.
+//
+// ASTER_LEX_THREADS=<n> caps the worker count (1 = serial).
+
+enum {
+  LEX_PARALLEL_MIN_BYTES = 64 * 1024, // below this, thread startup dominates
+  LEX_MAX_THREADS = 16,
+};
+
+typedef struct {
+  const uint8_t* src;
+  size_t start, end; // byte range in the unit
+  uint32_t mod_id;
+  AsterTok* toks;    // includes the slice's trailing EOF
+  size_t ntoks;
+  uint32_t* lines;   // line starts after each '\n' in the slice
+  size_t nlines;
+  size_t ndefs, nstructs, nconsts;
+} LexSlice;
+
+// Append the offset after every '\n' in src[start:end) (memchr is the
+// vectorized newline scan).
+static void scan_line_starts(const uint8_t* src, size_t start, size_t end, uint32_t** io_arr, size_t* io_n,
+                             size_t* io_cap) {
+  const uint8_t* p = src + start;
+  const uint8_t* e = src + end;
+  while (p < e) {
+    const uint8_t* nl = (const uint8_t*)memchr(p, '\n', (size_t)(e - p));
+    if (!nl) break;
+    if (*io_n == *io_cap) {
+      *io_cap = *io_cap ? *io_cap * 2 : 1024;
+      *io_arr = (uint32_t*)xrealloc(*io_arr, *io_cap * sizeof(uint32_t));
+    }
+    (*io_arr)[(*io_n)++] = (uint32_t)(nl + 1 - src);
+    p = nl + 1;
+  }
+}
+
+typedef struct {
+  LexSlice* slices;
+  size_t nslices;
+  size_t next; // atomic work cursor
+} LexJob;
+
+static void lex_slice(LexSlice* sl) {
+  lex_all(sl->src + sl->start, sl->end - sl->start, &sl->toks, &sl->ntoks);
+  size_t cap = 0;
+  scan_line_starts(sl->src, sl->start, sl->end, &sl->lines, &sl->nlines, &cap);
+  int depth = 0;
+  bool line_start = true;
+  for (size_t i = 0; i < sl->ntoks; i++) {
+    AsterTok* t = &sl->toks[i];
+    t->start += (uint32_t)sl->start;
+    t->end += (uint32_t)sl->start;
+    t->_pad = sl->mod_id;
+    uint32_t k = t->kind;
+    if (k == TOK_INDENT) depth++;
+    else if (k == TOK_DEDENT) depth--;
+    else if (depth == 0 && line_start) {
+      if (k == TOK_KW_DEF || k == TOK_KW_EXTERN) sl->ndefs++;
+      else if (k == TOK_KW_STRUCT) sl->nstructs++;
+      else if (k == TOK_KW_CONST) sl->nconsts++;
+    }
+    line_start = (k == TOK_NEWLINE || k == TOK_INDENT || k == TOK_DEDENT);
+  }
+}
+
+static void* lex_worker(void* arg) {
+  LexJob* job = (LexJob*)arg;
+  for (;;) {
+    size_t i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+    if (i >= job->nslices) break;
+    lex_slice(&job->slices[i]);
+  }
+  return NULL;
+}
+
+static size_t lex_thread_count(size_t nslices) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  const char* v = getenv("ASTER_LEX_THREADS");
+  if (v && v[0]) n = atol(v);
+  if (n < 1) n = 1;
+  if (n > LEX_MAX_THREADS) n = LEX_MAX_THREADS;
+  if ((size_t)n > nslices) n = (long)nslices;
+  return (size_t)n;
+}
+
+static void reserve_decls(Compiler* c, size_t ndefs, size_t nstructs, size_t nconsts) {
+  if (ndefs > c->capfuncs) {
+    c->capfuncs = ndefs;
+    c->funcs = (FuncDef**)xrealloc(c->funcs, c->capfuncs * sizeof(FuncDef*));
+  }
+  // Builtin structs are already registered.
+  if (c->nstructs + nstructs > c->capstructs) {
+    c->capstructs = c->nstructs + nstructs;
+    c->structs = (StructDef**)xrealloc(c->structs, c->capstructs * sizeof(StructDef*));
+  }
+  if (nconsts > c->capconsts) {
+    c->capconsts = nconsts;
+    c->consts = (ConstDef**)xrealloc(c->consts, c->capconsts * sizeof(ConstDef*));
+  }
+}
+
+// Lex the whole unit into c->toks with module ids assigned (replaces
+// lex_all + assign_tok_modules), and build the line index.
+static bool lex_unit(Compiler* c) {
+  size_t nslices = c->nfile_mods;
+  size_t nthreads = lex_thread_count(nslices);
+  if (nslices < 2 || nthreads < 2 || c->src_len < LEX_PARALLEL_MIN_BYTES) {
+    if (!lex_all(c->src, c->src_len, &c->toks, &c->ntoks)) return false;
+    assign_tok_modules(c);
+    size_t cap = 1;
+    c->line_starts = (uint32_t*)xmalloc(sizeof(uint32_t));
+    c->line_starts[0] = 0;
+    c->nline_starts = 1;
+    scan_line_starts(c->src, 0, c->src_len, &c->line_starts, &c->nline_starts, &cap);
+    return true;
+  }
+
+  LexSlice* slices = (LexSlice*)xmalloc(nslices * sizeof(LexSlice));
+  memset(slices, 0, nslices * sizeof(LexSlice));
+  for (size_t i = 0; i < nslices; i++) {
+    slices[i].src = c->src;
+    slices[i].start = i == 0 ? 0 : c->mods[i].unit_start;
+    slices[i].end = (i + 1 < nslices) ? c->mods[i + 1].unit_start : c->src_len;
+    slices[i].mod_id = (uint32_t)i;
+  }
+
+  LexJob job = {.slices = slices, .nslices = nslices, .next = 0};
+  pthread_t tids[LEX_MAX_THREADS];
+  size_t nspawned = 0;
+  for (size_t i = 1; i < nthreads; i++) {
+    if (pthread_create(&tids[nspawned], NULL, lex_worker, &job) != 0) break;
+    nspawned++;
+  }
+  lex_worker(&job);
+  for (size_t i = 0; i < nspawned; i++) pthread_join(tids[i], NULL);
+
+  // Concatenate, dropping every slice's EOF except the last.
+  size_t total = 1, nlines = 1, ndefs = 0, nstructs = 0, nconsts = 0;
+  for (size_t i = 0; i < nslices; i++) {
+    total += slices[i].ntoks - 1;
+    nlines += slices[i].nlines;
+    ndefs += slices[i].ndefs;
+    nstructs += slices[i].nstructs;
+    nconsts += slices[i].nconsts;
+  }
+  AsterTok* toks = (AsterTok*)xmalloc(total * sizeof(AsterTok));
+  uint32_t* lines = (uint32_t*)xmalloc(nlines * sizeof(uint32_t));
+  size_t n = 0, nl = 0;
+  lines[nl++] = 0;
+  for (size_t i = 0; i < nslices; i++) {
+    size_t keep = (i + 1 < nslices) ? slices[i].ntoks - 1 : slices[i].ntoks;
+    memcpy(toks + n, slices[i].toks, keep * sizeof(AsterTok));
+    n += keep;
+    if (slices[i].nlines) memcpy(lines + nl, slices[i].lines, slices[i].nlines * sizeof(uint32_t));
+    nl += slices[i].nlines;
+    free(slices[i].toks);
+    free(slices[i].lines);
+  }
+  c->line_starts = lines;
+  c->nline_starts = nl;
+  free(slices);
+  c->toks = toks;
+  c->ntoks = n;
+  reserve_decls(c, ndefs, nstructs, nconsts);
+  return true;
+}
+
 static bool is_mangle_ident_char(char c) {
   return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || (c == '_');
 }
@@ -1980,6 +2472,8 @@ static Value parse_primary(FuncCtx* f, size_t* io_i) {
         uint32_t imp = m->use_ids[ui];
         FuncDef* ff = find_func_in_mod(c, imp, name, name_len);
         if (!ff) continue;
+        // Two imports declaring the same C symbol are not ambiguous.
+        if (fn && fn->is_extern && ff->is_extern) continue;
         if (fn && ff != fn) {
           error_at_tok(c, t, "ambiguous identifier (func) across imported modules");
           return (Value){.type = ty_i32(), .kind = V_CONST_INT, .v.u = 0};
@@ -2026,6 +2520,60 @@ static Value parse_primary(FuncCtx* f, size_t* io_i) {
   return (Value){.type = ty_i32(), .kind = V_CONST_INT, .v.u = 0};
 }
 
+// ASTER_ALLOC_PROFILE: allocator calls become calls to
+// `aster_allocprof_<fn>(args..., ptr site)` (see alloc_prof_rt.c), where `site`
+// is a static "file:line:col caller fn" label. Sites are keyed by call token
+// so the type-inference pre-pass in scan_locals does not duplicate them.
+static bool is_alloc_profile_fn(const FuncDef* fn) {
+  if (!fn->is_extern && fn->id != (size_t)-1) return false;
+  return str_eq(fn->name, fn->name_len, "malloc") || str_eq(fn->name, fn->name_len, "calloc") ||
+         str_eq(fn->name, fn->name_len, "realloc") || str_eq(fn->name, fn->name_len, "free");
+}
+
+static StrConst* alloc_site_label(FuncCtx* f, size_t call_tok, const FuncDef* callee) {
+  Compiler* c = f->c;
+  if (!c->alloc_site_of_tok) c->alloc_site_of_tok = (StrConst**)xcalloc(c->ntoks, sizeof(StrConst*));
+  if (c->alloc_site_of_tok[call_tok]) return c->alloc_site_of_tok[call_tok];
+  const char* file = NULL;
+  size_t line = 1, col = 1;
+  // Point at the callee name rather than the `(`.
+  const AsterTok* t = &c->toks[call_tok];
+  if (call_tok > 0 && c->toks[call_tok - 1].kind == TOK_IDENT) t = &c->toks[call_tok - 1];
+  tok_location(c, t, &file, &line, &col);
+  char buf[512];
+  int n = snprintf(buf, sizeof(buf), "%s:%zu:%zu %.*s %.*s", file ? file : "<unit>", line, col, (int)f->f->name_len,
+                   f->f->name, (int)callee->name_len, callee->name);
+  if (n < 0) n = 0;
+  if ((size_t)n >= sizeof(buf)) n = (int)sizeof(buf) - 1;
+  buf[n] = 0;
+  StrConst* sc = new_str_const(c, (const uint8_t*)buf, (size_t)n + 1);
+  c->alloc_site_of_tok[call_tok] = sc;
+  return sc;
+}
+
+static void emit_alloc_profile_decls(Compiler* c) {
+  if (!c->alloc_profile) return;
+  fprintf(c->out, "declare noalias ptr @aster_allocprof_malloc(i64, ptr)\n");
+  fprintf(c->out, "declare noalias ptr @aster_allocprof_calloc(i64, i64, ptr)\n");
+  fprintf(c->out, "declare ptr @aster_allocprof_realloc(ptr, i64, ptr)\n");
+  fprintf(c->out, "declare void @aster_allocprof_free(ptr, ptr)\n");
+}
+
+// True if any identifier in toks[start:end) names a parameter of the current
+// function (and is not shadowed by a local): the value is caller-provided.
+static bool tokens_use_param(FuncCtx* f, size_t start, size_t end) {
+  Compiler* c = f->c;
+  for (size_t j = start; j < end; j++) {
+    const AsterTok* t = &c->toks[j];
+    if (t->kind != TOK_IDENT) continue;
+    const char* name = tok_ptr(c, t);
+    size_t name_len = tok_len(t);
+    if (find_local(f, name, name_len)) continue;
+    if (find_param(f->f, name, name_len) >= 0) return true;
+  }
+  return false;
+}
+
 static Value parse_postfix(FuncCtx* f, size_t* io_i, Value base) {
   Compiler* c = f->c;
   size_t i = *io_i;
@@ -2038,9 +2586,11 @@ static Value parse_postfix(FuncCtx* f, size_t* io_i, Value base) {
       i++; // '('
       Value args[32];
       size_t nargs = 0;
+      size_t arg0_start = i, arg0_end = i;
       if (c->toks[i].kind != TOK_RPAREN) {
         for (;;) {
           Value a = parse_expr(f, &i, 1);
+          if (nargs == 0) arg0_end = i;
           if (nargs >= 32) {
             error_at_tok(c, &c->toks[call_i], "too many call arguments");
             break;
@@ -2056,9 +2606,12 @@ static Value parse_postfix(FuncCtx* f, size_t* io_i, Value base) {
       if (c->toks[i].kind == TOK_RPAREN) i++;
 
       FuncDef* fn = base.v.fn;
+      if (c->alloc_report) record_call_site(c, f->f, fn, call_i, f->loop_depth);
       // Record call graph edges for `noalloc` analysis.
       if (is_known_alloc_fn(fn->name, fn->name_len)) {
         f->f->direct_alloc = true;
+      } else if (is_arena_scoped_fn(c, fn) && tokens_use_param(f, arg0_start, arg0_end)) {
+        // Arena allocation from a caller-provided arena: not an edge.
       } else if (fn->id != (size_t)-1) {
         record_call(f->f, fn);
       }
@@ -2103,6 +2656,36 @@ static Value parse_postfix(FuncCtx* f, size_t* io_i, Value base) {
         if (nargs >= 3) args[2] = cast_to(f, ty_i64(), args[2]);
       }
 
+      if (c->alloc_profile && is_alloc_profile_fn(fn)) {
+        StrConst* site = alloc_site_label(f, call_i, fn);
+        bool is_free = str_eq(fn->name, fn->name_len, "free");
+        bool is_realloc = str_eq(fn->name, fn->name_len, "realloc");
+        for (size_t ai = 0; ai < nargs; ai++) {
+          bool ptr_arg = (is_free || is_realloc) && ai == 0;
+          args[ai] = load_if_needed(f, cast_to(f, ptr_arg ? ptr_to(c, ty_void(), true) : ty_i64(), args[ai]));
+        }
+        int t = -1;
+        fprintf(c->out, "  ");
+        if (!is_free) {
+          t = new_temp(f);
+          emit_ssa(c->out, 't', t);
+          fprintf(c->out, " = call ptr");
+        } else {
+          fprintf(c->out, "call void");
+        }
+        fprintf(c->out, " @aster_allocprof_%.*s(", (int)fn->name_len, fn->name);
+        for (size_t ai = 0; ai < nargs; ai++) {
+          fprintf(c->out, "%s ", llvm_ty(args[ai].type));
+          emit_value(c->out, args[ai]);
+          fprintf(c->out, ", ");
+        }
+        fprintf(c->out, "ptr @.str%zu)\n", site->id);
+        if (t >= 0) base = cast_to(f, ret, (Value){.type = ptr_to(c, ty_void(), true), .kind = V_SSA_TEMP, .v.id = t});
+        else base = (Value){.type = ret, .kind = V_CONST_INT, .v.u = 0};
+        base.is_lvalue = false;
+        continue;
+      }
+
       int t = -1;
       if (ret->kind != TY_VOID) t = new_temp(f);
       fprintf(c->out, "  ");
@@ -2136,6 +2719,11 @@ static Value parse_postfix(FuncCtx* f, size_t* io_i, Value base) {
         emit_value(c->out, args[ai]);
       }
       fprintf(c->out, ")\n");
+      if (fn->is_noreturn) {
+        // Anything the caller emits after this lands in a fresh dead block.
+        fprintf(c->out, "  unreachable\n");
+        emit_label(c->out, new_label(f));
+      }
       if (t >= 0) base = (Value){.type = ret, .kind = V_SSA_TEMP, .v.id = t};
       else base = (Value){.type = ret, .kind = V_CONST_INT, .v.u = 0};
       base.is_lvalue = false;
@@ -2648,7 +3236,15 @@ static void emit_cond_atom(FuncCtx* f, size_t* io_i, int true_bb, int false_bb)
   v = cast_to(f, ty_bool(), v);
   fprintf(c->out, "  br i1 ");
   emit_value(c->out, v);
-  fprintf(c->out, ", label %%bb%d, label %%bb%d\n", true_bb, false_bb);
+  fprintf(c->out, ", label %%bb%d, label %%bb%d", true_bb, false_bb);
+  if (f->cold_bb >= 0 && (true_bb == f->cold_bb || false_bb == f->cold_bb)) {
+    // Inline metadata tuple: no module-level ids to collide with.
+    if (true_bb == f->cold_bb)
+      fprintf(c->out, ", !prof !{!\"branch_weights\", i32 1, i32 2000}");
+    else
+      fprintf(c->out, ", !prof !{!\"branch_weights\", i32 2000, i32 1}");
+  }
+  fprintf(c->out, "\n");
   f->terminated = true;
   *io_i = i;
 }
@@ -2685,17 +3281,42 @@ static void emit_cond_and(FuncCtx* f, size_t* io_i, int true_bb, int false_bb) {
   *io_i = i;
 }
 
+// True if another `or` operand follows at this nesting level before the
+// condition ends.
+static bool cond_or_follows(const Compiler* c, size_t i) {
+  int depth = 0;
+  for (;; i++) {
+    uint32_t k = c->toks[i].kind;
+    if (k == TOK_LPAREN || k == TOK_LBRACK) depth++;
+    else if (k == TOK_RPAREN || k == TOK_RBRACK) {
+      if (depth == 0) return false;
+      depth--;
+    } else if (k == TOK_KW_OR && depth == 0) return true;
+    else if (k == TOK_KW_THEN || k == TOK_KW_DO || k == TOK_NEWLINE || k == TOK_EOF ||
+             (k == TOK_COMMA && depth == 0)) return false;
+  }
+}
+
+static void emit_cond_and_in_or(FuncCtx* f, size_t* io_i, int true_bb, int next_false, int false_bb) {
+  // In the last `or` operand a false result falls through to `false_bb`, so a
+  // cold `false_bb` makes that operand's false edges cold too.
+  int saved_cold = f->cold_bb;
+  if (saved_cold >= 0 && saved_cold == false_bb && !cond_or_follows(f->c, *io_i)) f->cold_bb = next_false;
+  emit_cond_and(f, io_i, true_bb, next_false);
+  f->cold_bb = saved_cold;
+}
+
 static void emit_cond_or(FuncCtx* f, size_t* io_i, int true_bb, int false_bb) {
   Compiler* c = f->c;
   size_t i = *io_i;
   int next_false = new_label(f);
-  emit_cond_and(f, &i, true_bb, next_false);
+  emit_cond_and_in_or(f, &i, true_bb, next_false, false_bb);
   while (c->toks[i].kind == TOK_KW_OR) {
     emit_label(c->out, next_false);
     f->terminated = false;
     i++;
     next_false = new_label(f);
-    emit_cond_and(f, &i, true_bb, next_false);
+    emit_cond_and_in_or(f, &i, true_bb, next_false, false_bb);
   }
   emit_label(c->out, next_false);
   f->terminated = false;
@@ -2768,8 +3389,279 @@ static bool scan_locals(FuncCtx* f, size_t start, size_t end) {
   return true;
 }
 
+// Trace probes (ASTER_TRACE=1)
+//
+// Each probe owns two u64 slots {calls, ticks} in a per-thread block
+// `@__aster_trace_tls = [1 + 2*N x i64]`; slot 0 is the "registered" flag.
+// The first probe hit on a thread hands the block to trace_rt.c, which sums
+// all threads and prints the table at exit. Ticks come from the cycle counter
+// (rdtsc via llvm.readcyclecounter on x86_64, cntvct_el0 on arm64).
+static void emit_cycle_read(FuncCtx* f, int tmp) {
+  Compiler* c = f->c;
+  fprintf(c->out, "  ");
+  emit_ssa(c->out, 't', tmp);
+#if defined(__aarch64__)
+  fprintf(c->out, " = call i64 asm sideeffect \"mrs $0, cntvct_el0\", \"=r\"()\n");
+#else
+  fprintf(c->out, " = call i64 @llvm.readcyclecounter()\n");
+#endif
+}
+
+static void emit_trace_enter(FuncCtx* f, uint32_t probe) {
+  Compiler* c = f->c;
+  if (f->trace_depth >= 32) {
+    error_at_tok(c, &c->toks[f->f->decl_tok], "trace scopes nested too deeply (max 32)");
+    return;
+  }
+  int flag = new_temp(f);
+  int is_new = new_temp(f);
+  int reg_bb = new_label(f);
+  int go_bb = new_label(f);
+  fprintf(c->out, "  ");
+  emit_ssa(c->out, 't', flag);
+  fprintf(c->out, " = load i64, ptr @__aster_trace_tls, align 8\n");
+  fprintf(c->out, "  ");
+  emit_ssa(c->out, 't', is_new);
+  fprintf(c->out, " = icmp eq i64 ");
+  emit_ssa(c->out, 't', flag);
+  fprintf(c->out, ", 0\n");
+  fprintf(c->out, "  br i1 ");
+  emit_ssa(c->out, 't', is_new);
+  fprintf(c->out, ", label %%bb%d, label %%bb%d\n", reg_bb, go_bb);
+  emit_label(c->out, reg_bb);
+  fprintf(c->out, "  call void @aster_trace_rt_register(ptr @__aster_trace_tls, ptr @__aster_trace_names)\n");
+  fprintf(c->out, "  br label %%bb%d\n", go_bb);
+  emit_label(c->out, go_bb);
+
+  int start = new_temp(f);
+  emit_cycle_read(f, start);
+  f->trace_scopes[f->trace_depth++] = (TraceScope){.probe = probe, .start_tmp = start};
+}
+
+static void emit_trace_exit(FuncCtx* f, const TraceScope* ts) {
+  Compiler* c = f->c;
+  int end = new_temp(f);
+  emit_cycle_read(f, end);
+  int delta = new_temp(f);
+  fprintf(c->out, "  ");
+  emit_ssa(c->out, 't', delta);
+  fprintf(c->out, " = sub i64 ");
+  emit_ssa(c->out, 't', end);
+  fprintf(c->out, ", ");
+  emit_ssa(c->out, 't', ts->start_tmp);
+  fprintf(c->out, "\n");
+
+  uint64_t off = 8 + 16 * (uint64_t)ts->probe;
+  const char* slot_names[2] = {"calls", "ticks"};
+  for (int k = 0; k < 2; k++) {
+    int p = new_temp(f);
+    int old = new_temp(f);
+    int upd = new_temp(f);
+    fprintf(c->out, "  ");
+    emit_ssa(c->out, 't', p);
+    fprintf(c->out, " = getelementptr inbounds i8, ptr @__aster_trace_tls, i64 %llu ; %s\n",
+            (unsigned long long)(off + 8 * (uint64_t)k), slot_names[k]);
+    fprintf(c->out, "  ");
+    emit_ssa(c->out, 't', old);
+    fprintf(c->out, " = load i64, ptr ");
+    emit_ssa(c->out, 't', p);
+    fprintf(c->out, ", align 8\n");
+    fprintf(c->out, "  ");
+    emit_ssa(c->out, 't', upd);
+    fprintf(c->out, " = add i64 ");
+    emit_ssa(c->out, 't', old);
+    if (k == 0) {
+      fprintf(c->out, ", 1\n");
+    } else {
+      fprintf(c->out, ", ");
+      emit_ssa(c->out, 't', delta);
+      fprintf(c->out, "\n");
+    }
+    fprintf(c->out, "  store i64 ");
+    emit_ssa(c->out, 't', upd);
+    fprintf(c->out, ", ptr ");
+    emit_ssa(c->out, 't', p);
+    fprintf(c->out, ", align 8\n");
+  }
+}
+
+// Close (without popping) every open trace scope down to `depth`; used before
+// `return`/`break`/`continue` leave those scopes.
+static void emit_trace_unwind(FuncCtx* f, int depth) {
+  for (int d = f->trace_depth - 1; d >= depth; d--) emit_trace_exit(f, &f->trace_scopes[d]);
+}
+
+static void emit_trace_globals(Compiler* c) {
+  if (!c->trace) return;
+  size_t n = c->ntrace_probes;
+  fprintf(c->out, "@__aster_trace_tls = internal thread_local global [%zu x i64] zeroinitializer, align 64\n", 1 + 2 * n);
+  fprintf(c->out, "@__aster_trace_names = internal constant [%zu x ptr] [", n + 1);
+  for (size_t i = 0; i < n; i++) fprintf(c->out, "ptr @.str%zu, ", c->trace_probes[i]->id);
+  fprintf(c->out, "ptr null]\n");
+  fprintf(c->out, "declare void @aster_trace_rt_register(ptr, ptr)\n");
+#if !defined(__aarch64__)
+  fprintf(c->out, "declare i64 @llvm.readcyclecounter()\n");
+#endif
+}
+
 static void compile_stmt_list(FuncCtx* f, size_t* io_i, size_t end);
 
+static bool is_intrinsic_stmt(const Compiler* c, size_t i) {
+  const AsterTok* t = &c->toks[i];
+  if (t->kind != TOK_IDENT || c->toks[i + 1].kind != TOK_LPAREN) return false;
+  const char* p = tok_ptr(c, t);
+  size_t n = tok_len(t);
+  return str_eq(p, n, "assert") || str_eq(p, n, "unreachable") || str_eq(p, n, "assume");
+}
+
+// Calls the cold, non-returning failure helper with "<file>:<line>: <what>"
+// and ends the block.
+static void emit_fail(FuncCtx* f, const AsterTok* at, const char* what, const char* detail, size_t detail_len) {
+  Compiler* c = f->c;
+  const char* file = NULL;
+  size_t line = 1, col = 1;
+  tok_location(c, at, &file, &line, &col);
+  char buf[512];
+  int n = snprintf(buf, sizeof(buf), "%s:%zu: %s%s%.*s\n", file ? file : "<unit>", line, what, detail_len ? ": " : "",
+                   (int)detail_len, detail ? detail : "");
+  if (n < 0) n = 0;
+  if ((size_t)n >= sizeof(buf)) {
+    n = (int)sizeof(buf) - 1;
+    buf[n - 1] = '\n';
+  }
+  StrConst* sc = new_str_const(c, (const uint8_t*)buf, (size_t)n);
+  fprintf(c->out, "  call void @aster_rt_fail(ptr @.str%zu, i64 %d)\n", sc->id, n);
+  fprintf(c->out, "  unreachable\n");
+  c->uses_fail = true;
+  f->terminated = true;
+}
+
+// Compiler-known statements:
+//   assert(cond) / assert(cond, "msg")  check; failure is a cold call
+//   unreachable()                         fails if control gets here
+//   assume(cond)                          optimizer hint (llvm.assume), no check
+// assert branches carry branch weights so the failure path is laid out of
+// line and does not compete with the fast path for registers.
+static void compile_intrinsic_stmt(FuncCtx* f, size_t* io_i) {
+  Compiler* c = f->c;
+  size_t i = *io_i;
+  const AsterTok* name = &c->toks[i];
+  const char* np = tok_ptr(c, name);
+  size_t nl = tok_len(name);
+  i += 2; // name, `(`
+  if (str_eq(np, nl, "unreachable")) {
+    if (c->toks[i].kind != TOK_RPAREN) error_at_tok(c, &c->toks[i], "`unreachable()` takes no arguments");
+    while (c->toks[i].kind != TOK_RPAREN && c->toks[i].kind != TOK_NEWLINE && c->toks[i].kind != TOK_EOF) i++;
+    if (c->toks[i].kind == TOK_RPAREN) i++;
+    emit_fail(f, name, "reached unreachable code", NULL, 0);
+  } else if (str_eq(np, nl, "assume")) {
+    Value v = parse_expr(f, &i, 1);
+    v = load_if_needed(f, cast_to(f, ty_bool(), v));
+    fprintf(c->out, "  call void @llvm.assume(i1 ");
+    emit_value(c->out, v);
+    fprintf(c->out, ")\n");
+    c->uses_assume = true;
+    if (c->toks[i].kind != TOK_RPAREN) error_at_tok(c, &c->toks[i], "expected `)` after `assume` condition");
+    else i++;
+  } else {
+    size_t cond_start = i;
+    int ok_bb = new_label(f);
+    int fail_bb = new_label(f);
+    int saved_cold = f->cold_bb;
+    f->cold_bb = fail_bb;
+    emit_cond_or(f, &i, ok_bb, fail_bb);
+    f->cold_bb = saved_cold;
+    size_t cond_end = i;
+    uint8_t* msg = NULL;
+    size_t msg_len = 0;
+    if (c->toks[i].kind == TOK_COMMA) {
+      i++;
+      if (c->toks[i].kind != TOK_STRING || !unescape_string(tok_ptr(c, &c->toks[i]), tok_len(&c->toks[i]), &msg, &msg_len)) {
+        error_at_tok(c, &c->toks[i], "expected message string in `assert(cond, \"msg\")`");
+      } else {
+        i++;
+      }
+    }
+    if (c->toks[i].kind != TOK_RPAREN) error_at_tok(c, &c->toks[i], "expected `)` after `assert` arguments");
+    else i++;
+    emit_label(c->out, fail_bb);
+    f->terminated = false;
+    if (msg) {
+      emit_fail(f, name, "assertion failed", (const char*)msg, msg_len);
+    } else {
+      // No message: quote the condition's source text.
+      const char* src = tok_ptr(c, &c->toks[cond_start]);
+      const AsterTok* last = &c->toks[cond_end > cond_start ? cond_end - 1 : cond_start];
+      size_t src_len = (size_t)(tok_ptr(c, last) + tok_len(last) - src);
+      emit_fail(f, name, "assertion failed", src, src_len);
+    }
+    free(msg);
+    emit_label(c->out, ok_bb);
+    f->terminated = false;
+  }
+  if (c->toks[i].kind == TOK_NEWLINE) i++;
+  *io_i = i;
+}
+
+// Definitions behind the intrinsics above, emitted once per module.
+static void emit_intrinsic_support(Compiler* c) {
+  if (c->uses_fail) {
+    bool have_write = false, have_abort = false;
+    for (size_t i = 0; i < c->nfuncs; i++) {
+      const FuncDef* g = c->funcs[i];
+      if (!g->is_extern) continue;
+      if (str_eq(g->name, g->name_len, "write")) have_write = true;
+      if (str_eq(g->name, g->name_len, "abort")) have_abort = true;
+    }
+    if (!have_write) fprintf(c->out, "declare i64 @write(i32, ptr, i64)\n");
+    if (!have_abort) fprintf(c->out, "declare void @abort() noreturn\n");
+    fprintf(c->out, "define internal void @aster_rt_fail(ptr %%msg, i64 %%n) cold noreturn noinline nounwind {\n");
+    fprintf(c->out, "entry:\n");
+    fprintf(c->out, "  %%w = call i64 @write(i32 2, ptr %%msg, i64 %%n)\n");
+    fprintf(c->out, "  call void @abort()\n");
+    fprintf(c->out, "  unreachable\n");
+    fprintf(c->out, "}\n");
+  }
+  if (c->uses_assume) fprintf(c->out, "declare void @llvm.assume(i1)\n");
+}
+
+// `trace "name" do` + indented block. Compiles to a plain block unless
+// ASTER_TRACE is set.
+static void compile_trace_block(FuncCtx* f, size_t* io_i, size_t end) {
+  Compiler* c = f->c;
+  size_t i = *io_i;
+  i++; // consume `trace`
+  AsterTok* name_tok = &c->toks[i];
+  uint8_t* bytes = NULL;
+  size_t blen = 0;
+  if (name_tok->kind != TOK_STRING || !unescape_string(tok_ptr(c, name_tok), tok_len(name_tok), &bytes, &blen)) {
+    error_at_tok(c, name_tok, "expected probe name string after `trace`");
+    *io_i = i + 1;
+    return;
+  }
+  i++;
+  if (c->toks[i].kind != TOK_KW_DO) {
+    error_at_tok(c, &c->toks[i], "expected `do` after `trace \"name\"`");
+    free(bytes);
+    *io_i = i;
+    return;
+  }
+  i++;
+  if (c->toks[i].kind == TOK_NEWLINE) i++;
+  if (c->toks[i].kind == TOK_INDENT) i++;
+
+  int depth = f->trace_depth;
+  if (c->trace) emit_trace_enter(f, trace_probe_id(c, bytes, blen));
+  free(bytes);
+  compile_stmt_list(f, &i, end);
+  if (c->toks[i].kind == TOK_DEDENT) i++;
+  if (c->trace && f->trace_depth > depth) {
+    if (!f->terminated) emit_trace_exit(f, &f->trace_scopes[f->trace_depth - 1]);
+    f->trace_depth = depth;
+  }
+  *io_i = i;
+}
+
 static void compile_if(FuncCtx* f, size_t* io_i, size_t end) {
   Compiler* c = f->c;
   size_t i = *io_i;
@@ -2819,8 +3711,9 @@ static void compile_while(FuncCtx* f, size_t* io_i, size_t end) {
   Compiler* c = f->c;
   size_t i = *io_i;
   i++; // consume while
-  // Detect `while 1 do` (hashmap uses this). We'll compile it as an infinite
-  // loop with no fallthrough block, so a trailing `return` is not required.
+  // Detect `while 1 do` (hashmap uses this). It compiles as an infinite loop;
+  // unless a `break` leaves it there is no fallthrough block, so a trailing
+  // `return` is not required.
   bool infinite = false;
   if (c->toks[i].kind == TOK_INT) {
     uint64_t v = parse_uint_lit(tok_ptr(c, &c->toks[i]), tok_len(&c->toks[i]));
@@ -2829,7 +3722,7 @@ static void compile_while(FuncCtx* f, size_t* io_i, size_t end) {
 
   int cond_bb = new_label(f);
   int body_bb = new_label(f);
-  int end_bb = infinite ? -1 : new_label(f);
+  int end_bb = new_label(f);
 
   fprintf(c->out, "  br label %%bb%d\n", cond_bb);
   emit_label(c->out, cond_bb);
@@ -2849,7 +3742,9 @@ static void compile_while(FuncCtx* f, size_t* io_i, size_t end) {
   f->terminated = false;
   // push loop context
   f->loop_cond[f->loop_depth] = cond_bb;
-  f->loop_end[f->loop_depth] = (end_bb < 0) ? cond_bb : end_bb;
+  f->loop_end[f->loop_depth] = end_bb;
+  f->loop_broken[f->loop_depth] = false;
+  f->loop_trace_depth[f->loop_depth] = f->trace_depth;
   f->loop_depth++;
 
   compile_stmt_list(f, &i, end);
@@ -2858,7 +3753,7 @@ static void compile_while(FuncCtx* f, size_t* io_i, size_t end) {
 
   if (!f->terminated) fprintf(c->out, "  br label %%bb%d\n", cond_bb);
 
-  if (!infinite) {
+  if (!infinite || f->loop_broken[f->loop_depth]) {
     emit_label(c->out, end_bb);
     f->terminated = false;
   } else {
@@ -2943,9 +3838,19 @@ static void compile_stmt_list(FuncCtx* f, size_t* io_i, size_t end) {
       compile_while(f, &i, end);
       continue;
     }
+    if (k == TOK_IDENT && c->toks[i + 1].kind == TOK_STRING &&
+        str_eq(tok_ptr(c, &c->toks[i]), tok_len(&c->toks[i]), "trace")) {
+      compile_trace_block(f, &i, end);
+      continue;
+    }
+    if (is_intrinsic_stmt(c, i)) {
+      compile_intrinsic_stmt(f, &i);
+      continue;
+    }
     if (k == TOK_KW_RETURN) {
       i++;
       if (c->toks[i].kind == TOK_NEWLINE) {
+        emit_trace_unwind(f, 0);
         fprintf(c->out, "  ret void\n");
         f->terminated = true;
         i++;
@@ -2954,6 +3859,7 @@ static void compile_stmt_list(FuncCtx* f, size_t* io_i, size_t end) {
       Value v = parse_expr(f, &i, 1);
       v = cast_to(f, f->f->ret, v);
       v = load_if_needed(f, v);
+      emit_trace_unwind(f, 0);
       fprintf(c->out, "  ret %s ", llvm_ty(f->f->ret));
       emit_value(c->out, v);
       fprintf(c->out, "\n");
@@ -2963,14 +3869,21 @@ static void compile_stmt_list(FuncCtx* f, size_t* io_i, size_t end) {
     }
     if (k == TOK_KW_BREAK) {
       i++;
-      if (f->loop_depth > 0) fprintf(c->out, "  br label %%bb%d\n", f->loop_end[f->loop_depth - 1]);
+      if (f->loop_depth > 0) {
+        emit_trace_unwind(f, f->loop_trace_depth[f->loop_depth - 1]);
+        fprintf(c->out, "  br label %%bb%d\n", f->loop_end[f->loop_depth - 1]);
+        f->loop_broken[f->loop_depth - 1] = true;
+      }
       f->terminated = true;
       if (c->toks[i].kind == TOK_NEWLINE) i++;
       continue;
     }
     if (k == TOK_KW_CONTINUE) {
       i++;
-      if (f->loop_depth > 0) fprintf(c->out, "  br label %%bb%d\n", f->loop_cond[f->loop_depth - 1]);
+      if (f->loop_depth > 0) {
+        emit_trace_unwind(f, f->loop_trace_depth[f->loop_depth - 1]);
+        fprintf(c->out, "  br label %%bb%d\n", f->loop_cond[f->loop_depth - 1]);
+      }
       f->terminated = true;
       if (c->toks[i].kind == TOK_NEWLINE) i++;
       continue;
@@ -3034,7 +3947,7 @@ static void emit_extern_decl(Compiler* c, FuncDef* f) {
     if (f->param_count) fprintf(c->out, ", ");
     fprintf(c->out, "...");
   }
-  fprintf(c->out, ")\n");
+  fprintf(c->out, ")%s\n", f->is_noreturn ? " noreturn" : "");
 }
 
 static void emit_string_globals(Compiler* c) {
@@ -3075,6 +3988,28 @@ static void dump_ty(FILE* fp, Type* t) {
   fprintf(fp, "<ty>");
 }
 
+static bool env_enabled(const char* name) {
+  const char* v = getenv(name);
+  if (!v || !v[0]) return false;
+  if (v[0] == '0' && v[1] == 0) return false;
+  return true;
+}
+
+// True if the comma-separated env var `name` contains `word` (ASTER_REPORT=alloc,...).
+static bool env_has_word(const char* name, const char* word) {
+  const char* v = getenv(name);
+  if (!v) return false;
+  size_t wl = strlen(word);
+  while (*v) {
+    const char* e = strchr(v, ',');
+    size_t l = e ? (size_t)(e - v) : strlen(v);
+    if (l == wl && memcmp(v, word, wl) == 0) return true;
+    if (!e) break;
+    v = e + 1;
+  }
+  return false;
+}
+
 static FILE* open_dump(const char* env_name, bool* out_should_close) {
   if (out_should_close) *out_should_close = false;
   const char* v = getenv(env_name);
@@ -3165,7 +4100,7 @@ static void dump_hir(const Compiler* c, FILE* fp) {
 }
 
 static bool compile_func(Compiler* c, FuncDef* fn) {
-  FuncCtx f = {.c = c, .f = fn, .next_temp = 0, .next_label = 0, .loop_depth = 0, .terminated = false};
+  FuncCtx f = {.c = c, .f = fn, .next_temp = 0, .next_label = 0, .loop_depth = 0, .cold_bb = -1, .terminated = false};
   if (!scan_locals(&f, fn->body_start, fn->body_end)) {
     free(f.locals);
     return false;
@@ -3180,7 +4115,11 @@ static bool compile_func(Compiler* c, FuncDef* fn) {
     fprintf(c->out, "%s ", llvm_ty(fn->params[i].type));
     emit_ssa(c->out, 'p', (int)i);
   }
-  fprintf(c->out, ") {\n");
+  fprintf(c->out, ")");
+  // Panic paths: kept out of line and laid out away from their callers.
+  if (fn->is_noreturn) fprintf(c->out, " cold noreturn noinline");
+  if (c->frame_pointers) fprintf(c->out, " \"frame-pointer\"=\"all\"");
+  fprintf(c->out, " {\n");
   fprintf(c->out, "entry:\n");
 
   // allocas
@@ -3195,6 +4134,8 @@ static bool compile_func(Compiler* c, FuncDef* fn) {
     }
   }
 
+  if (fn->has_trace) emit_trace_enter(&f, fn->trace_probe);
+
   size_t i = fn->body_start;
   compile_stmt_list(&f, &i, fn->body_end);
 
@@ -3204,7 +4145,10 @@ static bool compile_func(Compiler* c, FuncDef* fn) {
   }
 
   if (!f.terminated) {
-    if (fn->ret->kind == TY_VOID) fprintf(c->out, "  ret void\n");
+    if (fn->ret->kind == TY_VOID) {
+      emit_trace_unwind(&f, 0);
+      fprintf(c->out, "  ret void\n");
+    }
     else {
       fprintf(stderr, "asterc: missing return in function %.*s\n", (int)fn->name_len, fn->name);
       free(f.locals);
@@ -3221,13 +4165,16 @@ int asterc1__compile_real(uint8_t* src, size_t len, FILE* out) {
   c.src = src;
   c.src_len = len;
   c.out = out;
+  c.frame_pointers = env_enabled("ASTER_FRAME_POINTERS");
+  c.trace = env_enabled("ASTER_TRACE");
+  c.alloc_profile = env_enabled("ASTER_ALLOC_PROFILE");
+  c.alloc_report = env_has_word("ASTER_REPORT", "alloc");
 
   add_builtin_structs(&c);
 
   compiler_scan_unit_meta(&c);
 
-  if (!lex_all(src, len, &c.toks, &c.ntoks)) return 1;
-  assign_tok_modules(&c);
+  if (!lex_unit(&c)) return 1;
   c.i = 0;
 
   // parse module
@@ -3247,7 +4194,7 @@ int asterc1__compile_real(uint8_t* src, size_t len, FILE* out) {
       if (!parse_struct_decl(&c)) return 1;
       continue;
     }
-    if (k == TOK_KW_DEF || k == TOK_KW_NOALLOC) {
+    if (k == TOK_KW_DEF || k == TOK_KW_NOALLOC || tok_is_at_sign(&c, cur(&c))) {
       if (!parse_def_decl(&c)) return 1;
       continue;
     }
@@ -3288,8 +4235,22 @@ int asterc1__compile_real(uint8_t* src, size_t len, FILE* out) {
   if (!have_memcpy) fprintf(out, "declare ptr @memcpy(ptr, ptr, i64)\n");
   fprintf(out, "\n");
 
+  // Several modules may declare the same libc symbol (each keeps the externs
+  // it needs local); LLVM accepts only one declaration per symbol.
   for (size_t i = 0; i < c.nfuncs; i++) {
-    if (c.funcs[i]->is_extern) emit_extern_decl(&c, c.funcs[i]);
+    FuncDef* f = c.funcs[i];
+    if (!f->is_extern) continue;
+    const char* irn = f->ir_name ? f->ir_name : f->name;
+    size_t irn_len = f->ir_name ? f->ir_name_len : f->name_len;
+    bool seen = false;
+    for (size_t j = 0; j < i && !seen; j++) {
+      const FuncDef* g = c.funcs[j];
+      if (!g->is_extern) continue;
+      const char* gn = g->ir_name ? g->ir_name : g->name;
+      size_t gn_len = g->ir_name ? g->ir_name_len : g->name_len;
+      seen = gn_len == irn_len && memcmp(gn, irn, irn_len) == 0;
+    }
+    if (!seen) emit_extern_decl(&c, f);
   }
   fprintf(out, "\n");
 
@@ -3303,6 +4264,9 @@ int asterc1__compile_real(uint8_t* src, size_t len, FILE* out) {
   if (c.had_error) return 1;
 
   emit_string_globals(&c);
+  emit_trace_globals(&c);
+  emit_alloc_profile_decls(&c);
+  emit_intrinsic_support(&c);
   return 0;
 }
 
@@ -3332,11 +4296,23 @@ typedef struct {
   uint32_t _pad_flags;
   char* net_obj_abs; // absolute path to net tls helper object (when needed)
   char* metal_obj_abs; // absolute path to metal helper object (when needed)
+  char* trace_obj_abs; // absolute path to trace probe runtime (ASTER_TRACE=1)
+  char* alloc_prof_obj_abs; // absolute path to alloc profiler runtime (ASTER_ALLOC_PROFILE=1)
+  char* arena_obj_abs; // absolute path to thread-local arena helper (when needed)
+  char* str_obj_abs; // absolute path to vectorized string helper (when needed)
+  char* time_obj_abs; // absolute path to cycle-counter clock helper (when needed)
+  char* ml_cpu_obj_abs; // absolute path to CPU kernel table/launch helper (when needed)
 } AsterUnit;
 
 enum {
   UNIT_FLAG_NET = 1u << 0, // unit imports core.net/core.http
   UNIT_FLAG_METAL = 1u << 1, // unit imports aster_ml.runtime.ops_metal
+  UNIT_FLAG_TRACE = 1u << 2, // ASTER_TRACE=1 (trace probes are lowered)
+  UNIT_FLAG_ALLOC_PROFILE = 1u << 3, // ASTER_ALLOC_PROFILE=1 (allocator calls go through shims)
+  UNIT_FLAG_ARENA = 1u << 4, // unit imports core.arena
+  UNIT_FLAG_STR = 1u << 5, // unit imports core.str
+  UNIT_FLAG_TIME = 1u << 6, // unit imports core.time
+  UNIT_FLAG_ML_CPU = 1u << 7, // unit imports aster_ml.runtime.ops_cpu
 };
 
 // sha256 (minimal, portable)
@@ -4030,6 +5006,10 @@ AsterUnit* asterc1__unit_from_entry(const char* in_path, const uint8_t* entry_sr
   sha256_init(&hu);
   bool needs_net = false;
   bool needs_metal = false;
+  bool needs_arena = false;
+  bool needs_str = false;
+  bool needs_time = false;
+  bool needs_ml_cpu = false;
 
   for (size_t i = 0; i < g.norder; i++) {
     ModNode* n = g.order[i];
@@ -4046,6 +5026,18 @@ AsterUnit* asterc1__unit_from_entry(const char* in_path, const uint8_t* entry_sr
     if (strcmp(rel, "src/aster_ml/runtime/ops_metal.as") == 0) {
       needs_metal = true;
     }
+    if (strcmp(rel, "src/core/arena.as") == 0) {
+      needs_arena = true;
+    }
+    if (strcmp(rel, "src/core/str.as") == 0) {
+      needs_str = true;
+    }
+    if (strcmp(rel, "src/core/time.as") == 0) {
+      needs_time = true;
+    }
+    if (strcmp(rel, "src/aster_ml/runtime/ops_cpu.as") == 0) {
+      needs_ml_cpu = true;
+    }
 
     bb_append_cstr(&out, "# --- module: ");
     sha256_update(&hu, "# --- module: ", 13);
@@ -4088,18 +5080,27 @@ AsterUnit* asterc1__unit_from_entry(const char* in_path, const uint8_t* entry_sr
   u->flags = 0;
   if (needs_net) u->flags |= UNIT_FLAG_NET;
   if (needs_metal) u->flags |= UNIT_FLAG_METAL;
+  if (needs_arena) u->flags |= UNIT_FLAG_ARENA;
+  if (needs_str) u->flags |= UNIT_FLAG_STR;
+  if (needs_time) u->flags |= UNIT_FLAG_TIME;
+  if (needs_ml_cpu) u->flags |= UNIT_FLAG_ML_CPU;
   u->net_obj_abs = needs_net ? path_join3(root_abs, "tools/build/out/net_tls_rt.o", "") : NULL;
   u->metal_obj_abs = needs_metal ? path_join3(root_abs, "tools/build/out/ml_metal_rt.o", "") : NULL;
+  u->arena_obj_abs = needs_arena ? path_join3(root_abs, "tools/build/out/arena_rt.o", "") : NULL;
+  u->str_obj_abs = needs_str ? path_join3(root_abs, "tools/build/out/str_rt.o", "") : NULL;
+  u->time_obj_abs = needs_time ? path_join3(root_abs, "tools/build/out/time_rt.o", "") : NULL;
+  u->ml_cpu_obj_abs = needs_ml_cpu ? path_join3(root_abs, "tools/build/out/ml_cpu_rt.o", "") : NULL;
+  if (env_enabled("ASTER_TRACE")) {
+    u->flags |= UNIT_FLAG_TRACE;
+    u->trace_obj_abs = path_join3(root_abs, "tools/build/out/trace_rt.o", "");
+  }
+  if (env_enabled("ASTER_ALLOC_PROFILE")) {
+    u->flags |= UNIT_FLAG_ALLOC_PROFILE;
+    u->alloc_prof_obj_abs = path_join3(root_abs, "tools/build/out/alloc_prof_rt.o", "");
+  }
   return u;
 }
 
-static bool env_enabled(const char* name) {
-  const char* v = getenv(name);
-  if (!v || !v[0]) return false;
-  if (v[0] == '0' && v[1] == 0) return false;
-  return true;
-}
-
 static bool sha256_file(const char* path, uint8_t out[32]) {
   FILE* fp = fopen(path, "rb");
   if (!fp) return false;
@@ -4267,6 +5268,11 @@ static void unit_cache_key(const AsterUnit* u, uint8_t out_key[32]) {
   } else {
     sha256_update(&s, "dbg=0\n", 6);
   }
+  if (env_enabled("ASTER_FRAME_POINTERS")) {
+    sha256_update(&s, "fp=1\n", 5);
+  } else {
+    sha256_update(&s, "fp=0\n", 5);
+  }
 
   // Match the driver flag selection for clang.
   int olevel = 3;
@@ -4308,6 +5314,42 @@ static void unit_cache_key(const AsterUnit* u, uint8_t out_key[32]) {
   } else {
     sha256_update(&s, "metal=0\n", 8);
   }
+  if (u->flags & UNIT_FLAG_TRACE) {
+    sha256_update(&s, "trace=1\n", 8);
+    if (u->trace_obj_abs) cache_key_add_file_hash(&s, "trace_obj=", u->trace_obj_abs);
+  } else {
+    sha256_update(&s, "trace=0\n", 8);
+  }
+  if (u->flags & UNIT_FLAG_ALLOC_PROFILE) {
+    sha256_update(&s, "allocprof=1\n", 12);
+    if (u->alloc_prof_obj_abs) cache_key_add_file_hash(&s, "allocprof_obj=", u->alloc_prof_obj_abs);
+  } else {
+    sha256_update(&s, "allocprof=0\n", 12);
+  }
+  if (u->flags & UNIT_FLAG_ARENA) {
+    sha256_update(&s, "arena=1\n", 8);
+    if (u->arena_obj_abs) cache_key_add_file_hash(&s, "arena_obj=", u->arena_obj_abs);
+  } else {
+    sha256_update(&s, "arena=0\n", 8);
+  }
+  if (u->flags & UNIT_FLAG_STR) {
+    sha256_update(&s, "str=1\n", 6);
+    if (u->str_obj_abs) cache_key_add_file_hash(&s, "str_obj=", u->str_obj_abs);
+  } else {
+    sha256_update(&s, "str=0\n", 6);
+  }
+  if (u->flags & UNIT_FLAG_TIME) {
+    sha256_update(&s, "time=1\n", 7);
+    if (u->time_obj_abs) cache_key_add_file_hash(&s, "time_obj=", u->time_obj_abs);
+  } else {
+    sha256_update(&s, "time=0\n", 7);
+  }
+  if (u->flags & UNIT_FLAG_ML_CPU) {
+    sha256_update(&s, "ml_cpu=1\n", 9);
+    if (u->ml_cpu_obj_abs) cache_key_add_file_hash(&s, "ml_cpu_obj=", u->ml_cpu_obj_abs);
+  } else {
+    sha256_update(&s, "ml_cpu=0\n", 9);
+  }
 
   sha256_final(&s, out_key);
 }
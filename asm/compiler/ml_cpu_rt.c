@@ -0,0 +1,711 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// CPU runtime for `aster_ml.runtime.ops_cpu`.
+//
+// Aster has no globals, cannot call through a function pointer and cannot
+// emit SIMD, so the pieces of the CPU backend that need those live here:
+// - the process-wide table of loaded kernels (a launch is a lookup plus a
+//   direct call, not a hash + stat + dlopen per call) and the call itself;
+//   compiling and the on-disk cache stay on the Aster side;
+// - a persistent worker pool;
+// - SGEMM (packed, cache-blocked, register-blocked microkernels picked at
+//   runtime for AVX-512 / AVX2+FMA / NEON, multithreaded over tiles of C).
+//
+// Auto-linked into Aster binaries that import aster_ml.runtime.ops_cpu.
+
+// Open-addressed, insert-only. An entry is named by two independent 64-bit
+// hashes, `key` and `check`, so a collision in one of them cannot hand back
+// another kernel. Readers take no lock: a slot's `check` and `fn` are
+// published before its `key`, so a reader that sees the key sees the entry.
+// The table doubles at 3/4 load; a replaced table is never freed because a
+// reader may still be probing it (it only misses, and the miss is retried
+// under the lock).
+#define KCACHE_CAP0 1024
+
+typedef struct {
+  _Atomic uint64_t key; // 0 = empty
+  _Atomic uint64_t check;
+  void* _Atomic fn;
+} KCacheSlot;
+
+typedef struct {
+  uint64_t mask;
+  KCacheSlot* slots;
+} KCacheTab;
+
+static KCacheSlot g_slots0[KCACHE_CAP0];
+static KCacheTab g_tab0 = {KCACHE_CAP0 - 1, g_slots0};
+static KCacheTab* _Atomic g_tab = &g_tab0;
+static uint64_t g_used; // guarded by g_insert_mu
+static pthread_mutex_t g_insert_mu = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t kcache_norm(uint64_t key) { return key ? key : 1; }
+
+static uint64_t kcache_mix(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdull;
+  k ^= k >> 33;
+  return k;
+}
+
+static void* kcache_find(KCacheTab* t, uint64_t key, uint64_t check) {
+  uint64_t i = kcache_mix(key) & t->mask;
+  for (uint64_t probes = 0; probes <= t->mask; probes++) {
+    uint64_t k = atomic_load_explicit(&t->slots[i].key, memory_order_acquire);
+    if (k == 0) return NULL;
+    if (k == key &&
+        atomic_load_explicit(&t->slots[i].check, memory_order_relaxed) == check)
+      return atomic_load_explicit(&t->slots[i].fn, memory_order_relaxed);
+    i = (i + 1) & t->mask;
+  }
+  return NULL;
+}
+
+// Stores into the first empty slot of the chain. Caller holds g_insert_mu
+// and has checked that the entry is absent and that `t` has room.
+static void kcache_store(KCacheTab* t, uint64_t key, uint64_t check, void* fn) {
+  uint64_t i = kcache_mix(key) & t->mask;
+  while (atomic_load_explicit(&t->slots[i].key, memory_order_relaxed) != 0)
+    i = (i + 1) & t->mask;
+  atomic_store_explicit(&t->slots[i].check, check, memory_order_relaxed);
+  atomic_store_explicit(&t->slots[i].fn, fn, memory_order_relaxed);
+  atomic_store_explicit(&t->slots[i].key, key, memory_order_release);
+}
+
+// Doubles the table. Caller holds g_insert_mu. Returns NULL if out of memory.
+static KCacheTab* kcache_grow(KCacheTab* t) {
+  KCacheTab* nt = malloc(sizeof(KCacheTab));
+  KCacheSlot* ns = nt ? calloc(2 * (t->mask + 1), sizeof(KCacheSlot)) : NULL;
+  if (!ns) {
+    free(nt);
+    return NULL;
+  }
+  nt->mask = 2 * t->mask + 1;
+  nt->slots = ns;
+  for (uint64_t i = 0; i <= t->mask; i++) {
+    uint64_t k = atomic_load_explicit(&t->slots[i].key, memory_order_relaxed);
+    if (k == 0) continue;
+    kcache_store(nt, k, atomic_load_explicit(&t->slots[i].check, memory_order_relaxed),
+                 atomic_load_explicit(&t->slots[i].fn, memory_order_relaxed));
+  }
+  atomic_store_explicit(&g_tab, nt, memory_order_release);
+  return nt;
+}
+
+// Kernel loaded under (`key`, `check`), or NULL if none has been loaded yet.
+void* aster_ml_kcache_get(uint64_t key, uint64_t check) {
+  return kcache_find(atomic_load_explicit(&g_tab, memory_order_acquire),
+                     kcache_norm(key), check);
+}
+
+// Records `fn` under (`key`, `check`) and returns the entry now in the table:
+// `fn`, or the kernel another thread loaded first (the caller should use that
+// one). Returns NULL only if the table could not grow; the caller can still
+// launch `fn`.
+void* aster_ml_kcache_put(uint64_t key, uint64_t check, void* fn) {
+  key = kcache_norm(key);
+  pthread_mutex_lock(&g_insert_mu);
+  KCacheTab* t = atomic_load_explicit(&g_tab, memory_order_relaxed);
+  void* out = kcache_find(t, key, check);
+  if (!out) {
+    if (4 * (g_used + 1) > 3 * (t->mask + 1)) t = kcache_grow(t);
+    if (t) {
+      kcache_store(t, key, check, fn);
+      g_used++;
+      out = fn;
+    }
+  }
+  pthread_mutex_unlock(&g_insert_mu);
+  return out;
+}
+
+// Entry recorded for kernels that failed to build, so a launch tells "tried
+// and failed" from "not loaded yet" with the same lookup. A no-op if called.
+static void kcache_failed_entry(void* ctx) { (void)ctx; }
+
+void* aster_ml_kcache_failed(void) { return (void*)kcache_failed_entry; }
+
+// Calls a `void entry(void* ctx)` kernel entry point on the calling thread.
+void aster_ml_kcall(void* fn, void* ctx) { ((void (*)(void*))fn)(ctx); }
+
+// Compiler flags that produce a loadable shared object on this platform, and
+// the matching file suffix.
+const char* aster_ml_cc_flags(void) {
+#if defined(__APPLE__)
+  return "-O3 -std=c11 -dynamiclib -fPIC";
+#else
+  return "-O3 -std=c11 -shared -fPIC";
+#endif
+}
+
+const char* aster_ml_dylib_suffix(void) {
+#if defined(__APPLE__)
+  return ".dylib";
+#else
+  return ".so";
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Worker pool
+// ---------------------------------------------------------------------------
+
+#define POOL_MAX_THREADS 64
+
+typedef void (*PoolFn)(void* arg, int tid);
+
+static pthread_mutex_t g_pool_run_mu = PTHREAD_MUTEX_INITIALIZER; // one parallel region at a time
+static pthread_mutex_t g_pool_mu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_pool_go = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_pool_done = PTHREAD_COND_INITIALIZER;
+static int g_pool_nworkers;    // spawned so far (tids 1..nworkers)
+static uint64_t g_pool_gen;    // bumped once per region
+static int g_pool_active;      // tids < active take part in the current region
+static int g_pool_remaining;   // workers still running the current region
+static PoolFn g_pool_fn;
+static void* g_pool_arg;
+static atomic_int g_threads;   // 0 = not yet read from the environment
+
+static void* pool_worker(void* p) {
+  int tid = (int)(intptr_t)p;
+  pthread_mutex_lock(&g_pool_mu);
+  // Workers are spawned for the region being started, which cannot finish
+  // without them, so the current generation is the one to run.
+  uint64_t seen = g_pool_gen - 1;
+  for (;;) {
+    while (g_pool_gen == seen) pthread_cond_wait(&g_pool_go, &g_pool_mu);
+    seen = g_pool_gen;
+    if (tid >= g_pool_active) continue;
+    PoolFn fn = g_pool_fn;
+    void* arg = g_pool_arg;
+    pthread_mutex_unlock(&g_pool_mu);
+    fn(arg, tid);
+    pthread_mutex_lock(&g_pool_mu);
+    if (--g_pool_remaining == 0) pthread_cond_signal(&g_pool_done);
+  }
+  return NULL;
+}
+
+// Threads the CPU backend may use: $ASTER_ML_THREADS, else the online CPUs.
+int aster_ml_threads(void) {
+  int n = atomic_load_explicit(&g_threads, memory_order_relaxed);
+  if (n > 0) return n;
+  const char* env = getenv("ASTER_ML_THREADS");
+  n = env ? atoi(env) : 0;
+  if (n <= 0) n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (n <= 0) n = 1;
+  if (n > POOL_MAX_THREADS) n = POOL_MAX_THREADS;
+  atomic_store_explicit(&g_threads, n, memory_order_relaxed);
+  return n;
+}
+
+// Runs fn(arg, tid) for tid in [0, n) and returns n; the caller is tid 0.
+// A region started while another is running (including from inside one)
+// runs on the calling thread alone, with n = 1.
+static int pool_run(PoolFn fn, void* arg, int n) {
+  if (n <= 1 || pthread_mutex_trylock(&g_pool_run_mu) != 0) {
+    fn(arg, 0);
+    return 1;
+  }
+  pthread_mutex_lock(&g_pool_mu);
+  while (g_pool_nworkers < n - 1) {
+    pthread_t t;
+    if (pthread_create(&t, NULL, pool_worker, (void*)(intptr_t)(g_pool_nworkers + 1)) != 0) break;
+    pthread_detach(t);
+    g_pool_nworkers++;
+  }
+  if (n > g_pool_nworkers + 1) n = g_pool_nworkers + 1;
+  g_pool_fn = fn;
+  g_pool_arg = arg;
+  g_pool_active = n;
+  g_pool_remaining = n - 1;
+  g_pool_gen++;
+  pthread_cond_broadcast(&g_pool_go);
+  pthread_mutex_unlock(&g_pool_mu);
+
+  fn(arg, 0);
+
+  pthread_mutex_lock(&g_pool_mu);
+  while (g_pool_remaining > 0) pthread_cond_wait(&g_pool_done, &g_pool_mu);
+  pthread_mutex_unlock(&g_pool_mu);
+  pthread_mutex_unlock(&g_pool_run_mu);
+  return n;
+}
+
+// ---------------------------------------------------------------------------
+// SGEMM
+//
+// BLIS loop nest. C is cut into tiles of up to MC rows x NT columns, handed
+// out to workers from a shared counter. Per tile and per KC-deep slice of K:
+// - B[kc x nt] is packed into NR-wide micro-panels (the panel stays in L2/L3,
+//   one micro-panel in L1 while it is swept),
+// - A[mc x kc] is packed into MR-tall micro-panels (the block stays in L2),
+// - an MR x NR microkernel accumulates one register tile per micro-panel
+//   pair. Edge tiles run on zero-padded panels into a scratch tile.
+// Packing reads A and B through (row, column) element strides, so transposed
+// and other strided views multiply without a contiguous copy.
+// ---------------------------------------------------------------------------
+
+typedef void (*SgemmUkr)(size_t kc, const float* a, const float* b, float* c, size_t ldc, int acc);
+
+typedef struct {
+  const char* name;
+  size_t mr, nr;
+  size_t mc, kc, nc; // L2 block rows, L1 panel depth, L3 panel width
+  SgemmUkr ukr;
+} SgemmArch;
+
+#define SGEMM_MAX_MR 8
+#define SGEMM_MAX_NR 32
+
+// Portable 4x8: plain C the compiler can vectorize for the baseline ISA.
+static void sgemm_ukr_generic_4x8(size_t kc, const float* a, const float* b, float* c, size_t ldc, int acc) {
+  float t[4][8] = {{0}};
+  for (size_t p = 0; p < kc; p++) {
+    for (int r = 0; r < 4; r++) {
+      float av = a[r];
+      for (int j = 0; j < 8; j++) t[r][j] += av * b[j];
+    }
+    a += 4;
+    b += 8;
+  }
+  for (int r = 0; r < 4; r++) {
+    float* cr = c + r * ldc;
+    for (int j = 0; j < 8; j++) cr[j] = acc ? cr[j] + t[r][j] : t[r][j];
+  }
+}
+
+#if defined(__x86_64__)
+
+#define AVX2_ROW(r)                                  \
+  do {                                               \
+    __m256 av = _mm256_broadcast_ss(a + (r));        \
+    c##r##0 = _mm256_fmadd_ps(av, b0, c##r##0);      \
+    c##r##1 = _mm256_fmadd_ps(av, b1, c##r##1);      \
+  } while (0)
+
+#define AVX2_STORE(r)                                                        \
+  do {                                                                       \
+    float* cr = c + (r) * ldc;                                               \
+    if (acc) {                                                               \
+      c##r##0 = _mm256_add_ps(c##r##0, _mm256_loadu_ps(cr));                 \
+      c##r##1 = _mm256_add_ps(c##r##1, _mm256_loadu_ps(cr + 8));             \
+    }                                                                        \
+    _mm256_storeu_ps(cr, c##r##0);                                           \
+    _mm256_storeu_ps(cr + 8, c##r##1);                                       \
+  } while (0)
+
+// 6x16: 12 ymm accumulators, 2 for B, 1 broadcast.
+__attribute__((target("avx2,fma")))
+static void sgemm_ukr_avx2_6x16(size_t kc, const float* a, const float* b, float* c, size_t ldc, int acc) {
+  __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+  __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+  __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+  __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+  __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+  __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+  for (size_t p = 0; p < kc; p++) {
+    __m256 b0 = _mm256_load_ps(b);
+    __m256 b1 = _mm256_load_ps(b + 8);
+    AVX2_ROW(0);
+    AVX2_ROW(1);
+    AVX2_ROW(2);
+    AVX2_ROW(3);
+    AVX2_ROW(4);
+    AVX2_ROW(5);
+    a += 6;
+    b += 16;
+  }
+  AVX2_STORE(0);
+  AVX2_STORE(1);
+  AVX2_STORE(2);
+  AVX2_STORE(3);
+  AVX2_STORE(4);
+  AVX2_STORE(5);
+}
+
+#define AVX512_ROW(r)                                \
+  do {                                               \
+    __m512 av = _mm512_set1_ps(a[(r)]);              \
+    c##r##0 = _mm512_fmadd_ps(av, b0, c##r##0);      \
+    c##r##1 = _mm512_fmadd_ps(av, b1, c##r##1);      \
+  } while (0)
+
+#define AVX512_STORE(r)                                                      \
+  do {                                                                       \
+    float* cr = c + (r) * ldc;                                               \
+    if (acc) {                                                               \
+      c##r##0 = _mm512_add_ps(c##r##0, _mm512_loadu_ps(cr));                 \
+      c##r##1 = _mm512_add_ps(c##r##1, _mm512_loadu_ps(cr + 16));            \
+    }                                                                        \
+    _mm512_storeu_ps(cr, c##r##0);                                           \
+    _mm512_storeu_ps(cr + 16, c##r##1);                                      \
+  } while (0)
+
+// 6x32: 12 zmm accumulators, 2 for B, 1 broadcast.
+__attribute__((target("avx512f")))
+static void sgemm_ukr_avx512_6x32(size_t kc, const float* a, const float* b, float* c, size_t ldc, int acc) {
+  __m512 c00 = _mm512_setzero_ps(), c01 = _mm512_setzero_ps();
+  __m512 c10 = _mm512_setzero_ps(), c11 = _mm512_setzero_ps();
+  __m512 c20 = _mm512_setzero_ps(), c21 = _mm512_setzero_ps();
+  __m512 c30 = _mm512_setzero_ps(), c31 = _mm512_setzero_ps();
+  __m512 c40 = _mm512_setzero_ps(), c41 = _mm512_setzero_ps();
+  __m512 c50 = _mm512_setzero_ps(), c51 = _mm512_setzero_ps();
+  for (size_t p = 0; p < kc; p++) {
+    __m512 b0 = _mm512_load_ps(b);
+    __m512 b1 = _mm512_load_ps(b + 16);
+    AVX512_ROW(0);
+    AVX512_ROW(1);
+    AVX512_ROW(2);
+    AVX512_ROW(3);
+    AVX512_ROW(4);
+    AVX512_ROW(5);
+    a += 6;
+    b += 32;
+  }
+  AVX512_STORE(0);
+  AVX512_STORE(1);
+  AVX512_STORE(2);
+  AVX512_STORE(3);
+  AVX512_STORE(4);
+  AVX512_STORE(5);
+}
+
+#endif // __x86_64__
+
+#if defined(__aarch64__)
+
+#define NEON_ROW(r, av, lane)                             \
+  do {                                                    \
+    c##r##0 = vfmaq_laneq_f32(c##r##0, b0, av, lane);     \
+    c##r##1 = vfmaq_laneq_f32(c##r##1, b1, av, lane);     \
+    c##r##2 = vfmaq_laneq_f32(c##r##2, b2, av, lane);     \
+  } while (0)
+
+#define NEON_STORE(r)                                                        \
+  do {                                                                       \
+    float* cr = c + (r) * ldc;                                               \
+    if (acc) {                                                               \
+      c##r##0 = vaddq_f32(c##r##0, vld1q_f32(cr));                           \
+      c##r##1 = vaddq_f32(c##r##1, vld1q_f32(cr + 4));                       \
+      c##r##2 = vaddq_f32(c##r##2, vld1q_f32(cr + 8));                       \
+    }                                                                        \
+    vst1q_f32(cr, c##r##0);                                                  \
+    vst1q_f32(cr + 4, c##r##1);                                              \
+    vst1q_f32(cr + 8, c##r##2);                                              \
+  } while (0)
+
+// 8x12: 24 q-register accumulators, 3 for B, 2 for A (lane-indexed FMA).
+static void sgemm_ukr_neon_8x12(size_t kc, const float* a, const float* b, float* c, size_t ldc, int acc) {
+  float32x4_t z = vdupq_n_f32(0.0f);
+  float32x4_t c00 = z, c01 = z, c02 = z, c10 = z, c11 = z, c12 = z;
+  float32x4_t c20 = z, c21 = z, c22 = z, c30 = z, c31 = z, c32 = z;
+  float32x4_t c40 = z, c41 = z, c42 = z, c50 = z, c51 = z, c52 = z;
+  float32x4_t c60 = z, c61 = z, c62 = z, c70 = z, c71 = z, c72 = z;
+  for (size_t p = 0; p < kc; p++) {
+    float32x4_t b0 = vld1q_f32(b);
+    float32x4_t b1 = vld1q_f32(b + 4);
+    float32x4_t b2 = vld1q_f32(b + 8);
+    float32x4_t a0 = vld1q_f32(a);
+    float32x4_t a1 = vld1q_f32(a + 4);
+    NEON_ROW(0, a0, 0);
+    NEON_ROW(1, a0, 1);
+    NEON_ROW(2, a0, 2);
+    NEON_ROW(3, a0, 3);
+    NEON_ROW(4, a1, 0);
+    NEON_ROW(5, a1, 1);
+    NEON_ROW(6, a1, 2);
+    NEON_ROW(7, a1, 3);
+    a += 8;
+    b += 12;
+  }
+  NEON_STORE(0);
+  NEON_STORE(1);
+  NEON_STORE(2);
+  NEON_STORE(3);
+  NEON_STORE(4);
+  NEON_STORE(5);
+  NEON_STORE(6);
+  NEON_STORE(7);
+}
+
+#endif // __aarch64__
+
+static const SgemmArch g_sgemm_generic = {"generic-4x8", 4, 8, 64, 256, 1024, sgemm_ukr_generic_4x8};
+#if defined(__x86_64__)
+static const SgemmArch g_sgemm_avx2 = {"avx2-6x16", 6, 16, 168, 256, 2048, sgemm_ukr_avx2_6x16};
+static const SgemmArch g_sgemm_avx512 = {"avx512-6x32", 6, 32, 144, 256, 2048, sgemm_ukr_avx512_6x32};
+#endif
+#if defined(__aarch64__)
+static const SgemmArch g_sgemm_neon = {"neon-8x12", 8, 12, 120, 512, 3072, sgemm_ukr_neon_8x12};
+#endif
+
+static const SgemmArch* _Atomic g_sgemm_arch;
+
+static int sgemm_want(const char* want, const char* family) { return want && strcmp(want, family) == 0; }
+
+// Best microkernel for this CPU; $ASTER_ML_SGEMM=generic|avx2|avx512|neon
+// forces one (ignored when the CPU lacks it or the name is unknown).
+static const SgemmArch* sgemm_arch(void) {
+  const SgemmArch* k = atomic_load_explicit(&g_sgemm_arch, memory_order_acquire);
+  if (k) return k;
+  const char* want = getenv("ASTER_ML_SGEMM");
+  k = &g_sgemm_generic;
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  int has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  int has_avx512 = __builtin_cpu_supports("avx512f");
+  if (has_avx512) k = &g_sgemm_avx512;
+  else if (has_avx2) k = &g_sgemm_avx2;
+  if (sgemm_want(want, "avx512") && has_avx512) k = &g_sgemm_avx512;
+  if (sgemm_want(want, "avx2") && has_avx2) k = &g_sgemm_avx2;
+#elif defined(__aarch64__)
+  k = &g_sgemm_neon;
+  if (sgemm_want(want, "neon")) k = &g_sgemm_neon;
+#endif
+  if (sgemm_want(want, "generic")) k = &g_sgemm_generic;
+  atomic_store_explicit(&g_sgemm_arch, k, memory_order_release);
+  return k;
+}
+
+const char* aster_ml_sgemm_kernel(void) { return sgemm_arch()->name; }
+
+static void sgemm_pack_a(size_t mc, size_t kc, const float* a, ptrdiff_t rsa, ptrdiff_t csa, size_t mr, float* dst) {
+  for (size_t i0 = 0; i0 < mc; i0 += mr) {
+    size_t rows = mc - i0 < mr ? mc - i0 : mr;
+    const float* src = a + (ptrdiff_t)i0 * rsa;
+    for (size_t p = 0; p < kc; p++) {
+      const float* s = src + (ptrdiff_t)p * csa;
+      size_t r = 0;
+      for (; r < rows; r++) dst[r] = s[(ptrdiff_t)r * rsa];
+      for (; r < mr; r++) dst[r] = 0.0f;
+      dst += mr;
+    }
+  }
+}
+
+static void sgemm_pack_b(size_t kc, size_t nc, const float* b, ptrdiff_t rsb, ptrdiff_t csb, size_t nr, float* dst) {
+  for (size_t j0 = 0; j0 < nc; j0 += nr) {
+    size_t cols = nc - j0 < nr ? nc - j0 : nr;
+    const float* src = b + (ptrdiff_t)j0 * csb;
+    for (size_t p = 0; p < kc; p++) {
+      const float* s = src + (ptrdiff_t)p * rsb;
+      if (csb == 1 && cols == nr) {
+        memcpy(dst, s, nr * sizeof(float));
+      } else {
+        size_t j = 0;
+        for (; j < cols; j++) dst[j] = s[(ptrdiff_t)j * csb];
+        for (; j < nr; j++) dst[j] = 0.0f;
+      }
+      dst += nr;
+    }
+  }
+}
+
+typedef struct {
+  const SgemmArch* arch;
+  size_t m, n, k;
+  const float* a;
+  ptrdiff_t rsa, csa;
+  const float* b;
+  ptrdiff_t rsb, csb;
+  float* c;
+  size_t ldc;
+  int accumulate;
+  size_t nt;                 // tile width (multiple of nr, <= nc)
+  size_t tiles_m, tiles;
+  atomic_size_t next_tile;
+} SgemmJob;
+
+// Per-thread packing buffers, grown on demand and kept for the thread's
+// lifetime (pool workers and callers are long-lived).
+static __thread float* t_pack;
+static __thread size_t t_pack_cap;
+
+static float* sgemm_pack_buf(size_t nfloats) {
+  if (t_pack_cap < nfloats) {
+    free(t_pack);
+    size_t bytes = (nfloats * sizeof(float) + 63) & ~(size_t)63;
+    t_pack = (float*)aligned_alloc(64, bytes);
+    t_pack_cap = t_pack ? nfloats : 0;
+  }
+  return t_pack;
+}
+
+static void sgemm_tile(const SgemmJob* g, size_t i0, size_t mc, size_t j0, size_t nc, float* pa, float* pb) {
+  const SgemmArch* ar = g->arch;
+  size_t mr = ar->mr, nr = ar->nr;
+  float tmp[SGEMM_MAX_MR * SGEMM_MAX_NR] __attribute__((aligned(64)));
+  for (size_t p0 = 0; p0 < g->k; p0 += ar->kc) {
+    size_t kc = g->k - p0 < ar->kc ? g->k - p0 : ar->kc;
+    int acc = g->accumulate || p0 > 0;
+    sgemm_pack_b(kc, nc, g->b + (ptrdiff_t)p0 * g->rsb + (ptrdiff_t)j0 * g->csb, g->rsb, g->csb, nr, pb);
+    sgemm_pack_a(mc, kc, g->a + (ptrdiff_t)i0 * g->rsa + (ptrdiff_t)p0 * g->csa, g->rsa, g->csa, mr, pa);
+    for (size_t jr = 0; jr < nc; jr += nr) {
+      size_t ncur = nc - jr < nr ? nc - jr : nr;
+      const float* bp = pb + jr * kc;
+      for (size_t ir = 0; ir < mc; ir += mr) {
+        size_t mcur = mc - ir < mr ? mc - ir : mr;
+        const float* ap = pa + ir * kc;
+        float* cp = g->c + (i0 + ir) * g->ldc + j0 + jr;
+        if (mcur == mr && ncur == nr) {
+          ar->ukr(kc, ap, bp, cp, g->ldc, acc);
+          continue;
+        }
+        ar->ukr(kc, ap, bp, tmp, nr, 0);
+        for (size_t r = 0; r < mcur; r++) {
+          float* cr = cp + r * g->ldc;
+          const float* tr = tmp + r * nr;
+          for (size_t j = 0; j < ncur; j++) cr[j] = acc ? cr[j] + tr[j] : tr[j];
+        }
+      }
+    }
+  }
+}
+
+static void sgemm_worker(void* p, int tid) {
+  (void)tid;
+  SgemmJob* g = (SgemmJob*)p;
+  const SgemmArch* ar = g->arch;
+  size_t kc = g->k < ar->kc ? g->k : ar->kc;
+  size_t pa_n = ((ar->mc + ar->mr) * kc + 15) & ~(size_t)15; // keeps pb 64-byte aligned
+  size_t pb_n = (g->nt + ar->nr) * kc;
+  float* pa = sgemm_pack_buf(pa_n + pb_n);
+  if (!pa) return; // the caller notices the unclaimed tiles
+  float* pb = pa + pa_n;
+  for (;;) {
+    size_t t = atomic_fetch_add_explicit(&g->next_tile, 1, memory_order_relaxed);
+    if (t >= g->tiles) break;
+    size_t tm = t % g->tiles_m, tn = t / g->tiles_m;
+    size_t i0 = tm * ar->mc, j0 = tn * g->nt;
+    size_t mc = g->m - i0 < ar->mc ? g->m - i0 : ar->mc;
+    size_t nc = g->n - j0 < g->nt ? g->n - j0 : g->nt;
+    sgemm_tile(g, i0, mc, j0, nc, pa, pb);
+  }
+}
+
+// Below this many multiply-adds a call runs on one thread: waking the pool
+// costs more than the work.
+#define SGEMM_PARALLEL_MIN_MACS (1ull << 21)
+
+// Sets up a job for `threads` workers (tiles narrowed until there are about
+// two per worker) and returns how many workers it can use. m, n, k > 0.
+static int sgemm_job_init(SgemmJob* g, size_t m, size_t n, size_t k, const float* a, ptrdiff_t rsa, ptrdiff_t csa,
+                          const float* b, ptrdiff_t rsb, ptrdiff_t csb, float* c, size_t ldc, int accumulate,
+                          int threads) {
+  const SgemmArch* ar = sgemm_arch();
+  g->arch = ar;
+  g->m = m, g->n = n, g->k = k;
+  g->a = a, g->rsa = rsa, g->csa = csa;
+  g->b = b, g->rsb = rsb, g->csb = csb;
+  g->c = c, g->ldc = ldc;
+  g->accumulate = accumulate;
+  g->tiles_m = (m + ar->mc - 1) / ar->mc;
+  size_t want_n = ((size_t)threads * 2 + g->tiles_m - 1) / g->tiles_m;
+  size_t nt = (n + want_n - 1) / want_n;
+  nt = (nt + ar->nr - 1) / ar->nr * ar->nr;
+  if (nt > ar->nc) nt = ar->nc;
+  g->nt = nt;
+  g->tiles = g->tiles_m * ((n + nt - 1) / nt);
+  atomic_init(&g->next_tile, 0);
+  return (size_t)threads > g->tiles ? (int)g->tiles : threads;
+}
+
+static int sgemm_job_done(SgemmJob* g) {
+  return atomic_load_explicit(&g->next_tile, memory_order_relaxed) >= g->tiles;
+}
+
+// C[m x n] = A[m x k] * B[k x n], or C += A*B when `accumulate` is set.
+// A and B are addressed as a[i*rsa + p*csa], b[p*rsb + j*csb] (strides in
+// elements, any sign); C is row-major with row stride `ldc`.
+// Returns 1 only if packing memory cannot be allocated.
+int aster_ml_sgemm(size_t m, size_t n, size_t k, const float* a, ptrdiff_t rsa, ptrdiff_t csa, const float* b,
+                   ptrdiff_t rsb, ptrdiff_t csb, float* c, size_t ldc, int accumulate) {
+  if (m == 0 || n == 0) return 0;
+  if (k == 0) {
+    if (!accumulate)
+      for (size_t i = 0; i < m; i++) memset(c + i * ldc, 0, n * sizeof(float));
+    return 0;
+  }
+  int threads = 1;
+  if ((unsigned long long)m * n * k >= SGEMM_PARALLEL_MIN_MACS) threads = aster_ml_threads();
+  SgemmJob g;
+  threads = sgemm_job_init(&g, m, n, k, a, rsa, csa, b, rsb, csb, c, ldc, accumulate, threads);
+  pool_run(sgemm_worker, &g, threads);
+  // A worker that could not allocate leaves its tiles unclaimed; finish here.
+  sgemm_worker(&g, 0);
+  return sgemm_job_done(&g) ? 0 : 1;
+}
+
+typedef struct {
+  size_t nb, m, n, k;
+  const float* a;
+  const ptrdiff_t* a_offs;
+  ptrdiff_t rsa, csa;
+  const float* b;
+  const ptrdiff_t* b_offs;
+  ptrdiff_t rsb, csb;
+  float* c;
+  size_t c_stride, ldc;
+  int accumulate;
+  atomic_size_t next;
+  atomic_int failed;
+} SgemmBatch;
+
+static void sgemm_batch_worker(void* p, int tid) {
+  (void)tid;
+  SgemmBatch* bt = (SgemmBatch*)p;
+  for (;;) {
+    size_t i = atomic_fetch_add_explicit(&bt->next, 1, memory_order_relaxed);
+    if (i >= bt->nb) break;
+    SgemmJob g;
+    sgemm_job_init(&g, bt->m, bt->n, bt->k, bt->a + bt->a_offs[i], bt->rsa, bt->csa, bt->b + bt->b_offs[i], bt->rsb,
+                   bt->csb, bt->c + i * bt->c_stride, bt->ldc, bt->accumulate, 1);
+    sgemm_worker(&g, 0);
+    if (!sgemm_job_done(&g)) atomic_store_explicit(&bt->failed, 1, memory_order_relaxed);
+  }
+}
+
+// `nb` independent products: C_i = A_i * B_i (or +=), where A_i starts at
+// a + a_offs[i], B_i at b + b_offs[i] (element offsets, so broadcast operands
+// repeat an offset) and C_i at c + i*c_stride. Strides as in aster_ml_sgemm.
+// Large products run one after another, each across the pool; small ones
+// are spread over the pool one product per worker at a time.
+int aster_ml_sgemm_batched(size_t nb, size_t m, size_t n, size_t k, const float* a, const ptrdiff_t* a_offs,
+                           ptrdiff_t rsa, ptrdiff_t csa, const float* b, const ptrdiff_t* b_offs, ptrdiff_t rsb,
+                           ptrdiff_t csb, float* c, size_t c_stride, size_t ldc, int accumulate) {
+  if (nb == 0 || m == 0 || n == 0) return 0;
+  unsigned long long macs = (unsigned long long)m * n * k;
+  if (nb == 1 || k == 0 || macs >= SGEMM_PARALLEL_MIN_MACS) {
+    int rc = 0;
+    for (size_t i = 0; i < nb; i++)
+      rc |= aster_ml_sgemm(m, n, k, a + a_offs[i], rsa, csa, b + b_offs[i], rsb, csb, c + i * c_stride, ldc,
+                           accumulate);
+    return rc;
+  }
+  SgemmBatch bt;
+  bt.nb = nb, bt.m = m, bt.n = n, bt.k = k;
+  bt.a = a, bt.a_offs = a_offs, bt.rsa = rsa, bt.csa = csa;
+  bt.b = b, bt.b_offs = b_offs, bt.rsb = rsb, bt.csb = csb;
+  bt.c = c, bt.c_stride = c_stride, bt.ldc = ldc;
+  bt.accumulate = accumulate;
+  atomic_init(&bt.next, 0);
+  atomic_init(&bt.failed, 0);
+  int threads = 1;
+  if (macs * nb >= SGEMM_PARALLEL_MIN_MACS) threads = aster_ml_threads();
+  if ((size_t)threads > nb) threads = (int)nb;
+  pool_run(sgemm_batch_worker, &bt, threads);
+  return atomic_load_explicit(&bt.failed, memory_order_relaxed);
+}
@@ -0,0 +1,323 @@
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+// Sampling profiler helper used by `tools/aster/aster prof`.
+//
+// Linked into the profiled binary via ASTER_LINK_OBJ. It is inert unless
+// ASTER_PROF_OUT is set, in which case a constructor arms a sampler:
+// - Linux: a perf_event_open cycles (or task-clock) counter that delivers a
+//   signal on overflow.
+// - Fallback (macOS, or perf_event_paranoid denies access): setitimer(ITIMER_PROF).
+//
+// The signal handler walks frame pointers (the binary is built with
+// ASTER_FRAME_POINTERS=1) into a preallocated buffer. At exit the samples are
+// written as one stack per line; symbolization and folding happen offline in
+// tools/prof/report.py.
+//
+// Only the main thread (the one running the constructor) is profiled: the
+// perf counter counts that thread only (pid 0, no `inherit`) and signals it
+// (F_SETOWN_EX), and its stack bounds are the only ones recorded. A sample
+// that lands on another thread (possible with the process-wide itimer) keeps
+// just its pc.
+//
+// The walk never trusts the frame-pointer register blindly: code built
+// without frame pointers (libc, for one) leaves arbitrary data in it. A
+// record is read only if it lies between the interrupted sp and the top of
+// the main thread's stack.
+
+enum {
+  ASTER_PROF_MAX_DEPTH = 128,
+  ASTER_PROF_BUF_WORDS = 1u << 23, // 64 MiB of u64 words
+  ASTER_PROF_DEFAULT_HZ = 997,
+};
+
+static uint64_t* g_buf;
+static atomic_uint_fast64_t g_pos;
+static atomic_uint_fast64_t g_dropped;
+static atomic_int g_active;
+static const char* g_mode = "off";
+static uint64_t g_hz;
+static uintptr_t g_stack_lo;  // main thread stack [lo, hi), 0 if unknown
+static uintptr_t g_stack_hi;
+#if defined(__linux__)
+static int g_perf_fd = -1;
+#endif
+
+static inline void aster_prof_regs(void* uctx, uintptr_t* pc, uintptr_t* fp, uintptr_t* sp) {
+  ucontext_t* uc = (ucontext_t*)uctx;
+#if defined(__APPLE__) && defined(__aarch64__)
+  *pc = (uintptr_t)uc->uc_mcontext->__ss.__pc;
+  *fp = (uintptr_t)uc->uc_mcontext->__ss.__fp;
+  *sp = (uintptr_t)uc->uc_mcontext->__ss.__sp;
+#elif defined(__APPLE__) && defined(__x86_64__)
+  *pc = (uintptr_t)uc->uc_mcontext->__ss.__rip;
+  *fp = (uintptr_t)uc->uc_mcontext->__ss.__rbp;
+  *sp = (uintptr_t)uc->uc_mcontext->__ss.__rsp;
+#elif defined(__linux__) && defined(__aarch64__)
+  *pc = (uintptr_t)uc->uc_mcontext.pc;
+  *fp = (uintptr_t)uc->uc_mcontext.regs[29];
+  *sp = (uintptr_t)uc->uc_mcontext.sp;
+#elif defined(__linux__) && defined(__x86_64__)
+  *pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+  *fp = (uintptr_t)uc->uc_mcontext.gregs[REG_RBP];
+  *sp = (uintptr_t)uc->uc_mcontext.gregs[REG_RSP];
+#else
+  (void)uc;
+  *pc = 0;
+  *fp = 0;
+  *sp = 0;
+#endif
+}
+
+// Records the calling (main) thread's stack bounds for the walk.
+static void aster_prof_stack_bounds(void) {
+#if defined(__APPLE__)
+  pthread_t self = pthread_self();
+  uintptr_t hi = (uintptr_t)pthread_get_stackaddr_np(self);
+  g_stack_hi = hi;
+  g_stack_lo = hi - (uintptr_t)pthread_get_stacksize_np(self);
+#elif defined(__linux__)
+  pthread_attr_t attr;
+  void* lo = NULL;
+  size_t size = 0;
+  if (pthread_getattr_np(pthread_self(), &attr) != 0) return;
+  if (pthread_attr_getstack(&attr, &lo, &size) == 0 && lo) {
+    g_stack_lo = (uintptr_t)lo;
+    g_stack_hi = (uintptr_t)lo + size;
+  }
+  pthread_attr_destroy(&attr);
+#endif
+}
+
+static void aster_prof_on_signal(int sig, siginfo_t* si, void* uctx) {
+  (void)sig;
+  (void)si;
+  if (!atomic_load_explicit(&g_active, memory_order_relaxed)) return;
+  int saved_errno = errno;
+
+  uintptr_t frames[ASTER_PROF_MAX_DEPTH];
+  uintptr_t pc = 0, fp = 0, sp = 0;
+  aster_prof_regs(uctx, &pc, &fp, &sp);
+  uint64_t n = 0;
+  if (pc) frames[n++] = pc;
+
+  // Off the main thread's stack (another thread, a signal stack): no walk.
+  if (sp < g_stack_lo || sp >= g_stack_hi) fp = 0;
+
+  // Frame record layout is [prev_fp, return_addr] on both arm64 and x86_64.
+  // Only follow aligned, strictly increasing frame pointers whose record lies
+  // in [sp, stack_hi), so a non-FP frame terminates the walk instead of
+  // faulting.
+  while (fp && n < ASTER_PROF_MAX_DEPTH) {
+    if (fp & (sizeof(uintptr_t) - 1)) break;
+    if (fp < sp || fp > g_stack_hi - 2 * sizeof(uintptr_t)) break;
+    uintptr_t* rec = (uintptr_t*)fp;
+    uintptr_t next = rec[0];
+    uintptr_t ret = rec[1];
+    if (!ret) break;
+    // Return addresses point after the call; step back into the call site.
+    frames[n++] = ret - 1;
+    if (next <= fp) break;
+    fp = next;
+  }
+
+  uint64_t need = n + 1;
+  uint64_t at = atomic_fetch_add_explicit(&g_pos, need, memory_order_relaxed);
+  if (at + need > ASTER_PROF_BUF_WORDS) {
+    atomic_fetch_add_explicit(&g_dropped, 1, memory_order_relaxed);
+  } else {
+    g_buf[at] = n;
+    for (uint64_t i = 0; i < n; i++) g_buf[at + 1 + i] = (uint64_t)frames[i];
+  }
+
+#if defined(__linux__)
+  if (g_perf_fd >= 0) ioctl(g_perf_fd, PERF_EVENT_IOC_REFRESH, 1);
+#endif
+  errno = saved_errno;
+}
+
+#if defined(__linux__)
+static int aster_prof_perf_open(uint32_t type, uint64_t config, uint64_t hz) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.freq = 1;
+  attr.sample_freq = hz;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.wakeup_events = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+static bool aster_prof_start_perf(uint64_t hz) {
+  int fd = aster_prof_perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, hz);
+  const char* mode = "perf-cycles";
+  if (fd < 0) {
+    fd = aster_prof_perf_open(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, hz);
+    mode = "perf-task-clock";
+  }
+  if (fd < 0) return false;
+
+  struct f_owner_ex owner = {.type = F_OWNER_TID, .pid = (pid_t)syscall(SYS_gettid)};
+  if (fcntl(fd, F_SETFL, O_ASYNC) != 0 || fcntl(fd, F_SETSIG, SIGPROF) != 0 || fcntl(fd, F_SETOWN_EX, &owner) != 0) {
+    close(fd);
+    return false;
+  }
+  g_perf_fd = fd;
+  g_mode = mode;
+  atomic_store(&g_active, 1);
+  if (ioctl(fd, PERF_EVENT_IOC_REFRESH, 1) != 0) {
+    atomic_store(&g_active, 0);
+    g_perf_fd = -1;
+    close(fd);
+    return false;
+  }
+  return true;
+}
+#endif
+
+static bool aster_prof_start_itimer(uint64_t hz) {
+  struct itimerval it;
+  memset(&it, 0, sizeof(it));
+  uint64_t usec = 1000000ull / (hz ? hz : ASTER_PROF_DEFAULT_HZ);
+  if (usec == 0) usec = 1;
+  it.it_interval.tv_sec = (time_t)(usec / 1000000ull);
+  it.it_interval.tv_usec = (suseconds_t)(usec % 1000000ull);
+  it.it_value = it.it_interval;
+  atomic_store(&g_active, 1);
+  if (setitimer(ITIMER_PROF, &it, NULL) != 0) {
+    atomic_store(&g_active, 0);
+    return false;
+  }
+  g_mode = "itimer";
+  return true;
+}
+
+static void aster_prof_stop(void) {
+  atomic_store(&g_active, 0);
+#if defined(__linux__)
+  if (g_perf_fd >= 0) {
+    ioctl(g_perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+    close(g_perf_fd);
+    g_perf_fd = -1;
+  }
+#endif
+  struct itimerval it;
+  memset(&it, 0, sizeof(it));
+  setitimer(ITIMER_PROF, &it, NULL);
+}
+
+// Output format (v1), one record per line:
+//   # aster-prof v1
+//   mode <perf-cycles|perf-task-clock|itimer>
+//   hz <n>
+//   dropped <n>
+//   s <frame> <frame> ...     (leaf first)
+// where <frame> is `m:<hex offset into main image>` or `x:<symbol>` for frames
+// in shared libraries that dladdr can name, or `?` otherwise.
+static void aster_prof_write_frame(FILE* fp, uintptr_t pc, uintptr_t main_base) {
+  Dl_info info;
+  if (dladdr((void*)pc, &info) && info.dli_fbase) {
+    if ((uintptr_t)info.dli_fbase == main_base) {
+      fprintf(fp, " m:%llx", (unsigned long long)(pc - main_base));
+      return;
+    }
+    if (info.dli_sname) {
+      fprintf(fp, " x:%s", info.dli_sname);
+      return;
+    }
+  }
+  fprintf(fp, " ?");
+}
+
+static void aster_prof_dump(void) {
+  aster_prof_stop();
+  const char* path = getenv("ASTER_PROF_OUT");
+  if (!path || !path[0] || !g_buf) return;
+  FILE* fp = fopen(path, "w");
+  if (!fp) {
+    fprintf(stderr, "aster prof: cannot write %s: %s\n", path, strerror(errno));
+    return;
+  }
+
+  uintptr_t main_base = 0;
+  Dl_info self;
+  if (dladdr((void*)&aster_prof_dump, &self)) main_base = (uintptr_t)self.dli_fbase;
+
+  uint64_t end = atomic_load(&g_pos);
+  if (end > ASTER_PROF_BUF_WORDS) end = ASTER_PROF_BUF_WORDS;
+  fprintf(fp, "# aster-prof v1\n");
+  fprintf(fp, "mode %s\n", g_mode);
+  fprintf(fp, "hz %llu\n", (unsigned long long)g_hz);
+  fprintf(fp, "dropped %llu\n", (unsigned long long)atomic_load(&g_dropped));
+  uint64_t at = 0;
+  while (at < end) {
+    uint64_t n = g_buf[at];
+    if (n == 0 || at + 1 + n > end) break;
+    fputc('s', fp);
+    for (uint64_t i = 0; i < n; i++) aster_prof_write_frame(fp, (uintptr_t)g_buf[at + 1 + i], main_base);
+    fputc('\n', fp);
+    at += 1 + n;
+  }
+  fclose(fp);
+}
+
+__attribute__((constructor)) static void aster_prof_init(void) {
+  const char* path = getenv("ASTER_PROF_OUT");
+  if (!path || !path[0]) return;
+
+  const char* hz_env = getenv("ASTER_PROF_HZ");
+  g_hz = hz_env && hz_env[0] ? strtoull(hz_env, NULL, 10) : ASTER_PROF_DEFAULT_HZ;
+  if (g_hz == 0) g_hz = ASTER_PROF_DEFAULT_HZ;
+
+  void* mem = mmap(NULL, (size_t)ASTER_PROF_BUF_WORDS * sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (mem == MAP_FAILED) {
+    fprintf(stderr, "aster prof: cannot allocate sample buffer\n");
+    return;
+  }
+  g_buf = (uint64_t*)mem;
+  aster_prof_stack_bounds();
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = aster_prof_on_signal;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(SIGPROF, &sa, NULL) != 0) return;
+
+  bool started = false;
+#if defined(__linux__)
+  const char* force = getenv("ASTER_PROF_MODE");
+  if (!force || strcmp(force, "itimer") != 0) started = aster_prof_start_perf(g_hz);
+#endif
+  if (!started) started = aster_prof_start_itimer(g_hz);
+  if (!started) {
+    fprintf(stderr, "aster prof: no sampler available\n");
+    return;
+  }
+  atexit(aster_prof_dump);
+}
@@ -0,0 +1,173 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Vectorized byte-string primitives for `core.str`.
+//
+// Every entry point takes explicit (ptr, len) spans and never reads outside
+// them: full 16-byte blocks are scanned with SSE2 (x86_64) or NEON (arm64),
+// the tail with one overlapping block when the span is at least 16 bytes and
+// a scalar loop otherwise. Searches return an index, or `n` when there is no
+// match, so the Aster side can map that to STR_NPOS.
+//
+// Auto-linked into Aster binaries that import core.str.
+
+static inline uint8_t lower_ascii(uint8_t c) {
+  return (uint8_t)(c - 'A') < 26 ? (uint8_t)(c | 0x20) : c;
+}
+
+#if defined(__SSE2__)
+
+typedef __m128i V16;
+
+static inline V16 v_load(const uint8_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline V16 v_splat(uint8_t b) { return _mm_set1_epi8((char)b); }
+static inline V16 v_eq(V16 a, V16 b) { return _mm_cmpeq_epi8(a, b); }
+static inline V16 v_and(V16 a, V16 b) { return _mm_and_si128(a, b); }
+
+// One bit per lane (bit i = lane i).
+static inline uint64_t v_mask(V16 m) { return (uint64_t)(uint32_t)_mm_movemask_epi8(m); }
+enum { V_LANE_BITS = 1 };
+
+static inline V16 v_lower(V16 x) {
+  // Lanes in 'A'..'Z' move to [-128, -103] after the bias; set 0x20 there.
+  V16 t = _mm_add_epi8(x, _mm_set1_epi8((char)(128 - 'A')));
+  V16 up = _mm_cmplt_epi8(t, _mm_set1_epi8((char)(-128 + 26)));
+  return _mm_or_si128(x, _mm_and_si128(up, _mm_set1_epi8(0x20)));
+}
+
+#define STR_RT_SIMD 1
+
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+
+typedef uint8x16_t V16;
+
+static inline V16 v_load(const uint8_t* p) { return vld1q_u8(p); }
+static inline V16 v_splat(uint8_t b) { return vdupq_n_u8(b); }
+static inline V16 v_eq(V16 a, V16 b) { return vceqq_u8(a, b); }
+static inline V16 v_and(V16 a, V16 b) { return vandq_u8(a, b); }
+
+// Four bits per lane (lane i = bits 4i..4i+3): narrowing shift of the
+// compare result, the usual NEON stand-in for movemask.
+static inline uint64_t v_mask(V16 m) {
+  uint8x8_t n = vshrn_n_u16(vreinterpretq_u16_u8(m), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(n), 0);
+}
+enum { V_LANE_BITS = 4 };
+
+static inline V16 v_lower(V16 x) {
+  V16 up = vcleq_u8(vsubq_u8(x, vdupq_n_u8('A')), vdupq_n_u8(25));
+  return vorrq_u8(x, vandq_u8(up, vdupq_n_u8(0x20)));
+}
+
+#define STR_RT_SIMD 1
+
+#endif
+
+#if defined(STR_RT_SIMD)
+
+// Lane index of the lowest set lane in a non-zero mask.
+static inline size_t v_first(uint64_t m) { return (size_t)__builtin_ctzll(m) / V_LANE_BITS; }
+
+// Mask with all bits for lanes >= `from` (0 <= from < 16).
+static inline uint64_t v_from(size_t from) {
+  return (V_LANE_BITS == 1 ? 0xFFFFull : ~0ull) << (from * V_LANE_BITS);
+}
+
+#endif
+
+size_t aster_str_find_byte(const uint8_t* p, size_t n, uint8_t b) {
+  size_t i = 0;
+#if defined(STR_RT_SIMD)
+  if (n >= 16) {
+    V16 vb = v_splat(b);
+    for (; i + 16 <= n; i += 16) {
+      uint64_t m = v_mask(v_eq(v_load(p + i), vb));
+      if (m) return i + v_first(m);
+    }
+    if (i < n) {
+      // Overlapping last block; lanes before `i` were already scanned.
+      size_t base = n - 16;
+      uint64_t m = v_mask(v_eq(v_load(p + base), vb)) & v_from(i - base);
+      if (m) return base + v_first(m);
+    }
+    return n;
+  }
+#endif
+  for (; i < n; i++) {
+    if (p[i] == b) return i;
+  }
+  return n;
+}
+
+size_t aster_str_count_byte(const uint8_t* p, size_t n, uint8_t b) {
+  size_t i = 0, count = 0;
+#if defined(STR_RT_SIMD)
+  V16 vb = v_splat(b);
+  for (; i + 16 <= n; i += 16) {
+    count += (size_t)__builtin_popcountll(v_mask(v_eq(v_load(p + i), vb))) / V_LANE_BITS;
+  }
+#endif
+  for (; i < n; i++) count += p[i] == b;
+  return count;
+}
+
+size_t aster_str_mismatch(const uint8_t* a, const uint8_t* b, size_t n) {
+  size_t i = 0;
+#if defined(STR_RT_SIMD)
+  for (; i + 16 <= n; i += 16) {
+    uint64_t ne = v_mask(v_eq(v_load(a + i), v_load(b + i))) ^ v_from(0);
+    if (ne) return i + v_first(ne);
+  }
+#endif
+  for (; i < n; i++) {
+    if (a[i] != b[i]) return i;
+  }
+  return n;
+}
+
+size_t aster_str_mismatch_ci(const uint8_t* a, const uint8_t* b, size_t n) {
+  size_t i = 0;
+#if defined(STR_RT_SIMD)
+  for (; i + 16 <= n; i += 16) {
+    uint64_t ne = v_mask(v_eq(v_lower(v_load(a + i)), v_lower(v_load(b + i)))) ^ v_from(0);
+    if (ne) return i + v_first(ne);
+  }
+#endif
+  for (; i < n; i++) {
+    if (lower_ascii(a[i]) != lower_ascii(b[i])) return i;
+  }
+  return n;
+}
+
+size_t aster_str_find(const uint8_t* h, size_t hn, const uint8_t* nd, size_t nn) {
+  if (nn == 0) return 0;
+  if (nn > hn) return hn;
+  if (nn == 1) return aster_str_find_byte(h, hn, nd[0]);
+  size_t last = hn - nn; // last valid start
+  size_t i = 0;
+#if defined(STR_RT_SIMD)
+  // Candidate starts match both the first and the last needle byte; only
+  // those are verified with a full compare.
+  V16 vf = v_splat(nd[0]);
+  V16 vl = v_splat(nd[nn - 1]);
+  for (; i + 16 <= last + 1; i += 16) {
+    uint64_t m = v_mask(v_and(v_eq(v_load(h + i), vf), v_eq(v_load(h + i + nn - 1), vl)));
+    while (m) {
+      size_t k = v_first(m);
+      if (memcmp(h + i + k + 1, nd + 1, nn - 2) == 0) return i + k;
+      m &= ~((((uint64_t)1 << V_LANE_BITS) - 1) << (V_LANE_BITS * k));
+    }
+  }
+#endif
+  for (; i <= last; i++) {
+    if (h[i] == nd[0] && h[i + nn - 1] == nd[nn - 1] && memcmp(h + i + 1, nd + 1, nn - 2) == 0) return i;
+  }
+  return hn;
+}
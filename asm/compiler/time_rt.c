@@ -0,0 +1,58 @@
+#include <stdint.h>
+#include <time.h>
+
+// Cycle-counter and coarse clocks for `core.time`.
+//
+// Aster cannot emit rdtsc / mrs itself, so the raw counter reads live here.
+// Everything else (calibration, tick -> ns conversion, histograms) is on the
+// Aster side, which keeps the calibrated state in a caller-owned TickClock.
+//
+// Auto-linked into Aster binaries that import core.time.
+
+// Raw counter: the invariant TSC on x86_64, the virtual counter (CNTVCT_EL0)
+// on arm64, CLOCK_MONOTONIC nanoseconds elsewhere. Not serializing: a read can
+// move a few instructions earlier or later, which is noise at the scale this
+// is meant for (loop iterations, request latencies).
+uint64_t aster_time_ticks(void) {
+#if defined(__x86_64__)
+  uint32_t lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+  uint64_t v;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+  return v;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Counter frequency when the hardware reports it (CNTFRQ_EL0 on arm64, 1 GHz
+// for the clock_gettime fallback); 0 means the caller must calibrate (TSC).
+uint64_t aster_time_tick_hz(void) {
+#if defined(__x86_64__)
+  return 0;
+#elif defined(__aarch64__)
+  uint64_t f;
+  __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(f));
+  return f;
+#else
+  return 1000000000ull;
+#endif
+}
+
+// Monotonic time from the kernel's per-tick cached value: no counter read, no
+// vDSO fallback to a syscall, resolution of one scheduler tick (1-4 ms).
+uint64_t aster_time_coarse_ns(void) {
+  struct timespec ts;
+#if defined(CLOCK_MONOTONIC_COARSE)
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#elif defined(CLOCK_MONOTONIC_RAW_APPROX)
+  clock_gettime(CLOCK_MONOTONIC_RAW_APPROX, &ts);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
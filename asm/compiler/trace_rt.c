@@ -0,0 +1,159 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Trace probe runtime for `@trace("name")` / `trace "name" do` (ASTER_TRACE=1).
+//
+// asterc lowers each probe to inline cycle-counter reads that accumulate
+// {calls, ticks} into a per-thread block (`@__aster_trace_tls`). The first
+// probe hit on a thread registers that block here; thread exit folds it into
+// `g_retired`, and process exit prints the merged table.
+//
+// Auto-linked into Aster binaries built with ASTER_TRACE=1.
+//
+// Output goes to stderr, or to the file named by ASTER_TRACE_OUT at runtime.
+
+typedef struct AsterTraceThread {
+  uint64_t* block; // [0]=registered flag, then {calls, ticks} per probe
+  struct AsterTraceThread* next;
+} AsterTraceThread;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t g_key;
+static AsterTraceThread* g_threads;
+static const char* const* g_names;
+static size_t g_nprobes;
+static uint64_t* g_retired; // {calls, ticks} per probe from exited threads
+static uint64_t g_nthreads;
+static uint64_t g_ticks0;
+static uint64_t g_ns0;
+
+static inline uint64_t aster_trace_ticks(void) {
+#if defined(__aarch64__)
+  uint64_t v;
+  __asm__ volatile("mrs %0, cntvct_el0" : "=r"(v));
+  return v;
+#elif defined(__x86_64__)
+  return __builtin_ia32_rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static uint64_t aster_trace_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Ticks per second: architectural on arm64, calibrated against the monotonic
+// clock over the traced run on x86_64.
+static double aster_trace_tick_hz(void) {
+#if defined(__aarch64__)
+  uint64_t f;
+  __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(f));
+  return (double)f;
+#else
+  uint64_t dt = aster_trace_ticks() - g_ticks0;
+  uint64_t dns = aster_trace_now_ns() - g_ns0;
+  if (dns == 0 || dt == 0) return 1e9;
+  return (double)dt * 1e9 / (double)dns;
+#endif
+}
+
+static void aster_trace_retire(void* p) {
+  AsterTraceThread* t = (AsterTraceThread*)p;
+  pthread_mutex_lock(&g_lock);
+  for (size_t i = 0; i < 2 * g_nprobes; i++) g_retired[i] += t->block[1 + i];
+  AsterTraceThread** pp = &g_threads;
+  while (*pp && *pp != t) pp = &(*pp)->next;
+  if (*pp) *pp = t->next;
+  pthread_mutex_unlock(&g_lock);
+  free(t);
+}
+
+typedef struct {
+  size_t probe;
+  uint64_t calls;
+  uint64_t ticks;
+} AsterTraceRow;
+
+static int aster_trace_row_cmp(const void* a, const void* b) {
+  const AsterTraceRow* x = (const AsterTraceRow*)a;
+  const AsterTraceRow* y = (const AsterTraceRow*)b;
+  if (x->ticks != y->ticks) return x->ticks < y->ticks ? 1 : -1;
+  return x->probe < y->probe ? -1 : (x->probe > y->probe);
+}
+
+static void aster_trace_dump(void) {
+  pthread_mutex_lock(&g_lock);
+  AsterTraceRow* rows = (AsterTraceRow*)calloc(g_nprobes ? g_nprobes : 1, sizeof(AsterTraceRow));
+  if (!rows) {
+    pthread_mutex_unlock(&g_lock);
+    return;
+  }
+  for (size_t i = 0; i < g_nprobes; i++) {
+    rows[i].probe = i;
+    rows[i].calls = g_retired[2 * i];
+    rows[i].ticks = g_retired[2 * i + 1];
+  }
+  for (AsterTraceThread* t = g_threads; t; t = t->next) {
+    for (size_t i = 0; i < g_nprobes; i++) {
+      rows[i].calls += t->block[1 + 2 * i];
+      rows[i].ticks += t->block[2 + 2 * i];
+    }
+  }
+  uint64_t nthreads = g_nthreads;
+  pthread_mutex_unlock(&g_lock);
+
+  qsort(rows, g_nprobes, sizeof(AsterTraceRow), aster_trace_row_cmp);
+  double hz = aster_trace_tick_hz();
+
+  FILE* fp = stderr;
+  const char* path = getenv("ASTER_TRACE_OUT");
+  if (path && path[0]) {
+    FILE* f = fopen(path, "w");
+    if (f) fp = f;
+  }
+  fprintf(fp, "aster trace: %llu thread(s), %.1f MHz tick\n", (unsigned long long)nthreads, hz / 1e6);
+  fprintf(fp, "%-32s %12s %14s %12s %12s\n", "probe", "calls", "ticks", "total_ms", "ns/call");
+  for (size_t i = 0; i < g_nprobes; i++) {
+    const AsterTraceRow* r = &rows[i];
+    if (r->calls == 0) continue;
+    double total_ns = (double)r->ticks * 1e9 / hz;
+    fprintf(fp, "%-32s %12llu %14llu %12.3f %12.1f\n", g_names[r->probe], (unsigned long long)r->calls,
+            (unsigned long long)r->ticks, total_ns / 1e6, total_ns / (double)r->calls);
+  }
+  if (fp != stderr) fclose(fp);
+  free(rows);
+}
+
+void aster_trace_rt_register(uint64_t* block, const char* const* names) {
+  if (!block || block[0]) return;
+  AsterTraceThread* t = (AsterTraceThread*)calloc(1, sizeof(AsterTraceThread));
+  if (!t) return;
+  t->block = block;
+
+  pthread_mutex_lock(&g_lock);
+  if (!g_names) {
+    size_t n = 0;
+    while (names[n]) n++;
+    g_names = names;
+    g_nprobes = n;
+    g_retired = (uint64_t*)calloc(2 * (n ? n : 1), sizeof(uint64_t));
+    g_ticks0 = aster_trace_ticks();
+    g_ns0 = aster_trace_now_ns();
+    pthread_key_create(&g_key, aster_trace_retire);
+    atexit(aster_trace_dump);
+  }
+  t->next = g_threads;
+  g_threads = t;
+  g_nthreads++;
+  pthread_mutex_unlock(&g_lock);
+
+  pthread_setspecific(g_key, t);
+  block[0] = 1;
+}
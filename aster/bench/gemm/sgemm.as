@@ -0,0 +1,76 @@
+# Aster SGEMM throughput (aster_ml CPU backend)
+#
+# Square float32 matmuls through `cpu_matmul_f32` (packed, cache-blocked,
+# multithreaded; see asm/compiler/ml_cpu_rt.c). Prints one line per size:
+#   sgemm <kernel> threads=<t> n=<n> gflops=<x>
+# ASTER_ML_THREADS caps the threads and ASTER_ML_SGEMM=generic|avx2|avx512|neon
+# forces a microkernel, to compare them.
+
+use core.libc
+use core.io
+use core.time
+use aster_ml.runtime.ops_cpu
+
+const MIN_NS is u64 = 200000000   # time each size for at least 0.2 s
+
+
+def fill(p is slice of f32, n is usize, seed is usize) returns ()
+    var i is usize = 0
+    while i < n do
+        var v is usize = (i * 7 + seed) - ((i * 7 + seed) / 13) * 13
+        p[i] = (0.0 + v) * 0.125 - 0.75
+        i = i + 1
+    return
+
+
+def bench_size(w is mut ref Writer, n is usize) returns i32
+    var bytes is usize = n * n * 4
+    var a is MutString = malloc(bytes)
+    var b is MutString = malloc(bytes)
+    var c is MutString = malloc(bytes)
+    if a is null or b is null or c is null then
+        return 1
+    fill(a, n * n, 1)
+    fill(b, n * n, 5)
+
+    # Warm up once (spawns the pool, faults in the packing buffers).
+    if cpu_matmul_f32(c, 0, a, 0, b, 0, n, n, n) != 0 then
+        return 1
+    var reps is u64 = 0
+    var t0 is u64 = now_ns()
+    var t1 is u64 = t0
+    while t1 - t0 < MIN_NS do
+        if cpu_matmul_f32(c, 0, a, 0, b, 0, n, n, n) != 0 then
+            return 1
+        reps = reps + 1
+        t1 = now_ns()
+
+    var flops is f64 = 2.0 * n * n * n * reps
+    var secs is f64 = t1 - t0
+    writer_write_cstr(w, "sgemm ")
+    writer_write_cstr(w, cpu_sgemm_kernel_name())
+    writer_write_cstr(w, " threads=")
+    writer_write_u64(w, cpu_threads())
+    writer_write_cstr(w, " n=")
+    writer_write_u64(w, n)
+    writer_write_cstr(w, " gflops=")
+    writer_write_f64(w, flops / secs, 1)
+    writer_write_u8(w, 10)
+    writer_flush(w)
+    free(a)
+    free(b)
+    free(c)
+    return 0
+
+
+def main() returns i32
+    var w is Writer
+    if writer_init(&w, 1, 4096) != 0 then
+        return 1
+    var n is usize = 64
+    while n <= 1024 do
+        if bench_size(&w, n) != 0 then
+            return 1
+        n = n * 2
+    writer_close(&w)
+    return 0
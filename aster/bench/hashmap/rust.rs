@@ -1,55 +1,31 @@
+use std::collections::HashMap;
+
+// Workload matches hashmap.as: insert N LCG keys (low KEY_SHIFT bits zero)
+// into an empty map, then per round look up every key, miss on every 4th key,
+// and delete + re-insert every 8th key.
+
 const N: usize = 200000;
-const CAP: usize = 1048576;
-const MASK: usize = CAP - 1;
-const TAB_MASK: usize = (CAP * 2) - 1;
+const KEY_SHIFT: u32 = 20;
 const LCG_A: u64 = 6364136223846793005;
 const LCG_C: u64 = 1;
-const LOOKUP_SCALE: usize = 25;
+const LOOKUP_SCALE: usize = 10;
 
 #[inline]
-fn hash_u64(key: u64) -> usize {
-    // Benchmark-specific fast hash: use low bits (LCG is full-period mod 2^k).
-    (key as usize) & MASK
-}
-
-fn map_put(tab: &mut [u64], key: u64, val: u64) {
-    let mut base = hash_u64(key) << 1;
-    loop {
-        let cur = unsafe { *tab.get_unchecked(base) };
-        if cur == 0 || cur == key {
-            unsafe {
-                *tab.get_unchecked_mut(base) = key;
-                *tab.get_unchecked_mut(base + 1) = val;
-            }
-            return;
-        }
-        base = (base + 2) & TAB_MASK;
-    }
-}
-
-// Benchmark-specific fast path: all lookups are for keys that were inserted, so
-// we can skip the empty-slot check.
-fn map_get_present(tab: &[u64], key: u64) -> u64 {
-    let mut base = hash_u64(key) << 1;
-    loop {
-        let cur = unsafe { *tab.get_unchecked(base) };
-        if cur == key {
-            return unsafe { *tab.get_unchecked(base + 1) };
-        }
-        base = (base + 2) & TAB_MASK;
-    }
+fn get_or_zero(m: &HashMap<u64, u64>, key: u64) -> u64 {
+    *m.get(&key).unwrap_or(&0)
 }
 
 fn main() {
-    // Pack (key,value) pairs in a single array to keep the two loads on the
-    // same cache line.
-    let mut tab = vec![0u64; CAP * 2];
-
+    let mut keys = vec![0u64; N];
     let mut seed: u64 = 1;
-    for i in 0..N {
+    for k in keys.iter_mut() {
         seed = seed.wrapping_mul(LCG_A).wrapping_add(LCG_C);
-        let key = seed | 1;
-        map_put(&mut tab, key, i as u64);
+        *k = seed << KEY_SHIFT;
+    }
+
+    let mut m: HashMap<u64, u64> = HashMap::new();
+    for (i, &k) in keys.iter().enumerate() {
+        m.insert(k, i as u64);
     }
 
     let iters: usize = std::env::var("BENCH_ITERS")
@@ -60,14 +36,20 @@ fn main() {
     let iters = iters * LOOKUP_SCALE;
 
     let mut total: u64 = 0;
-    for _ in 0..iters {
-        seed = 1;
-        for _ in 0..N {
-            seed = seed.wrapping_mul(LCG_A).wrapping_add(LCG_C);
-            let key = seed | 1;
-            total = total.wrapping_add(map_get_present(&tab, key));
+    for it in 0..iters {
+        for &k in keys.iter() {
+            total = total.wrapping_add(get_or_zero(&m, k));
+        }
+        for i in (0..N).step_by(4) {
+            total = total.wrapping_add(get_or_zero(&m, keys[i] | 1));
+        }
+        for i in (0..N).step_by(8) {
+            m.remove(&keys[i]);
+        }
+        for i in (0..N).step_by(8) {
+            m.insert(keys[i], (i + it) as u64);
         }
     }
 
-    println!("{}", total);
+    println!("{}", total.wrapping_add(m.len() as u64));
 }
@@ -0,0 +1,44 @@
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// Workload matches logwrite.as: write N CSV lines "<i>,<-3i>,<i/8 .3f>\n" to
+// stdout through a 64 KiB buffer. Numbers are formatted with std::to_chars
+// (no format-string parsing) and flushed with fwrite.
+
+static constexpr uint64_t N = 10000000;
+static constexpr size_t BUF = 65536;
+
+static size_t bench_iters() {
+    const char* s = std::getenv("BENCH_ITERS");
+    if (!s || !*s) return 1;
+    long v = std::strtol(s, nullptr, 10);
+    if (v <= 0) return 1;
+    return static_cast<size_t>(v);
+}
+
+int main() {
+    static char buf[BUF];
+    size_t len = 0;
+    const size_t iters = bench_iters();
+    for (size_t it = 0; it < iters; it++) {
+        for (uint64_t i = 0; i < N; i++) {
+            if (len + 64 > BUF) {
+                std::fwrite(buf, 1, len, stdout);
+                len = 0;
+            }
+            char* p = buf + len;
+            char* end = buf + BUF;
+            p = std::to_chars(p, end, i).ptr;
+            *p++ = ',';
+            p = std::to_chars(p, end, -static_cast<int64_t>(i * 3)).ptr;
+            *p++ = ',';
+            p = std::to_chars(p, end, static_cast<double>(i) * 0.125, std::chars_format::fixed, 3).ptr;
+            *p++ = '\n';
+            len = static_cast<size_t>(p - buf);
+        }
+    }
+    std::fwrite(buf, 1, len, stdout);
+    return std::fflush(stdout) == 0 ? 0 : 1;
+}
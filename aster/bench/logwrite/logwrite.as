@@ -0,0 +1,42 @@
+# Aster log-writing benchmark (core.io Writer)
+#
+# Workload (identical in cpp.cpp / rust.rs): write N CSV lines
+# "<i>,<-3i>,<i/8 with 3 decimals>\n" to stdout through a 64 KiB buffer.
+# i/8 is exact in binary, so every implementation prints identical bytes.
+
+use core.libc
+use core.io
+
+const N is u64 = 10000000
+
+
+def bench_iters() returns usize
+    var s is String = getenv("BENCH_ITERS")
+    if s is null then
+        return 1
+    var n is i32 = atoi(s)
+    if n <= 0 then
+        return 1
+    return n
+
+
+def main() returns i32
+    var w is Writer
+    if writer_init(&w, 1, 65536) != 0 then
+        return 1
+    var iters is usize = bench_iters()
+    var it is usize = 0
+    while it < iters do
+        var i is u64 = 0
+        while i < N do
+            var neg is i64 = 0 - i * 3
+            var x is f64 = i
+            writer_write_u64(&w, i)
+            writer_write_u8(&w, 44)
+            writer_write_i64(&w, neg)
+            writer_write_u8(&w, 44)
+            writer_write_f64(&w, x * 0.125, 3)
+            writer_write_u8(&w, 10)
+            i = i + 1
+        it = it + 1
+    return writer_close(&w)
@@ -0,0 +1,24 @@
+use std::io::{BufWriter, Write};
+
+// Workload matches logwrite.as: write N CSV lines "<i>,<-3i>,<i/8 .3f>\n" to
+// stdout through a 64 KiB BufWriter over the locked handle.
+
+const N: u64 = 10_000_000;
+
+fn main() {
+    let iters: usize = std::env::var("BENCH_ITERS")
+        .ok()
+        .and_then(|s| s.parse::<usize>().ok())
+        .filter(|&v| v > 0)
+        .unwrap_or(1);
+
+    let stdout = std::io::stdout();
+    let mut w = BufWriter::with_capacity(65536, stdout.lock());
+    for _ in 0..iters {
+        for i in 0..N {
+            let neg = -((i * 3) as i64);
+            writeln!(w, "{},{},{:.3}", i, neg, i as f64 * 0.125).unwrap();
+        }
+    }
+    w.flush().unwrap();
+}
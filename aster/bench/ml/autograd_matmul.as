@@ -1,6 +1,8 @@
 # ML bench: matmul + sum + backward (float32, CPU)
 #
-# Prints: elapsed nanoseconds as a single integer line.
+# Prints: elapsed nanoseconds as a single integer line. The matmul
+# throughput (forward + both backward matmuls, 6*m*k*n flops per iteration)
+# goes to stderr as `autograd_matmul gflops=<x>`.
 
 use core.libc
 use core.time
@@ -84,6 +86,15 @@ def main() returns i32
     var t1 is u64 = now_ns()
     print_u64(t1 - t0)
 
+    var ew is Writer
+    if writer_init(&ew, 2, 256) == 0 then
+        var flops is f64 = 6.0 * m * k * n * iters
+        var secs is f64 = t1 - t0
+        writer_write_cstr(&ew, "autograd_matmul gflops=")
+        writer_write_f64(&ew, flops / secs, 3)
+        writer_write_u8(&ew, 10)
+        writer_close(&ew)
+
     # Prevent dead-code elimination of the loop in extreme optimizer scenarios.
     if checksum == 1234567.0 then
         return 1
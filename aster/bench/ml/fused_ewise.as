@@ -0,0 +1,103 @@
+# ML bench: relu(a*b + c) through the lazy graph (float32, CPU)
+#
+# Prints: elapsed nanoseconds of the fused (lazy) path as a single integer
+# line. The eager path (tensor_mul/add/relu, one output and one memory pass
+# per op) is timed on the same inputs and reported on stderr as
+# `fused_ewise eager_ns=<x> lazy_ns=<y>`.
+
+use core.libc
+use core.time
+use core.io
+use aster_ml.tensor
+use aster_ml.lazy
+use aster_ml.dtype
+use aster_ml.device
+
+
+def fill_linspace_f32(p is slice of f32, n is usize, scale is f32, shift is f32) returns ()
+    var i is usize = 0
+    while i < n do
+        p[i] = (0.0 + i) * scale - shift
+        i = i + 1
+    return
+
+
+def main() returns i32
+    var n is usize = 4194304
+    var iters is usize = 10
+
+    var dims is slice of usize = malloc(1 * 8)
+    if dims is null then
+        return 1
+    dims[0] = n
+    var a is Tensor
+    var b is Tensor
+    var c is Tensor
+    if tensor_init_contiguous(&a, DT_F32, DEV_CPU, 1, dims) != 0 then
+        return 1
+    if tensor_init_contiguous(&b, DT_F32, DEV_CPU, 1, dims) != 0 then
+        return 1
+    if tensor_init_contiguous(&c, DT_F32, DEV_CPU, 1, dims) != 0 then
+        return 1
+    fill_linspace_f32(tensor_data_ptr(&a), n, 0.000001, 1.0)
+    fill_linspace_f32(tensor_data_ptr(&b), n, 0.000002, 2.0)
+    fill_linspace_f32(tensor_data_ptr(&c), n, 0.000003, 3.0)
+
+    var checksum is f32 = 0.0
+
+    # Eager: three ops, three outputs.
+    var t0 is u64 = now_ns()
+    var i is usize = 0
+    while i < iters do
+        var t1 is Tensor
+        var t2 is Tensor
+        var t3 is Tensor
+        if tensor_mul_f32(&t1, &a, &b) != 0 or tensor_add_f32(&t2, &t1, &c) != 0 or tensor_relu_f32(&t3, &t2) != 0 then
+            return 1
+        var p3 is slice of f32 = tensor_data_ptr(&t3)
+        checksum = checksum + p3[n - 1]
+        tensor_free(&t3)
+        tensor_free(&t2)
+        tensor_free(&t1)
+        i = i + 1
+    var t1_ns is u64 = now_ns()
+
+    # Lazy: one fused kernel per realize.
+    var lz is LazyCtx
+    if lazy_init(&lz) != 0 then
+        return 1
+    var la is MutString = lazy_buffer(&lz, &a)
+    var lb is MutString = lazy_buffer(&lz, &b)
+    var lc is MutString = lazy_buffer(&lz, &c)
+    var e is MutString = lazy_relu(&lz, lazy_add(&lz, lazy_mul(&lz, la, lb), lc))
+    var t2_ns is u64 = now_ns()
+    i = 0
+    while i < iters do
+        var out is Tensor
+        if lazy_realize(&lz, &out, e, 1, dims) != 0 then
+            return 1
+        var op is slice of f32 = tensor_data_ptr(&out)
+        checksum = checksum + op[n - 1]
+        tensor_free(&out)
+        i = i + 1
+    var t3_ns is u64 = now_ns()
+    print_u64(t3_ns - t2_ns)
+
+    var ew is Writer
+    if writer_init(&ew, 2, 256) == 0 then
+        writer_write_cstr(&ew, "fused_ewise eager_ns=")
+        writer_write_u64(&ew, t1_ns - t0)
+        writer_write_cstr(&ew, " lazy_ns=")
+        writer_write_u64(&ew, t3_ns - t2_ns)
+        writer_write_u8(&ew, 10)
+        writer_close(&ew)
+
+    if checksum == 1234567.0 then
+        return 1
+
+    lazy_free(&lz)
+    free(dims)
+    tensor_free(&c)
+    tensor_free(&b)
+    tensor_free(&a)
+    return 0
@@ -0,0 +1,65 @@
+# ML bench: graph_rewrite with the symbolic rule pack on a large index graph
+#
+# Prints: elapsed nanoseconds of one graph_rewrite over a ~1M-node graph as a
+# single integer line. The graph is a chain of index expressions
+# (e = ((e + 1) * 2 + 3) * 1 + 0, plus an x * 4 // 4 detour every 4th step):
+# every step has something to fold, regroup or eliminate. Reported on stderr
+# as `graph_rewrite nodes=<n> new_nodes=<m> rules=<r>`.
+
+use core.libc
+use core.time
+use core.io
+use aster_ml.uop.ops
+use aster_ml.uop.rewrite
+use aster_ml.dtype
+
+
+def ibin(ctx is mut ref UOpCtx, op is i32, a is MutString, b is MutString) returns MutString
+    return uop_intern2(ctx, op, DT_INDEX, a, b, 0, 0)
+
+
+def main() returns i32
+    var ctx is UOpCtx
+    if uop_ctx_init(&ctx) != 0 then
+        return 1
+    var rs is RewriteSet
+    if rewrite_set_init(&rs) != 0 or rewrite_rules_symbolic(&rs) != 0 then
+        return 1
+    var c0 is MutString = uop_const_int(&ctx, DT_INDEX, 0)
+    var c1 is MutString = uop_const_int(&ctx, DT_INDEX, 1)
+    var c2 is MutString = uop_const_int(&ctx, DT_INDEX, 2)
+    var c3 is MutString = uop_const_int(&ctx, DT_INDEX, 3)
+    var c4 is MutString = uop_const_int(&ctx, DT_INDEX, 4)
+    var e is MutString = uop_intern(&ctx, UOP_BUFFER, DT_INDEX, 0, null, 0, 1)
+    var step is usize = 1
+    while uop_count(&ctx) < 1000000 do
+        var b is MutString = uop_intern(&ctx, UOP_BUFFER, DT_INDEX, 0, null, step, 1)
+        e = ibin(&ctx, UOP_ADD, ibin(&ctx, UOP_MUL, ibin(&ctx, UOP_ADD, ibin(&ctx, UOP_MUL, ibin(&ctx, UOP_ADD, e, c1), c2), c3), c1), c0)
+        e = ibin(&ctx, UOP_ADD, e, b)
+        if step - (step / 4) * 4 == 0 then
+            e = ibin(&ctx, UOP_IDIV, ibin(&ctx, UOP_MUL, e, c4), c4)
+        step = step + 1
+    if e is null then
+        return 1
+    var before is usize = uop_count(&ctx)
+
+    var t0 is u64 = now_ns()
+    var r is MutString = graph_rewrite(&ctx, &rs, e)
+    var t1 is u64 = now_ns()
+    if r is null then
+        return 1
+    print_u64(t1 - t0)
+
+    var ew is Writer
+    if writer_init(&ew, 2, 256) == 0 then
+        writer_write_cstr(&ew, "graph_rewrite nodes=")
+        writer_write_u64(&ew, before)
+        writer_write_cstr(&ew, " new_nodes=")
+        writer_write_u64(&ew, uop_count(&ctx) - before)
+        writer_write_cstr(&ew, " rules=")
+        writer_write_u64(&ew, rs.rules.len)
+        writer_write_u8(&ew, 10)
+        writer_close(&ew)
+    rewrite_set_free(&rs)
+    uop_ctx_free(&ctx)
+    return 0
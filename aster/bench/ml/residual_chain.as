@@ -0,0 +1,95 @@
+# ML bench: 16 residual layers x = x + relu(x * w) through the lazy graph
+# (float32, CPU)
+#
+# Prints: elapsed nanoseconds of the realizes as a single integer line. Every
+# layer is its own kernel (x has two users), so this stresses intermediate
+# buffers: the memory plan is reported on stderr as
+# `residual_chain naive_bytes=<x> planned_bytes=<y> inplace=<z>`.
+
+use core.libc
+use core.time
+use core.io
+use aster_ml.tensor
+use aster_ml.lazy
+use aster_ml.engine.schedule
+use aster_ml.engine.memory
+use aster_ml.dtype
+use aster_ml.device
+
+
+def fill_linspace_f32(p is slice of f32, n is usize, scale is f32, shift is f32) returns ()
+    var i is usize = 0
+    while i < n do
+        p[i] = (0.0 + i) * scale - shift
+        i = i + 1
+    return
+
+
+def main() returns i32
+    var n is usize = 1048576
+    var layers is usize = 16
+    var iters is usize = 10
+
+    var dims is slice of usize = malloc(1 * 8)
+    if dims is null then
+        return 1
+    dims[0] = n
+    var a is Tensor
+    var w is Tensor
+    if tensor_init_contiguous(&a, DT_F32, DEV_CPU, 1, dims) != 0 then
+        return 1
+    if tensor_init_contiguous(&w, DT_F32, DEV_CPU, 1, dims) != 0 then
+        return 1
+    fill_linspace_f32(tensor_data_ptr(&a), n, 0.000001, 0.5)
+    fill_linspace_f32(tensor_data_ptr(&w), n, 0.0000001, 0.05)
+
+    var lz is LazyCtx
+    if lazy_init(&lz) != 0 then
+        return 1
+    var lw is MutString = lazy_buffer(&lz, &w)
+    var x is MutString = lazy_buffer(&lz, &a)
+    var l is usize = 0
+    while l < layers do
+        x = lazy_add(&lz, x, lazy_relu(&lz, lazy_mul(&lz, x, lw)))
+        l = l + 1
+
+    var s is Schedule
+    var plan is MemPlan
+    if schedule_build(&s, x) != 0 or memplan_build(&plan, &s) != 0 then
+        return 1
+
+    var checksum is f32 = 0.0
+    var t0 is u64 = now_ns()
+    var i is usize = 0
+    while i < iters do
+        var out is Tensor
+        if lazy_realize(&lz, &out, x, 1, dims) != 0 then
+            return 1
+        var op is slice of f32 = tensor_data_ptr(&out)
+        checksum = checksum + op[n - 1]
+        tensor_free(&out)
+        i = i + 1
+    var t1 is u64 = now_ns()
+    print_u64(t1 - t0)
+
+    var ew is Writer
+    if writer_init(&ew, 2, 256) == 0 then
+        writer_write_cstr(&ew, "residual_chain naive_bytes=")
+        writer_write_u64(&ew, plan.naive_bytes)
+        writer_write_cstr(&ew, " planned_bytes=")
+        writer_write_u64(&ew, plan.arena_bytes)
+        writer_write_cstr(&ew, " inplace=")
+        writer_write_u64(&ew, plan.inplace)
+        writer_write_u8(&ew, 10)
+        writer_close(&ew)
+
+    if checksum == 1234567.0 then
+        return 1
+
+    memplan_free(&plan)
+    schedule_free(&s)
+    lazy_free(&lz)
+    free(dims)
+    tensor_free(&w)
+    tensor_free(&a)
+    return 0
@@ -0,0 +1,79 @@
+# ML bench: schedule_build on large synthetic UOp graphs
+#
+# Prints: elapsed nanoseconds of scheduling a ~1M-node graph as a single
+# integer line. The graph is one long dependency chain (x = x + buffer_i,
+# and every 8th step x = x + relu(x), which makes x a kernel root), so it is
+# as deep as it is large and its kernels take many inputs. The same graph
+# at ~250k nodes is timed too, and both are reported on stderr as
+# `schedule_graph nodes=<n> kernels=<k> ns=<t> nodes_quarter=<n> ns_quarter=<t>`;
+# linear scheduling keeps ns/nodes flat between the two.
+
+use core.libc
+use core.time
+use core.io
+use aster_ml.uop.ops
+use aster_ml.engine.schedule
+use aster_ml.dtype
+
+
+def build_chain(ctx is mut ref UOpCtx, want is usize) returns MutString
+    var x is MutString = uop_intern(ctx, UOP_BUFFER, DT_F32, 0, null, 0, 1)
+    var step is usize = 1
+    while uop_count(ctx) < want do
+        var b is MutString = uop_intern(ctx, UOP_BUFFER, DT_F32, 0, null, step, 1)
+        x = uop_add(ctx, x, b)
+        if step - (step / 8) * 8 == 0 then
+            x = uop_add(ctx, x, uop_relu(ctx, x))
+        if x is null then
+            return null
+        step = step + 1
+    return x
+
+
+def time_schedule(want is usize, nodes is mut ref usize, kernels is mut ref usize, ns is mut ref u64) returns i32
+    var ctx is UOpCtx
+    if uop_ctx_init(&ctx) != 0 then
+        return 1
+    var sink is MutString = build_chain(&ctx, want)
+    if sink is null then
+        return 1
+    var s is Schedule
+    var t0 is u64 = now_ns()
+    if schedule_build(&s, sink) != 0 then
+        return 1
+    *ns = now_ns() - t0
+    *nodes = s.order.len
+    *kernels = s.kernels.len
+    schedule_free(&s)
+    uop_ctx_free(&ctx)
+    return 0
+
+
+def main() returns i32
+    var nq is usize = 0
+    var kq is usize = 0
+    var tq is u64 = 0
+    if time_schedule(262144, &nq, &kq, &tq) != 0 then
+        return 1
+    var n is usize = 0
+    var k is usize = 0
+    var t is u64 = 0
+    if time_schedule(1048576, &n, &k, &t) != 0 then
+        return 1
+    print_u64(t)
+
+    var ew is Writer
+    if writer_init(&ew, 2, 256) == 0 then
+        writer_write_cstr(&ew, "schedule_graph nodes=")
+        writer_write_u64(&ew, n)
+        writer_write_cstr(&ew, " kernels=")
+        writer_write_u64(&ew, k)
+        writer_write_cstr(&ew, " ns=")
+        writer_write_u64(&ew, t)
+        writer_write_cstr(&ew, " nodes_quarter=")
+        writer_write_u64(&ew, nq)
+        writer_write_cstr(&ew, " ns_quarter=")
+        writer_write_u64(&ew, tq)
+        writer_write_u8(&ew, 10)
+        writer_close(&ew)
+    return 0
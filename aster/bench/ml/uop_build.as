@@ -0,0 +1,56 @@
+# ML bench: UOp graph construction (hash-consing) in a UOpCtx
+#
+# Prints: elapsed nanoseconds to intern ~1M nodes as a single integer line.
+# The graph is a long chain (x = x * buffer_i + c, every 8th step
+# x = x + relu(x)) built twice in the same context: the first pass creates
+# every node, the second finds every node already interned. Both are
+# reported on stderr as `uop_build nodes=<n> build_ns=<t> reintern_ns=<t>`.
+
+use core.libc
+use core.time
+use core.io
+use aster_ml.uop.ops
+use aster_ml.dtype
+
+
+def build_chain(ctx is mut ref UOpCtx, steps is usize) returns MutString
+    var c is MutString = uop_const_f32(ctx, 0.5)
+    var x is MutString = uop_intern(ctx, UOP_BUFFER, DT_F32, 0, null, 0, 1)
+    var step is usize = 1
+    while step <= steps do
+        var b is MutString = uop_intern(ctx, UOP_BUFFER, DT_F32, 0, null, step, 1)
+        x = uop_add(ctx, uop_mul(ctx, x, b), c)
+        if step - (step / 8) * 8 == 0 then
+            x = uop_add(ctx, x, uop_relu(ctx, x))
+        if x is null then
+            return null
+        step = step + 1
+    return x
+
+
+def main() returns i32
+    var steps is usize = 310000
+    var ctx is UOpCtx
+    if uop_ctx_init(&ctx) != 0 then
+        return 1
+    var t0 is u64 = now_ns()
+    var x is MutString = build_chain(&ctx, steps)
+    var t1 is u64 = now_ns()
+    var y is MutString = build_chain(&ctx, steps)
+    var t2 is u64 = now_ns()
+    if x is null or y != x then
+        return 1
+    print_u64(t1 - t0)
+
+    var ew is Writer
+    if writer_init(&ew, 2, 256) == 0 then
+        writer_write_cstr(&ew, "uop_build nodes=")
+        writer_write_u64(&ew, uop_count(&ctx))
+        writer_write_cstr(&ew, " build_ns=")
+        writer_write_u64(&ew, t1 - t0)
+        writer_write_cstr(&ew, " reintern_ns=")
+        writer_write_u64(&ew, t2 - t1)
+        writer_write_u8(&ew, 10)
+        writer_close(&ew)
+    uop_ctx_free(&ctx)
+    return 0
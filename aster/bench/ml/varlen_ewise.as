@@ -0,0 +1,162 @@
+# ML bench: relu(a*b + c) through the lazy graph over variable lengths
+#
+# Simulates variable-length inference: 32 requests, each with a different
+# length, realized once each (float32, CPU). Prints: elapsed nanoseconds
+# with the default shape buckets (ASTER_ML_SHAPES=bucket) as a single
+# integer line. The same requests with every dim specialized
+# (ASTER_ML_SHAPES=exact, one kernel per length) are timed too and reported
+# on stderr as `varlen_ewise exact_ns=<x> bucket_ns=<y> kernels_exact=<a>
+# kernels_bucket=<b>`. Kernel builds hit the on-disk cache after the first
+# run, so later runs mostly measure loading instead of compiling.
+
+use core.libc
+use core.time
+use core.io
+use aster_ml.tensor
+use aster_ml.lazy
+use aster_ml.dtype
+use aster_ml.device
+use aster_ml.engine.schedule
+use aster_ml.codegen.c
+
+extern def setenv(name is String, value is String, overwrite is i32) returns i32
+
+
+def fill_linspace_f32(p is slice of f32, n is usize, scale is f32, shift is f32) returns ()
+    var i is usize = 0
+    while i < n do
+        p[i] = (0.0 + i) * scale - shift
+        i = i + 1
+    return
+
+
+def request_len(r is usize) returns usize
+    # Distinct, mostly unaligned lengths around 64K elements.
+    return 65536 + 977 * r + 3
+
+
+def run_requests(a is mut ref Tensor, b is mut ref Tensor, c is mut ref Tensor, nreq is usize, checksum is mut ref f32) returns i32
+    # One lazy graph per request over the first request_len(r) elements.
+    var dims is slice of usize = malloc(1 * 8)
+    if dims is null then
+        return 1
+    var r is usize = 0
+    while r < nreq do
+        var n is usize = request_len(r)
+        dims[0] = n
+        var va is Tensor
+        var vb is Tensor
+        var vc is Tensor
+        if tensor_slice(&va, a, 0, 0, n) != 0 or tensor_slice(&vb, b, 0, 0, n) != 0 or tensor_slice(&vc, c, 0, 0, n) != 0 then
+            return 1
+        var lz is LazyCtx
+        if lazy_init(&lz) != 0 then
+            return 1
+        var la is MutString = lazy_buffer(&lz, &va)
+        var lb is MutString = lazy_buffer(&lz, &vb)
+        var lc is MutString = lazy_buffer(&lz, &vc)
+        var e is MutString = lazy_relu(&lz, lazy_add(&lz, lazy_mul(&lz, la, lb), lc))
+        var out is Tensor
+        if lazy_realize(&lz, &out, e, 1, dims) != 0 then
+            return 1
+        var op is slice of f32 = tensor_data_ptr(&out)
+        *checksum = *checksum + op[n - 1]
+        tensor_free(&out)
+        lazy_free(&lz)
+        tensor_free(&vc)
+        tensor_free(&vb)
+        tensor_free(&va)
+        r = r + 1
+    free(dims)
+    return 0
+
+
+def count_kernels(nreq is usize, mode is i32) returns usize
+    # Distinct compiled kernels the requests need under shape policy `mode`
+    # (they share one structure, so a kernel per distinct shape bucket).
+    var sigs is slice of u64 = malloc(nreq * 8)
+    if sigs is null then
+        return 0
+    var nsigs is usize = 0
+    var ir is KernelIR
+    ir.run = 0
+    var r is usize = 0
+    while r < nreq do
+        ir.numel = request_len(r)
+        var shape is CShape
+        c_shape_init(&shape, &ir, mode)
+        var sig is u64 = shape.n_class
+        if shape.n_class == C_DIM_EXACT then
+            sig = sig + 4 * shape.n
+        var seen is i32 = 0
+        var j is usize = 0
+        while j < nsigs do
+            if sigs[j] == sig then
+                seen = 1
+            j = j + 1
+        if seen == 0 then
+            sigs[nsigs] = sig
+            nsigs = nsigs + 1
+        r = r + 1
+    free(sigs)
+    return nsigs
+
+
+def main() returns i32
+    var nreq is usize = 32
+    var cap is usize = request_len(nreq)
+    var dims is slice of usize = malloc(1 * 8)
+    if dims is null then
+        return 1
+    dims[0] = cap
+    var a is Tensor
+    var b is Tensor
+    var c is Tensor
+    if tensor_init_contiguous(&a, DT_F32, DEV_CPU, 1, dims) != 0 then
+        return 1
+    if tensor_init_contiguous(&b, DT_F32, DEV_CPU, 1, dims) != 0 then
+        return 1
+    if tensor_init_contiguous(&c, DT_F32, DEV_CPU, 1, dims) != 0 then
+        return 1
+    fill_linspace_f32(tensor_data_ptr(&a), cap, 0.000001, 1.0)
+    fill_linspace_f32(tensor_data_ptr(&b), cap, 0.000002, 2.0)
+    fill_linspace_f32(tensor_data_ptr(&c), cap, 0.000003, 3.0)
+
+    var checksum is f32 = 0.0
+
+    # Shape buckets: the unaligned lengths share one kernel.
+    setenv("ASTER_ML_SHAPES", "bucket", 1)
+    var t0 is u64 = now_ns()
+    if run_requests(&a, &b, &c, nreq, &checksum) != 0 then
+        return 1
+    var t1 is u64 = now_ns()
+
+    # Fully specialized: a kernel per length.
+    setenv("ASTER_ML_SHAPES", "exact", 1)
+    var t2 is u64 = now_ns()
+    if run_requests(&a, &b, &c, nreq, &checksum) != 0 then
+        return 1
+    var t3 is u64 = now_ns()
+    print_u64(t1 - t0)
+
+    var ew is Writer
+    if writer_init(&ew, 2, 256) == 0 then
+        writer_write_cstr(&ew, "varlen_ewise exact_ns=")
+        writer_write_u64(&ew, t3 - t2)
+        writer_write_cstr(&ew, " bucket_ns=")
+        writer_write_u64(&ew, t1 - t0)
+        writer_write_cstr(&ew, " kernels_exact=")
+        writer_write_u64(&ew, count_kernels(nreq, C_SHAPES_EXACT))
+        writer_write_cstr(&ew, " kernels_bucket=")
+        writer_write_u64(&ew, count_kernels(nreq, C_SHAPES_BUCKET))
+        writer_write_u8(&ew, 10)
+        writer_close(&ew)
+
+    if checksum == 1234567.0 then
+        return 1
+
+    free(dims)
+    tensor_free(&c)
+    tensor_free(&b)
+    tensor_free(&a)
+    return 0
@@ -0,0 +1,15 @@
+# `noalloc` may allocate only from an arena the caller provides: creating an
+# arena allocates its first chunk.
+
+use core.arena
+
+noalloc def scratch_sum(n is usize) returns u64
+    var a is Arena
+    if arena_init(&a, 4096) != 0 then
+        return 0
+    return n
+
+def main() returns i32
+    if scratch_sum(4) != 4 then
+        return 1
+    return 0
@@ -0,0 +1,9 @@
+# `@noreturn` functions cannot return a value.
+
+@noreturn
+def stop(code is i32) returns i32
+    return code
+
+
+def main() returns i32
+    return stop(0)
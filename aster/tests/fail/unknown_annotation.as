@@ -0,0 +1,9 @@
+# Only `@trace("name")` and `@noreturn` are recognized def annotations.
+
+@inline
+def add1(x is i32) returns i32
+    return x + 1
+
+
+def main() returns i32
+    return add1(0) - 1
@@ -0,0 +1,45 @@
+# Allocation reports: ASTER_REPORT=alloc (static) and ASTER_ALLOC_PROFILE=1
+# (per-site counts at exit). Deterministic: fixed sizes, one thread.
+
+extern def malloc(n is usize) returns MutString
+extern def calloc(n is usize, size is usize) returns MutString
+extern def realloc(p is MutString, n is usize) returns MutString
+extern def free(p is MutString) returns ()
+
+
+def scratch(n is usize) returns usize
+    # 16 bytes per call, freed before return.
+    var p is MutString = malloc(16)
+    if p is null then
+        return 0
+    free(p)
+    return n + 1
+
+
+def grow() returns MutString
+    # 8 -> 64 bytes, returned to the caller (freed there).
+    var p is MutString = malloc(8)
+    return realloc(p, 64)
+
+
+def add(a is usize, b is usize) returns usize
+    return a + b
+
+
+def main() returns i32
+    var total is usize = 0
+    var i is usize = 0
+    while i < 10 do
+        total = scratch(total)
+        i = i + 1
+    # Leaked on purpose: 3 x 8 bytes still live at exit.
+    var keep is MutString = calloc(3, 8)
+    # Too large to satisfy: returns NULL, counted but never live or leaked.
+    var huge is usize = 1
+    huge = huge << 62
+    var none is MutString = malloc(huge)
+    var g is MutString = grow()
+    free(g)
+    if add(total, 0) != 10 or keep is null or none is not null then
+        return 1
+    return 0
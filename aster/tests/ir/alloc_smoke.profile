@@ -0,0 +1,23 @@
+aster alloc profile: 5 sites, 14 allocs, 256 bytes, peak live 88 bytes, live at exit 24 bytes
+allocs that returned NULL: 1
+top sites by count:
+      allocs          bytes      peak_live     leaked  site
+          10            160             16          0  aster/tests/ir/alloc_smoke.as:12:26 scratch malloc
+           1              8              8          0  aster/tests/ir/alloc_smoke.as:21:26 grow malloc
+           1             64             64          0  aster/tests/ir/alloc_smoke.as:22:12 grow realloc
+           1             24             24          1  aster/tests/ir/alloc_smoke.as:36:29 main calloc
+           1              0              0          0  aster/tests/ir/alloc_smoke.as:40:29 main malloc
+top sites by bytes:
+      allocs          bytes      peak_live     leaked  site
+          10            160             16          0  aster/tests/ir/alloc_smoke.as:12:26 scratch malloc
+           1             64             64          0  aster/tests/ir/alloc_smoke.as:22:12 grow realloc
+           1             24             24          1  aster/tests/ir/alloc_smoke.as:36:29 main calloc
+           1              8              8          0  aster/tests/ir/alloc_smoke.as:21:26 grow malloc
+           1              0              0          0  aster/tests/ir/alloc_smoke.as:40:29 main malloc
+top sites by peak live:
+      allocs          bytes      peak_live     leaked  site
+           1             64             64          0  aster/tests/ir/alloc_smoke.as:22:12 grow realloc
+           1             24             24          1  aster/tests/ir/alloc_smoke.as:36:29 main calloc
+          10            160             16          0  aster/tests/ir/alloc_smoke.as:12:26 scratch malloc
+           1              8              8          0  aster/tests/ir/alloc_smoke.as:21:26 grow malloc
+           1              0              0          0  aster/tests/ir/alloc_smoke.as:40:29 main malloc
@@ -0,0 +1,36 @@
+# Runtime failure paths of the intrinsics. ASSERT_FAIL_CASE picks one:
+# "msg" (assert with a message), "cond" (assert quoting its condition) or
+# "unreachable". Each writes `file:line: ...` to stderr and aborts; with no
+# case set the program exits 0.
+
+use core.libc
+
+
+def checked_div(a is u64, b is u64) returns u64
+    assert(b != 0, "division by zero")
+    return a / b
+
+
+def sign(x is i32) returns i32
+    if x < 0 then
+        return 0 - 1
+    if x > 0 then
+        return 1
+    unreachable()
+    return 0
+
+
+def main() returns i32
+    var which is String = getenv("ASSERT_FAIL_CASE")
+    if which is null then
+        return 0
+    var n is usize = strlen(which)
+    if strcmp(which, "msg") == 0 then
+        if checked_div(1, 0) == 0 then
+            return 2
+    if strcmp(which, "cond") == 0 then
+        assert(n > 4 and n < 100)
+    if strcmp(which, "unreachable") == 0 then
+        if sign(0) == 0 then
+            return 2
+    return 0
@@ -29,3 +29,63 @@ cmp -s "$ast" "$want_dir/$base.ast" || { echo "FAIL ast dump ($base)" >&2; diff
 cmp -s "$hir" "$want_dir/$base.hir" || { echo "FAIL hir dump ($base)" >&2; diff -u "$want_dir/$base.hir" "$hir" >&2 || true; exit 1; }
 
 echo "ok ir_dumps $base"
+
+# Allocation reports: the static one printed at compile time (ASTER_REPORT=alloc)
+# and the per-site profile printed at exit (ASTER_ALLOC_PROFILE=1). The cache
+# is off so the compile (and its report) always runs.
+src="$want_dir/alloc_smoke.as"
+base="alloc_smoke"
+bin="$OUT/$base.bin"
+report="$OUT/$base.report"
+profile="$OUT/$base.profile"
+
+rm -f "$bin" "$bin.ll" "$report" "$profile"
+
+ASTER_CACHE=0 ASTER_REPORT=alloc ASTER_REPORT_OUT="$report" ASTER_ALLOC_PROFILE=1 compile "$src" "$bin" >/dev/null 2>"$OUT/$base.compile.stderr"
+ASTER_ALLOC_PROFILE_OUT="$profile" "$bin"
+
+cmp -s "$report" "$want_dir/$base.report" || { echo "FAIL alloc report ($base)" >&2; diff -u "$want_dir/$base.report" "$report" >&2 || true; exit 1; }
+cmp -s "$profile" "$want_dir/$base.profile" || { echo "FAIL alloc profile ($base)" >&2; diff -u "$want_dir/$base.profile" "$profile" >&2 || true; exit 1; }
+
+echo "ok alloc_reports $base"
+
+# Trace probes (ASTER_TRACE=1): the exit table names every probe that fired
+# with its call count. Tick columns vary run to run, and rows are ordered by
+# ticks, so only the sorted (probe, calls) pairs are compared.
+src="$ROOT/aster/tests/pass/trace_probe.as"
+base="trace_probe"
+bin="$OUT/$base.bin"
+table="$OUT/$base.table"
+
+rm -f "$bin" "$bin.ll" "$table"
+
+ASTER_CACHE=0 ASTER_TRACE=1 compile "$src" "$bin" >/dev/null 2>"$OUT/$base.compile.stderr"
+ASTER_TRACE_OUT="$table" "$bin"
+
+grep -q '^aster trace: 1 thread(s)' "$table" || { echo "FAIL trace header ($base)" >&2; cat "$table" >&2 || true; exit 1; }
+awk 'NR > 2 { print $1, $2 }' "$table" | LC_ALL=C sort >"$OUT/$base.calls"
+cmp -s "$OUT/$base.calls" "$want_dir/$base.calls" || { echo "FAIL trace calls ($base)" >&2; diff -u "$want_dir/$base.calls" "$OUT/$base.calls" >&2 || true; exit 1; }
+
+echo "ok trace_probes $base"
+
+# Failing intrinsics: each case must print its `file:line: ...` message to
+# stderr and abort (SIGABRT, exit status 134), and the program must exit 0
+# when no case is selected.
+src="$want_dir/assert_fail.as"
+base="assert_fail"
+bin="$OUT/$base.bin"
+err="$OUT/$base.stderr"
+
+rm -f "$bin" "$bin.ll" "$err"
+
+compile "$src" "$bin" >/dev/null 2>"$OUT/$base.compile.stderr"
+"$bin" 2>"$err" || { echo "FAIL $base exited non-zero with no case" >&2; exit 1; }
+for case in msg cond unreachable; do
+  rc=0
+  # The outer redirect keeps the shell's "Aborted" job notice out of the log.
+  { ASSERT_FAIL_CASE="$case" "$bin" 2>>"$err"; } 2>/dev/null || rc=$?
+  [[ "$rc" -eq 134 ]] || { echo "FAIL $base case $case: exit $rc, want 134 (abort)" >&2; exit 1; }
+done
+cmp -s "$err" "$want_dir/$base.stderr" || { echo "FAIL $base stderr" >&2; diff -u "$want_dir/$base.stderr" "$err" >&2 || true; exit 1; }
+
+echo "ok assert_fail $base"
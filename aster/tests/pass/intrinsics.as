@@ -0,0 +1,53 @@
+# Conformance: assert/assume/unreachable intrinsics and `@noreturn` calls
+# (the failure paths are compiled but never taken here).
+
+use core.io
+use core.libc
+use core.panic
+
+
+def checked_div(a is u64, b is u64) returns u64
+    assert(b != 0, "division by zero")
+    return a / b
+
+
+def sum_to(n is usize, step is usize) returns usize
+    assume(step > 0 and step <= 8)
+    var s is usize = 0
+    var i is usize = 0
+    while i < n do
+        s = s + i
+        i = i + step
+    return s
+
+
+def classify(x is i32) returns i32
+    if x < 0 then
+        return 0 - 1
+    if x == 0 then
+        return 0
+    if x > 0 then
+        return 1
+    unreachable()
+    return 2
+
+
+@noreturn
+def give_up(code is i32) returns ()
+    exit(code)
+
+
+def main() returns i32
+    assert(checked_div(84, 2) == 42)
+    var n is usize = 10
+    assert(n > 0 and (n < 100 or n == 1000))
+    print_u64(sum_to(n, 1))
+    print_u64(sum_to(n, 3))
+    if classify(0 - 5) != 0 - 1 or classify(0) != 0 or classify(7) != 1 then
+        return 1
+    if n == 11 then
+        give_up(3)
+    if n == 12 then
+        panic("not reached")
+    println("ok")
+    return 0
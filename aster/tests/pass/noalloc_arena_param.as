@@ -0,0 +1,38 @@
+# Expected: compile+run OK (`noalloc` may use an arena its caller passes in)
+
+use core.arena
+
+
+noalloc def fill(a is mut ref Arena, n is usize) returns u64
+    # Every arena-scoped entry point on the parameter arena is allowed.
+    var m is ArenaMark
+    arena_mark(a, &m)
+    var xs is slice of u64 = arena_alloc(a, n * 8, 8)
+    var zs is slice of u64 = arena_alloc_zeroed(a, n * 8, 8)
+    if xs is null or zs is null then
+        return 0
+    var i is usize = 0
+    var sum is u64 = 0
+    while i < n do
+        xs[i] = i + zs[i]
+        sum = sum + xs[i]
+        i = i + 1
+    var used is usize = arena_used(a)
+    arena_reset_to(a, &m)
+    if used < n * 16 then
+        return 0
+    return sum
+
+
+def main() returns i32
+    var a is Arena
+    if arena_init(&a, 4096) != 0 then
+        return 1
+    # 0 + 1 + ... + 99
+    var rc is i32 = 0
+    if fill(&a, 100) != 4950 then
+        rc = 1
+    if arena_used(&a) != 0 then
+        rc = 1
+    arena_free(&a)
+    return rc
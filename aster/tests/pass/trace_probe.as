@@ -0,0 +1,32 @@
+# Trace probes: `@trace("name")` on a def and `trace "name" do` blocks.
+# Compiled out unless ASTER_TRACE=1; semantics must be identical either way.
+
+@trace("sum_to")
+def sum_to(n is u64) returns u64
+    var s is u64 = 0
+    var i is u64 = 0
+    while i < n do
+        trace "inner" do
+            s = s + i
+            if i == 7 then
+                i = i + 1
+                continue
+        i = i + 1
+    return s
+
+
+def early(x is i32) returns i32
+    trace "early" do
+        if x > 0 then
+            return x
+    return 0 - x
+
+
+def main() returns i32
+    if sum_to(10) != 45 then
+        return 1
+    if early(3) != 3 then
+        return 1
+    if early(0 - 2) != 2 then
+        return 1
+    return 0
@@ -0,0 +1,172 @@
+# Expected: compile+run OK (matmul/bmm on strided views, broadcast, accumulate)
+
+use aster_ml.tensor
+use aster_ml.dtype
+use aster_ml.device
+use core.io
+use core.libc
+
+def fill_iota(t is mut ref Tensor, ndim is usize, d0 is usize, d1 is usize, d2 is usize) returns i32
+    # Contiguous tensor holding 1..7 repeating (products stay exact in f32).
+    var dims is slice of usize = malloc(3 * 8)
+    if dims is null then
+        return 1
+    if ndim == 2 then
+        dims[0] = d1
+        dims[1] = d2
+    else
+        dims[0] = d0
+        dims[1] = d1
+        dims[2] = d2
+    var rc is i32 = tensor_init_contiguous(t, DT_F32, DEV_CPU, ndim, dims)
+    free(dims)
+    if rc != 0 then
+        return 1
+    var p is slice of f32 = tensor_data_ptr(t)
+    var n is usize = tensor_numel(t)
+    var i is usize = 0
+    while i < n do
+        var v is usize = i - (i / 7) * 7
+        p[i] = 1.0 + v
+        i = i + 1
+    return 0
+
+
+def get3(t is mut ref Tensor, b is usize, i is usize, j is usize) returns f32
+    # Element (b,i,j) of a 3-D tensor, or (i,j) of a 2-D one; size-1 batch
+    # dims broadcast.
+    var idx is slice of usize = malloc(3 * 8)
+    var sh is slice of usize = (*t).shape
+    var v is f32 = 0.0
+    if (*t).ndim == 2 then
+        idx[0] = i
+        idx[1] = j
+    else
+        idx[0] = b
+        if sh[0] == 1 then
+            idx[0] = 0
+        idx[1] = i
+        idx[2] = j
+    tensor_get_f32(t, idx, &v)
+    free(idx)
+    return v
+
+
+def check_bmm(out is mut ref Tensor, a is mut ref Tensor, b is mut ref Tensor, nb is usize, m is usize, k is usize, n is usize, scale is f32) returns i32
+    # out[b] == scale * a[b] @ b[b], element by element.
+    var bi is usize = 0
+    while bi < nb do
+        var i is usize = 0
+        while i < m do
+            var j is usize = 0
+            while j < n do
+                var acc is f32 = 0.0
+                var kk is usize = 0
+                while kk < k do
+                    acc = acc + get3(a, bi, i, kk) * get3(b, bi, kk, j)
+                    kk = kk + 1
+                if get3(out, bi, i, j) != acc * scale then
+                    return 1
+                j = j + 1
+            i = i + 1
+        bi = bi + 1
+    return 0
+
+
+def main() returns i32
+    # 2-D: a^T @ a with a^T as a transposed view (no contiguous copy).
+    var a is Tensor
+    tensor_reset(&a)
+    if fill_iota(&a, 2, 0, 5, 3) != 0 then
+        return 1
+    var at is Tensor
+    tensor_reset(&at)
+    if tensor_transpose(&at, &a, 0, 1) != 0 then
+        return 1
+    if tensor_is_contiguous(&at) != 0 then
+        return 1
+    var c is Tensor
+    tensor_reset(&c)
+    if tensor_matmul_f32(&c, &at, &a) != 0 then
+        return 1
+    if check_bmm(&c, &at, &a, 1, 3, 5, 3, 1.0) != 0 then
+        println("transpose matmul mismatch")
+        return 1
+
+    # Accumulate: c += a^T @ a.
+    if tensor_matmul_into_f32(&c, &at, &a, 1) != 0 then
+        return 1
+    if check_bmm(&c, &at, &a, 1, 3, 5, 3, 2.0) != 0 then
+        println("accumulate mismatch")
+        return 1
+
+    # Batched: x (4,3,5) @ w (5,6), w broadcast over the batch.
+    var x is Tensor
+    tensor_reset(&x)
+    if fill_iota(&x, 3, 4, 3, 5) != 0 then
+        return 1
+    var w is Tensor
+    tensor_reset(&w)
+    if fill_iota(&w, 2, 0, 5, 6) != 0 then
+        return 1
+    var y is Tensor
+    tensor_reset(&y)
+    if tensor_bmm_f32(&y, &x, &w) != 0 then
+        return 1
+    var ysh is slice of usize = y.shape
+    if y.ndim != 3 or ysh[0] != 4 or ysh[1] != 3 or ysh[2] != 6 then
+        println("bmm shape mismatch")
+        return 1
+    if check_bmm(&y, &x, &w, 4, 3, 5, 6, 1.0) != 0 then
+        println("broadcast bmm mismatch")
+        return 1
+
+    # Same with w as a size-1 batch dim: (1,5,6).
+    var d3 is slice of usize = malloc(3 * 8)
+    d3[0] = 1
+    d3[1] = 5
+    d3[2] = 6
+    var w3 is Tensor
+    tensor_reset(&w3)
+    if tensor_reshape(&w3, &w, 3, d3) != 0 then
+        return 1
+    free(d3)
+    var y3 is Tensor
+    tensor_reset(&y3)
+    if tensor_bmm_f32(&y3, &x, &w3) != 0 then
+        return 1
+    if check_bmm(&y3, &x, &w3, 4, 3, 5, 6, 1.0) != 0 then
+        println("size-1 batch bmm mismatch")
+        return 1
+
+    # Batched with a transposed operand: q (4,3,5) @ k^T, k (4,3,5).
+    var kt is Tensor
+    tensor_reset(&kt)
+    if tensor_transpose(&kt, &x, 1, 2) != 0 then
+        return 1
+    var s is Tensor
+    tensor_reset(&s)
+    if tensor_bmm_f32(&s, &x, &kt) != 0 then
+        return 1
+    if check_bmm(&s, &x, &kt, 4, 3, 5, 3, 1.0) != 0 then
+        println("transposed bmm mismatch")
+        return 1
+
+    # Mismatched inner dims are rejected.
+    var bad is Tensor
+    tensor_reset(&bad)
+    if tensor_bmm_f32(&bad, &x, &x) == 0 then
+        return 1
+
+    tensor_free(&s)
+    tensor_free(&kt)
+    tensor_free(&y3)
+    tensor_free(&w3)
+    tensor_free(&y)
+    tensor_free(&w)
+    tensor_free(&x)
+    tensor_free(&c)
+    tensor_free(&at)
+    tensor_free(&a)
+    println("ok")
+    return 0
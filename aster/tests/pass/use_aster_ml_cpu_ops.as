@@ -1,4 +1,5 @@
-# Expected: compile+run OK (CPU codegen: C renderer + clang `.dylib` cache + dlopen launch)
+# Expected: compile+run OK (CPU codegen: C renderer + cc `.dylib`/`.so` cache +
+# dlopen once per process, then direct launches from the in-process table)
 
 use aster_ml.buffer
 use aster_ml.device
@@ -48,6 +49,15 @@ def main() returns i32
     if op[3] < 43.99 or op[3] > 44.01 then
         return 1
 
+    # Repeat launches hit the in-process table: no hashing, stat or dlopen.
+    var r is i32 = 0
+    while r < 10000 do
+        if cpu_add_f32(out.base, buffer_offset_bytes(&out), out.base, buffer_offset_bytes(&out), b.base, buffer_offset_bytes(&b), 4) != 0 then
+            return 1
+        r = r + 1
+    if op[0] < 100010.9 or op[0] > 100011.1 then
+        return 1
+
     if cpu_mul_f32(out.base, buffer_offset_bytes(&out), a.base, buffer_offset_bytes(&a), b.base, buffer_offset_bytes(&b), 4) != 0 then
         buffer_free(&out)
         buffer_free(&b)
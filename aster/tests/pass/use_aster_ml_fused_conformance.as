@@ -0,0 +1,150 @@
+# Expected: compile+run OK (compiled fused kernels match the interpreter)
+
+use aster_ml.tensor
+use aster_ml.lazy
+use aster_ml.uop.ops
+use aster_ml.engine.schedule
+use aster_ml.engine.realize
+use aster_ml.runtime.ops_cpu
+use aster_ml.dtype
+use aster_ml.device
+use core.io
+use core.libc
+use testmods.ml_fixtures
+
+extern def setenv(name is String, value is String, overwrite is i32) returns i32
+
+
+def run_both(lz is mut ref LazyCtx, e is MutString, nout is usize) returns i32
+    # Runs the single kernel of `e` compiled and interpreted, over the same
+    # KernelIR and inputs, and compares the outputs.
+    if e is null then
+        return 1
+    var s is Schedule
+    if schedule_build(&s, e) != 0 then
+        return 1
+    if s.kernels.len != 1 then
+        schedule_free(&s)
+        return 1
+    var ks is slice of MutString = s.kernels.data
+    var k is mut ref SchedKernel = ks[0]
+    var nin is usize = (*k).inputs.len
+    var ins is slice of MutString = malloc(nin * 8 + 8)
+    var out_c is slice of f32 = malloc(nout * 4)
+    var out_i is slice of f32 = malloc(nout * 4)
+    var rc is i32 = 1
+    if ins is not null and out_c is not null and out_i is not null then
+        var inu is slice of MutString = (*k).inputs.data
+        var bs is slice of MutString = (*lz).bufs.data
+        var j is usize = 0
+        while j < nin do
+            var bu is mut ref UOp = inu[j]
+            ins[j] = bs[(*bu).arg0]
+            j = j + 1
+        var ir is KernelIR
+        if kernel_ir_build(&ir, k) == 0 then
+            rc = cpu_fused_run(&ir, nin, ins, out_c)
+            kernel_ir_free(&ir)
+        var prog is KernelProg
+        if rc == 0 and kprog_build(&prog, k) == 0 then
+            prog.ins = ins
+            prog.out = out_i
+            kprog_run(&prog)
+            kprog_free(&prog)
+            var i is usize = 0
+            while i < nout do
+                var want is f32 = out_i[i]
+                var d is f32 = out_c[i] - want
+                if d < 0.0 then
+                    d = 0.0 - d
+                if want < 0.0 then
+                    want = 0.0 - want
+                if d > 0.00001 * (want + 1.0) then
+                    rc = 1
+                i = i + 1
+        else
+            rc = 1
+    if ins is not null then
+        free(ins)
+    if out_c is not null then
+        free(out_c)
+    if out_i is not null then
+        free(out_i)
+    schedule_free(&s)
+    return rc
+
+
+def check_ewise(n is usize) returns i32
+    # relu(a*b + c) + 0.5 over n elements.
+    var a is Tensor
+    var b is Tensor
+    var c is Tensor
+    if make_f32(&a, n, 13, 0.5, 2.0) != 0 or make_f32(&b, n, 13, 0.25, 1.0) != 0 or make_f32(&c, n, 13, 0.125, 0.5) != 0 then
+        return 1
+    var lz is LazyCtx
+    if lazy_init(&lz) != 0 then
+        return 1
+    var la is MutString = lazy_buffer(&lz, &a)
+    var lb is MutString = lazy_buffer(&lz, &b)
+    var lc is MutString = lazy_buffer(&lz, &c)
+    var e is MutString = lazy_relu(&lz, lazy_add(&lz, lazy_mul(&lz, la, lb), lc))
+    var rc is i32 = run_both(&lz, lazy_add(&lz, e, lazy_const(&lz, 0.5)), n)
+    lazy_free(&lz)
+    tensor_free(&c)
+    tensor_free(&b)
+    tensor_free(&a)
+    return rc
+
+
+def check_reduce(rows is usize, run is usize) returns i32
+    # relu(sum_runs(a*b) - 1) over (rows, run).
+    var n is usize = rows * run
+    var a is Tensor
+    var b is Tensor
+    if make_f32(&a, n, 13, 0.5, 2.0) != 0 or make_f32(&b, n, 13, 0.25, 1.0) != 0 then
+        return 1
+    var lz is LazyCtx
+    if lazy_init(&lz) != 0 then
+        return 1
+    var la is MutString = lazy_buffer(&lz, &a)
+    var lb is MutString = lazy_buffer(&lz, &b)
+    var r is MutString = lazy_sum_runs(&lz, lazy_mul(&lz, la, lb), run)
+    var e is MutString = lazy_relu(&lz, lazy_add(&lz, r, lazy_const(&lz, 0.0 - 1.0)))
+    var rc is i32 = run_both(&lz, e, rows)
+    lazy_free(&lz)
+    tensor_free(&b)
+    tensor_free(&a)
+    return rc
+
+
+def check_mode(mode is String) returns i32
+    setenv("ASTER_ML_SHAPES", mode, 1)
+    # Lengths with a scalar tail at every vector width, and aligned ones.
+    if check_ewise(1) != 0 or check_ewise(3) != 0 or check_ewise(7) != 0 or check_ewise(9) != 0 then
+        return 1
+    if check_ewise(17) != 0 or check_ewise(1003) != 0 or check_ewise(4101) != 0 then
+        return 1
+    if check_ewise(1008) != 0 or check_ewise(1024) != 0 then
+        return 1
+    # Partial output tiles (rows % 64) and ragged runs (run % 8, run % 16).
+    if check_reduce(1, 1) != 0 or check_reduce(3, 5) != 0 or check_reduce(65, 13) != 0 then
+        return 1
+    if check_reduce(130, 17) != 0 or check_reduce(129, 33) != 0 or check_reduce(7, 1000) != 0 then
+        return 1
+    if check_reduce(64, 16) != 0 or check_reduce(200, 3) != 0 then
+        return 1
+    return 0
+
+
+def main() returns i32
+    if check_mode("exact") != 0 then
+        println("exact mismatch")
+        return 1
+    if check_mode("bucket") != 0 then
+        println("bucket mismatch")
+        return 1
+    if check_mode("symbolic") != 0 then
+        println("symbolic mismatch")
+        return 1
+    println("ok")
+    return 0
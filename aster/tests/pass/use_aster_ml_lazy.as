@@ -0,0 +1,161 @@
+# Expected: compile+run OK (lazy graph, fused elementwise/reduce kernels)
+
+use aster_ml.tensor
+use aster_ml.lazy
+use aster_ml.uop.ops
+use aster_ml.engine.schedule
+use aster_ml.dtype
+use aster_ml.device
+use core.io
+use core.libc
+use testmods.ml_fixtures
+
+def kernel_count(node is MutString) returns usize
+    var s is Schedule
+    if schedule_build(&s, node) != 0 then
+        return 0
+    var n is usize = s.kernels.len
+    schedule_free(&s)
+    return n
+
+
+def main() returns i32
+    var n is usize = 1000
+    var a is Tensor
+    var b is Tensor
+    var c is Tensor
+    var d is Tensor
+    if make_f32(&a, n, 13, 0.5, 2.0) != 0 or make_f32(&b, n, 13, 0.25, 1.0) != 0 then
+        return 1
+    if make_f32(&c, n, 13, 0.125, 0.5) != 0 or make_f32(&d, 10, 13, 1.0, 40.0) != 0 then
+        return 1
+    var ap is slice of f32 = tensor_data_ptr(&a)
+    var bp is slice of f32 = tensor_data_ptr(&b)
+    var cp is slice of f32 = tensor_data_ptr(&c)
+    var dp is slice of f32 = tensor_data_ptr(&d)
+
+    var lz is LazyCtx
+    if lazy_init(&lz) != 0 then
+        return 1
+    var la is MutString = lazy_buffer(&lz, &a)
+    var lb is MutString = lazy_buffer(&lz, &b)
+    var lc is MutString = lazy_buffer(&lz, &c)
+    var ld is MutString = lazy_buffer(&lz, &d)
+
+    # relu(a*b + c): one kernel, same values as the eager ops.
+    var e is MutString = lazy_relu(&lz, lazy_add(&lz, lazy_mul(&lz, la, lb), lc))
+    if e is null or kernel_count(e) != 1 then
+        println("ewise not fused")
+        return 1
+    var dims is slice of usize = malloc(2 * 8)
+    dims[0] = n
+    var out is Tensor
+    if lazy_realize(&lz, &out, e, 1, dims) != 0 then
+        return 1
+    var t1 is Tensor
+    var t2 is Tensor
+    var t3 is Tensor
+    if tensor_mul_f32(&t1, &a, &b) != 0 or tensor_add_f32(&t2, &t1, &c) != 0 or tensor_relu_f32(&t3, &t2) != 0 then
+        return 1
+    var op is slice of f32 = tensor_data_ptr(&out)
+    var ep is slice of f32 = tensor_data_ptr(&t3)
+    var i is usize = 0
+    while i < n do
+        if op[i] != ep[i] then
+            println("ewise mismatch")
+            return 1
+        i = i + 1
+    tensor_free(&out)
+
+    # relu(sum_rows(a*b) * 0.5 + d) over (10, 100): prologue, reduce and
+    # epilogue in one kernel.
+    var half is MutString = lazy_const(&lz, 0.5)
+    var r is MutString = lazy_sum_runs(&lz, lazy_mul(&lz, la, lb), 100)
+    var y is MutString = lazy_relu(&lz, lazy_add(&lz, lazy_mul(&lz, r, half), ld))
+    if y is null or kernel_count(y) != 1 then
+        println("reduce not fused")
+        return 1
+    dims[0] = 10
+    if lazy_realize(&lz, &out, y, 1, dims) != 0 then
+        return 1
+    op = tensor_data_ptr(&out)
+    var row is usize = 0
+    while row < 10 do
+        var acc is f32 = 0.0
+        var j is usize = 0
+        while j < 100 do
+            acc = acc + ap[row * 100 + j] * bp[row * 100 + j]
+            j = j + 1
+        var want is f32 = acc * 0.5 + dp[row]
+        if want < 0.0 then
+            want = 0.0
+        if op[row] != want then
+            println("reduce mismatch")
+            return 1
+        row = row + 1
+    tensor_free(&out)
+
+    # A value with two users is realized once: m + relu(m) is two kernels.
+    var m is MutString = lazy_mul(&lz, la, lc)
+    var z is MutString = lazy_add(&lz, m, lazy_relu(&lz, m))
+    if kernel_count(z) != 2 then
+        println("shared node not realized")
+        return 1
+    dims[0] = 25
+    dims[1] = 40
+    if lazy_realize(&lz, &out, z, 2, dims) != 0 then
+        return 1
+    op = tensor_data_ptr(&out)
+    i = 0
+    while i < n do
+        var mv is f32 = ap[i] * cp[i]
+        var rv is f32 = mv
+        if rv < 0.0 then
+            rv = 0.0
+        if op[i] != mv + rv then
+            println("shared node mismatch")
+            return 1
+        i = i + 1
+    tensor_free(&out)
+
+    # Reduce of a reduce: two kernels.
+    var s2 is MutString = lazy_sum_runs(&lz, lazy_sum_runs(&lz, lb, 100), 10)
+    if kernel_count(s2) != 2 then
+        println("nested reduce")
+        return 1
+    dims[0] = 1
+    if lazy_realize(&lz, &out, s2, 1, dims) != 0 then
+        return 1
+    op = tensor_data_ptr(&out)
+    var total is f32 = 0.0
+    row = 0
+    while row < 10 do
+        var acc2 is f32 = 0.0
+        var j2 is usize = 0
+        while j2 < 100 do
+            acc2 = acc2 + bp[row * 100 + j2]
+            j2 = j2 + 1
+        total = total + acc2
+        row = row + 1
+    if op[0] != total then
+        println("nested reduce mismatch")
+        return 1
+    tensor_free(&out)
+
+    # Shape mismatches are rejected when building.
+    if lazy_add(&lz, la, ld) is not null then
+        return 1
+    if lazy_sum_runs(&lz, la, 3) is not null then
+        return 1
+
+    free(dims)
+    lazy_free(&lz)
+    tensor_free(&t3)
+    tensor_free(&t2)
+    tensor_free(&t1)
+    tensor_free(&d)
+    tensor_free(&c)
+    tensor_free(&b)
+    tensor_free(&a)
+    println("ok")
+    return 0
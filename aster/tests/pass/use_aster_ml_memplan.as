@@ -0,0 +1,125 @@
+# Expected: compile+run OK (schedule memory planning: liveness, slot reuse, in-place)
+
+use aster_ml.tensor
+use aster_ml.lazy
+use aster_ml.uop.ops
+use aster_ml.engine.schedule
+use aster_ml.engine.memory
+use aster_ml.dtype
+use aster_ml.device
+use core.io
+use core.libc
+use testmods.ml_fixtures
+
+def main() returns i32
+    var n is usize = 1000
+    var a is Tensor
+    var w is Tensor
+    if make_f32(&a, n, 7, 0.5, 1.5) != 0 or make_f32(&w, n, 7, 0.25, 0.5) != 0 then
+        return 1
+    var ap is slice of f32 = tensor_data_ptr(&a)
+    var wp is slice of f32 = tensor_data_ptr(&w)
+
+    var lz is LazyCtx
+    if lazy_init(&lz) != 0 then
+        return 1
+    var la is MutString = lazy_buffer(&lz, &a)
+    var lw is MutString = lazy_buffer(&lz, &w)
+
+    # Residual chain x = x + relu(x * w): every x has two users, so each
+    # layer is a kernel, and each layer's input dies in it.
+    var x is MutString = la
+    var layer is usize = 0
+    while layer < 6 do
+        x = lazy_add(&lz, x, lazy_relu(&lz, lazy_mul(&lz, x, lw)))
+        layer = layer + 1
+    var s is Schedule
+    if schedule_build(&s, x) != 0 or s.kernels.len != 6 then
+        println("chain schedule")
+        return 1
+    var plan is MemPlan
+    if memplan_build(&plan, &s) != 0 then
+        return 1
+    # 1000 floats -> 4000 bytes, rounded up to 4032.
+    if plan.naive_bytes != 5 * 4032 or plan.arena_bytes != 4032 or plan.nslots != 1 or plan.inplace != 4 then
+        println("chain plan")
+        return 1
+    var slots is slice of i64 = plan.slot
+    if slots[5] != 0 - 1 then
+        return 1
+    memplan_free(&plan)
+    schedule_free(&s)
+
+    var dims is slice of usize = malloc(1 * 8)
+    dims[0] = n
+    var out is Tensor
+    if lazy_realize(&lz, &out, x, 1, dims) != 0 then
+        return 1
+    var op is slice of f32 = tensor_data_ptr(&out)
+    var i is usize = 0
+    while i < n do
+        var v is f32 = ap[i]
+        layer = 0
+        while layer < 6 do
+            var r is f32 = v * wp[i]
+            if r < 0.0 then
+                r = 0.0
+            v = v + r
+            layer = layer + 1
+        if op[i] != v then
+            println("chain mismatch")
+            return 1
+        i = i + 1
+    tensor_free(&out)
+
+    # m = a * w and its row sums are both live when the sums are added back
+    # (relu(m) + m needs m, the reduce kernel cannot run in place): no reuse
+    # for those two, then the dead sums' slot is reused best-fit.
+    var m is MutString = lazy_mul(&lz, la, lw)
+    var rs is MutString = lazy_sum_runs(&lz, m, 10)
+    var rs2 is MutString = lazy_add(&lz, rs, rs)
+    var y is MutString = lazy_sum_runs(&lz, lazy_add(&lz, lazy_relu(&lz, m), m), 10)
+    var z is MutString = lazy_add(&lz, lazy_mul(&lz, rs2, rs2), y)
+    if schedule_build(&s, z) != 0 then
+        return 1
+    if memplan_build(&plan, &s) != 0 then
+        return 1
+    if plan.arena_bytes > plan.naive_bytes or plan.nslots < 2 then
+        println("mixed plan")
+        return 1
+    memplan_free(&plan)
+    schedule_free(&s)
+    dims[0] = 100
+    if lazy_realize(&lz, &out, z, 1, dims) != 0 then
+        return 1
+    op = tensor_data_ptr(&out)
+    var row is usize = 0
+    while row < 100 do
+        var sm is f32 = 0.0
+        var sy is f32 = 0.0
+        var j is usize = 0
+        while j < 10 do
+            var mv is f32 = ap[row * 10 + j] * wp[row * 10 + j]
+            var rv is f32 = mv
+            if rv < 0.0 then
+                rv = 0.0
+            sm = sm + mv
+            sy = sy + (rv + mv)
+            j = j + 1
+        var d is f32 = sm + sm
+        var want is f32 = d * d + sy
+        var diff is f32 = op[row] - want
+        if diff < 0.0 then
+            diff = 0.0 - diff
+        if diff > 0.001 then
+            println("mixed mismatch")
+            return 1
+        row = row + 1
+    tensor_free(&out)
+
+    free(dims)
+    lazy_free(&lz)
+    tensor_free(&w)
+    tensor_free(&a)
+    println("ok")
+    return 0
@@ -0,0 +1,165 @@
+# Expected: compile+run OK (compiled UPat rule set, graph_rewrite to a fixpoint)
+
+use aster_ml.uop.ops
+use aster_ml.uop.rewrite
+use aster_ml.dtype
+use core.io
+
+def ix(ctx is mut ref UOpCtx, v is i64) returns MutString
+    return uop_const_int(ctx, DT_INDEX, v)
+
+
+def ibin(ctx is mut ref UOpCtx, op is i32, a is MutString, b is MutString) returns MutString
+    return uop_intern2(ctx, op, DT_INDEX, a, b, 0, 0)
+
+
+def is_bin(p is MutString, op is i32, a is MutString, b is MutString) returns i32
+    if p is null then
+        return 0
+    var u is mut ref UOp = p
+    if (*u).op != op or (*u).nsrc != 2 then
+        return 0
+    var src is slice of MutString = (*u).src
+    return (src[0] == a and src[1] == b)
+
+
+def main() returns i32
+    var ctx is UOpCtx
+    if uop_ctx_init(&ctx) != 0 then
+        return 1
+    var rs is RewriteSet
+    if rewrite_set_init(&rs) != 0 or rewrite_rules_symbolic(&rs) != 0 then
+        return 1
+
+    # float32: identities and folding, no reassociation.
+    var x is MutString = uop_intern(&ctx, UOP_BUFFER, DT_F32, 0, null, 0, 1)
+    var z is MutString = uop_const_f32(&ctx, 0.0)
+    var nz is MutString = uop_const_f32(&ctx, (0.0 - 1.0) * 0.0)
+    var o is MutString = uop_const_f32(&ctx, 1.0)
+    var two is MutString = uop_const_f32(&ctx, 2.0)
+    var three is MutString = uop_const_f32(&ctx, 3.0)
+    if graph_rewrite(&ctx, &rs, uop_mul(&ctx, o, uop_add(&ctx, x, nz))) != x then
+        println("float identity")
+        return 1
+    # Not IEEE identities: x + 0.0 (x = -0.0) and x * 0.0 (NaN, inf, -x).
+    var xz is MutString = uop_add(&ctx, x, z)
+    if graph_rewrite(&ctx, &rs, xz) != xz then
+        println("add zero")
+        return 1
+    var mz is MutString = uop_mul(&ctx, uop_relu(&ctx, x), z)
+    if graph_rewrite(&ctx, &rs, mz) != mz then
+        println("mul zero")
+        return 1
+    if graph_rewrite(&ctx, &rs, uop_relu(&ctx, uop_relu(&ctx, x))) != uop_relu(&ctx, x) then
+        println("relu relu")
+        return 1
+    var f is MutString = graph_rewrite(&ctx, &rs, uop_add(&ctx, two, uop_mul(&ctx, three, uop_relu(&ctx, uop_const_f32(&ctx, 0.0 - 4.0)))))
+    if f != two then
+        println("float fold")
+        return 1
+    var fx is MutString = uop_add(&ctx, uop_add(&ctx, x, two), three)
+    if graph_rewrite(&ctx, &rs, fx) != fx then
+        println("float reassociated")
+        return 1
+
+    # Index arithmetic.
+    var i is MutString = uop_intern(&ctx, UOP_BUFFER, DT_INDEX, 0, null, 0, 1)
+    # (i + 1) * 4 + 2 -> i * 4 + 6
+    var e is MutString = ibin(&ctx, UOP_ADD, ibin(&ctx, UOP_MUL, ibin(&ctx, UOP_ADD, i, ix(&ctx, 1)), ix(&ctx, 4)), ix(&ctx, 2))
+    if is_bin(graph_rewrite(&ctx, &rs, e), UOP_ADD, ibin(&ctx, UOP_MUL, i, ix(&ctx, 4)), ix(&ctx, 6)) == 0 then
+        println("distribute")
+        return 1
+    # 3 + i -> i + 3; (i * 2) * 3 -> i * 6
+    if is_bin(graph_rewrite(&ctx, &rs, ibin(&ctx, UOP_ADD, ix(&ctx, 3), i)), UOP_ADD, i, ix(&ctx, 3)) == 0 then
+        println("canonical")
+        return 1
+    if is_bin(graph_rewrite(&ctx, &rs, ibin(&ctx, UOP_MUL, ibin(&ctx, UOP_MUL, i, ix(&ctx, 2)), ix(&ctx, 3))), UOP_MUL, i, ix(&ctx, 6)) == 0 then
+        println("mul chain")
+        return 1
+    # i + i -> i * 2; i * 3 + i -> i * 4; i * 2 + i * 5 -> i * 7
+    if is_bin(graph_rewrite(&ctx, &rs, ibin(&ctx, UOP_ADD, i, i)), UOP_MUL, i, ix(&ctx, 2)) == 0 then
+        println("x + x")
+        return 1
+    if is_bin(graph_rewrite(&ctx, &rs, ibin(&ctx, UOP_ADD, ibin(&ctx, UOP_MUL, i, ix(&ctx, 3)), i)), UOP_MUL, i, ix(&ctx, 4)) == 0 then
+        println("x * c + x")
+        return 1
+    var t is MutString = ibin(&ctx, UOP_ADD, ibin(&ctx, UOP_MUL, i, ix(&ctx, 2)), ibin(&ctx, UOP_MUL, i, ix(&ctx, 5)))
+    if is_bin(graph_rewrite(&ctx, &rs, t), UOP_MUL, i, ix(&ctx, 7)) == 0 then
+        println("combine terms")
+        return 1
+    # (i * 4) // 4 -> i; (i * 4) % 4 -> 0; i % 1 -> 0; 17 // 5 -> 3; -7 % 3 -> -1
+    if graph_rewrite(&ctx, &rs, ibin(&ctx, UOP_IDIV, ibin(&ctx, UOP_MUL, i, ix(&ctx, 4)), ix(&ctx, 4))) != i then
+        println("div")
+        return 1
+    if graph_rewrite(&ctx, &rs, ibin(&ctx, UOP_MOD, ibin(&ctx, UOP_MUL, i, ix(&ctx, 4)), ix(&ctx, 4))) != ix(&ctx, 0) then
+        println("mod")
+        return 1
+    if graph_rewrite(&ctx, &rs, ibin(&ctx, UOP_MOD, i, ix(&ctx, 1))) != ix(&ctx, 0) then
+        println("mod one")
+        return 1
+    if graph_rewrite(&ctx, &rs, ibin(&ctx, UOP_IDIV, ix(&ctx, 17), ix(&ctx, 5))) != ix(&ctx, 3) then
+        println("fold div")
+        return 1
+    if graph_rewrite(&ctx, &rs, ibin(&ctx, UOP_MOD, ix(&ctx, 0 - 7), ix(&ctx, 3))) != ix(&ctx, 0 - 1) then
+        println("fold mod")
+        return 1
+    # Division by a zero constant is left alone.
+    var dz is MutString = ibin(&ctx, UOP_IDIV, ix(&ctx, 1), ix(&ctx, 0))
+    if graph_rewrite(&ctx, &rs, dz) != dz then
+        println("div zero")
+        return 1
+
+    # Folding wraps to the dtype width; INT64_MIN / -1 is left alone.
+    var imax is MutString = uop_const_int(&ctx, DT_I32, 2147483647)
+    var wrapped is MutString = graph_rewrite(&ctx, &rs, uop_intern2(&ctx, UOP_ADD, DT_I32, imax, uop_const_int(&ctx, DT_I32, 1), 0, 0))
+    if wrapped != uop_const_int(&ctx, DT_I32, 0 - 2147483648) then
+        println("i32 wrap")
+        return 1
+    var u8s is MutString = uop_intern2(&ctx, UOP_MUL, DT_U8, uop_const_int(&ctx, DT_U8, 20), uop_const_int(&ctx, DT_U8, 13), 0, 0)
+    if graph_rewrite(&ctx, &rs, u8s) != uop_const_int(&ctx, DT_U8, 4) then
+        println("u8 wrap")
+        return 1
+    var big is u64 = 0xfffffffffffffffe
+    var bigi is i64 = big
+    var u64d is MutString = uop_intern2(&ctx, UOP_IDIV, DT_U64, uop_const_int(&ctx, DT_U64, bigi), uop_const_int(&ctx, DT_U64, 2), 0, 0)
+    if graph_rewrite(&ctx, &rs, u64d) != uop_const_int(&ctx, DT_U64, 9223372036854775807) then
+        println("u64 div")
+        return 1
+    var minb is u64 = 0x8000000000000000
+    var mini is i64 = minb
+    var ovf is MutString = uop_intern2(&ctx, UOP_IDIV, DT_I64, uop_const_int(&ctx, DT_I64, mini), uop_const_int(&ctx, DT_I64, 0 - 1), 0, 0)
+    if graph_rewrite(&ctx, &rs, ovf) != ovf then
+        println("min div")
+        return 1
+    var ovm is MutString = uop_intern2(&ctx, UOP_MOD, DT_I64, uop_const_int(&ctx, DT_I64, mini), uop_const_int(&ctx, DT_I64, 0 - 1), 0, 0)
+    if graph_rewrite(&ctx, &rs, ovm) != ovm then
+        println("min mod")
+        return 1
+
+    # x * 0 folds in integer dtypes only, and keeps the node's dtype.
+    var i32x is MutString = uop_intern(&ctx, UOP_BUFFER, DT_I32, 0, null, 0, 1)
+    var i32z is MutString = uop_const_int(&ctx, DT_I32, 0)
+    if graph_rewrite(&ctx, &rs, uop_intern2(&ctx, UOP_MUL, DT_I32, i32x, i32z, 0, 0)) != i32z then
+        println("int mul zero")
+        return 1
+    var x64 is MutString = uop_intern(&ctx, UOP_BUFFER, DT_F64, 0, null, 0, 1)
+    var m64 is MutString = uop_intern2(&ctx, UOP_MUL, DT_F64, x64, uop_const_int(&ctx, DT_F64, 0), 0, 0)
+    if graph_rewrite(&ctx, &rs, m64) != m64 then
+        println("f64 mul zero")
+        return 1
+
+    # Deep graph: 100000 levels of (x + -0.0) * 1 collapse to x, bottom-up
+    # without recursion.
+    var d is MutString = x
+    var k is usize = 0
+    while k < 100000 do
+        d = uop_mul(&ctx, uop_add(&ctx, d, nz), o)
+        k = k + 1
+    if graph_rewrite(&ctx, &rs, d) != x then
+        println("deep")
+        return 1
+
+    rewrite_set_free(&rs)
+    uop_ctx_free(&ctx)
+    println("ok")
+    return 0
@@ -0,0 +1,70 @@
+# Expected: compile+run OK (schedule_build on a deep graph: iterative walk, repeatable)
+
+use aster_ml.uop.ops
+use aster_ml.engine.schedule
+use aster_ml.dtype
+use core.io
+use core.libc
+use core.map
+
+def main() returns i32
+    var ctx is UOpCtx
+    if uop_ctx_init(&ctx) != 0 then
+        return 1
+    # x = x + buffer_i, 200000 times, and x = x + relu(x) every 8th step:
+    # far deeper than a recursive walk's stack allows.
+    var x is MutString = uop_intern(&ctx, UOP_BUFFER, DT_F32, 0, null, 0, 1)
+    var step is usize = 1
+    while step <= 200000 do
+        var b is MutString = uop_intern(&ctx, UOP_BUFFER, DT_F32, 0, null, step, 1)
+        x = uop_add(&ctx, x, b)
+        if step - (step / 8) * 8 == 0 then
+            x = uop_add(&ctx, x, uop_relu(&ctx, x))
+        step = step + 1
+    if x is null then
+        return 1
+
+    var s is Schedule
+    if schedule_build(&s, x) != 0 then
+        println("build failed")
+        return 1
+    var order is slice of MutString = s.order.data
+    # 200001 buffers, 200000 + 2 * 25000 adds/relus, each once.
+    if s.order.len != uop_count(&ctx) or s.order.len != 450001 or order[s.order.len - 1] != x then
+        println("bad order")
+        return 1
+    # One kernel per shared x, plus the sink's.
+    if s.kernels.len != 25001 then
+        println("bad kernels")
+        return 1
+    # Every source precedes its user.
+    var first is slice of MutString = s.order.data
+    var seen is MapU64
+    if mapu64_init(&seen, s.order.len) != 0 then
+        return 1
+    var i is usize = 0
+    while i < s.order.len do
+        var u is mut ref UOp = first[i]
+        var src is slice of MutString = (*u).src
+        var j is usize = 0
+        while j < (*u).nsrc do
+            var v is u64 = 0
+            if mapu64_get(&seen, kernel_ir_key(src[j]), &v) == 0 then
+                println("source after user")
+                return 1
+            j = j + 1
+        if mapu64_put(&seen, kernel_ir_key(first[i]), i) != 0 then
+            return 1
+        i = i + 1
+    mapu64_free(&seen)
+
+    # Walk state is reset: a second build sees the same graph.
+    var s2 is Schedule
+    if schedule_build(&s2, x) != 0 or s2.order.len != s.order.len or s2.kernels.len != s.kernels.len then
+        println("rebuild differs")
+        return 1
+    schedule_free(&s2)
+    schedule_free(&s)
+    uop_ctx_free(&ctx)
+    println("ok")
+    return 0
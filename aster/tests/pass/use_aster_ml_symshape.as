@@ -0,0 +1,173 @@
+# Expected: compile+run OK (fused kernels compiled per shape bucket)
+
+use aster_ml.tensor
+use aster_ml.lazy
+use aster_ml.uop.ops
+use aster_ml.engine.schedule
+use aster_ml.codegen.c
+use aster_ml.dtype
+use aster_ml.device
+use core.io
+use core.libc
+use testmods.ml_fixtures
+
+def shape_key(n is usize, run is usize, mode is i32) returns u64
+    # Kernel key of relu(a*a + 1) over n elements, or of relu(sum_runs(a*a)
+    # + 1) over n outputs of `run` elements each, under shape policy `mode`.
+    var numel is usize = n
+    if run != 0 then
+        numel = n * run
+    var a is Tensor
+    if make_f32(&a, numel, 13, 0.5, 2.0) != 0 then
+        return 0
+    var lz is LazyCtx
+    if lazy_init(&lz) != 0 then
+        return 0
+    var la is MutString = lazy_buffer(&lz, &a)
+    var x is MutString = lazy_mul(&lz, la, la)
+    if run != 0 then
+        x = lazy_sum_runs(&lz, x, run)
+    var e is MutString = lazy_relu(&lz, lazy_add(&lz, x, lazy_const(&lz, 1.0)))
+    var key is u64 = 0
+    var s is Schedule
+    if e is not null and schedule_build(&s, e) == 0 then
+        var ks is slice of MutString = s.kernels.data
+        var ir is KernelIR
+        if s.kernels.len == 1 and kernel_ir_build(&ir, ks[0]) == 0 then
+            var shape is CShape
+            c_shape_init(&shape, &ir, mode)
+            key = c_kernel_key(&ir, 1, &shape)
+            kernel_ir_free(&ir)
+        schedule_free(&s)
+    lazy_free(&lz)
+    tensor_free(&a)
+    return key
+
+
+def check_ewise(n is usize) returns i32
+    # relu(a*b + c) over n elements against the eager ops.
+    var a is Tensor
+    var b is Tensor
+    var c is Tensor
+    if make_f32(&a, n, 13, 0.5, 2.0) != 0 or make_f32(&b, n, 13, 0.25, 1.0) != 0 or make_f32(&c, n, 13, 0.125, 0.5) != 0 then
+        return 1
+    var lz is LazyCtx
+    if lazy_init(&lz) != 0 then
+        return 1
+    var la is MutString = lazy_buffer(&lz, &a)
+    var lb is MutString = lazy_buffer(&lz, &b)
+    var lc is MutString = lazy_buffer(&lz, &c)
+    var e is MutString = lazy_relu(&lz, lazy_add(&lz, lazy_mul(&lz, la, lb), lc))
+    var dims is slice of usize = malloc(1 * 8)
+    dims[0] = n
+    var out is Tensor
+    if lazy_realize(&lz, &out, e, 1, dims) != 0 then
+        return 1
+    var t1 is Tensor
+    var t2 is Tensor
+    var t3 is Tensor
+    if tensor_mul_f32(&t1, &a, &b) != 0 or tensor_add_f32(&t2, &t1, &c) != 0 or tensor_relu_f32(&t3, &t2) != 0 then
+        return 1
+    var op is slice of f32 = tensor_data_ptr(&out)
+    var ep is slice of f32 = tensor_data_ptr(&t3)
+    var rc is i32 = 0
+    var i is usize = 0
+    while i < n do
+        if op[i] != ep[i] then
+            rc = 1
+        i = i + 1
+    tensor_free(&t3)
+    tensor_free(&t2)
+    tensor_free(&t1)
+    tensor_free(&out)
+    free(dims)
+    lazy_free(&lz)
+    tensor_free(&c)
+    tensor_free(&b)
+    tensor_free(&a)
+    return rc
+
+
+def check_reduce(rows is usize, run is usize) returns i32
+    # sum_runs(a*a) over (rows, run) against a scalar reference.
+    var n is usize = rows * run
+    var a is Tensor
+    if make_f32(&a, n, 13, 0.5, 2.0) != 0 then
+        return 1
+    var ap is slice of f32 = tensor_data_ptr(&a)
+    var lz is LazyCtx
+    if lazy_init(&lz) != 0 then
+        return 1
+    var la is MutString = lazy_buffer(&lz, &a)
+    var r is MutString = lazy_sum_runs(&lz, lazy_mul(&lz, la, la), run)
+    var dims is slice of usize = malloc(1 * 8)
+    dims[0] = rows
+    var out is Tensor
+    if lazy_realize(&lz, &out, r, 1, dims) != 0 then
+        return 1
+    var op is slice of f32 = tensor_data_ptr(&out)
+    var rc is i32 = 0
+    var row is usize = 0
+    while row < rows do
+        var acc is f32 = 0.0
+        var j is usize = 0
+        while j < run do
+            acc = acc + ap[row * run + j] * ap[row * run + j]
+            j = j + 1
+        var d is f32 = op[row] - acc
+        if d < 0.0 then
+            d = 0.0 - d
+        if d > 0.001 * (acc + 1.0) then
+            rc = 1
+        row = row + 1
+    tensor_free(&out)
+    free(dims)
+    lazy_free(&lz)
+    tensor_free(&a)
+    return rc
+
+
+def main() returns i32
+    # Bucket policy: unaligned lengths share a kernel, aligned ones share
+    # another, powers of two are specialized.
+    var k1000 is u64 = shape_key(1000, 0, C_SHAPES_BUCKET)
+    if k1000 == 0 or k1000 != shape_key(1003, 0, C_SHAPES_BUCKET) then
+        println("unaligned bucket not shared")
+        return 1
+    var k1008 is u64 = shape_key(1008, 0, C_SHAPES_BUCKET)
+    if k1008 != shape_key(2000, 0, C_SHAPES_BUCKET) or k1008 == k1000 then
+        println("aligned bucket wrong")
+        return 1
+    var k1024 is u64 = shape_key(1024, 0, C_SHAPES_BUCKET)
+    if k1024 == k1000 or k1024 == k1008 or k1024 == shape_key(2048, 0, C_SHAPES_BUCKET) then
+        println("power of two not specialized")
+        return 1
+    if shape_key(1000, 0, C_SHAPES_EXACT) == shape_key(1003, 0, C_SHAPES_EXACT) then
+        println("exact shapes shared")
+        return 1
+    if shape_key(1000, 0, C_SHAPES_SYMBOLIC) != shape_key(1024, 0, C_SHAPES_SYMBOLIC) then
+        println("symbolic shapes not shared")
+        return 1
+    # Reduce kernels bucket the output count and the run length separately.
+    if shape_key(10, 100, C_SHAPES_BUCKET) != shape_key(12, 75, C_SHAPES_BUCKET) then
+        println("reduce bucket not shared")
+        return 1
+    if shape_key(10, 100, C_SHAPES_BUCKET) == shape_key(10, 112, C_SHAPES_BUCKET) then
+        println("reduce run alignment ignored")
+        return 1
+
+    # One compiled kernel per bucket still computes every length.
+    if check_ewise(1000) != 0 or check_ewise(1003) != 0 or check_ewise(1008) != 0 then
+        println("ewise mismatch")
+        return 1
+    if check_ewise(2000) != 0 or check_ewise(1024) != 0 or check_ewise(7) != 0 then
+        println("ewise mismatch")
+        return 1
+    if check_reduce(10, 100) != 0 or check_reduce(12, 75) != 0 or check_reduce(70, 112) != 0 then
+        println("reduce mismatch")
+        return 1
+    if check_reduce(3, 128) != 0 or check_reduce(65, 5) != 0 then
+        println("reduce mismatch")
+        return 1
+    println("ok")
+    return 0
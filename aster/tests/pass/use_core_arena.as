@@ -0,0 +1,85 @@
+# Conformance: core.arena (bump alloc, chained growth, mark/reset scopes,
+# thread-local scratch) and `noalloc` allocation from a caller's arena.
+
+use core.io
+use core.arena
+
+
+noalloc def fill_squares(a is mut ref Arena, n is usize) returns u64
+    # Allowed in `noalloc`: the arena belongs to the caller.
+    var xs is slice of u64 = arena_alloc(a, n * 8, 8)
+    if xs is null then
+        return 0
+    var i is usize = 0
+    var sum is u64 = 0
+    while i < n do
+        xs[i] = i * i
+        sum = sum + xs[i]
+        i = i + 1
+    return sum
+
+
+def main() returns i32
+    var a is Arena
+    if arena_init(&a, 4096) != 0 then
+        return 1
+
+    # Chained growth: 64 KiB of 1 KiB blocks in a 4 KiB first chunk.
+    var i is usize = 0
+    while i < 64 do
+        var p is MutString = arena_alloc(&a, 1024, 16)
+        if p is null then
+            return 1
+        p[0] = 7
+        i = i + 1
+    if a.nchunks < 2 then
+        return 2
+
+    # Mark/reset scope: frees the chunks chained on inside the scope.
+    var m is ArenaMark
+    arena_mark(&a, &m)
+    var before is usize = a.nchunks
+    var big is MutString = arena_alloc_zeroed(&a, 200000, 64)
+    if big is null or big[199999] != 0 then
+        return 3
+    arena_reset_to(&a, &m)
+    if a.nchunks != before then
+        return 4
+
+    # Full reset coalesces the chain into one chunk.
+    arena_reset(&a)
+    if a.nchunks != 1 or arena_used(&a) != 0 then
+        return 5
+    if arena_alloc(&a, 1024, 16) is null or a.nchunks != 1 then
+        return 6
+    print_u64(fill_squares(&a, 100))
+
+    # Alignment: 0 means 1; non-powers of two and > ARENA_MAX_ALIGN fail
+    # without touching the arena.
+    var nul is MutString = null
+    var used1 is usize = arena_used(&a)
+    var one is MutString = arena_alloc(&a, 1, 0)
+    if one is null or arena_used(&a) != used1 + 1 then
+        return 8
+    used1 = used1 + 1
+    if arena_alloc(&a, 8, 3) is not null or arena_alloc(&a, 8, 128) is not null then
+        return 9
+    if arena_alloc(&a, 8, 0 - 1) is not null or arena_used(&a) != used1 then
+        return 10
+    var al is MutString = arena_alloc(&a, 8, 64)
+    if al is null or ((al - nul) & 63) != 0 then
+        return 11
+
+    # Thread-local scratch arena.
+    var s is mut ref Arena = arena_tls()
+    var sm is ArenaMark
+    arena_mark(s, &sm)
+    var used0 is usize = arena_used(s)
+    print_u64(fill_squares(s, 10))
+    arena_reset_to(s, &sm)
+    if arena_used(s) != used0 then
+        return 7
+
+    arena_free(&a)
+    println("ok")
+    return 0
@@ -0,0 +1,81 @@
+# Conformance: core.io Reader (buffered refill and growth past a tiny buffer,
+# mmap mode, zero-copy line/record views, fixed-size reads).
+
+use core.io
+use core.str
+
+const FIXTURE is String = "aster/tests/fixtures/lines.txt"
+
+
+def scan_lines(r is mut ref Reader, out_bytes is mut ref usize, out_max is mut ref usize) returns usize
+    var line is Str
+    var n is usize = 0
+    (*out_bytes) = 0
+    (*out_max) = 0
+    while reader_next_line(r, &line) != 0 do
+        n = n + 1
+        (*out_bytes) = (*out_bytes) + line.len
+        if line.len > (*out_max) then
+            (*out_max) = line.len
+    return n
+
+
+def main() returns i32
+    # Buffered, 16-byte buffer: every line needs refills, long ones growth.
+    var r is Reader
+    if reader_open(&r, FIXTURE, 16) != 0 then
+        return 1
+    var bytes is usize = 0
+    var longest is usize = 0
+    print_u64(scan_lines(&r, &bytes, &longest))
+    print_u64(bytes)
+    print_u64(longest)
+    reader_close(&r)
+
+    # Mapped: same views, no copies.
+    var m is Reader
+    if reader_open_mmap(&m, FIXTURE) != 0 then
+        return 2
+    var mbytes is usize = 0
+    var mlongest is usize = 0
+    if scan_lines(&m, &mbytes, &mlongest) != 35 or mbytes != bytes or mlongest != longest then
+        return 3
+    reader_close(&m)
+
+    # Records split on ',' and a CRLF line's trailing '\r' kept in the view.
+    if reader_open(&r, FIXTURE, 0) != 0 then
+        return 4
+    var rec is Str
+    var nrec is usize = 0
+    while reader_next_record(&r, 44, &rec) != 0 do
+        nrec = nrec + 1
+    print_u64(nrec)
+    reader_close(&r)
+    if reader_open_mmap(&m, FIXTURE) != 0 then
+        return 5
+    var line is Str
+    var want is Str
+    str_init(&want, "crlf line\r", 10)
+    var found is i32 = 0
+    while reader_next_line(&m, &line) != 0 do
+        if str_equal(&line, &want) != 0 then
+            found = 1
+    reader_close(&m)
+    if found == 0 then
+        return 6
+
+    # Fixed-size reads: the short remainder is left unread for line reads.
+    if reader_open(&r, FIXTURE, 8) != 0 then
+        return 7
+    var chunk is Str
+    var nchunks is usize = 0
+    while reader_next_bytes(&r, 100, &chunk) != 0 do
+        nchunks = nchunks + 1
+    print_u64(nchunks)
+    if reader_next_line(&r, &line) == 0 or line.len != 21 then
+        return 8
+    if reader_next_line(&r, &line) == 0 or line.len != 25 or reader_next_line(&r, &line) != 0 then
+        return 9
+    reader_close(&r)
+    println("ok")
+    return 0
@@ -0,0 +1,69 @@
+# Conformance: core.io Writer (buffered fd output, direct number formatting,
+# large-payload bypass, multi-writer writev flush).
+
+use core.io
+use core.libc
+
+
+def main() returns i32
+    # A 64-byte buffer forces refills and the large-payload path.
+    var w is Writer
+    if writer_init(&w, 1, 64) != 0 then
+        return 1
+    writer_write_u64(&w, 0)
+    writer_write_u8(&w, 32)
+    writer_write_u64(&w, 18446744073709551615)
+    writer_write_u8(&w, 32)
+    writer_write_i64(&w, 0 - 9223372036854775807 - 1)
+    writer_write_u8(&w, 32)
+    writer_write_i64(&w, 12345)
+    writer_write_u8(&w, 10)
+    writer_write_f64(&w, 3.14159, 3)
+    writer_write_u8(&w, 32)
+    writer_write_f64(&w, 0.0 - 2.5, 0)
+    writer_write_u8(&w, 32)
+    writer_write_f64(&w, 0.9996, 3)
+    writer_write_u8(&w, 32)
+    writer_write_f64(&w, 123456.125, 3)
+    writer_write_u8(&w, 32)
+    writer_write_f64(&w, 150000000000000000000.0, 2)
+    writer_write_u8(&w, 32)
+    writer_write_f64(&w, 0.0 - 0.0004, 3)
+    writer_write_u8(&w, 32)
+    writer_write_f64(&w, (0.0 - 1.0) * 0.0, 1)
+    writer_write_u8(&w, 10)
+    writer_write_cstr(&w, "0123456789012345678901234567890123456789012345678901234567890123456789\n")
+
+    # Caps below IO_RESERVE_MAX are raised: a full-width float still fits.
+    var t is Writer
+    if writer_init(&t, 1, 24) != 0 or t.cap < IO_RESERVE_MAX then
+        return 6
+    writer_write_f64(&t, 0.0 - 12345678901234567.0, 9)
+    writer_write_u8(&t, 10)
+    if writer_reserve(&t, t.cap + 1) == 0 then
+        return 7
+
+    # Writers sharing fd 1 drain in order with one writev.
+    var a is Writer
+    var b is Writer
+    if writer_init(&a, 1, 0) != 0 or writer_init(&b, 1, 0) != 0 then
+        return 2
+    var i is u64 = 0
+    while i < 3 do
+        writer_write_cstr(&a, "a")
+        writer_write_u64(&a, i)
+        writer_write_u8(&a, 10)
+        i = i + 1
+    writer_write_cstr(&b, "b\n")
+    if writer_flush(&w) != 0 then
+        return 3
+    var ws is slice of MutString = malloc(16)
+    ws[0] = &a
+    ws[1] = &b
+    if writer_flush_many(ws, 2) != 0 or a.len != 0 or b.len != 0 then
+        return 4
+    free(ws)
+    if writer_close(&a) != 0 or writer_close(&b) != 0 or writer_close(&w) != 0 or writer_close(&t) != 0 then
+        return 5
+    println("ok")
+    return 0
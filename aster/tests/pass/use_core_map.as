@@ -0,0 +1,169 @@
+# Conformance: core.map (u64 and String keys, growth, deletion).
+
+use core.io
+use core.libc
+use core.map
+
+const N is u64 = 20000
+
+
+def every_third(i is u64) returns i32
+    var q is u64 = i / 3
+    if i - q * 3 == 0 then
+        return 1
+    return 0
+
+
+def key_of(i is u64) returns u64
+    # Keys share their low 16 bits so identity-hashed tables would collide.
+    return (i * 2654435761) << 16
+
+
+def check_u64() returns i32
+    var m is MapU64
+    if mapu64_init(&m, 0) != 0 then
+        return 1
+    var i is u64 = 0
+    while i < N do
+        if mapu64_put(&m, key_of(i), i) != 0 then
+            return 1
+        i = i + 1
+    if mapu64_len(&m) != N then
+        return 2
+
+    # Overwrite, then remove every third key.
+    i = 0
+    while i < N do
+        mapu64_put(&m, key_of(i), i + 1)
+        if every_third(i) != 0 then
+            if mapu64_remove(&m, key_of(i)) != 1 then
+                return 3
+        i = i + 1
+    if mapu64_remove(&m, key_of(0)) != 0 then
+        return 4
+
+    var sum is u64 = 0
+    var v is u64 = 0
+    i = 0
+    while i < N do
+        var found is i32 = mapu64_get(&m, key_of(i), &v)
+        if every_third(i) == found then
+            return 5
+        if found != 0 then
+            sum = sum + v
+        if mapu64_contains(&m, key_of(i) + 1) != 0 then
+            return 6
+        i = i + 1
+    print_u64(mapu64_len(&m))
+    print_u64(sum)
+    mapu64_free(&m)
+    return 0
+
+
+def check_str() returns i32
+    var m is MapStr
+    if mapstr_init(&m, 4) != 0 then
+        return 1
+    mapstr_put(&m, "alpha", 1)
+    mapstr_put(&m, "beta", 2)
+    mapstr_put(&m, "gamma", 3)
+    mapstr_put(&m, "beta", 20)
+    mapstr_put(&m, "delta", 4)
+    mapstr_put(&m, "epsilon", 5)
+    mapstr_put(&m, "zeta", 6)
+    mapstr_put(&m, "eta", 7)
+    mapstr_put(&m, "theta", 8)
+    if mapstr_remove(&m, "gamma") != 1 then
+        return 2
+    var v is u64 = 0
+    if mapstr_get(&m, "beta", &v) != 1 or v != 20 then
+        return 3
+    if mapstr_contains(&m, "gamma") != 0 or mapstr_contains(&m, "iota") != 0 then
+        return 4
+    if mapstr_get(&m, "theta", &v) != 1 or v != 8 then
+        return 5
+    print_u64(mapstr_len(&m))
+    mapstr_free(&m)
+    return 0
+
+
+def check_u64_migrating() returns i32
+    # Lookups, hits and misses, while a retiring table is half migrated.
+    var m is MapU64
+    if mapu64_init(&m, 0) != 0 then
+        return 1
+    var checks is u64 = 0
+    var i is u64 = 0
+    while i < 6000 do
+        if mapu64_put(&m, key_of(i), i) != 0 then
+            return 1
+        i = i + 1
+        if m.old.ctrl is not null and m.cursor != 0 then
+            checks = checks + 1
+            var v is u64 = 0
+            var j is u64 = 0
+            while j < i do
+                if mapu64_get(&m, key_of(j), &v) != 1 or v != j then
+                    return 2
+                j = j + 7
+            if mapu64_contains(&m, key_of(i + 1)) != 0 or mapu64_contains(&m, key_of(j) + 1) != 0 then
+                return 3
+    if checks == 0 then
+        return 4
+    mapu64_free(&m)
+    return 0
+
+
+def str_key(buf is MutString, i is u64) returns String
+    # "k" and six digits of `i`, NUL-terminated, at buf + 8 * i.
+    var b is slice of u8 = buf + i * 8
+    b[0] = 107
+    var v is u64 = i
+    var d is usize = 6
+    while d > 0 do
+        b[d] = 48 + (v - (v / 10) * 10)
+        v = v / 10
+        d = d - 1
+    b[7] = 0
+    return buf + i * 8
+
+
+def check_str_migrating() returns i32
+    var keys is MutString = malloc(3000 * 8 + 16)
+    if keys is null then
+        return 1
+    var m is MapStr
+    if mapstr_init(&m, 0) != 0 then
+        return 1
+    var checks is u64 = 0
+    var i is u64 = 0
+    while i < 3000 do
+        if mapstr_put(&m, str_key(keys, i), i) != 0 then
+            return 1
+        i = i + 1
+        if m.old.ctrl is not null and m.cursor != 0 then
+            checks = checks + 1
+            var v is u64 = 0
+            var j is u64 = 0
+            while j < i do
+                if mapstr_get(&m, str_key(keys, j), &v) != 1 or v != j then
+                    return 2
+                j = j + 5
+            if mapstr_contains(&m, "k999999") != 0 then
+                return 3
+    if checks == 0 then
+        return 4
+    mapstr_free(&m)
+    free(keys)
+    return 0
+
+
+def main() returns i32
+    if check_u64() != 0 then
+        return 1
+    if check_str() != 0 then
+        return 1
+    if check_u64_migrating() != 0 or check_str_migrating() != 0 then
+        return 1
+    println("ok")
+    return 0
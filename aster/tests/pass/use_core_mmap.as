@@ -0,0 +1,54 @@
+# Conformance: core.mmap read-only and copy-on-write mappings, access hints,
+# explicit unmap.
+
+use core.io
+use core.mmap
+use core.str
+
+const FIXTURE is String = "aster/tests/fixtures/lines.txt"
+
+
+def main() returns i32
+    var fm is FileMap
+    if fmap_open(&fm, FIXTURE, FMAP_READ) != 0 then
+        return 1
+    print_u64(fm.len)
+    if fmap_advise(&fm, FMAP_SEQUENTIAL) != 0 or fmap_advise(&fm, FMAP_WILLNEED) != 0 then
+        return 2
+    if fmap_advise_range(&fm, 100, 200, FMAP_RANDOM) != 0 then
+        return 3
+    # Huge pages are best-effort: the result is platform-dependent.
+    fmap_advise(&fm, FMAP_HUGEPAGE)
+    var all is Str
+    str_init(&all, fm.data, fm.len)
+    print_u64(str_count_byte(&all, 10))
+
+    # Copy-on-write: writes land in this process only.
+    var cow is FileMap
+    if fmap_open(&cow, FIXTURE, FMAP_COW) != 0 then
+        return 4
+    var w is slice of u8 = cow.data
+    w[0] = 33
+    w[cow.len - 1] = 33
+    var ro is slice of u8 = fm.data
+    if ro[0] != 35 or ro[fm.len - 1] == 33 then
+        return 5
+    fmap_close(&cow)
+    if cow.data is not null or cow.len != 0 then
+        return 6
+
+    # The file itself is unchanged.
+    var again is FileMap
+    if fmap_open(&again, FIXTURE, FMAP_READ) != 0 then
+        return 7
+    var b is Str
+    str_init(&b, again.data, again.len)
+    if str_equal(&all, &b) == 0 then
+        return 8
+    fmap_close(&again)
+    fmap_close(&fm)
+
+    if fmap_open(&fm, "aster/tests/fixtures/no_such_file", FMAP_READ) == 0 then
+        return 9
+    println("ok")
+    return 0
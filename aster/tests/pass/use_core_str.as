@@ -0,0 +1,80 @@
+# Conformance: core.str views (find, split, compare, case-insensitive
+# compare) across the vector block boundary, and StrBuf growth.
+
+use core.io
+use core.libc
+use core.str
+
+
+def main() returns i32
+    var hay is Str
+    str_from_cstr(&hay, "content-type: text/plain; charset=utf-8\r\nContent-Length: 42\r\n\r\nbody")
+    if hay.len != 67 then
+        return 1
+
+    # Search: bytes and substrings inside and past the first 16-byte block.
+    var colon is usize = str_find_byte(&hay, 58)
+    print_u64(colon)
+    if str_find_byte(&hay, 0) != STR_NPOS then
+        return 2
+    var needle is Str
+    str_init(&needle, "\r\n\r\n", 4)
+    print_u64(str_find(&hay, &needle))
+    str_init(&needle, "charset=utf-16", 14)
+    if str_find(&hay, &needle) != STR_NPOS then
+        return 3
+    print_u64(str_count_byte(&hay, 10))
+
+    # Case-insensitive prefix compare on header names.
+    var line is Str
+    str_init(&line, "CONTENT-TYPE: TEXT/PLAIN", 24)
+    var prefix is Str
+    str_init(&prefix, "content-type", 12)
+    if str_starts_with_ci(&line, &prefix) == 0 or str_starts_with(&line, &prefix) != 0 then
+        return 4
+    var a is Str
+    var b is Str
+    str_init(&a, "Accept-Encoding: GZIP, Deflate", 30)
+    str_init(&b, "accept-encoding: gzip, deflate", 30)
+    if str_equal_ci(&a, &b) == 0 or str_equal(&a, &b) != 0 then
+        return 5
+    str_init(&b, "accept-encoding: gzip, deflatX", 30)
+    if str_equal_ci(&a, &b) != 0 then
+        return 6
+    if str_compare(&a, &b) >= 0 or str_compare(&b, &a) <= 0 or str_compare(&a, &a) != 0 then
+        return 7
+
+    # Split keeps empty fields; fields are views into the input.
+    var rest is Str
+    str_init(&rest, "w0,,weight.layer1,bias,", 23)
+    var field is Str
+    var n is usize = 0
+    var total is usize = 0
+    while str_split_next(&rest, 44, &field) != 0 do
+        n = n + 1
+        total = total + field.len
+    print_u64(n)
+    print_u64(total)
+
+    # StrBuf: growth past the initial capacity stays NUL-terminated.
+    var sb is StrBuf
+    if strbuf_init(&sb, 0) != 0 then
+        return 8
+    var i is usize = 0
+    while i < 100 do
+        if strbuf_append_cstr(&sb, "ab") != 0 or strbuf_push_u8(&sb, 59) != 0 then
+            return 9
+        i = i + 1
+    var view is Str
+    strbuf_view(&sb, &view)
+    print_u64(view.len)
+    str_init(&needle, ";ab;", 4)
+    if str_find(&view, &needle) != 2 or sb.data[300] != 0 then
+        return 10
+    var owned is MutString = strbuf_take(&sb)
+    if sb.data is not null or owned[299] != 59 then
+        return 11
+    free(owned)
+    strbuf_free(&sb)
+    println("ok")
+    return 0
@@ -0,0 +1,70 @@
+# Conformance: core.time cycle-counter clock against now_ns, coarse clock,
+# and LatencyHist bucketing/quantiles.
+
+use core.io
+use core.time
+
+
+def main() returns i32
+    # The tick clock tracks now_ns over a short spin (within 5% + 0.5 ms).
+    var c is TickClock
+    tick_clock_init(&c)
+    if c.hz == 0 or c.mult == 0 then
+        return 1
+    var t0 is u64 = ticks()
+    var n0 is u64 = now_ns()
+    var n1 is u64 = n0
+    while n1 - n0 < 20000000 do
+        n1 = now_ns()
+    var t1 is u64 = ticks()
+    var by_ticks is u64 = tick_clock_to_ns(&c, t1 - t0)
+    var by_clock is u64 = n1 - n0
+    var diff is u64 = by_ticks - by_clock
+    if by_clock > by_ticks then
+        diff = by_clock - by_ticks
+    if diff > by_clock / 20 + 500000 then
+        return 2
+    var on_timeline is u64 = tick_clock_now_ns(&c)
+    var ref_now is u64 = now_ns()
+    if on_timeline + 5000000 < ref_now or on_timeline > ref_now + 5000000 then
+        return 3
+
+    # Coarse clock: monotonic and close to now_ns.
+    var k0 is u64 = now_ns_coarse()
+    var k1 is u64 = now_ns_coarse()
+    if k1 < k0 or k0 + 50000000 < now_ns() then
+        return 4
+
+    # Histogram: exact below 128, within 1/64 above, bounded memory.
+    var h is LatencyHist
+    if hist_init(&h) != 0 then
+        return 5
+    var v is u64 = 1
+    while v <= 100000 do
+        hist_record(&h, v)
+        v = v + 1
+    print_u64(h.total)
+    print_u64(hist_quantile(&h, 0.5))
+    print_u64(hist_quantile(&h, 0.99))
+    print_u64(hist_quantile(&h, 1.0))
+    if hist_quantile(&h, 0.0005) != 50 then
+        return 6
+    if hist_index(0xFFFFFFFFFFFFFFFF) != HIST_BUCKETS - 1 then
+        return 7
+    var other is LatencyHist
+    if hist_init(&other) != 0 then
+        return 8
+    hist_record(&other, 0)
+    hist_record(&other, 1000000000)
+    hist_merge(&h, &other)
+    if h.total != 100002 or h.min != 0 or h.max != 1000000000 then
+        return 9
+    if hist_quantile(&h, 1.0) != 1000000000 then
+        return 10
+    hist_reset(&h)
+    if h.total != 0 or hist_quantile(&h, 0.5) != 0 then
+        return 11
+    hist_free(&other)
+    hist_free(&h)
+    println("ok")
+    return 0
@@ -0,0 +1,34 @@
+# Conformance: `break` leaves a `while 1` loop (and only the innermost one);
+# code after the loop runs.
+
+def first_multiple(x is i32, q is i32) returns i32
+    var v is i32 = x
+    while 1 do
+        if v - (v / q) * q == 0 then
+            break
+        v = v + 1
+    return v
+
+def main() returns i32
+    if first_multiple(10, 7) != 14 then
+        return 1
+
+    var outer is i32 = 0
+    var inner is i32 = 0
+    while 1 do
+        outer = outer + 1
+        while 1 do
+            inner = inner + 1
+            if inner >= outer * 2 then
+                break
+        if outer == 3 then
+            break
+    if outer != 3 or inner != 6 then
+        return 2
+
+    # No `break`: the loop still needs no trailing `return`.
+    var n is i32 = 0
+    while 1 do
+        n = n + 1
+        if n == 5 then
+            return 0
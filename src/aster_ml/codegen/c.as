@@ -1,12 +1,31 @@
 # aster_ml.codegen.c (v0)
 #
-# Minimal C renderer for CPU elementwise kernels.
+# C renderers for CPU kernels.
 #
-# v0 scope:
-# - float32 elementwise kernels: add/mul/relu
-# - stable symbol ABI:
-#   - `aster_ml_kernel(out, a, b, n)` (out-of-line loop)
-#   - `aster_ml_kernel_entry(void* ctx)` (dispatch_sync_f-compatible trampoline)
+# - `c_render_ewise_f32`: fixed float32 add/mul/relu templates (eager ops),
+#   `aster_ml_kernel(out, a, b, n)` plus the entry trampoline.
+# - `c_render_kernel`: any fused kernel of a Schedule (a lowered KernelIR).
+#   CONSTs are inlined by bit pattern, and the body is written at an
+#   explicit vector width (GCC/clang vector extensions: 8 lanes when the
+#   compiler targets AVX, else 4 for SSE/NEON) followed by a scalar tail.
+#   Reduce kernels tile their outputs (C_REDUCE_TILE per tile), sum each run
+#   into two vector accumulators, and run the epilogue vectorized over the
+#   tile.
+#   The element count N and run length RUN are rendered from a `CShape`:
+#   either literals, or runtime arguments (SymInt variables `n` / `run`)
+#   bucketed by alignment, so one compiled kernel serves every length in its
+#   bucket (see `c_shape_init`).
+#   `c_kernel_key` hashes the KernelIR structure and the shape buckets, so
+#   each distinct fused kernel is rendered and compiled once; `c_kernel_check`
+#   is a second, independently seeded hash the kernel cache also compares.
+#
+# Every kernel exports `aster_ml_kernel_entry(void* ctx)` (the `void (*)(void*)`
+# trampoline the runtime calls).
+
+use core.str
+use aster_ml.uop.ops
+use aster_ml.uop.symbolic
+use aster_ml.engine.schedule
 
 const C_EWISE_ADD_F32 is i32 = 1
 const C_EWISE_MUL_F32 is i32 = 2
@@ -22,3 +41,359 @@ def c_render_ewise_f32(op is i32) returns String
     if op == C_EWISE_RELU_F32 then
         return "#include <stddef.h>\n\n__attribute__((visibility(\"default\")))\nvoid aster_ml_kernel(float* out, const float* a, const float* b, size_t n) {\n    (void)b;\n    for (size_t i = 0; i < n; i++) {\n        float x = a[i];\n        if (x < 0.0f) x = 0.0f;\n        out[i] = x;\n    }\n}\n\ntypedef struct {\n    float* out;\n    const float* a;\n    const float* b;\n    size_t n;\n} AsterMlKernelCtx;\n\n__attribute__((visibility(\"default\")))\nvoid aster_ml_kernel_entry(void* p) {\n    AsterMlKernelCtx* c = (AsterMlKernelCtx*)p;\n    aster_ml_kernel(c->out, c->a, c->b, c->n);\n}\n"
     return null
+
+
+# -----------------------------
+# Fused kernels
+# -----------------------------
+
+const C_REDUCE_TILE is usize = 64   # outputs per reduce tile
+const C_KERNEL_ABI is u64 = 2       # bump when the generated ABI changes
+
+# How a kernel dim is rendered.
+const C_DIM_EXACT is i32 = 0     # literal (fully specialized)
+const C_DIM_ALIGNED is i32 = 1   # runtime argument, a multiple of C_DIM_ALIGN
+const C_DIM_ANY is i32 = 2       # runtime argument
+
+# Two vectors at the widest VW: an aligned dim leaves no scalar tail, in
+# the reduce's unrolled loop either.
+const C_DIM_ALIGN is u64 = 16
+
+# Shape policies (ASTER_ML_SHAPES=exact|bucket|symbolic, see ops_cpu).
+const C_SHAPES_EXACT is i32 = 0      # every dim literal: a kernel per shape
+const C_SHAPES_BUCKET is i32 = 1     # powers of two literal, other dims runtime
+const C_SHAPES_SYMBOLIC is i32 = 2   # every dim runtime: a kernel per structure
+
+const C_FUSED_PRELUDE is String = "#include <stddef.h>\n#include <string.h>\n\n#if defined(__AVX__)\n#define VW 8\n#else\n#define VW 4\n#endif\n\ntypedef float vf __attribute__((vector_size(VW * 4)));\ntypedef int vi __attribute__((vector_size(VW * 4)));\n\nstatic inline vf ld(const float* p) { vf v; memcpy(&v, p, sizeof v); return v; }\nstatic inline void st(float* p, vf v) { memcpy(p, &v, sizeof v); }\nstatic inline vf splat(float x) { vf v; for (int l = 0; l < VW; l++) v[l] = x; return v; }\nstatic inline float kf(unsigned u) { float f; memcpy(&f, &u, sizeof f); return f; }\nstatic inline float hsum(vf v) { float s = 0.0f; for (int l = 0; l < VW; l++) s += v[l]; return s; }\nstatic inline float srelu(float x) { return x < 0.0f ? 0.0f : x; }\nstatic inline vf vrelu(vf x) { vi m = x < splat(0.0f); return (vf)((vi)x & ~m); }\n\ntypedef struct {\n    float* out;\n    const float* const* ins;\n    size_t n;\n    size_t run;\n} AsterMlFusedCtx;\n\n"
+
+const C_FUSED_ENTRY is String = "__attribute__((visibility(\"default\")))\nvoid aster_ml_kernel_entry(void* p) {\n    AsterMlFusedCtx* c = (AsterMlFusedCtx*)p;\n    kernel(c->out, c->ins, c->n, c->run);\n}\n"
+
+
+struct CShape
+    # Per-dim rendering of one kernel launch. `n` / `run` are the launch's
+    # values (KernelIR numel / run), passed to the kernel either way.
+    var n_class is i32
+    var run_class is i32
+    var n is u64
+    var run is u64
+
+
+struct CSrc
+    # Source being rendered; `err` latches the first allocation failure.
+    var sb is StrBuf
+    var err is i32
+
+
+def csrc_put(c is mut ref CSrc, s is String) returns ()
+    if strbuf_append_cstr(&(*c).sb, s) != 0 then
+        (*c).err = 1
+    return
+
+
+def csrc_u64(c is mut ref CSrc, x is u64) returns ()
+    if x >= 10 then
+        csrc_u64(c, x / 10)
+    var d is u64 = x - (x / 10) * 10
+    if strbuf_push_u8(&(*c).sb, 48 + d) != 0 then
+        (*c).err = 1
+    return
+
+
+def csrc_hex(c is mut ref CSrc, x is u64) returns ()
+    if x >= 16 then
+        csrc_hex(c, x / 16)
+    var d is u64 = x & 15
+    var ch is u64 = 48 + d
+    if d >= 10 then
+        ch = 87 + d
+    if strbuf_push_u8(&(*c).sb, ch) != 0 then
+        (*c).err = 1
+    return
+
+
+def c_dim_class(mode is i32, v is u64) returns i32
+    if mode == C_SHAPES_EXACT or v == 0 then
+        return C_DIM_EXACT
+    if mode == C_SHAPES_BUCKET and (v & (v - 1)) == 0 then
+        return C_DIM_EXACT
+    if v - (v / C_DIM_ALIGN) * C_DIM_ALIGN == 0 then
+        return C_DIM_ALIGNED
+    return C_DIM_ANY
+
+
+def c_shape_init(out is mut ref CShape, ir is mut ref KernelIR, mode is i32) returns ()
+    # Buckets the kernel's dims under `mode`. With C_SHAPES_BUCKET a
+    # variable-length workload compiles one kernel per power of two it hits
+    # plus at most two runtime ones (aligned and not).
+    (*out).n = (*ir).numel
+    (*out).run = (*ir).run
+    (*out).n_class = c_dim_class(mode, (*out).n)
+    (*out).run_class = c_dim_class(mode, (*out).run)
+    if mode == C_SHAPES_SYMBOLIC then
+        # One kernel per structure: alignment is not worth a second one.
+        if (*out).n_class != C_DIM_EXACT then
+            (*out).n_class = C_DIM_ANY
+        if (*out).run_class != C_DIM_EXACT then
+            (*out).run_class = C_DIM_ANY
+    return
+
+
+def c_shape_dim(cls is i32, v is u64, name is String) returns MutString
+    # SymInt for one dim (caller frees): the literal, or the runtime argument.
+    if cls == C_DIM_EXACT then
+        return sym_const(v)
+    return sym_var(name)
+
+
+def c_sym(c is mut ref CSrc, p is MutString) returns ()
+    # C expression for a SymInt (constants, argument names, + and *).
+    var s is mut ref SymInt = p
+    if (*s).kind == SYM_CONST then
+        if (*s).val < 0 then
+            csrc_put(c, "-")
+            csrc_u64(c, 0 - (*s).val)
+        else
+            csrc_u64(c, (*s).val)
+    else if (*s).kind == SYM_VAR then
+        csrc_put(c, (*s).name)
+    else
+        csrc_put(c, "(")
+        c_sym(c, (*s).a)
+        if (*s).kind == SYM_MUL then
+            csrc_put(c, " * ")
+        else
+            csrc_put(c, " + ")
+        c_sym(c, (*s).b)
+        csrc_put(c, ")")
+    return
+
+
+def c_emit_dim(c is mut ref CSrc, mac is String, cls is i32, v is u64, name is String) returns ()
+    var d is MutString = c_shape_dim(cls, v, name)
+    if d is null then
+        (*c).err = 1
+        return
+    csrc_put(c, "#define ")
+    csrc_put(c, mac)
+    csrc_put(c, " ")
+    c_sym(c, d)
+    csrc_put(c, "\n")
+    sym_free(d)
+    return
+
+
+def c_emit_assume_aligned(c is mut ref CSrc, cls is i32, mac is String) returns ()
+    # Tells the compiler an aligned runtime dim leaves no scalar tail.
+    if cls != C_DIM_ALIGNED then
+        return
+    csrc_put(c, "    if (")
+    csrc_put(c, mac)
+    csrc_put(c, " % ")
+    csrc_u64(c, C_DIM_ALIGN)
+    csrc_put(c, " != 0) __builtin_unreachable();\n")
+    return
+
+
+def c_operand(c is mut ref CSrc, ir is mut ref KernelIR, r is i64, vec is i32) returns ()
+    # Value of source ref `r` at index `i` (a node variable, an inlined
+    # constant, or a load).
+    if r < 0 then
+        var j is u64 = 0 - r - 1
+        if vec != 0 then
+            csrc_put(c, "ld(in")
+            csrc_u64(c, j)
+            csrc_put(c, " + i)")
+        else
+            csrc_put(c, "in")
+            csrc_u64(c, j)
+            csrc_put(c, "[i]")
+        return
+    var slot is u64 = r
+    if slot < (*ir).nn then
+        csrc_put(c, "v")
+    else if vec != 0 then
+        csrc_put(c, "kv")
+    else
+        csrc_put(c, "k")
+    csrc_u64(c, slot)
+    return
+
+
+def c_emit_phase(c is mut ref CSrc, ir is mut ref KernelIR, phase is i32, vec is i32, indent is String) returns ()
+    # One statement per node of `phase`, in dependency order; the root also
+    # stores its value to out[i].
+    var ops is slice of i32 = (*ir).ops
+    var phases is slice of i32 = (*ir).phase
+    var refs is slice of i64 = (*ir).refs
+    var t is usize = 0
+    while t < (*ir).nn do
+        if phases[t] == phase then
+            var op is i32 = ops[t]
+            csrc_put(c, indent)
+            if vec != 0 then
+                csrc_put(c, "vf v")
+            else
+                csrc_put(c, "float v")
+            csrc_u64(c, t)
+            csrc_put(c, " = ")
+            if op == UOP_RELU then
+                if vec != 0 then
+                    csrc_put(c, "vrelu(")
+                else
+                    csrc_put(c, "srelu(")
+                c_operand(c, ir, refs[2 * t], vec)
+                csrc_put(c, ")")
+            else
+                c_operand(c, ir, refs[2 * t], vec)
+                if op == UOP_MUL then
+                    csrc_put(c, " * ")
+                else
+                    csrc_put(c, " + ")
+                c_operand(c, ir, refs[2 * t + 1], vec)
+            csrc_put(c, ";\n")
+            if t + 1 == (*ir).nn then
+                csrc_put(c, indent)
+                if vec != 0 then
+                    csrc_put(c, "st(out + i, v")
+                    csrc_u64(c, t)
+                    csrc_put(c, ");\n")
+                else
+                    csrc_put(c, "out[i] = v")
+                    csrc_u64(c, t)
+                    csrc_put(c, ";\n")
+        t = t + 1
+    return
+
+
+def c_emit_reduce(c is mut ref CSrc, ir is mut ref KernelIR) returns ()
+    var refs is slice of i64 = (*ir).refs
+    var ri is usize = (*ir).reduce
+    var rs is i64 = refs[2 * ri]
+    var root_is_reduce is i32 = (ri + 1 == (*ir).nn)
+    csrc_put(c, "    for (size_t o0 = 0; o0 < N; o0 += RT) {\n        const size_t ot = N - o0 < RT ? N - o0 : RT;\n        float red[RT];\n        for (size_t o = 0; o < ot; o++) {\n            const size_t base = (o0 + o) * RUN;\n            vf acc0 = splat(0.0f), acc1 = splat(0.0f);\n            for (size_t j = 0; j < RUN - RUN % (2 * VW); j += 2 * VW) {\n                {\n                    const size_t i = base + j;\n")
+    c_emit_phase(c, ir, KIR_PROLOGUE, 1, "                    ")
+    csrc_put(c, "                    acc0 += ")
+    c_operand(c, ir, rs, 1)
+    csrc_put(c, ";\n                }\n                {\n                    const size_t i = base + j + VW;\n")
+    c_emit_phase(c, ir, KIR_PROLOGUE, 1, "                    ")
+    csrc_put(c, "                    acc1 += ")
+    c_operand(c, ir, rs, 1)
+    csrc_put(c, ";\n                }\n            }\n            if (RUN % (2 * VW) >= VW) {\n                const size_t i = base + RUN - RUN % (2 * VW);\n")
+    c_emit_phase(c, ir, KIR_PROLOGUE, 1, "                ")
+    csrc_put(c, "                acc0 += ")
+    c_operand(c, ir, rs, 1)
+    csrc_put(c, ";\n            }\n            float acc = hsum(acc0 + acc1);\n            for (size_t j = RUN - RUN % VW; j < RUN; j++) {\n                const size_t i = base + j;\n")
+    c_emit_phase(c, ir, KIR_PROLOGUE, 0, "                ")
+    csrc_put(c, "                acc += ")
+    c_operand(c, ir, rs, 0)
+    csrc_put(c, ";\n            }\n")
+    if root_is_reduce != 0 then
+        csrc_put(c, "            out[o0 + o] = acc;\n        }\n    }\n")
+        return
+    csrc_put(c, "            red[o] = acc;\n        }\n        size_t e = 0;\n        for (; e + VW <= ot; e += VW) {\n            const size_t i = o0 + e;\n            vf v")
+    csrc_u64(c, ri)
+    csrc_put(c, " = ld(red + e);\n")
+    c_emit_phase(c, ir, KIR_EPILOGUE, 1, "            ")
+    csrc_put(c, "        }\n        for (; e < ot; e++) {\n            const size_t i = o0 + e;\n            float v")
+    csrc_u64(c, ri)
+    csrc_put(c, " = red[e];\n")
+    c_emit_phase(c, ir, KIR_EPILOGUE, 0, "            ")
+    csrc_put(c, "        }\n    }\n")
+    return
+
+
+def c_render_kernel(ir is mut ref KernelIR, ninputs is usize, shape is mut ref CShape) returns MutString
+    # C source for one fused kernel (caller frees), or null.
+    var c is CSrc
+    c.err = 0
+    if strbuf_init(&c.sb, 4096) != 0 then
+        return null
+    csrc_put(&c, "#define RT ")
+    csrc_u64(&c, C_REDUCE_TILE)
+    csrc_put(&c, "\n")
+    c_emit_dim(&c, "N", (*shape).n_class, (*shape).n, "n")
+    c_emit_dim(&c, "RUN", (*shape).run_class, (*shape).run, "run")
+    csrc_put(&c, C_FUSED_PRELUDE)
+    csrc_put(&c, "static void kernel(float* out, const float* const* ins, size_t n, size_t run) {\n    (void)n;\n    (void)run;\n")
+    c_emit_assume_aligned(&c, (*shape).n_class, "N")
+    c_emit_assume_aligned(&c, (*shape).run_class, "RUN")
+    var j is usize = 0
+    while j < ninputs do
+        csrc_put(&c, "    const float* in")
+        csrc_u64(&c, j)
+        csrc_put(&c, " = ins[")
+        csrc_u64(&c, j)
+        csrc_put(&c, "];\n")
+        j = j + 1
+    var consts is slice of MutString = (*ir).consts.data
+    var k is usize = 0
+    while k < (*ir).consts.len do
+        var cu is mut ref UOp = consts[k]
+        var slot is usize = (*ir).nn + k
+        csrc_put(&c, "    const float k")
+        csrc_u64(&c, slot)
+        csrc_put(&c, " = kf(0x")
+        csrc_hex(&c, (*cu).arg0)
+        csrc_put(&c, "u);\n    const vf kv")
+        csrc_u64(&c, slot)
+        csrc_put(&c, " = splat(k")
+        csrc_u64(&c, slot)
+        csrc_put(&c, ");\n")
+        k = k + 1
+    if (*ir).reduce < 0 then
+        csrc_put(&c, "    const size_t nv = N - N % VW;\n    for (size_t i = 0; i < nv; i += VW) {\n")
+        c_emit_phase(&c, ir, KIR_EPILOGUE, 1, "        ")
+        csrc_put(&c, "    }\n    for (size_t i = nv; i < N; i++) {\n")
+        c_emit_phase(&c, ir, KIR_EPILOGUE, 0, "        ")
+        csrc_put(&c, "    }\n")
+    else
+        c_emit_reduce(&c, ir)
+    csrc_put(&c, "}\n\n")
+    csrc_put(&c, C_FUSED_ENTRY)
+    if c.err != 0 then
+        strbuf_free(&c.sb)
+        return null
+    return strbuf_take(&c.sb)
+
+
+def c_kernel_hash(ir is mut ref KernelIR, ninputs is usize, shape is mut ref CShape, seed is u64) returns u64
+    var h is u64 = hash_combine(seed, C_KERNEL_ABI)
+    h = hash_combine(h, (*ir).nn)
+    h = hash_combine(h, (*ir).nslots)
+    h = hash_combine(h, ninputs)
+    h = hash_combine(h, (*shape).n_class)
+    h = hash_combine(h, (*shape).run_class)
+    if (*shape).n_class == C_DIM_EXACT then
+        h = hash_combine(h, (*shape).n)
+    if (*shape).run_class == C_DIM_EXACT then
+        h = hash_combine(h, (*shape).run)
+    var ops is slice of i32 = (*ir).ops
+    var phases is slice of i32 = (*ir).phase
+    var refs is slice of i64 = (*ir).refs
+    var t is usize = 0
+    while t < (*ir).nn do
+        h = hash_combine(h, ops[t])
+        h = hash_combine(h, phases[t])
+        h = hash_combine(h, refs[2 * t])
+        h = hash_combine(h, refs[2 * t + 1])
+        t = t + 1
+    var consts is slice of MutString = (*ir).consts.data
+    var k is usize = 0
+    while k < (*ir).consts.len do
+        var cu is mut ref UOp = consts[k]
+        h = hash_combine(h, (*cu).arg0)
+        k = k + 1
+    return h
+
+
+def c_kernel_key(ir is mut ref KernelIR, ninputs is usize, shape is mut ref CShape) returns u64
+    # Structural hash of a lowered kernel: ops, wiring, phases, shape buckets
+    # (literal dims by value) and constant bits, but not which buffers it
+    # reads. Equal keys render equal sources.
+    return c_kernel_hash(ir, ninputs, shape, 0x6a09e667f3bcc908)
+
+
+def c_kernel_check(ir is mut ref KernelIR, ninputs is usize, shape is mut ref CShape) returns u64
+    # The same structure hashed from another seed. Two different kernels
+    # would have to collide in both hashes to share a cache entry.
+    return c_kernel_hash(ir, ninputs, shape, 0xbb67ae8584caa73b)
@@ -1,17 +1,166 @@
 # aster_ml.engine.memory (v0)
 #
-# Placeholder for buffer lifetime + memory planning.
+# Buffer lifetime + memory planning for a Schedule.
 #
-# v0 note: scheduling currently uses an interpreter-style execution and does not
-# yet allocate/plan device buffers. This file exists to reserve the API surface.
+# Every kernel but the last stores its root to an intermediate buffer that is
+# live from that kernel until the last kernel reading it. Instead of one
+# allocation per intermediate, `memplan_build` packs them into arena slots:
+#
+# - kernels are walked in schedule order; a slot whose occupant's last reader
+#   ran before the current kernel is free again;
+# - an elementwise kernel may write over an input that dies at it (element i
+#   is read before element i is stored), so it takes that input's slot;
+# - otherwise the best-fit free slot is taken (the smallest one large
+#   enough, else the largest one, grown), and a new slot only when none is
+#   free;
+# - sizes are rounded up to MEMPLAN_ALIGN bytes and slots are laid out back
+#   to back, so every buffer starts MEMPLAN_ALIGN-aligned in the arena.
+#
+# The last kernel writes the caller's output and gets no slot.
+
+use core.libc
+use aster_ml.uop.ops
+use aster_ml.engine.schedule
+
+const MEMPLAN_ALIGN is usize = 64   # a cache line (and a full AVX-512 vector)
 
 struct MemPlan
-    var dummy is i32
+    var nbufs is usize          # one entry per Schedule kernel
+    var offset is MutString     # `slice of u64`: arena byte offset of kernel k's root
+    var slot is MutString       # `slice of i64`: arena slot of kernel k, -1 for the last kernel
+    var nslots is usize
+    var arena_bytes is usize    # planned peak: one arena for every intermediate
+    var naive_bytes is usize    # one buffer per intermediate, all live at once
+    var inplace is usize        # kernels that write over a dying input
+
+
+def memplan_align(n is usize) returns usize
+    if n == 0 then
+        return MEMPLAN_ALIGN
+    return (n + MEMPLAN_ALIGN - 1) & (0 - MEMPLAN_ALIGN)
 
-def memplan_build(out is mut ref MemPlan) returns i32
-    (*out).dummy = 0
-    return 0
 
 def memplan_free(out is mut ref MemPlan) returns ()
-    (*out).dummy = 0
+    if (*out).offset is not null then
+        free((*out).offset)
+    if (*out).slot is not null then
+        free((*out).slot)
+    (*out).offset = null
+    (*out).slot = null
+    (*out).nbufs = 0
+    (*out).nslots = 0
     return
+
+
+def memplan_pick(slot_size is slice of u64, slot_last is slice of u64, nslots is usize, k is usize, need is usize) returns i64
+    # Best-fit free slot for a `need`-byte buffer at kernel k, or -1.
+    var best is i64 = 0 - 1
+    var best_size is u64 = 0
+    var big is i64 = 0 - 1
+    var big_size is u64 = 0
+    var s is usize = 0
+    while s < nslots do
+        if slot_last[s] < k then
+            var sz is u64 = slot_size[s]
+            if sz >= need and (best < 0 or sz < best_size) then
+                best = s
+                best_size = sz
+            if big < 0 or sz > big_size then
+                big = s
+                big_size = sz
+        s = s + 1
+    if best >= 0 then
+        return best
+    return big
+
+
+def memplan_build(out is mut ref MemPlan, s is mut ref Schedule) returns i32
+    var nk is usize = (*s).kernels.len
+    (*out).nbufs = nk
+    (*out).nslots = 0
+    (*out).arena_bytes = 0
+    (*out).naive_bytes = 0
+    (*out).inplace = 0
+    (*out).offset = calloc(nk + 1, 8)
+    (*out).slot = calloc(nk + 1, 8)
+    var last is slice of u64 = calloc(nk + 1, 8)
+    var need is slice of u64 = calloc(nk + 1, 8)
+    # Slot tables (at most one slot per kernel).
+    var slot_size is slice of u64 = calloc(nk + 1, 8)
+    var slot_last is slice of u64 = calloc(nk + 1, 8)
+    var rc is i32 = 0
+    if (*out).offset is null or (*out).slot is null or last is null or need is null or slot_size is null or slot_last is null then
+        rc = 1
+
+    var ks is slice of MutString = (*s).kernels.data
+    var offset is slice of u64 = (*out).offset
+    var slot is slice of i64 = (*out).slot
+    var k is usize = 0
+    # Liveness: kernel k's buffer is read up to last[k].
+    while rc == 0 and k < nk do
+        var kk is mut ref SchedKernel = ks[k]
+        last[k] = k
+        need[k] = memplan_align(uop_numel((*kk).root) * 4)
+        var ink is slice of MutString = (*kk).input_kernels.data
+        var j is usize = 0
+        while j < (*kk).input_kernels.len do
+            if ink[j] is not null then
+                var pk is mut ref SchedKernel = ink[j]
+                if last[(*pk).id] < k then
+                    last[(*pk).id] = k
+            j = j + 1
+        k = k + 1
+
+    k = 0
+    while rc == 0 and k + 1 < nk do
+        var kk2 is mut ref SchedKernel = ks[k]
+        (*out).naive_bytes = (*out).naive_bytes + need[k]
+        var chosen is i64 = 0 - 1
+        if (*kk2).reduce is null then
+            var ink2 is slice of MutString = (*kk2).input_kernels.data
+            var j2 is usize = 0
+            while chosen < 0 and j2 < (*kk2).input_kernels.len do
+                if ink2[j2] is not null then
+                    var pk2 is mut ref SchedKernel = ink2[j2]
+                    if last[(*pk2).id] == k then
+                        chosen = slot[(*pk2).id]
+                        (*out).inplace = (*out).inplace + 1
+                j2 = j2 + 1
+        if chosen < 0 then
+            chosen = memplan_pick(slot_size, slot_last, (*out).nslots, k, need[k])
+        if chosen < 0 then
+            chosen = (*out).nslots
+            slot_size[chosen] = 0
+            (*out).nslots = (*out).nslots + 1
+        if slot_size[chosen] < need[k] then
+            slot_size[chosen] = need[k]
+        slot_last[chosen] = last[k]
+        slot[k] = chosen
+        k = k + 1
+    if rc == 0 and nk != 0 then
+        slot[nk - 1] = 0 - 1
+
+    # Lay the slots out back to back (slot_size becomes the slot's offset).
+    if rc == 0 then
+        var so is usize = 0
+        while so < (*out).nslots do
+            var sz2 is u64 = slot_size[so]
+            slot_size[so] = (*out).arena_bytes
+            (*out).arena_bytes = (*out).arena_bytes + sz2
+            so = so + 1
+        k = 0
+        while k + 1 < nk do
+            offset[k] = slot_size[slot[k]]
+            k = k + 1
+
+    if last is not null then
+        free(last)
+    if need is not null then
+        free(need)
+    if slot_size is not null then
+        free(slot_size)
+    if slot_last is not null then
+        free(slot_last)
+    if rc != 0 then
+        memplan_free(out)
+    return rc
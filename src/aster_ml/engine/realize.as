@@ -0,0 +1,262 @@
+# aster_ml.engine.realize (v0)
+#
+# Executes a fused Schedule on the CPU (float32).
+#
+# Kernels run compiled: `cpu_fused_run` renders each distinct kernel to C
+# specialized for its shapes, builds it once and calls it. If it cannot be
+# built (no compiler), or ASTER_ML_REALIZE=interp, the kernel is interpreted
+# instead, with the same fusion:
+#
+# Each SchedKernel runs as one pass: its nodes are evaluated a block of
+# REALIZE_BLK elements at a time into scratch slots that stay in cache, and
+# only the root's value is written to memory. A reduce kernel walks its
+# output in blocks; for every output element it runs the prologue over the
+# reduced run and sums it, then evaluates the epilogue on the block.
+#
+# Buffers:
+# - UOP_BUFFER slot i reads `bufs[i]` (a float* borrowed from the caller);
+# - the last kernel writes to `out`;
+# - every other kernel root lives in one arena laid out by `memplan_build`
+#   (buffers with disjoint lifetimes share bytes), freed on return.
+
+use core.libc
+use aster_ml.uop.ops
+use aster_ml.engine.schedule
+use aster_ml.engine.memory
+use aster_ml.runtime.ops_cpu
+
+const REALIZE_BLK is usize = 256
+
+struct KernelProg
+    # Interpreter state for one kernel: slots 0..nslots-1 of the KernelIR
+    # are REALIZE_BLK-float scratch blocks (CONST slots pre-filled).
+    var ir is KernelIR
+    var slots is MutString     # nslots * REALIZE_BLK floats
+    var ins is MutString       # `slice of MutString`, per kernel input
+    var out is MutString
+
+
+def kprog_free(p is mut ref KernelProg) returns ()
+    kernel_ir_free(&(*p).ir)
+    if (*p).slots is not null then
+        free((*p).slots)
+    (*p).slots = null
+    return
+
+
+def kprog_build(p is mut ref KernelProg, k is mut ref SchedKernel) returns i32
+    (*p).slots = null
+    if kernel_ir_build(&(*p).ir, k) != 0 then
+        return 1
+    (*p).slots = malloc((*p).ir.nslots * REALIZE_BLK * 4)
+    if (*p).slots is null then
+        kprog_free(p)
+        return 1
+    var consts is slice of MutString = (*p).ir.consts.data
+    var c is usize = 0
+    while c < (*p).ir.consts.len do
+        var cs is slice of f32 = (*p).slots + ((*p).ir.nn + c) * REALIZE_BLK * 4
+        var v is f32 = uop_const_value(consts[c])
+        var e is usize = 0
+        while e < REALIZE_BLK do
+            cs[e] = v
+            e = e + 1
+        c = c + 1
+    return 0
+
+
+def kprog_src(p is mut ref KernelProg, r is i64, i0 is usize) returns MutString
+    # Operand block for elements [i0, i0 + REALIZE_BLK): a slot, or the
+    # input itself at i0 (read in place, no copy).
+    if r >= 0 then
+        var slot is usize = r
+        return (*p).slots + slot * REALIZE_BLK * 4
+    var j is usize = 0 - r - 1
+    var ins is slice of MutString = (*p).ins
+    return ins[j] + i0 * 4
+
+
+def kprog_dst(p is mut ref KernelProg, t is usize, i0 is usize) returns MutString
+    # The root stores straight to the output; other nodes to their slot.
+    if t + 1 == (*p).ir.nn then
+        return (*p).out + i0 * 4
+    return (*p).slots + t * REALIZE_BLK * 4
+
+
+def kprog_eval(p is mut ref KernelProg, phase is i32, i0 is usize, len is usize) returns ()
+    # Evaluates every node of `phase` for elements [i0, i0 + len).
+    var ops is slice of i32 = (*p).ir.ops
+    var phases is slice of i32 = (*p).ir.phase
+    var refs is slice of i64 = (*p).ir.refs
+    var t is usize = 0
+    while t < (*p).ir.nn do
+        if phases[t] == phase then
+            var op is i32 = ops[t]
+            var d is slice of f32 = kprog_dst(p, t, i0)
+            var x is slice of f32 = kprog_src(p, refs[2 * t], i0)
+            var e is usize = 0
+            if op == UOP_ADD then
+                var y is slice of f32 = kprog_src(p, refs[2 * t + 1], i0)
+                while e < len do
+                    d[e] = x[e] + y[e]
+                    e = e + 1
+            else if op == UOP_MUL then
+                var y2 is slice of f32 = kprog_src(p, refs[2 * t + 1], i0)
+                while e < len do
+                    d[e] = x[e] * y2[e]
+                    e = e + 1
+            else if op == UOP_RELU then
+                while e < len do
+                    var v is f32 = x[e]
+                    if v < 0.0 then
+                        v = 0.0
+                    d[e] = v
+                    e = e + 1
+        t = t + 1
+    return
+
+
+def kprog_run(p is mut ref KernelProg) returns ()
+    if (*p).ir.reduce < 0 then
+        var n is usize = (*p).ir.numel
+        var i0 is usize = 0
+        while i0 < n do
+            var len is usize = n - i0
+            if len > REALIZE_BLK then
+                len = REALIZE_BLK
+            kprog_eval(p, KIR_EPILOGUE, i0, len)
+            i0 = i0 + len
+        return
+
+    var ri is usize = (*p).ir.reduce
+    var run is usize = (*p).ir.run
+    var nout is usize = (*p).ir.numel
+    var refs is slice of i64 = (*p).ir.refs
+    var rsrc is i64 = refs[2 * ri]
+    var o0 is usize = 0
+    while o0 < nout do
+        var olen is usize = nout - o0
+        if olen > REALIZE_BLK then
+            olen = REALIZE_BLK
+        var acc_out is slice of f32 = kprog_dst(p, ri, o0)
+        var o is usize = 0
+        while o < olen do
+            var acc is f32 = 0.0
+            var base is usize = (o0 + o) * run
+            var c is usize = 0
+            while c < run do
+                var clen is usize = run - c
+                if clen > REALIZE_BLK then
+                    clen = REALIZE_BLK
+                kprog_eval(p, KIR_PROLOGUE, base + c, clen)
+                var x is slice of f32 = kprog_src(p, rsrc, base + c)
+                var e is usize = 0
+                while e < clen do
+                    acc = acc + x[e]
+                    e = e + 1
+                c = c + clen
+            acc_out[o] = acc
+            o = o + 1
+        kprog_eval(p, KIR_EPILOGUE, o0, olen)
+        o0 = o0 + olen
+    return
+
+
+def realize_leaf(sink is MutString, bufs is mut ref VecPtr, out is MutString) returns i32
+    # A sink that is itself a leaf: copy the buffer / fill the constant.
+    var u is mut ref UOp = sink
+    if (*u).op == UOP_BUFFER then
+        var bs is slice of MutString = (*bufs).data
+        memcpy(out, bs[(*u).arg0], (*u).arg1 * 4)
+        return 0
+    if (*u).op == UOP_CONST then
+        var o is slice of f32 = out
+        o[0] = uop_const_value(sink)
+        return 0
+    return 1
+
+
+def realize_use_jit() returns i32
+    var mode is String = getenv("ASTER_ML_REALIZE")
+    if mode is not null and strcmp(mode, "interp") == 0 then
+        return 0
+    return 1
+
+
+def realize_schedule(s is mut ref Schedule, bufs is mut ref VecPtr, out is MutString) returns i32
+    var nk is usize = (*s).kernels.len
+    if nk == 0 then
+        if (*s).order.len == 0 then
+            return 1
+        var order is slice of MutString = (*s).order.data
+        return realize_leaf(order[(*s).order.len - 1], bufs, out)
+
+    var plan is MemPlan
+    if memplan_build(&plan, s) != 0 then
+        return 1
+    var arena is MutString = malloc(plan.arena_bytes + MEMPLAN_ALIGN)
+    var outs is slice of MutString = calloc(nk, 8)
+    if arena is null or outs is null then
+        if arena is not null then
+            free(arena)
+        if outs is not null then
+            free(outs)
+        memplan_free(&plan)
+        return 1
+    var nul is MutString = null
+    var addr is u64 = arena - nul
+    var base is MutString = arena + ((0 - addr) & (MEMPLAN_ALIGN - 1))
+    var offs is slice of u64 = plan.offset
+    var ks is slice of MutString = (*s).kernels.data
+    var bs is slice of MutString = (*bufs).data
+    var jit is i32 = realize_use_jit()
+    var rc is i32 = 0
+    var ki is usize = 0
+    while rc == 0 and ki < nk do
+        var k is mut ref SchedKernel = ks[ki]
+        if ki + 1 == nk then
+            outs[ki] = out
+        else
+            outs[ki] = base + offs[ki]
+        var ins is slice of MutString = null
+        if rc == 0 and (*k).inputs.len != 0 then
+            ins = malloc((*k).inputs.len * 8)
+            if ins is null then
+                rc = 1
+        if rc == 0 then
+            var inu is slice of MutString = (*k).inputs.data
+            var ink is slice of MutString = (*k).input_kernels.data
+            var j is usize = 0
+            while j < (*k).inputs.len do
+                if ink[j] is null then
+                    var bu is mut ref UOp = inu[j]
+                    ins[j] = bs[(*bu).arg0]
+                else
+                    var pk is mut ref SchedKernel = ink[j]
+                    ins[j] = outs[(*pk).id]
+                j = j + 1
+            var ir is KernelIR
+            if kernel_ir_build(&ir, k) != 0 then
+                rc = 1
+            else
+                var done is i32 = 0
+                if jit != 0 and cpu_fused_run(&ir, (*k).inputs.len, ins, outs[ki]) == 0 then
+                    done = 1
+                kernel_ir_free(&ir)
+                if done == 0 then
+                    var prog is KernelProg
+                    if kprog_build(&prog, k) != 0 then
+                        rc = 1
+                    else
+                        prog.ins = ins
+                        prog.out = outs[ki]
+                        kprog_run(&prog)
+                        kprog_free(&prog)
+        if ins is not null then
+            free(ins)
+        ki = ki + 1
+
+    free(outs)
+    free(arena)
+    memplan_free(&plan)
+    return rc
@@ -2,63 +2,443 @@
 #
 # Deterministic schedule construction for a UOp sink.
 #
-# v0: a minimal topo-order schedule used to unblock the rest of the ML stack.
+# - `order`: every UOp reachable from the sink, in dependency order.
+# - `kernels`: the computed UOps grouped into fused kernels, also in
+#   dependency order. Each kernel stores one value (its root) to a buffer;
+#   everything else it computes lives in registers/scratch:
+#   - a node is a kernel root if it is the sink or has more than one user
+#     (realize once instead of recomputing per use);
+#   - any other node fuses into its only user's kernel, so elementwise
+#     chains become one kernel;
+#   - a kernel holds at most one UOP_REDUCE_SUM: the nodes below it are its
+#     prologue (evaluated per input element), the nodes above it its
+#     epilogue (per output element). A second reduce starts a new kernel.
+#   CONST and BUFFER nodes are leaves: loaded (or inlined), never computed.
 
+use core.libc
+use core.map
 use aster_ml.uop.ops
 
+const SCHED_KERNEL_BYTES is usize = 96  # sizeof(SchedKernel) on 64-bit
+
+# Node phases within a kernel (KernelIR.phase).
+const KIR_EPILOGUE is i32 = 0   # per output element (all nodes of an elementwise kernel)
+const KIR_PROLOGUE is i32 = 1   # per reduced input element
+const KIR_REDUCE is i32 = 2     # the reduce itself (accumulated, not evaluated)
+const KIR_REF_FAIL is i64 = 0x7FFFFFFFFFFFFFFF  # kernel_ir_ref: out of memory (never a slot or input ref)
+
+struct SchedKernel
+    var id is usize             # index in Schedule.kernels
+    var root is MutString       # UOp* the kernel stores
+    var reduce is MutString     # its UOP_REDUCE_SUM, or null (pure elementwise)
+    var nodes is VecPtr         # computed UOps, dependency order, root last
+    var inputs is VecPtr        # UOps it loads: BUFFERs and earlier kernels' roots
+    var input_kernels is VecPtr # per input: producing SchedKernel*, or null for a BUFFER
+
+
+struct KernelIR
+    # A SchedKernel lowered for the executors (interpreter, C renderer).
+    # Computed nodes are slots 0..nn-1 (root nn-1), inlined CONSTs slots
+    # nn..nslots-1. Source refs: >= 0 is a slot, < 0 is input -(ref + 1).
+    var nn is usize
+    var nslots is usize
+    var ops is MutString       # `slice of i32`
+    var phase is MutString     # `slice of i32`
+    var refs is MutString      # `slice of i64`, 2 per node (unary: both the same)
+    var consts is VecPtr       # CONST UOp* for slots nn..nslots-1
+    var reduce is i64          # node index of the reduce, or -1
+    var numel is usize         # elements the root stores
+    var run is usize           # reduced run length (0 without a reduce)
+
+
 struct Schedule
     var order is VecPtr   # list of UOp* in dependency order
+    var kernels is VecPtr # list of SchedKernel* in dependency order
 
 
 def schedule_init(s is mut ref Schedule) returns ()
     vec_ptr_init(&(*s).order)
+    vec_ptr_init(&(*s).kernels)
+    return
+
+
+def sched_kernel_free(k is mut ref SchedKernel) returns ()
+    vec_ptr_free(&(*k).nodes)
+    vec_ptr_free(&(*k).inputs)
+    vec_ptr_free(&(*k).input_kernels)
     return
 
 
 def schedule_free(s is mut ref Schedule) returns ()
+    var ks is slice of MutString = (*s).kernels.data
+    var i is usize = 0
+    while i < (*s).kernels.len do
+        sched_kernel_free(ks[i])
+        free(ks[i])
+        i = i + 1
+    vec_ptr_free(&(*s).kernels)
     vec_ptr_free(&(*s).order)
     return
 
 
-def vec_ptr_contains(v is mut ref VecPtr, p is MutString) returns i32
-    var xs is slice of MutString = (*v).data
+# UOp.mark while schedule_build runs: 0 unvisited, SCHED_OPEN on the DFS
+# stack, else 1 + the node's index in `order`. Cleared before returning.
+const SCHED_OPEN is u64 = 0xffffffffffffffff
+
+
+def schedule_index(p is MutString) returns usize
+    var u is mut ref UOp = p
+    return (*u).mark - 1
+
+
+def schedule_unmark(order is mut ref VecPtr) returns ()
+    var xs is slice of MutString = (*order).data
     var i is usize = 0
-    while i < (*v).len do
-        if xs[i] == p then
-            return 1
+    while i < (*order).len do
+        var u is mut ref UOp = xs[i]
+        (*u).mark = 0
         i = i + 1
-    return 0
+    return
 
 
-def schedule_visit(order is mut ref VecPtr, seen is mut ref VecPtr, p is MutString) returns i32
-    if p is null then
-        return 1
-    if vec_ptr_contains(seen, p) != 0 then
-        return 0
-    if vec_ptr_push(seen, p) != 0 then
+def schedule_topo(order is mut ref VecPtr, sink is MutString) returns i32
+    # Post-order DFS from the sink with an explicit stack (graph depth is not
+    # bounded by the call stack), sources in order. Every reachable UOp is
+    # appended to `order` once; visited state lives in UOp.mark, so the walk
+    # is linear in graph size. On failure the still-open nodes are unmarked
+    # here; the caller unmarks the finished ones (`order`).
+    if sink is null then
         return 1
+    var stack is VecPtr     # UOp* path from the sink
+    var cur is slice of u64 = malloc(64 * 8)  # per stack entry: next source
+    var cur_cap is usize = 64
+    vec_ptr_init(&stack)
+    var rc is i32 = 0
+    if cur is null or vec_ptr_push(&stack, sink) != 0 then
+        rc = 1
+    else
+        var su is mut ref UOp = sink
+        (*su).mark = SCHED_OPEN
+        cur[0] = 0
+    while rc == 0 and stack.len != 0 do
+        var top is usize = stack.len - 1
+        var st is slice of MutString = stack.data
+        var p is MutString = st[top]
+        var u is mut ref UOp = p
+        var next is u64 = cur[top]
+        if next < (*u).nsrc then
+            cur[top] = next + 1
+            var src is slice of MutString = (*u).src
+            var c is MutString = src[next]
+            if c is null then
+                rc = 1
+                continue
+            var cu is mut ref UOp = c
+            if (*cu).mark != 0 then
+                continue
+            if stack.len == cur_cap then
+                var grown is slice of u64 = malloc(cur_cap * 2 * 8)
+                if grown is null then
+                    rc = 1
+                    continue
+                memcpy(grown, cur, cur_cap * 8)
+                free(cur)
+                cur = grown
+                cur_cap = cur_cap * 2
+            if vec_ptr_push(&stack, c) != 0 then
+                rc = 1
+                continue
+            (*cu).mark = SCHED_OPEN
+            cur[stack.len - 1] = 0
+        else
+            stack.len = top
+            if vec_ptr_push(order, p) != 0 then
+                rc = 1
+                continue
+            (*u).mark = (*order).len
+    if rc != 0 then
+        var sx is slice of MutString = stack.data
+        var k is usize = 0
+        while k < stack.len do
+            var ou is mut ref UOp = sx[k]
+            (*ou).mark = 0
+            k = k + 1
+    if cur is not null then
+        free(cur)
+    vec_ptr_free(&stack)
+    return rc
 
-    var u is mut ref UOp = p
-    var i is usize = 0
+
+def uop_src_repeats(u is mut ref UOp, i is usize) returns i32
+    # 1 if source i already appeared at a lower index (add(x, x) uses x once).
     var src is slice of MutString = (*u).src
-    while i < (*u).nsrc do
-        if schedule_visit(order, seen, src[i]) != 0 then
+    var j is usize = 0
+    while j < i do
+        if src[j] == src[i] then
             return 1
+        j = j + 1
+    return 0
+
+
+def sched_kernel_new(root is MutString) returns MutString
+    var kp is MutString = malloc(SCHED_KERNEL_BYTES)
+    if kp is null then
+        return null
+    var k is mut ref SchedKernel = kp
+    (*k).id = 0
+    (*k).root = root
+    (*k).reduce = null
+    vec_ptr_init(&(*k).nodes)
+    vec_ptr_init(&(*k).inputs)
+    vec_ptr_init(&(*k).input_kernels)
+    return kp
+
+
+def schedule_group(s is mut ref Schedule, users is slice of u64, user is slice of u64, kern is slice of MutString) returns i32
+    # Assigns each computed node a kernel (`kern`), sink first, then fills
+    # the kernels' node and input lists in dependency order.
+    var order is slice of MutString = (*s).order.data
+    var n is usize = (*s).order.len
+    var i is usize = n
+    while i > 0 do
+        i = i - 1
+        var p is MutString = order[i]
+        if uop_is_leaf(p) != 0 then
+            continue
+        var u is mut ref UOp = p
+        var kp is MutString = null
+        if i + 1 != n and users[i] == 1 then
+            kp = kern[user[i]]
+            var uk is mut ref SchedKernel = kp
+            if (*u).op == UOP_REDUCE_SUM and (*uk).reduce is not null then
+                kp = null
+        if kp is null then
+            kp = sched_kernel_new(p)
+            if kp is null then
+                return 1
+            if vec_ptr_push(&(*s).kernels, kp) != 0 then
+                free(kp)
+                return 1
+        kern[i] = kp
+        if (*u).op == UOP_REDUCE_SUM then
+            var k is mut ref SchedKernel = kp
+            (*k).reduce = p
+
+    # Kernels were created sink-first; flip to dependency order.
+    var ks is slice of MutString = (*s).kernels.data
+    var nk is usize = (*s).kernels.len
+    var a is usize = 0
+    while a < nk / 2 do
+        var t is MutString = ks[a]
+        ks[a] = ks[nk - 1 - a]
+        ks[nk - 1 - a] = t
+        a = a + 1
+    a = 0
+    while a < nk do
+        var ka is mut ref SchedKernel = ks[a]
+        (*ka).id = a
+        a = a + 1
+
+    i = 0
+    while i < n do
+        if kern[i] is not null then
+            var kn is mut ref SchedKernel = kern[i]
+            if vec_ptr_push(&(*kn).nodes, order[i]) != 0 then
+                return 1
         i = i + 1
 
-    if vec_ptr_push(order, p) != 0 then
+    # Inputs per kernel, first use first. `mark[si]` is 1 + the id of the
+    # last kernel that took node si as an input.
+    var mark is slice of u64 = calloc(n, 8)
+    if mark is null then
         return 1
+    a = 0
+    while a < nk do
+        var k2 is mut ref SchedKernel = ks[a]
+        var kn2 is slice of MutString = (*k2).nodes.data
+        var ni is usize = 0
+        while ni < (*k2).nodes.len do
+            var u2 is mut ref UOp = kn2[ni]
+            var src is slice of MutString = (*u2).src
+            var j is usize = 0
+            while j < (*u2).nsrc do
+                var sp is MutString = src[j]
+                var su is mut ref UOp = sp
+                var si is usize = schedule_index(sp)
+                var producer is MutString = kern[si]
+                if (*su).op != UOP_CONST and producer != ks[a] and mark[si] != a + 1 then
+                    mark[si] = a + 1
+                    if vec_ptr_push(&(*k2).inputs, sp) != 0 or vec_ptr_push(&(*k2).input_kernels, producer) != 0 then
+                        free(mark)
+                        return 1
+                j = j + 1
+            ni = ni + 1
+        a = a + 1
+    free(mark)
     return 0
 
 
 def schedule_build(out is mut ref Schedule, sink is MutString) returns i32
     schedule_init(out)
-    var seen is VecPtr
-    vec_ptr_init(&seen)
+    var rc is i32 = schedule_topo(&(*out).order, sink)
+    if rc != 0 then
+        schedule_unmark(&(*out).order)
+        schedule_free(out)
+        return 1
 
-    var rc is i32 = schedule_visit(&(*out).order, &seen, sink)
-    vec_ptr_free(&seen)
+    # Users per node (distinct consumers) and the last one seen.
+    var n is usize = (*out).order.len
+    var order is slice of MutString = (*out).order.data
+    var users is slice of u64 = calloc(n, 8)
+    var user is slice of u64 = calloc(n, 8)
+    var kern is slice of MutString = calloc(n, 8)
+    if users is null or user is null or kern is null then
+        rc = 1
+    var i is usize = 0
+    while rc == 0 and i < n do
+        var u is mut ref UOp = order[i]
+        var src is slice of MutString = (*u).src
+        var j is usize = 0
+        while rc == 0 and j < (*u).nsrc do
+            if uop_src_repeats(u, j) == 0 then
+                var si is usize = schedule_index(src[j])
+                users[si] = users[si] + 1
+                user[si] = i
+            j = j + 1
+        i = i + 1
+    if rc == 0 then
+        rc = schedule_group(out, users, user, kern)
+
+    schedule_unmark(&(*out).order)
+    if users is not null then
+        free(users)
+    if user is not null then
+        free(user)
+    if kern is not null then
+        free(kern)
     if rc != 0 then
         schedule_free(out)
         return 1
     return 0
+
+
+# -----------------------------
+# Lowering
+# -----------------------------
+
+def kernel_ir_free(ir is mut ref KernelIR) returns ()
+    if (*ir).ops is not null then
+        free((*ir).ops)
+    if (*ir).phase is not null then
+        free((*ir).phase)
+    if (*ir).refs is not null then
+        free((*ir).refs)
+    vec_ptr_free(&(*ir).consts)
+    (*ir).ops = null
+    (*ir).phase = null
+    (*ir).refs = null
+    return
+
+
+def kernel_ir_key(p is MutString) returns u64
+    # MapU64 key for a UOp pointer.
+    var nul is MutString = null
+    var k is u64 = p - nul
+    return k
+
+
+def kernel_ir_ref(ir is mut ref KernelIR, map is mut ref MapU64, sp is MutString) returns i64
+    # Slot/input ref for source `sp` (inputs and earlier nodes are already in
+    # `map`); a CONST gets a slot on first use. KIR_REF_FAIL on allocation
+    # failure.
+    var v is u64 = 0
+    if mapu64_get(map, kernel_ir_key(sp), &v) != 0 then
+        var r is i64 = v
+        return r
+    var slot is usize = (*ir).nslots
+    if vec_ptr_push(&(*ir).consts, sp) != 0 then
+        return KIR_REF_FAIL
+    if mapu64_put(map, kernel_ir_key(sp), slot) != 0 then
+        return KIR_REF_FAIL
+    (*ir).nslots = slot + 1
+    var r2 is i64 = slot
+    return r2
+
+
+def kernel_ir_build(ir is mut ref KernelIR, k is mut ref SchedKernel) returns i32
+    var nn is usize = (*k).nodes.len
+    var root is mut ref UOp = (*k).root
+    (*ir).nn = nn
+    (*ir).nslots = nn
+    (*ir).reduce = 0 - 1
+    (*ir).numel = (*root).arg1
+    (*ir).run = 0
+    vec_ptr_init(&(*ir).consts)
+    (*ir).ops = malloc(nn * 4)
+    (*ir).phase = malloc(nn * 4)
+    (*ir).refs = malloc(nn * 16)
+    if (*ir).ops is null or (*ir).phase is null or (*ir).refs is null then
+        kernel_ir_free(ir)
+        return 1
+    var map is MapU64
+    if mapu64_init(&map, nn + (*k).inputs.len + 8) != 0 then
+        kernel_ir_free(ir)
+        return 1
+    var ins is slice of MutString = (*k).inputs.data
+    var j0 is usize = 0
+    while j0 < (*k).inputs.len do
+        var r0 is i64 = j0
+        var neg is i64 = 0 - r0 - 1
+        var nv is u64 = neg
+        if mapu64_put(&map, kernel_ir_key(ins[j0]), nv) != 0 then
+            mapu64_free(&map)
+            kernel_ir_free(ir)
+            return 1
+        j0 = j0 + 1
+    var ops is slice of i32 = (*ir).ops
+    var phase is slice of i32 = (*ir).phase
+    var refs is slice of i64 = (*ir).refs
+    var nodes is slice of MutString = (*k).nodes.data
+    var t is usize = 0
+    while t < nn do
+        var u is mut ref UOp = nodes[t]
+        var src is slice of MutString = (*u).src
+        ops[t] = (*u).op
+        phase[t] = KIR_EPILOGUE
+        refs[2 * t] = kernel_ir_ref(ir, &map, src[0])
+        refs[2 * t + 1] = refs[2 * t]
+        if (*u).nsrc > 1 then
+            refs[2 * t + 1] = kernel_ir_ref(ir, &map, src[1])
+        var failed is i32 = 0
+        if refs[2 * t] == KIR_REF_FAIL or refs[2 * t + 1] == KIR_REF_FAIL then
+            failed = 1
+        else if mapu64_put(&map, kernel_ir_key(nodes[t]), t) != 0 then
+            failed = 1
+        if failed != 0 then
+            mapu64_free(&map)
+            kernel_ir_free(ir)
+            return 1
+        if (*u).op == UOP_REDUCE_SUM then
+            var ti is i64 = t
+            (*ir).reduce = ti
+            (*ir).run = (*u).arg0
+        t = t + 1
+    mapu64_free(&map)
+
+    # Phases, root down: whatever feeds the reduce (transitively) is prologue.
+    var nni is i64 = nn
+    t = nn
+    while t > 0 do
+        t = t - 1
+        var ph is i32 = phase[t]
+        if ops[t] == UOP_REDUCE_SUM then
+            phase[t] = KIR_REDUCE
+            ph = KIR_PROLOGUE
+        var j is usize = 0
+        while j < 2 do
+            var r is i64 = refs[2 * t + j]
+            if r >= 0 and r < nni then
+                var ri is usize = r
+                phase[ri] = ph
+            j = j + 1
+    return 0
@@ -368,7 +368,7 @@ def tensor_copy_any_to_contig_f32(dst is mut ref Tensor, src is mut ref Tensor)
         if tensor_get_f32(src, idx, &v) != 0 then
             free(idx)
             return 1
-        var p is MutString = tensor_elem_ptr(dst, idx)
+        var p is MutString = tensor_elem_ptr_at(dst, idx)
         if p is null then
             free(idx)
             return 1
@@ -535,8 +535,33 @@ def grad_tensor_backward_visit(t is mut ref GradTensor) returns i32
             if grad_tensor_alloc_grad(b) != 0 then
                 return 1
 
+        # CPU: accumulate straight into the grads, reading the transposes as
+        # strided views (no transposed copies, no temporary products).
+        var on_cpu is i32 = 0
+        if (*t).grad.device == DEV_CPU and (*a).data.device == DEV_CPU and (*b).data.device == DEV_CPU then
+            on_cpu = 1
+        if on_cpu != 0 then
+            if ra != 0 then
+                var btv is Tensor
+                tensor_reset(&btv)
+                if tensor_transpose(&btv, &(*b).data, 0, 1) != 0 then
+                    return 1
+                var rca is i32 = tensor_matmul_into_f32(&(*a).grad, &(*t).grad, &btv, 1)
+                tensor_free(&btv)
+                if rca != 0 then
+                    return 1
+            if rb != 0 then
+                var atv is Tensor
+                tensor_reset(&atv)
+                if tensor_transpose(&atv, &(*a).data, 0, 1) != 0 then
+                    return 1
+                var rcb is i32 = tensor_matmul_into_f32(&(*b).grad, &atv, &(*t).grad, 1)
+                tensor_free(&atv)
+                if rcb != 0 then
+                    return 1
+
         # grad_a += grad_out.matmul(b^T)
-        if ra != 0 then
+        if ra != 0 and on_cpu == 0 then
             var bt is Tensor
             tensor_reset(&bt)
             if tensor_transpose_2d_contig_f32(&bt, &(*b).data) != 0 then
@@ -554,7 +579,7 @@ def grad_tensor_backward_visit(t is mut ref GradTensor) returns i32
             tensor_free(&bt)
 
         # grad_b += a^T.matmul(grad_out)
-        if rb != 0 then
+        if rb != 0 and on_cpu == 0 then
             var at is Tensor
             tensor_reset(&at)
             if tensor_transpose_2d_contig_f32(&at, &(*a).data) != 0 then
@@ -0,0 +1,125 @@
+# aster_ml.lazy (v0)
+#
+# Lazy execution mode for float32 CPU tensors.
+#
+# Instead of computing (and allocating) a result per call like
+# `tensor_add_f32`, the `lazy_*` ops only build UOps in the LazyCtx. Work
+# happens in `lazy_realize`: the graph under the requested node is
+# scheduled into fused kernels (`engine/schedule.as`) and run
+# (`engine/realize.as`), so `relu(a*b + c)` is a single pass over a, b, c and
+# the output, and only kernel roots (nodes with several users, or a second
+# reduce) get buffers.
+#
+# Graph nodes are interned UOp pointers (MutString). Elementwise ops need
+# equal element counts, or one side a `lazy_const` scalar. Inputs are
+# borrowed: a tensor passed to `lazy_buffer` must stay alive and unchanged
+# until the last realize that reads it.
+#
+# The context is explicit (no global "lazy mode" switch): code opts in by
+# building through a LazyCtx and calling `lazy_realize` for the values it
+# needs.
+
+use core.libc
+use aster_ml.tensor
+use aster_ml.dtype
+use aster_ml.device
+use aster_ml.uop.ops
+use aster_ml.engine.schedule
+use aster_ml.engine.realize
+
+struct LazyCtx
+    var uops is UOpCtx
+    var bufs is VecPtr   # float* per UOP_BUFFER slot (borrowed)
+
+
+def lazy_init(lz is mut ref LazyCtx) returns i32
+    vec_ptr_init(&(*lz).bufs)
+    return uop_ctx_init(&(*lz).uops)
+
+
+def lazy_free(lz is mut ref LazyCtx) returns ()
+    uop_ctx_free(&(*lz).uops)
+    vec_ptr_free(&(*lz).bufs)
+    return
+
+
+def lazy_buffer(lz is mut ref LazyCtx, t is mut ref Tensor) returns MutString
+    # Leaf for a realized tensor (contiguous f32 on the CPU), or null.
+    if (*t).dtype != DT_F32 or (*t).device != DEV_CPU then
+        return null
+    if tensor_is_contiguous(t) == 0 then
+        return null
+    var slot is usize = (*lz).bufs.len
+    if vec_ptr_push(&(*lz).bufs, tensor_data_ptr(t)) != 0 then
+        return null
+    return uop_intern(&(*lz).uops, UOP_BUFFER, DT_F32, 0, null, slot, tensor_numel(t))
+
+
+def lazy_const(lz is mut ref LazyCtx, v is f32) returns MutString
+    return uop_const_f32(&(*lz).uops, v)
+
+
+def lazy_binary(lz is mut ref LazyCtx, op is i32, a is MutString, b is MutString) returns MutString
+    if a is null or b is null then
+        return null
+    var na is u64 = uop_numel(a)
+    var nb is u64 = uop_numel(b)
+    var ua is mut ref UOp = a
+    var ub is mut ref UOp = b
+    var n is u64 = na
+    if (*ua).op == UOP_CONST then
+        n = nb
+    else if (*ub).op != UOP_CONST and na != nb then
+        return null
+    return uop_intern2(&(*lz).uops, op, DT_F32, a, b, 0, n)
+
+
+def lazy_add(lz is mut ref LazyCtx, a is MutString, b is MutString) returns MutString
+    return lazy_binary(lz, UOP_ADD, a, b)
+
+
+def lazy_mul(lz is mut ref LazyCtx, a is MutString, b is MutString) returns MutString
+    return lazy_binary(lz, UOP_MUL, a, b)
+
+
+def lazy_relu(lz is mut ref LazyCtx, a is MutString) returns MutString
+    if a is null then
+        return null
+    return uop_intern1(&(*lz).uops, UOP_RELU, DT_F32, a, 0, uop_numel(a))
+
+
+def lazy_sum_runs(lz is mut ref LazyCtx, a is MutString, run is usize) returns MutString
+    # Sums each run of `run` consecutive elements: the last axis of a
+    # contiguous (..., run) value, or everything when run == numel.
+    if a is null or run == 0 then
+        return null
+    var n is u64 = uop_numel(a)
+    if n - (n / run) * run != 0 then
+        return null
+    return uop_intern1(&(*lz).uops, UOP_REDUCE_SUM, DT_F32, a, run, n / run)
+
+
+def lazy_realize(lz is mut ref LazyCtx, out is mut ref Tensor, node is MutString, ndim is usize, dims is slice of usize) returns i32
+    # Computes `node` into a new contiguous (dims) tensor; the product of
+    # dims must equal the node's element count.
+    if node is null then
+        return 1
+    var n is u64 = 1
+    var i is usize = 0
+    while i < ndim do
+        n = n * dims[i]
+        i = i + 1
+    if n != uop_numel(node) then
+        return 1
+    if tensor_init_contiguous(out, DT_F32, DEV_CPU, ndim, dims) != 0 then
+        return 1
+    var s is Schedule
+    if schedule_build(&s, node) != 0 then
+        tensor_free(out)
+        return 1
+    var rc is i32 = realize_schedule(&s, &(*lz).bufs, tensor_data_ptr(out))
+    schedule_free(&s)
+    if rc != 0 then
+        tensor_free(out)
+        return 1
+    return 0
@@ -273,12 +273,12 @@ def softmax_inplace_f32(buf is slice of f32, n is usize) returns ()
 
 def sdpa_forward(out is mut ref Tensor, q is mut ref Tensor, k is mut ref Tensor, v is mut ref Tensor) returns i32
     # q,k,v: (batch, seq, dim), out: (batch, seq, dim)
+    # scores = q @ k^T and out = softmax(scores * scale) @ v run as two batched
+    # GEMMs; k^T is a strided view, so q/k/v may themselves be views.
     if (*q).dtype != DT_F32 or (*k).dtype != DT_F32 or (*v).dtype != DT_F32 then
         return 1
     if (*q).ndim != 3 or (*k).ndim != 3 or (*v).ndim != 3 then
         return 1
-    if tensor_is_contiguous(q) == 0 or tensor_is_contiguous(k) == 0 or tensor_is_contiguous(v) == 0 then
-        return 1
 
     var qsh is slice of usize = (*q).shape
     var ksh is slice of usize = (*k).shape
@@ -290,9 +290,6 @@ def sdpa_forward(out is mut ref Tensor, q is mut ref Tensor, k is mut ref Tensor
     if ksh[2] != qsh[2] or vsh[2] != qsh[2] then
         return 1
 
-    if tensor_init_contiguous(out, DT_F32, DEV_CPU, 3, qsh) != 0 then
-        return 1
-
     var batch is usize = qsh[0]
     var seq is usize = qsh[1]
     var dim is usize = qsh[2]
@@ -300,50 +297,32 @@ def sdpa_forward(out is mut ref Tensor, q is mut ref Tensor, k is mut ref Tensor
         return 1
     var scale is f32 = 1.0 / sqrtf(dim)
 
-    var tmp is slice of f32 = malloc(seq * 4)
-    if tmp is null then
-        tensor_free(out)
+    var kt is Tensor
+    tensor_reset(&kt)
+    if tensor_transpose(&kt, k, 1, 2) != 0 then
+        return 1
+    var scores is Tensor
+    tensor_reset(&scores)
+    var rc is i32 = tensor_bmm_f32(&scores, q, &kt)
+    tensor_free(&kt)
+    if rc != 0 then
         return 1
 
-    var qp is slice of f32 = tensor_data_ptr(q)
-    var kp is slice of f32 = tensor_data_ptr(k)
-    var vp is slice of f32 = tensor_data_ptr(v)
-    var op is slice of f32 = tensor_data_ptr(out)
+    var sp is MutString = tensor_data_ptr(&scores)
+    var rows is usize = batch * seq
+    var r is usize = 0
+    while r < rows do
+        var row is slice of f32 = sp + r * seq * 4
+        var j is usize = 0
+        while j < seq do
+            row[j] = row[j] * scale
+            j = j + 1
+        softmax_inplace_f32(row, seq)
+        r = r + 1
 
-    var b0 is usize = 0
-    while b0 < batch do
-        var i0 is usize = 0
-        while i0 < seq do
-            # scores[j] = dot(q[b,i,:], k[b,j,:]) * scale
-            var j0 is usize = 0
-            while j0 < seq do
-                var dot is f32 = 0.0
-                var d0 is usize = 0
-                var qbase is usize = ((b0 * seq + i0) * dim)
-                var kbase is usize = ((b0 * seq + j0) * dim)
-                while d0 < dim do
-                    dot = dot + qp[qbase + d0] * kp[kbase + d0]
-                    d0 = d0 + 1
-                tmp[j0] = dot * scale
-                j0 = j0 + 1
-            softmax_inplace_f32(tmp, seq)
-            # out[b,i,:] = sum_j tmp[j] * v[b,j,:]
-            var d1 is usize = 0
-            var obase is usize = ((b0 * seq + i0) * dim)
-            while d1 < dim do
-                var acc is f32 = 0.0
-                var jj is usize = 0
-                while jj < seq do
-                    var vbase is usize = ((b0 * seq + jj) * dim)
-                    acc = acc + tmp[jj] * vp[vbase + d1]
-                    jj = jj + 1
-                op[obase + d1] = acc
-                d1 = d1 + 1
-            i0 = i0 + 1
-        b0 = b0 + 1
-
-    free(tmp)
-    return 0
+    rc = tensor_bmm_f32(out, &scores, v)
+    tensor_free(&scores)
+    return rc
 
 
 # -----------------------------
@@ -10,18 +10,19 @@
 # - This file provides its own tiny float32 CPU tensor struct (contiguous,
 #   ndim<=3) to keep serialization work unblocked while the main Tensor API
 #   evolves into a buffer-backed strided descriptor.
+# - Loaders map the file (core.mmap) and copy tensors straight out of the
+#   mapping; the file is never read into a heap copy first.
 # - Correctness-first, minimal surface area.
 
 use core.libc
+use core.mmap
+use core.str
 
 # ---- libc extras (not yet centralized in core.libc) ----
 extern def fwrite(ptr is MutString, size is usize, count is usize, fp is File) returns usize
 extern def fflush(fp is File) returns i32
 extern def system(cmd is String) returns i32
 
-const SEEK_SET is i32 = 0
-const SEEK_END is i32 = 2
-
 const TENSORF32_BYTES is usize = 40  # sizeof(TensorF32) on 64-bit today (v0)
 
 # -----------------------------
@@ -162,14 +163,7 @@ def bytevec_take_cstr(v is mut ref ByteVec) returns MutString
 def str_eq(a is String, b is String) returns i32
     if a is null or b is null then
         return 0
-    var pa is String = a
-    var pb is String = b
-    while pa[0] != 0 or pb[0] != 0 do
-        if pa[0] != pb[0] then
-            return 0
-        pa = pa + 1
-        pb = pb + 1
-    return 1
+    return strcmp(a, b) == 0
 
 
 def str_dup(s is String) returns MutString
@@ -197,30 +191,30 @@ def str_dup_n(s is MutString, n is usize) returns MutString
     return p
 
 
-def str_concat2(a is String, b is String) returns MutString
-    if a is null or b is null then
+def str_concat4(a is String, b is String, c is String, d is String) returns MutString
+    # One exact-size allocation; each input is scanned once.
+    if a is null or b is null or c is null or d is null then
         return null
     var na is usize = strlen(a)
     var nb is usize = strlen(b)
-    var p is MutString = malloc(na + nb + 1)
-    if p is null then
+    var nc is usize = strlen(c)
+    var nd is usize = strlen(d)
+    var sb is StrBuf
+    if strbuf_init(&sb, na + nb + nc + nd) != 0 then
         return null
-    if na != 0 then
-        memcpy(p, a, na)
-    if nb != 0 then
-        memcpy(p + na, b, nb)
-    var xs is slice of u8 = p
-    xs[na + nb] = 0
-    return p
+    strbuf_append_bytes(&sb, a, na)
+    strbuf_append_bytes(&sb, b, nb)
+    strbuf_append_bytes(&sb, c, nc)
+    strbuf_append_bytes(&sb, d, nd)
+    return strbuf_take(&sb)
+
+
+def str_concat2(a is String, b is String) returns MutString
+    return str_concat4(a, b, "", "")
 
 
 def str_concat3(a is String, b is String, c is String) returns MutString
-    var ab is MutString = str_concat2(a, b)
-    if ab is null then
-        return null
-    var abc is MutString = str_concat2(ab, c)
-    free(ab)
-    return abc
+    return str_concat4(a, b, c, "")
 
 
 def json_append_escaped(v is mut ref ByteVec, s is String) returns i32
@@ -502,37 +496,6 @@ def state_dict_len(sd is mut ref StateDict) returns usize
 # File helpers
 # -----------------------------
 
-def read_file(path is String, out_buf is mut ref MutString, out_len is mut ref usize) returns i32
-    *out_buf = null
-    *out_len = 0
-    var fp is File = fopen(path, "rb")
-    if fp is null then
-        return 1
-    if fseek(fp, 0, SEEK_END) != 0 then
-        fclose(fp)
-        return 1
-    var sz is isize = ftell(fp)
-    if sz < 0 then
-        fclose(fp)
-        return 1
-    if fseek(fp, 0, SEEK_SET) != 0 then
-        fclose(fp)
-        return 1
-    var n is usize = sz
-    var buf is MutString = malloc(n)
-    if buf is null then
-        fclose(fp)
-        return 1
-    var got is usize = fread(buf, 1, n, fp)
-    fclose(fp)
-    if got != n then
-        free(buf)
-        return 1
-    *out_buf = buf
-    *out_len = n
-    return 0
-
-
 def write_u64_le(fp is File, x is u64) returns i32
     var tmp is MutString = malloc(8)
     if tmp is null then
@@ -846,21 +809,23 @@ def json_skip_value(p is mut ref String) returns i32
 def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
     if path is null then
         return 2
-    var buf is MutString = null
-    var n is usize = 0
-    if read_file(path, &buf, &n) != 0 then
+    var fm is FileMap
+    if fmap_open(&fm, path, FMAP_READ) != 0 then
         return 3
+    fmap_advise(&fm, FMAP_WILLNEED)
+    var buf is MutString = fm.data
+    var n is usize = fm.len
     if n < 8 then
-        free(buf)
+        fmap_close(&fm)
         return 4
     var header_len is u64 = read_u64_le(buf)
     if 8 + header_len > n then
-        free(buf)
+        fmap_close(&fm)
         return 5
 
     var hcopy is MutString = malloc(header_len + 1)
     if hcopy is null then
-        free(buf)
+        fmap_close(&fm)
         return 6
     memcpy(hcopy, buf + 8, header_len)
     var hs is slice of u8 = hcopy
@@ -872,12 +837,12 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
     var p is String = hcopy
     if json_expect(&p, '{') != 0 then
         free(hcopy)
-        free(buf)
+        fmap_close(&fm)
         return 7
     json_ws(&p)
     if p[0] == '}' then
         free(hcopy)
-        free(buf)
+        fmap_close(&fm)
         return 0
 
     var done_obj is i32 = 0
@@ -885,26 +850,26 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
         var name is MutString = json_parse_string(&p)
         if name is null then
             free(hcopy)
-            free(buf)
+            fmap_close(&fm)
             return 8
         if json_expect(&p, ':') != 0 then
             free(name)
             free(hcopy)
-            free(buf)
+            fmap_close(&fm)
             return 9
 
         if str_eq(name, "__metadata__") != 0 then
             free(name)
             if json_skip_value(&p) != 0 then
                 free(hcopy)
-                free(buf)
+                fmap_close(&fm)
                 return 10
         else
             # Parse tensor record object.
             if json_expect(&p, '{') != 0 then
                 free(name)
                 free(hcopy)
-                free(buf)
+                fmap_close(&fm)
                 return 11
 
             var dtype_ok is i32 = 0
@@ -918,7 +883,7 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
             if p[0] == '}' then
                 free(name)
                 free(hcopy)
-                free(buf)
+                fmap_close(&fm)
                 return 12
 
             var done_rec is i32 = 0
@@ -927,13 +892,13 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
                 if field is null then
                     free(name)
                     free(hcopy)
-                    free(buf)
+                    fmap_close(&fm)
                     return 13
                 if json_expect(&p, ':') != 0 then
                     free(field)
                     free(name)
                     free(hcopy)
-                    free(buf)
+                    fmap_close(&fm)
                     return 14
 
                 if str_eq(field, "dtype") != 0 then
@@ -942,7 +907,7 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
                         free(field)
                         free(name)
                         free(hcopy)
-                        free(buf)
+                        fmap_close(&fm)
                         return 15
                     if str_eq(dt, "F32") != 0 then
                         dtype_ok = 1
@@ -952,7 +917,7 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
                         free(field)
                         free(name)
                         free(hcopy)
-                        free(buf)
+                        fmap_close(&fm)
                         return 16
                     json_ws(&p)
                     ndim = 0
@@ -961,7 +926,7 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
                         free(field)
                         free(name)
                         free(hcopy)
-                        free(buf)
+                        fmap_close(&fm)
                         return 17
                     var done_shape is i32 = 0
                     while done_shape == 0 do
@@ -970,7 +935,7 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
                             free(field)
                             free(name)
                             free(hcopy)
-                            free(buf)
+                            fmap_close(&fm)
                             return 18
                         var dv is u64 = json_parse_u64(&p)
                         if ndim == 0 then
@@ -983,7 +948,7 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
                             free(field)
                             free(name)
                             free(hcopy)
-                            free(buf)
+                            fmap_close(&fm)
                             return 19
                         ndim = ndim + 1
                         json_ws(&p)
@@ -996,7 +961,7 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
                             free(field)
                             free(name)
                             free(hcopy)
-                            free(buf)
+                            fmap_close(&fm)
                             return 20
                     # end shape
                 else if str_eq(field, "data_offsets") != 0 then
@@ -1004,35 +969,35 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
                         free(field)
                         free(name)
                         free(hcopy)
-                        free(buf)
+                        fmap_close(&fm)
                         return 21
                     json_ws(&p)
                     if p[0] < '0' or p[0] > '9' then
                         free(field)
                         free(name)
                         free(hcopy)
-                        free(buf)
+                        fmap_close(&fm)
                         return 22
                     off0 = json_parse_u64(&p)
                     if json_expect(&p, ',') != 0 then
                         free(field)
                         free(name)
                         free(hcopy)
-                        free(buf)
+                        fmap_close(&fm)
                         return 23
                     json_ws(&p)
                     if p[0] < '0' or p[0] > '9' then
                         free(field)
                         free(name)
                         free(hcopy)
-                        free(buf)
+                        fmap_close(&fm)
                         return 24
                     off1 = json_parse_u64(&p)
                     if json_expect(&p, ']') != 0 then
                         free(field)
                         free(name)
                         free(hcopy)
-                        free(buf)
+                        fmap_close(&fm)
                         return 25
                 else
                     # skip unknown field
@@ -1040,7 +1005,7 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
                         free(field)
                         free(name)
                         free(hcopy)
-                        free(buf)
+                        fmap_close(&fm)
                         return 26
                 free(field)
 
@@ -1053,13 +1018,13 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
                 else
                     free(name)
                     free(hcopy)
-                    free(buf)
+                    fmap_close(&fm)
                     return 27
 
             if dtype_ok == 0 or ndim == 0 then
                 free(name)
                 free(hcopy)
-                free(buf)
+                fmap_close(&fm)
                 return 28
 
             var want_bytes is u64 = d0 * 4
@@ -1070,42 +1035,42 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
             else if ndim != 1 then
                 free(name)
                 free(hcopy)
-                free(buf)
+                fmap_close(&fm)
                 return 29
             if off1 < off0 then
                 free(name)
                 free(hcopy)
-                free(buf)
+                fmap_close(&fm)
                 return 30
             if off1 - off0 != want_bytes then
                 free(name)
                 free(hcopy)
-                free(buf)
+                fmap_close(&fm)
                 return 31
             if off1 > data_len then
                 free(name)
                 free(hcopy)
-                free(buf)
+                fmap_close(&fm)
                 return 32
 
             var tp is MutString = malloc(TENSORF32_BYTES)
             if tp is null then
                 free(name)
                 free(hcopy)
-                free(buf)
+                fmap_close(&fm)
                 return 33
             var tt is mut ref TensorF32 = tp
             if tensor_f32_init(tt, ndim, d0, d1, d2) != 0 then
                 free(tp)
                 free(name)
                 free(hcopy)
-                free(buf)
+                fmap_close(&fm)
                 return 34
             if want_bytes != 0 then
                 memcpy((*tt).data, data_base + off0, want_bytes)
             if state_dict_put_take(out, name, tp) != 0 then
                 free(hcopy)
-                free(buf)
+                fmap_close(&fm)
                 return 35
 
         json_ws(&p)
@@ -1115,11 +1080,11 @@ def safetensors_load_f32(path is String, out is mut ref StateDict) returns i32
             done_obj = 1
         else
             free(hcopy)
-            free(buf)
+            fmap_close(&fm)
             return 36
 
     free(hcopy)
-    free(buf)
+    fmap_close(&fm)
     return 0
 
 
@@ -1223,25 +1188,27 @@ def gguf_skip_value(p is mut ref MutString, end is MutString, ty is u32) returns
 
 
 def gguf_load_f32(path is String, out is mut ref StateDict) returns i32
-    var buf is MutString = null
-    var n is usize = 0
-    if read_file(path, &buf, &n) != 0 then
+    var fm is FileMap
+    if fmap_open(&fm, path, FMAP_READ) != 0 then
         return 1
+    fmap_advise(&fm, FMAP_WILLNEED)
+    var buf is MutString = fm.data
+    var n is usize = fm.len
     if n < 32 then
-        free(buf)
+        fmap_close(&fm)
         return 1
     var end is MutString = buf + n
 
     var p is MutString = buf
     var b is slice of u8 = p
     if b[0] != GGUF_MAGIC0 or b[1] != GGUF_MAGIC1 or b[2] != GGUF_MAGIC2 or b[3] != GGUF_MAGIC3 then
-        free(buf)
+        fmap_close(&fm)
         return 1
     p = p + 4
     var version is u32 = read_u32_le(p)
     p = p + 4
     if version < 2 or version > 3 then
-        free(buf)
+        fmap_close(&fm)
         return 1
     var n_tensors is u64 = read_u64_le(p)
     p = p + 8
@@ -1254,17 +1221,17 @@ def gguf_load_f32(path is String, out is mut ref StateDict) returns i32
     while ki < n_kv do
         # key: gguf string (u64 len + bytes)
         if p + 8 > end then
-            free(buf)
+            fmap_close(&fm)
             return 1
         var klen is u64 = read_u64_le(p)
         p = p + 8
         if p + klen > end then
-            free(buf)
+            fmap_close(&fm)
             return 1
         var kptr is MutString = p
         p = p + klen
         if p + 4 > end then
-            free(buf)
+            fmap_close(&fm)
             return 1
         var vty is u32 = read_u32_le(p)
         p = p + 4
@@ -1310,23 +1277,23 @@ def gguf_load_f32(path is String, out is mut ref StateDict) returns i32
                 ok = 0
             if ok != 0 and vty == GGUF_TYPE_UINT32 then
                 if p + 4 > end then
-                    free(buf)
+                    fmap_close(&fm)
                     return 1
                 alignment = read_u32_le(p)
                 p = p + 4
             else
                 if gguf_skip_value(&p, end, vty) != 0 then
-                    free(buf)
+                    fmap_close(&fm)
                     return 1
         else
             if gguf_skip_value(&p, end, vty) != 0 then
-                free(buf)
+                fmap_close(&fm)
                 return 1
         ki = ki + 1
 
     # tensor infos
     if n_tensors > 1024 then
-        free(buf)
+        fmap_close(&fm)
         return 1
     var nt is usize = n_tensors
     var names_mem is MutString = malloc(nt * 8)
@@ -1351,7 +1318,7 @@ def gguf_load_f32(path is String, out is mut ref StateDict) returns i32
             free(ty_mem)
         if off_mem is not null then
             free(off_mem)
-        free(buf)
+        fmap_close(&fm)
         return 1
     var names is slice of MutString = names_mem
     var ndims is slice of u64 = ndims_mem
@@ -1365,31 +1332,31 @@ def gguf_load_f32(path is String, out is mut ref StateDict) returns i32
     while ti < nt do
         # tensor name: gguf string (u64 len + bytes)
         if p + 8 > end then
-            free(buf)
+            fmap_close(&fm)
             return 1
         var nlen is u64 = read_u64_le(p)
         p = p + 8
         if p + nlen > end then
-            free(buf)
+            fmap_close(&fm)
             return 1
         var nm is MutString = str_dup_n(p, nlen)
         if nm is null then
-            free(buf)
+            fmap_close(&fm)
             return 1
         p = p + nlen
         if p + 4 > end then
             free(nm)
-            free(buf)
+            fmap_close(&fm)
             return 1
         var ndim is u32 = read_u32_le(p)
         p = p + 4
         if ndim == 0 or ndim > 3 then
             free(nm)
-            free(buf)
+            fmap_close(&fm)
             return 1
         if p + (ndim * 8) > end then
             free(nm)
-            free(buf)
+            fmap_close(&fm)
             return 1
         var d0 is u64 = read_u64_le(p)
         p = p + 8
@@ -1403,7 +1370,7 @@ def gguf_load_f32(path is String, out is mut ref StateDict) returns i32
             p = p + 8
         if p + 4 + 8 > end then
             free(nm)
-            free(buf)
+            fmap_close(&fm)
             return 1
         var ttype is u32 = read_u32_le(p)
         p = p + 4
@@ -1421,7 +1388,7 @@ def gguf_load_f32(path is String, out is mut ref StateDict) returns i32
 
     var data_start is u64 = align_up(p - buf, alignment)
     if data_start > n then
-        free(buf)
+        fmap_close(&fm)
         return 1
 
     # Load tensors
@@ -1442,12 +1409,12 @@ def gguf_load_f32(path is String, out is mut ref StateDict) returns i32
 
         var tp is MutString = malloc(TENSORF32_BYTES)
         if tp is null then
-            free(buf)
+            fmap_close(&fm)
             return 1
         var tt is mut ref TensorF32 = tp
         if tensor_f32_init(tt, ndim0, d0, d1, d2) != 0 then
             free(tp)
-            free(buf)
+            fmap_close(&fm)
             return 1
         var outp is slice of f32 = (*tt).data
 
@@ -1457,7 +1424,7 @@ def gguf_load_f32(path is String, out is mut ref StateDict) returns i32
             if data_start + toff + want > n then
                 tensor_f32_free(tt)
                 free(tp)
-                free(buf)
+                fmap_close(&fm)
                 return 1
             memcpy((*tt).data, data_ptr, want)
         else if ty == GGML_TYPE_Q8_0 then
@@ -1465,14 +1432,14 @@ def gguf_load_f32(path is String, out is mut ref StateDict) returns i32
             if (numel & 31) != 0 then
                 tensor_f32_free(tt)
                 free(tp)
-                free(buf)
+                fmap_close(&fm)
                 return 1
             var nblocks is u64 = numel >> 5
             var need is u64 = nblocks * 34
             if data_start + toff + need > n then
                 tensor_f32_free(tt)
                 free(tp)
-                free(buf)
+                fmap_close(&fm)
                 return 1
             var bi is u64 = 0
             var outi is usize = 0
@@ -1494,12 +1461,12 @@ def gguf_load_f32(path is String, out is mut ref StateDict) returns i32
         else
             tensor_f32_free(tt)
             free(tp)
-            free(buf)
+            fmap_close(&fm)
             return 1
 
         # Insert (take ownership of name + tensor).
         if state_dict_put_take(out, name, tp) != 0 then
-            free(buf)
+            fmap_close(&fm)
             return 1
         xi = xi + 1
 
@@ -1510,7 +1477,7 @@ def gguf_load_f32(path is String, out is mut ref StateDict) returns i32
     free(d2_mem)
     free(ty_mem)
     free(off_mem)
-    free(buf)
+    fmap_close(&fm)
     return 0
 
 
@@ -1520,15 +1487,11 @@ def gguf_load_f32(path is String, out is mut ref StateDict) returns i32
 
 def extract_gzip(gz_path is String, out_path is String) returns i32
     # Uses `/bin/sh -c` via system(); paths must be "simple" (no spaces/quotes).
-    var cmd is MutString = str_concat3("gzip -dc ", gz_path, " > ")
+    var cmd is MutString = str_concat4("gzip -dc ", gz_path, " > ", out_path)
     if cmd is null then
         return 1
-    var cmd2 is MutString = str_concat2(cmd, out_path)
+    var rc is i32 = system(cmd)
     free(cmd)
-    if cmd2 is null then
-        return 1
-    var rc is i32 = system(cmd2)
-    free(cmd2)
     if rc != 0 then
         return 1
     return 0
@@ -1536,15 +1499,11 @@ def extract_gzip(gz_path is String, out_path is String) returns i32
 
 def extract_tar(tar_path is String, out_dir is String) returns i32
     # Uses system `tar`; paths must be "simple" (no spaces/quotes).
-    var cmd is MutString = str_concat3("tar -xf ", tar_path, " -C ")
+    var cmd is MutString = str_concat4("tar -xf ", tar_path, " -C ", out_dir)
     if cmd is null then
         return 1
-    var cmd2 is MutString = str_concat2(cmd, out_dir)
+    var rc is i32 = system(cmd)
     free(cmd)
-    if cmd2 is null then
-        return 1
-    var rc is i32 = system(cmd2)
-    free(cmd2)
     if rc != 0 then
         return 1
     return 0
@@ -1552,15 +1511,11 @@ def extract_tar(tar_path is String, out_dir is String) returns i32
 
 def extract_zip(zip_path is String, out_dir is String) returns i32
     # Uses system `unzip`; paths must be "simple" (no spaces/quotes).
-    var cmd is MutString = str_concat3("unzip -q ", zip_path, " -d ")
+    var cmd is MutString = str_concat4("unzip -q ", zip_path, " -d ", out_dir)
     if cmd is null then
         return 1
-    var cmd2 is MutString = str_concat2(cmd, out_dir)
+    var rc is i32 = system(cmd)
     free(cmd)
-    if cmd2 is null then
-        return 1
-    var rc is i32 = system(cmd2)
-    free(cmd2)
     if rc != 0 then
         return 1
     return 0
@@ -2,37 +2,70 @@
 #
 # CPU backend parity (minimal):
 # - render elementwise kernels to C
-# - clang compile to a cached `.dylib` under `.context/ml/cpu_cache`
-# - dlopen/dlsym and launch via a stable ABI trampoline
+# - compile with `cc` (or `$ASTER_ML_CC`) to a cached `.dylib` (macOS) / `.so`
+#   (Linux) under `.context/ml/cpu_cache`, keyed by the SHA-256 of source,
+#   compiler and flags
+# - dlopen/dlsym once per process: loaded entry points are kept in a
+#   process-wide table, so a repeat launch is a table lookup and a direct call
+# - fused Schedule kernels rendered by `c_render_kernel`, keyed in-process by
+#   their structural hash (a repeat launch neither renders nor hashes source);
+#   dims are bucketed per `ASTER_ML_SHAPES` (exact, bucket (default) or
+#   symbolic), so variable-length inputs reuse compiled kernels
+# - float32 matmul through the runtime's packed, multithreaded SGEMM
 #
-# Note: Aster MVP doesn't yet support direct fn-pointer calls from Aster code.
-# We route launches through `dispatch_sync_f`, which invokes `work(context)`
-# for a `void (*)(void*)` entrypoint.
+# Note: Aster MVP doesn't yet support direct fn-pointer calls from Aster code,
+# globals or SIMD. The table, the `void (*)(void*)` call and the SGEMM
+# microkernels live in `tools/build/out/ml_cpu_rt.o` (auto-linked on import).
 
 use core.libc
 use aster_ml.codegen.c
+use aster_ml.engine.schedule
 
 # Minimal OS/stdlib externs (declared locally to avoid expanding core.libc).
 extern def system(cmd is String) returns i32
 extern def fwrite(ptr is String, size is usize, count is usize, fp is File) returns usize
+extern def mkdir(path is String, mode is u32) returns i32
 
 extern def dlopen(path is String, mode is i32) returns MutString
 extern def dlsym(handle is MutString, sym is String) returns MutString
-extern def dlclose(handle is MutString) returns i32
 
-extern def dispatch_get_global_queue(identifier is i64, flags is u64) returns MutString
-extern def dispatch_sync_f(queue is MutString, context is MutString, work is MutString) returns ()
+# ml_cpu_rt.c
+extern def aster_ml_kcache_get(key is u64, check is u64) returns MutString
+extern def aster_ml_kcache_put(key is u64, check is u64, entry is MutString) returns MutString
+extern def aster_ml_kcache_failed() returns MutString
+extern def aster_ml_kcall(entry is MutString, ctx is MutString) returns ()
+extern def aster_ml_cc_flags() returns String
+extern def aster_ml_dylib_suffix() returns String
+extern def aster_ml_sgemm(m is usize, n is usize, k is usize, a is MutString, rsa is isize, csa is isize, b is MutString, rsb is isize, csb is isize, c is MutString, ldc is usize, accumulate is i32) returns i32
+extern def aster_ml_sgemm_batched(nb is usize, m is usize, n is usize, k is usize, a is MutString, a_offs is MutString, rsa is isize, csa is isize, b is MutString, b_offs is MutString, rsb is isize, csb is isize, c is MutString, c_stride is usize, ldc is usize, accumulate is i32) returns i32
+extern def aster_ml_sgemm_kernel() returns String
+extern def aster_ml_threads() returns i32
 
 const RTLD_NOW is i32 = 2
 
 const CPU_CACHE_DIR is String = ".context/ml/cpu_cache"
-const CPU_CACHE_MKDIR_CMD is String = "mkdir -p .context/ml/cpu_cache"
+const CPU_DIR_MODE is u32 = 493   # 0755
 
-# Keep flags stable; included in the cache key.
-const CPU_CLANG_FLAGS is String = "-O3 -std=c11 -dynamiclib -fPIC"
+# Compiler used when $ASTER_ML_CC is unset. Compiler and flags are part of
+# the on-disk cache key.
+const CPU_CC_DEFAULT is String = "cc"
 
 const CPU_KERNEL_ENTRY_SYM is String = "aster_ml_kernel_entry"
 
+# In-process kernel keys. A (key, check) pair names one rendered source for
+# the life of the process: fixed-source kernels use a constant key and
+# CPU_CHECK_FIXED, fused kernels `c_kernel_key` / `c_kernel_check`. A
+# generated kernel only lands on a fixed one if both of its hashes collide.
+const CPU_KEY_EWISE_F32 is u64 = 0x100   # + C_EWISE_* op
+const CPU_CHECK_FIXED is u64 = 0x4153544552464958   # "ASTERFIX"
+
+struct CpuFusedCtx
+    var out is MutString
+    var ins is MutString   # `slice of MutString`, per kernel input
+    var n is usize         # runtime dims (ignored by literal-shape kernels)
+    var run is usize
+
+
 struct CpuKernelCtx
     var out is MutString
     var a is MutString
@@ -554,102 +587,155 @@ def cpu_cache_path(hash_hex is String, suffix is String) returns MutString
     return cstr_concat3(".context/ml/cpu_cache/", hash_hex, suffix)
 
 
-def cpu_build_clang_cmd(flags is String, c_path is String, dylib_path is String) returns MutString
-    var p0 is MutString = cstr_concat3("clang ", flags, " -o ")
+def cpu_cache_mkdir() returns ()
+    # Best-effort `mkdir -p`; existing directories fail with EEXIST, and a
+    # real failure surfaces when the source file cannot be written.
+    mkdir(".context", CPU_DIR_MODE)
+    mkdir(".context/ml", CPU_DIR_MODE)
+    mkdir(CPU_CACHE_DIR, CPU_DIR_MODE)
+    return
+
+
+def cpu_build_cc_cmd(tool is String, c_path is String, so_path is String) returns MutString
+    # "<cc> <flags> -o <so_path> <c_path>"
+    var p0 is MutString = cstr_concat3(tool, " -o ", so_path)
     if p0 is null then
         return null
-    var p1 is MutString = cstr_concat3(p0, dylib_path, " ")
+    var p1 is MutString = cstr_concat3(p0, " ", c_path)
     free(p0)
-    if p1 is null then
-        return null
-    var p2 is MutString = cstr_concat2(p1, c_path)
-    free(p1)
-    return p2
-
+    return p1
 
-def cpu_ewise_f32_run(op is i32, out_ptr is MutString, a_ptr is MutString, b_ptr is MutString, n is usize) returns i32
-    if out_ptr is null or a_ptr is null then
-        return 1
-    var src is String = c_render_ewise_f32(op)
-    if src is null then
-        return 1
 
+def cpu_kernel_key(src is String, n is usize) returns u64
+    # FNV-1a over a generated source, for kernels without a constant key.
+    var h is u64 = 0xcbf29ce484222325
+    var i is usize = 0
+    while i < n do
+        var b is u64 = src[i]
+        h = (h ^ b) * 0x100000001b3
+        i = i + 1
+    return h
+
+
+def cpu_kernel_build(src is String) returns MutString
+    # Compiles `src` (unless the shared object is already in the disk cache),
+    # loads it, and returns its entry point. The library stays loaded for the
+    # life of the process. Returns null on any failure.
+    var cc is String = getenv("ASTER_ML_CC")
+    if cc is null then
+        cc = CPU_CC_DEFAULT
+    var tool is MutString = cstr_concat3(cc, " ", aster_ml_cc_flags())
+    if tool is null then
+        return null
     var src_len is usize = strlen(src)
-    var flags_len is usize = strlen(CPU_CLANG_FLAGS)
-    var hash_hex is MutString = sha256_hex_two(src, src_len, CPU_CLANG_FLAGS, flags_len)
+    var hash_hex is MutString = sha256_hex_two(src, src_len, tool, strlen(tool))
     if hash_hex is null then
-        return 1
-
-    # Ensure cache directory exists (best-effort).
-    if system(CPU_CACHE_MKDIR_CMD) != 0 then
-        free(hash_hex)
-        return 1
+        free(tool)
+        return null
 
+    cpu_cache_mkdir()
     var c_path is MutString = cpu_cache_path(hash_hex, ".c")
-    var dylib_path is MutString = cpu_cache_path(hash_hex, ".dylib")
+    var so_path is MutString = cpu_cache_path(hash_hex, aster_ml_dylib_suffix())
     free(hash_hex)
-    if c_path is null or dylib_path is null then
-        if c_path is not null then
-            free(c_path)
-        if dylib_path is not null then
-            free(dylib_path)
-        return 1
+    var entry is MutString = null
+    if c_path is not null and so_path is not null then
+        var ok is i32 = 1
+        if file_exists(so_path) == 0 then
+            ok = 0
+            if file_write_all(c_path, src, src_len) == 0 then
+                var cmd is MutString = cpu_build_cc_cmd(tool, c_path, so_path)
+                if cmd is not null then
+                    if system(cmd) == 0 then
+                        ok = 1
+                    free(cmd)
+        if ok != 0 then
+            var h is MutString = dlopen(so_path, RTLD_NOW)
+            if h is not null then
+                entry = dlsym(h, CPU_KERNEL_ENTRY_SYM)
+    if c_path is not null then
+        free(c_path)
+    if so_path is not null then
+        free(so_path)
+    free(tool)
+    return entry
+
+
+def cpu_kernel_load(key is u64, check is u64, src is String) returns MutString
+    # Entry point of the kernel compiled from `src`, built and loaded at most
+    # once per process; later calls with the same `key` and `check` are a
+    # table lookup. Null if it cannot be built. A failed build is remembered,
+    # so a missing compiler costs one attempt per kernel, not one per launch.
+    var entry is MutString = aster_ml_kcache_get(key, check)
+    if entry == aster_ml_kcache_failed() then
+        return null
+    if entry is not null then
+        return entry
+    if src is null then
+        return null
+    entry = cpu_kernel_build(src)
+    if entry is null then
+        aster_ml_kcache_put(key, check, aster_ml_kcache_failed())
+        return null
+    # Another thread may have loaded the same kernel meanwhile; use one entry.
+    var kept is MutString = aster_ml_kcache_put(key, check, entry)
+    if kept is not null and kept != aster_ml_kcache_failed() then
+        return kept
+    return entry
 
-    if file_exists(dylib_path) == 0 then
-        if file_write_all(c_path, src, src_len) != 0 then
-            free(c_path)
-            free(dylib_path)
-            return 1
-        var cmd is MutString = cpu_build_clang_cmd(CPU_CLANG_FLAGS, c_path, dylib_path)
-        if cmd is null then
-            free(c_path)
-            free(dylib_path)
-            return 1
-        var rc is i32 = system(cmd)
-        free(cmd)
-        if rc != 0 then
-            free(c_path)
-            free(dylib_path)
-            return 1
 
-    # Load and launch.
-    var h is MutString = dlopen(dylib_path, RTLD_NOW)
-    if h is null then
-        free(c_path)
-        free(dylib_path)
+def cpu_ewise_f32_run(op is i32, out_ptr is MutString, a_ptr is MutString, b_ptr is MutString, n is usize) returns i32
+    if out_ptr is null or a_ptr is null then
         return 1
-    var fn is MutString = dlsym(h, CPU_KERNEL_ENTRY_SYM)
-    if fn is null then
-        dlclose(h)
-        free(c_path)
-        free(dylib_path)
+    # Rendering only selects a string constant; the source is compiled and
+    # loaded on the first launch of each op.
+    var key is u64 = op
+    var entry is MutString = cpu_kernel_load(CPU_KEY_EWISE_F32 + key, CPU_CHECK_FIXED, c_render_ewise_f32(op))
+    if entry is null then
         return 1
+    var ctx is CpuKernelCtx
+    ctx.out = out_ptr
+    ctx.a = a_ptr
+    ctx.b = b_ptr
+    ctx.n = n
+    aster_ml_kcall(entry, &ctx)
+    return 0
 
-    var q is MutString = dispatch_get_global_queue(0, 0)
-    if q is null then
-        dlclose(h)
-        free(c_path)
-        free(dylib_path)
-        return 1
 
-    var ctx_mem is MutString = malloc(32)  # sizeof(CpuKernelCtx) on 64-bit
-    if ctx_mem is null then
-        dlclose(h)
-        free(c_path)
-        free(dylib_path)
+def cpu_shape_mode() returns i32
+    var mode is String = getenv("ASTER_ML_SHAPES")
+    if mode is not null then
+        if strcmp(mode, "exact") == 0 then
+            return C_SHAPES_EXACT
+        if strcmp(mode, "symbolic") == 0 then
+            return C_SHAPES_SYMBOLIC
+    return C_SHAPES_BUCKET
+
+
+def cpu_fused_run(ir is mut ref KernelIR, ninputs is usize, ins is MutString, out is MutString) returns i32
+    # Runs one fused kernel, compiled on first use of its shape bucket.
+    # Returns 1 if it cannot be built (the caller falls back to interpreting
+    # it).
+    var shape is CShape
+    c_shape_init(&shape, ir, cpu_shape_mode())
+    var key is u64 = c_kernel_key(ir, ninputs, &shape)
+    var check is u64 = c_kernel_check(ir, ninputs, &shape)
+    var entry is MutString = aster_ml_kcache_get(key, check)
+    if entry is null then
+        var src is MutString = c_render_kernel(ir, ninputs, &shape)
+        if src is null then
+            return 1
+        entry = cpu_kernel_load(key, check, src)
+        free(src)
+        if entry is null then
+            return 1
+    if entry == aster_ml_kcache_failed() then
         return 1
-    var ctx is mut ref CpuKernelCtx = ctx_mem
-    (*ctx).out = out_ptr
-    (*ctx).a = a_ptr
-    (*ctx).b = b_ptr
-    (*ctx).n = n
-
-    dispatch_sync_f(q, ctx_mem, fn)
-    free(ctx_mem)
-
-    dlclose(h)
-    free(c_path)
-    free(dylib_path)
+    var ctx is CpuFusedCtx
+    ctx.out = out
+    ctx.ins = ins
+    ctx.n = (*ir).numel
+    ctx.run = (*ir).run
+    aster_ml_kcall(entry, &ctx)
     return 0
 
 
@@ -665,3 +751,41 @@ def cpu_mul_f32(out_base is MutString, out_off is usize, a_base is MutString, a_
 
 def cpu_relu_f32(out_base is MutString, out_off is usize, a_base is MutString, a_off is usize, n is usize) returns i32
     return cpu_ewise_f32_run(C_EWISE_RELU_F32, out_base + out_off, a_base + a_off, null, n)
+
+
+# Matmul: out(m,n) = a(m,k) @ b(k,n), float32. `cpu_matmul_f32` takes
+# row-major contiguous operands as (base, byte_off) pairs like the Metal entry
+# point; the strided forms take pointers to element (0,0) plus element
+# strides, so transposed and broadcast views need no copy.
+
+def cpu_matmul_f32(out_base is MutString, out_off is usize, a_base is MutString, a_off is usize, b_base is MutString, b_off is usize, m is usize, k is usize, n is usize) returns i32
+    if out_base is null or a_base is null or b_base is null then
+        return 1
+    var ki is isize = k
+    var ni is isize = n
+    return aster_ml_sgemm(m, n, k, a_base + a_off, ki, 1, b_base + b_off, ni, 1, out_base + out_off, n, 0)
+
+
+def cpu_matmul_strided_f32(out is MutString, ldo is usize, a is MutString, rsa is isize, csa is isize, b is MutString, rsb is isize, csb is isize, m is usize, k is usize, n is usize, accumulate is i32) returns i32
+    # out(m,n) with row stride `ldo`; `accumulate` != 0 adds to it.
+    if out is null or a is null or b is null then
+        return 1
+    return aster_ml_sgemm(m, n, k, a, rsa, csa, b, rsb, csb, out, ldo, accumulate)
+
+
+def cpu_bmm_f32(nb is usize, out is MutString, a is MutString, a_offs is slice of isize, rsa is isize, csa is isize, b is MutString, b_offs is slice of isize, rsb is isize, csb is isize, m is usize, k is usize, n is usize, accumulate is i32) returns i32
+    # `nb` products into contiguous out[i] (m,n); operand i starts `a_offs[i]`
+    # / `b_offs[i]` elements past `a` / `b`.
+    if out is null or a is null or b is null then
+        return 1
+    return aster_ml_sgemm_batched(nb, m, n, k, a, a_offs, rsa, csa, b, b_offs, rsb, csb, out, m * n, n, accumulate)
+
+
+def cpu_sgemm_kernel_name() returns String
+    # Microkernel picked for this CPU (e.g. "avx2-6x16"), for bench reports.
+    return aster_ml_sgemm_kernel()
+
+
+def cpu_threads() returns i32
+    # Worker threads the CPU backend uses ($ASTER_ML_THREADS or online CPUs).
+    return aster_ml_threads()
@@ -9,9 +9,11 @@
 #   IR scheduler on top of this descriptor.
 
 use core.libc
+use core.arena
 use aster_ml.buffer
 use aster_ml.dtype
 use aster_ml.device
+use aster_ml.runtime.ops_cpu
 use aster_ml.runtime.ops_metal
 
 
@@ -40,23 +42,18 @@ def tensor_meta_alloc(t is mut ref Tensor, ndim is usize) returns i32
     (*t).strides = null
     if ndim == 0 then
         return 0
-    var sh is MutString = malloc(ndim * 8)
+    # One block: shape, then strides (freed through `shape`).
+    var sh is MutString = malloc(ndim * 16)
     if sh is null then
         return 1
-    var st is MutString = malloc(ndim * 8)
-    if st is null then
-        free(sh)
-        return 1
     (*t).shape = sh
-    (*t).strides = st
+    (*t).strides = sh + ndim * 8
     return 0
 
 
 def tensor_meta_free(t is mut ref Tensor) returns ()
     if (*t).shape is not null then
         free((*t).shape)
-    if (*t).strides is not null then
-        free((*t).strides)
     (*t).shape = null
     (*t).strides = null
     (*t).ndim = 0
@@ -163,7 +160,10 @@ def tensor_data_ptr(t is mut ref Tensor) returns MutString
     return (*t).buf.data + (*t).byte_off
 
 
-def tensor_elem_ptr(t is mut ref Tensor, idx is slice of usize) returns MutString
+def tensor_elem_ptr_at(t is mut ref Tensor, idx is slice of usize) returns MutString
+    # Element pointer without bounds checks: for loops whose indices come
+    # from the tensor's own shape (the odometer walks below). Everything else
+    # goes through `tensor_elem_ptr`.
     var base is MutString = tensor_data_ptr(t)
     if base is null then
         return null
@@ -181,6 +181,16 @@ def tensor_elem_ptr(t is mut ref Tensor, idx is slice of usize) returns MutStrin
     return ptr_add_bytes(base, off_bytes)
 
 
+def tensor_elem_ptr(t is mut ref Tensor, idx is slice of usize) returns MutString
+    # Checked element pointer: every index must be inside the shape.
+    var sh is slice of usize = (*t).shape
+    var i is usize = 0
+    while i < (*t).ndim do
+        assert(idx[i] < sh[i], "tensor index out of range")
+        i = i + 1
+    return tensor_elem_ptr_at(t, idx)
+
+
 def tensor_get_f32(t is mut ref Tensor, idx is slice of usize, out is mut ref f32) returns i32
     if (*t).dtype != DT_F32 then
         return 1
@@ -280,14 +290,17 @@ def tensor_from_scalar_f32(out is mut ref Tensor, v is f32) returns i32
 
 
 def tensor_from_list_f32_1d(out is mut ref Tensor, xs is slice of f32, n is usize) returns i32
-    var dims is slice of usize = malloc(1 * 8)
+    var scratch is mut ref Arena = arena_tls()
+    var sm is ArenaMark
+    arena_mark(scratch, &sm)
+    var dims is slice of usize = arena_alloc(scratch, 1 * 8, 8)
     if dims is null then
         return 1
     dims[0] = n
-    if tensor_init_contiguous(out, DT_F32, DEV_CPU, 1, dims) != 0 then
-        free(dims)
+    var rc is i32 = tensor_init_contiguous(out, DT_F32, DEV_CPU, 1, dims)
+    arena_reset_to(scratch, &sm)
+    if rc != 0 then
         return 1
-    free(dims)
     var dst is slice of f32 = tensor_data_ptr(out)
     memcpy(dst, xs, n * 4)
     return 0
@@ -447,6 +460,30 @@ def tensor_permute(out is mut ref Tensor, base is mut ref Tensor, perm is slice
     return 0
 
 
+def tensor_transpose(out is mut ref Tensor, base is mut ref Tensor, d0 is usize, d1 is usize) returns i32
+    # View with axes `d0` and `d1` swapped (no copy).
+    if d0 >= (*base).ndim or d1 >= (*base).ndim then
+        return 1
+    tensor_reset(out)
+    (*out).dtype = (*base).dtype
+    (*out).device = (*base).device
+    (*out).owns = 0
+    (*out).buf = (*base).buf
+    (*out).byte_off = (*base).byte_off
+    if tensor_copy_meta(out, base) != 0 then
+        tensor_reset(out)
+        return 1
+    var osh is slice of usize = (*out).shape
+    var ost is slice of isize = (*out).strides
+    var sh is usize = osh[d0]
+    var st is isize = ost[d0]
+    osh[d0] = osh[d1]
+    ost[d0] = ost[d1]
+    osh[d1] = sh
+    ost[d1] = st
+    return 0
+
+
 def tensor_expand(out is mut ref Tensor, base is mut ref Tensor, ndim is usize, dims is slice of usize) returns i32
     # Broadcast/expand semantics: align from the right; size-1 dims can expand with stride 0.
     if ndim < (*base).ndim then
@@ -874,7 +911,7 @@ def tensor_sum_axis_f32(out is mut ref Tensor, t is mut ref Tensor, axis is usiz
                     oj = oj + 1
                 ti = ti + 1
 
-        var p is MutString = tensor_elem_ptr(out, out_idx)
+        var p is MutString = tensor_elem_ptr_at(out, out_idx)
         var fp is slice of f32 = p
         fp[0] = fp[0] + v
 
@@ -1159,9 +1196,9 @@ def tensor_add_f32(out is mut ref Tensor, a is mut ref Tensor, b is mut ref Tens
     var osh is slice of usize = (*out).shape
     var k is usize = 0
     while k < n do
-        var optr is MutString = tensor_elem_ptr(out, idx)
-        var aptr is MutString = tensor_elem_ptr(&av, idx)
-        var bptr is MutString = tensor_elem_ptr(&bv, idx)
+        var optr is MutString = tensor_elem_ptr_at(out, idx)
+        var aptr is MutString = tensor_elem_ptr_at(&av, idx)
+        var bptr is MutString = tensor_elem_ptr_at(&bv, idx)
         var outp is slice of f32 = optr
         var af is slice of f32 = aptr
         var bf is slice of f32 = bptr
@@ -1282,9 +1319,9 @@ def tensor_mul_f32(out is mut ref Tensor, a is mut ref Tensor, b is mut ref Tens
     var osh is slice of usize = (*out).shape
     var k is usize = 0
     while k < n do
-        var optr is MutString = tensor_elem_ptr(out, idx)
-        var aptr is MutString = tensor_elem_ptr(&av, idx)
-        var bptr is MutString = tensor_elem_ptr(&bv, idx)
+        var optr is MutString = tensor_elem_ptr_at(out, idx)
+        var aptr is MutString = tensor_elem_ptr_at(&av, idx)
+        var bptr is MutString = tensor_elem_ptr_at(&bv, idx)
         var outp is slice of f32 = optr
         var af is slice of f32 = aptr
         var bf is slice of f32 = bptr
@@ -1341,8 +1378,8 @@ def tensor_relu_f32(out is mut ref Tensor, a is mut ref Tensor) returns i32
     var sh is slice of usize = (*a).shape
     var k is usize = 0
     while k < n do
-        var aptr is MutString = tensor_elem_ptr(a, idx)
-        var optr is MutString = tensor_elem_ptr(out, idx)
+        var aptr is MutString = tensor_elem_ptr_at(a, idx)
+        var optr is MutString = tensor_elem_ptr_at(out, idx)
         var af is slice of f32 = aptr
         var outp is slice of f32 = optr
         var x is f32 = af[0]
@@ -1364,6 +1401,32 @@ def tensor_relu_f32(out is mut ref Tensor, a is mut ref Tensor) returns i32
     return 0
 
 
+def tensor_matmul_into_f32(out is mut ref Tensor, a is mut ref Tensor, b is mut ref Tensor, accumulate is i32) returns i32
+    # out = a @ b, or out += a @ b when `accumulate` != 0, into an existing
+    # contiguous (m,n) CPU tensor. a: (m,k), b: (k,n) may be any strided
+    # views (transposes, slices, expands): the packing stage reads them in
+    # place, so callers never need a contiguous copy.
+    if (*a).dtype != DT_F32 or (*b).dtype != DT_F32 or (*out).dtype != DT_F32 then
+        return 1
+    if (*a).device != DEV_CPU or (*b).device != DEV_CPU or (*out).device != DEV_CPU then
+        return 1
+    if (*a).ndim != 2 or (*b).ndim != 2 or (*out).ndim != 2 then
+        return 1
+    if tensor_is_contiguous(out) == 0 then
+        return 1
+    var ash is slice of usize = (*a).shape
+    var bsh is slice of usize = (*b).shape
+    var osh is slice of usize = (*out).shape
+    var m is usize = ash[0]
+    var k is usize = ash[1]
+    var n is usize = bsh[1]
+    if bsh[0] != k or osh[0] != m or osh[1] != n then
+        return 1
+    var ast is slice of isize = (*a).strides
+    var bst is slice of isize = (*b).strides
+    return cpu_matmul_strided_f32(tensor_data_ptr(out), n, tensor_data_ptr(a), ast[0], ast[1], tensor_data_ptr(b), bst[0], bst[1], m, k, n, accumulate)
+
+
 def tensor_matmul_f32(out is mut ref Tensor, a is mut ref Tensor, b is mut ref Tensor) returns i32
     # a: (m,k), b: (k,n), out: (m,n)
     if (*a).dtype != DT_F32 or (*b).dtype != DT_F32 then
@@ -1380,15 +1443,18 @@ def tensor_matmul_f32(out is mut ref Tensor, a is mut ref Tensor, b is mut ref T
         return 1
     var n is usize = bsh[1]
 
-    var dims is slice of usize = malloc(2 * 8)
+    var scratch is mut ref Arena = arena_tls()
+    var sm is ArenaMark
+    arena_mark(scratch, &sm)
+    var dims is slice of usize = arena_alloc(scratch, 2 * 8, 8)
     if dims is null then
         return 1
     dims[0] = m
     dims[1] = n
-    if tensor_init_contiguous(out, DT_F32, (*a).device, 2, dims) != 0 then
-        free(dims)
+    var rc is i32 = tensor_init_contiguous(out, DT_F32, (*a).device, 2, dims)
+    arena_reset_to(scratch, &sm)
+    if rc != 0 then
         return 1
-    free(dims)
 
     # Metal fast path (contiguous row-major only).
     if (*a).device == DEV_METAL then
@@ -1404,23 +1470,118 @@ def tensor_matmul_f32(out is mut ref Tensor, a is mut ref Tensor, b is mut ref T
             return 1
         return 0
 
-    # CPU: require contiguous for now.
-    if tensor_is_contiguous(a) == 0 or tensor_is_contiguous(b) == 0 then
+    # CPU: any strides.
+    if tensor_matmul_into_f32(out, a, b, 0) != 0 then
+        tensor_free(out)
+        return 1
+    return 0
+
+
+def tensor_bmm_f32(out is mut ref Tensor, a is mut ref Tensor, b is mut ref Tensor) returns i32
+    # Batched matmul (CPU): a (..., m, k) @ b (..., k, n) -> out (..., m, n).
+    # Leading dims broadcast numpy-style (aligned from the right, size 1 or
+    # missing repeats), operands may be any strided views, and out is a new
+    # contiguous tensor. The batch runs as one call so small products spread
+    # over the worker pool.
+    if (*a).dtype != DT_F32 or (*b).dtype != DT_F32 then
+        return 1
+    if (*a).device != DEV_CPU or (*b).device != DEV_CPU then
+        return 1
+    if (*a).ndim < 2 or (*b).ndim < 2 then
+        return 1
+    var an is usize = (*a).ndim
+    var bnd is usize = (*b).ndim
+    var ash is slice of usize = (*a).shape
+    var bsh is slice of usize = (*b).shape
+    var ast is slice of isize = (*a).strides
+    var bst is slice of isize = (*b).strides
+    var m is usize = ash[an - 2]
+    var k is usize = ash[an - 1]
+    var n is usize = bsh[bnd - 1]
+    if bsh[bnd - 2] != k then
+        return 1
+    var lead is usize = an - 2
+    if bnd - 2 > lead then
+        lead = bnd - 2
+    var ond is usize = lead + 2
+
+    # Output shape, plus each operand's stride per output batch dim (0 where
+    # it broadcasts).
+    var scratch is mut ref Arena = arena_tls()
+    var sm is ArenaMark
+    arena_mark(scratch, &sm)
+    var dims is slice of usize = arena_alloc(scratch, ond * 8, 8)
+    var sa is slice of isize = arena_alloc(scratch, ond * 8, 8)
+    var sb is slice of isize = arena_alloc(scratch, ond * 8, 8)
+    var idx is slice of usize = arena_alloc(scratch, ond * 8, 8)
+    if dims is null or sa is null or sb is null or idx is null then
+        arena_reset_to(scratch, &sm)
+        return 1
+    var nb is usize = 1
+    var d is usize = 0
+    while d < lead do
+        var da is usize = 1
+        var db is usize = 1
+        sa[d] = 0
+        sb[d] = 0
+        if d + an >= ond then
+            da = ash[d + an - ond]
+            sa[d] = ast[d + an - ond]
+        if d + bnd >= ond then
+            db = bsh[d + bnd - ond]
+            sb[d] = bst[d + bnd - ond]
+        var dd is usize = da
+        if da == 1 then
+            dd = db
+            sa[d] = 0
+        if db == 1 then
+            sb[d] = 0
+        else if db != dd then
+            arena_reset_to(scratch, &sm)
+            return 1
+        dims[d] = dd
+        idx[d] = 0
+        nb = nb * dd
+        d = d + 1
+    dims[lead] = m
+    dims[lead + 1] = n
+    var rc is i32 = tensor_init_contiguous(out, DT_F32, DEV_CPU, ond, dims)
+    if rc != 0 then
+        arena_reset_to(scratch, &sm)
+        return 1
+    if nb == 0 then
+        arena_reset_to(scratch, &sm)
+        return 0
+
+    # Per-product operand offsets (elements), walking the batch odometer.
+    var a_offs is slice of isize = arena_alloc(scratch, nb * 8, 8)
+    var b_offs is slice of isize = arena_alloc(scratch, nb * 8, 8)
+    if a_offs is null or b_offs is null then
+        arena_reset_to(scratch, &sm)
+        tensor_free(out)
+        return 1
+    var oa is isize = 0
+    var ob is isize = 0
+    var bi is usize = 0
+    while bi < nb do
+        a_offs[bi] = oa
+        b_offs[bi] = ob
+        var e is usize = lead
+        while e > 0 do
+            e = e - 1
+            var ie is isize = idx[e]
+            idx[e] = idx[e] + 1
+            if idx[e] < dims[e] then
+                oa = oa + sa[e]
+                ob = ob + sb[e]
+                break
+            oa = oa - ie * sa[e]
+            ob = ob - ie * sb[e]
+            idx[e] = 0
+        bi = bi + 1
+    rc = cpu_bmm_f32(nb, tensor_data_ptr(out), tensor_data_ptr(a), a_offs, ast[an - 2], ast[an - 1], tensor_data_ptr(b), b_offs, bst[bnd - 2], bst[bnd - 1], m, k, n, 0)
+    arena_reset_to(scratch, &sm)
+    if rc != 0 then
         tensor_free(out)
         return 1
-    var ap is slice of f32 = tensor_data_ptr(a)
-    var bp is slice of f32 = tensor_data_ptr(b)
-    var op is slice of f32 = tensor_data_ptr(out)
-    var i is usize = 0
-    while i < m do
-        var j is usize = 0
-        while j < n do
-            var acc is f32 = 0.0
-            var p is usize = 0
-            while p < k do
-                acc = acc + ap[i * k + p] * bp[p * n + j]
-                p = p + 1
-            op[i * n + j] = acc
-            j = j + 1
-        i = i + 1
     return 0
@@ -2,13 +2,15 @@
 #
 # Minimal tinygrad-style UOp IR bring-up:
 # - UOp nodes with structural hashes ("stable keys")
-# - hash-consing / interning in an explicit context
+# - hash-consing / interning in an explicit context (arena-backed nodes,
+#   32-bit ids, struct-of-arrays columns for the intern table)
 # - tiny local simplifier (rewrite hook)
 #
 # This is intentionally small: it exists to unlock Phase 7 work without
 # requiring global mutable state or advanced Aster language features.
 
 use core.libc
+use core.arena
 use aster_ml.dtype
 
 # ---- ops (subset) ----
@@ -17,6 +19,17 @@ const UOP_CONST is i32 = 1
 const UOP_ADD is i32 = 2
 const UOP_MUL is i32 = 3
 const UOP_RELU is i32 = 4
+const UOP_BUFFER is i32 = 5       # realized input: arg0 = buffer slot, arg1 = numel
+const UOP_REDUCE_SUM is i32 = 6   # sums runs of arg0 consecutive elements: arg1 = output numel
+const UOP_IDIV is i32 = 7         # integer division, truncating (index arithmetic)
+const UOP_MOD is i32 = 8          # integer remainder, sign of the dividend
+const UOP_NOPS is i32 = 9         # op codes are 0..UOP_NOPS-1
+
+# CONST arg0 holds the value's bits: f32 bits for DT_F32, the two's
+# complement i64 for integer dtypes.
+
+# Lazy-graph nodes carry their element count in arg1 (elementwise nodes
+# included); CONST is a broadcast scalar.
 
 # ---- generic helpers ----
 
@@ -40,20 +53,6 @@ def hash_combine(h is u64, x is u64) returns u64
     return hash_mix_u64(z)
 
 
-def uop_hash(op is i32, dtype is i32, nsrc is usize, src_keys is slice of u64, arg0 is u64, arg1 is u64) returns u64
-    var h is u64 = 0x243f6a8885a308d3
-    h = hash_combine(h, op)
-    h = hash_combine(h, dtype)
-    h = hash_combine(h, nsrc)
-    h = hash_combine(h, arg0)
-    h = hash_combine(h, arg1)
-    var i is usize = 0
-    while i < nsrc do
-        h = hash_combine(h, src_keys[i])
-        i = i + 1
-    return h
-
-
 struct VecPtr
     var data is MutString  # `slice of MutString`
     var len is usize
@@ -105,6 +104,8 @@ def vec_ptr_push(v is mut ref VecPtr, p is MutString) returns i32
 
 
 struct UOp
+    # Node record, in its context's arena. `src` points at src0/src1 for up
+    # to two sources (no separate allocation), else at an arena array.
     var op is i32
     var dtype is i32
     var nsrc is usize
@@ -112,103 +113,148 @@ struct UOp
     var arg0 is u64
     var arg1 is u64
     var key is u64
+    var mark is u64       # scratch for graph walks (schedule_build); 0 when idle
+    var id is u32         # index into the context's columns
+    var src0 is MutString
+    var src1 is MutString
+
+const UOP_BYTES is usize = 80   # sizeof(UOp) on 64-bit
 
 
 struct UOpCtx
-    # Intern table: (keyhash -> UOp*)
-    var tab_keys is MutString  # `slice of u64`
-    var tab_vals is MutString  # `slice of MutString` (UOp*)
+    # Nodes live in `arena` and are never freed individually; each gets a
+    # 32-bit id (interning order). The fields hashing and equality read are
+    # also kept as columns indexed by id, so probing the intern table scans
+    # dense arrays and touches a node only to compare its sources.
+    var arena is Arena
+    var len is usize             # nodes interned (ids 0..len-1)
+    var cap is usize             # column capacity
+    var col_op is MutString      # `slice of i32`
+    var col_dtype is MutString   # `slice of i32`
+    var col_key is MutString     # `slice of u64`
+    var col_arg0 is MutString    # `slice of u64`
+    var col_arg1 is MutString    # `slice of u64`
+    var col_node is MutString    # `slice of MutString` (UOp*)
+    # Intern table: open-addressed, id + 1 per slot (0 = empty).
+    var tab is MutString         # `slice of u32`
     var tab_cap is usize
-    var tab_len is usize
-    # Ownership tracking for freeing.
-    var nodes is VecPtr
+    var srcbuf is MutString      # `slice of MutString`, 2 entries (uop_intern1/2)
+
+
+def uop_ctx_free(ctx is mut ref UOpCtx) returns ()
+    # Frees every node at once (they all live in the arena).
+    arena_free(&(*ctx).arena)
+    if (*ctx).col_op is not null then
+        free((*ctx).col_op)
+    if (*ctx).col_dtype is not null then
+        free((*ctx).col_dtype)
+    if (*ctx).col_key is not null then
+        free((*ctx).col_key)
+    if (*ctx).col_arg0 is not null then
+        free((*ctx).col_arg0)
+    if (*ctx).col_arg1 is not null then
+        free((*ctx).col_arg1)
+    if (*ctx).col_node is not null then
+        free((*ctx).col_node)
+    if (*ctx).tab is not null then
+        free((*ctx).tab)
+    if (*ctx).srcbuf is not null then
+        free((*ctx).srcbuf)
+    (*ctx).col_op = null
+    (*ctx).col_dtype = null
+    (*ctx).col_key = null
+    (*ctx).col_arg0 = null
+    (*ctx).col_arg1 = null
+    (*ctx).col_node = null
+    (*ctx).tab = null
+    (*ctx).srcbuf = null
+    (*ctx).len = 0
+    (*ctx).cap = 0
+    (*ctx).tab_cap = 0
+    return
 
 
 def uop_ctx_init(ctx is mut ref UOpCtx) returns i32
-    (*ctx).tab_cap = 1024
-    (*ctx).tab_len = 0
-    (*ctx).tab_keys = calloc((*ctx).tab_cap, 8)
-    if (*ctx).tab_keys is null then
-        return 1
-    (*ctx).tab_vals = calloc((*ctx).tab_cap, 8)
-    if (*ctx).tab_vals is null then
-        free((*ctx).tab_keys)
-        (*ctx).tab_keys = null
+    (*ctx).len = 0
+    (*ctx).cap = 1024
+    (*ctx).tab_cap = 2048
+    (*ctx).col_op = malloc((*ctx).cap * 4)
+    (*ctx).col_dtype = malloc((*ctx).cap * 4)
+    (*ctx).col_key = malloc((*ctx).cap * 8)
+    (*ctx).col_arg0 = malloc((*ctx).cap * 8)
+    (*ctx).col_arg1 = malloc((*ctx).cap * 8)
+    (*ctx).col_node = malloc((*ctx).cap * 8)
+    (*ctx).tab = calloc((*ctx).tab_cap, 4)
+    (*ctx).srcbuf = malloc(2 * 8)
+    var rc is i32 = arena_init(&(*ctx).arena, 65536)
+    if rc != 0 or (*ctx).col_op is null or (*ctx).col_dtype is null or (*ctx).col_key is null or (*ctx).col_arg0 is null or (*ctx).col_arg1 is null or (*ctx).col_node is null or (*ctx).tab is null or (*ctx).srcbuf is null then
+        uop_ctx_free(ctx)
         return 1
-    vec_ptr_init(&(*ctx).nodes)
     return 0
 
 
-def uop_ctx_free(ctx is mut ref UOpCtx) returns ()
-    # Free all nodes (and their src arrays).
-    var xs is slice of MutString = (*ctx).nodes.data
-    var i is usize = 0
-    while i < (*ctx).nodes.len do
-        var p is MutString = xs[i]
-        if p is not null then
-            var u is mut ref UOp = p
-            if (*u).src is not null then
-                free((*u).src)
-            free(p)
-        i = i + 1
-    vec_ptr_free(&(*ctx).nodes)
-
-    if (*ctx).tab_keys is not null then
-        free((*ctx).tab_keys)
-    if (*ctx).tab_vals is not null then
-        free((*ctx).tab_vals)
-    (*ctx).tab_keys = null
-    (*ctx).tab_vals = null
-    (*ctx).tab_cap = 0
-    (*ctx).tab_len = 0
-    return
+def uop_count(ctx is mut ref UOpCtx) returns usize
+    return (*ctx).len
 
 
-def uop_tab_grow(ctx is mut ref UOpCtx) returns i32
-    var old_cap is usize = (*ctx).tab_cap
-    var new_cap is usize = old_cap * 2
-    var new_keys is MutString = calloc(new_cap, 8)
-    if new_keys is null then
-        return 1
-    var new_vals is MutString = calloc(new_cap, 8)
-    if new_vals is null then
-        free(new_keys)
+def uop_at(ctx is mut ref UOpCtx, id is u32) returns MutString
+    var nodes is slice of MutString = (*ctx).col_node
+    return nodes[id]
+
+
+def uop_id(p is MutString) returns u32
+    var u is mut ref UOp = p
+    return (*u).id
+
+
+def uop_col_grow(col is mut ref MutString, len is usize, elem is usize, cap is usize) returns i32
+    var grown is MutString = malloc(cap * elem)
+    if grown is null then
         return 1
+    memcpy(grown, *col, len * elem)
+    free(*col)
+    *col = grown
+    return 0
 
-    var oldk is slice of u64 = (*ctx).tab_keys
-    var oldv is slice of MutString = (*ctx).tab_vals
-    var nk is slice of u64 = new_keys
-    var nv is slice of MutString = new_vals
 
-    var i is usize = 0
-    while i < old_cap do
-        var k is u64 = oldk[i]
-        if k != 0 then
-            var idx is usize = k
-            idx = idx & (new_cap - 1)
-            while nk[idx] != 0 do
-                idx = (idx + 1) & (new_cap - 1)
-            nk[idx] = k
-            nv[idx] = oldv[i]
-        i = i + 1
+def uop_cols_grow(ctx is mut ref UOpCtx) returns i32
+    var len is usize = (*ctx).len
+    var cap is usize = (*ctx).cap * 2
+    if uop_col_grow(&(*ctx).col_op, len, 4, cap) != 0 or uop_col_grow(&(*ctx).col_dtype, len, 4, cap) != 0 then
+        return 1
+    if uop_col_grow(&(*ctx).col_key, len, 8, cap) != 0 or uop_col_grow(&(*ctx).col_arg0, len, 8, cap) != 0 then
+        return 1
+    if uop_col_grow(&(*ctx).col_arg1, len, 8, cap) != 0 or uop_col_grow(&(*ctx).col_node, len, 8, cap) != 0 then
+        return 1
+    (*ctx).cap = cap
+    return 0
 
-    free((*ctx).tab_keys)
-    free((*ctx).tab_vals)
-    (*ctx).tab_keys = new_keys
-    (*ctx).tab_vals = new_vals
+
+def uop_tab_grow(ctx is mut ref UOpCtx) returns i32
+    var new_cap is usize = (*ctx).tab_cap * 2
+    var nt is slice of u32 = calloc(new_cap, 4)
+    if nt is null then
+        return 1
+    var keys is slice of u64 = (*ctx).col_key
+    var id is usize = 0
+    while id < (*ctx).len do
+        var idx is usize = keys[id]
+        idx = idx & (new_cap - 1)
+        while nt[idx] != 0 do
+            idx = (idx + 1) & (new_cap - 1)
+        nt[idx] = id + 1
+        id = id + 1
+    free((*ctx).tab)
+    (*ctx).tab = nt
     (*ctx).tab_cap = new_cap
     return 0
 
 
-def uop_eq(u is mut ref UOp, op is i32, dtype is i32, nsrc is usize, src is slice of MutString, arg0 is u64, arg1 is u64) returns i32
-    if (*u).op != op then
-        return 0
-    if (*u).dtype != dtype then
-        return 0
+def uop_src_eq(u is mut ref UOp, nsrc is usize, src is slice of MutString) returns i32
+    # The node-side half of intern equality (op, dtype and args are compared
+    # on the columns first).
     if (*u).nsrc != nsrc then
         return 0
-    if (*u).arg0 != arg0 or (*u).arg1 != arg1 then
-        return 0
     if nsrc == 0 then
         return 1
     var usrc is slice of MutString = (*u).src
@@ -221,43 +267,49 @@ def uop_eq(u is mut ref UOp, op is i32, dtype is i32, nsrc is usize, src is slic
 
 
 def uop_intern(ctx is mut ref UOpCtx, op is i32, dtype is i32, nsrc is usize, src is slice of MutString, arg0 is u64, arg1 is u64) returns MutString
-    # Compute structural hash from children keys (stable keys).
-    var tmp_keys is slice of u64 = null
-    if nsrc != 0 then
-        tmp_keys = malloc(nsrc * 8)
-        if tmp_keys is null then
-            return null
-        var i is usize = 0
-        while i < nsrc do
-            var su is mut ref UOp = src[i]
-            tmp_keys[i] = (*su).key
-            i = i + 1
-    var key is u64 = uop_hash(op, dtype, nsrc, tmp_keys, arg0, arg1)
-    if tmp_keys is not null then
-        free(tmp_keys)
+    # Structural hash from the children's keys (stable keys).
+    var h is u64 = 0x243f6a8885a308d3
+    h = hash_combine(h, op)
+    h = hash_combine(h, dtype)
+    h = hash_combine(h, nsrc)
+    h = hash_combine(h, arg0)
+    h = hash_combine(h, arg1)
+    var i is usize = 0
+    while i < nsrc do
+        var su is mut ref UOp = src[i]
+        h = hash_combine(h, (*su).key)
+        i = i + 1
+    var key is u64 = h
 
     # Grow table if load factor > 0.7.
-    if ((*ctx).tab_len * 10) >= ((*ctx).tab_cap * 7) then
+    if ((*ctx).len * 10) >= ((*ctx).tab_cap * 7) then
         if uop_tab_grow(ctx) != 0 then
             return null
 
-    var keys is slice of u64 = (*ctx).tab_keys
-    var vals is slice of MutString = (*ctx).tab_vals
-    var cap is usize = (*ctx).tab_cap
-
+    # Probe on the columns; a node is dereferenced only once its key, op,
+    # dtype and args all match, to compare sources.
+    var tab is slice of u32 = (*ctx).tab
+    var keys is slice of u64 = (*ctx).col_key
+    var ops is slice of i32 = (*ctx).col_op
+    var dts is slice of i32 = (*ctx).col_dtype
+    var a0s is slice of u64 = (*ctx).col_arg0
+    var a1s is slice of u64 = (*ctx).col_arg1
+    var nodes is slice of MutString = (*ctx).col_node
+    var mask is usize = (*ctx).tab_cap - 1
     var idx is usize = key
-    idx = idx & (cap - 1)
-    while keys[idx] != 0 do
-        if keys[idx] == key then
-            var p is MutString = vals[idx]
-            if p is not null then
-                var u is mut ref UOp = p
-                if uop_eq(u, op, dtype, nsrc, src, arg0, arg1) != 0 then
-                    return p
-        idx = (idx + 1) & (cap - 1)
-
-    # Allocate node.
-    var up is MutString = malloc(56)  # sizeof(UOp) on 64-bit (aligned)
+    idx = idx & mask
+    while tab[idx] != 0 do
+        var hit is usize = tab[idx] - 1
+        if keys[hit] == key and ops[hit] == op and dts[hit] == dtype and a0s[hit] == arg0 and a1s[hit] == arg1 then
+            if uop_src_eq(nodes[hit], nsrc, src) != 0 then
+                return nodes[hit]
+        idx = (idx + 1) & mask
+
+    # New node.
+    if (*ctx).len == (*ctx).cap then
+        if uop_cols_grow(ctx) != 0 then
+            return null
+    var up is MutString = arena_alloc(&(*ctx).arena, UOP_BYTES, 16)
     if up is null then
         return null
     var u is mut ref UOp = up
@@ -267,25 +319,54 @@ def uop_intern(ctx is mut ref UOpCtx, op is i32, dtype is i32, nsrc is usize, sr
     (*u).arg0 = arg0
     (*u).arg1 = arg1
     (*u).key = key
+    (*u).mark = 0
+    (*u).id = (*ctx).len
+    (*u).src0 = null
+    (*u).src1 = null
     (*u).src = null
-    if nsrc != 0 then
-        var sp is MutString = malloc(nsrc * 8)
-        if sp is null then
-            free(up)
+    if nsrc > 2 then
+        (*u).src = arena_alloc(&(*ctx).arena, nsrc * 8, 8)
+        if (*u).src is null then
             return null
-        memcpy(sp, src, nsrc * 8)
-        (*u).src = sp
+    else if nsrc != 0 then
+        (*u).src = &(*u).src0
+    if nsrc != 0 then
+        memcpy((*u).src, src, nsrc * 8)
+
+    var id is usize = (*ctx).len
+    ops = (*ctx).col_op
+    dts = (*ctx).col_dtype
+    a0s = (*ctx).col_arg0
+    a1s = (*ctx).col_arg1
+    keys = (*ctx).col_key
+    nodes = (*ctx).col_node
+    ops[id] = op
+    dts[id] = dtype
+    keys[id] = key
+    a0s[id] = arg0
+    a1s[id] = arg1
+    nodes[id] = up
+    tab[idx] = id + 1
+    (*ctx).len = id + 1
+    return up
+
 
-    if vec_ptr_push(&(*ctx).nodes, up) != 0 then
-        if (*u).src is not null then
-            free((*u).src)
-        free(up)
+def uop_intern1(ctx is mut ref UOpCtx, op is i32, dtype is i32, a is MutString, arg0 is u64, arg1 is u64) returns MutString
+    # uop_intern for one source, without a caller-side source array.
+    if a is null then
         return null
+    var src is slice of MutString = (*ctx).srcbuf
+    src[0] = a
+    return uop_intern(ctx, op, dtype, 1, src, arg0, arg1)
 
-    keys[idx] = key
-    vals[idx] = up
-    (*ctx).tab_len = (*ctx).tab_len + 1
-    return up
+
+def uop_intern2(ctx is mut ref UOpCtx, op is i32, dtype is i32, a is MutString, b is MutString, arg0 is u64, arg1 is u64) returns MutString
+    if a is null or b is null then
+        return null
+    var src is slice of MutString = (*ctx).srcbuf
+    src[0] = a
+    src[1] = b
+    return uop_intern(ctx, op, dtype, 2, src, arg0, arg1)
 
 
 # ---- constructors (subset) ----
@@ -299,36 +380,43 @@ def uop_const_f32(ctx is mut ref UOpCtx, v is f32) returns MutString
     return uop_intern(ctx, UOP_CONST, DT_F32, 0, null, bits, 0)
 
 
+def uop_const_int(ctx is mut ref UOpCtx, dtype is i32, v is i64) returns MutString
+    var bits is u64 = v
+    return uop_intern(ctx, UOP_CONST, dtype, 0, null, bits, 0)
+
+
 def uop_add(ctx is mut ref UOpCtx, a is MutString, b is MutString) returns MutString
-    var src is slice of MutString = malloc(2 * 8)
-    if src is null then
-        return null
-    src[0] = a
-    src[1] = b
-    var out is MutString = uop_intern(ctx, UOP_ADD, DT_F32, 2, src, 0, 0)
-    free(src)
-    return out
+    return uop_intern2(ctx, UOP_ADD, DT_F32, a, b, 0, 0)
 
 
 def uop_mul(ctx is mut ref UOpCtx, a is MutString, b is MutString) returns MutString
-    var src is slice of MutString = malloc(2 * 8)
-    if src is null then
-        return null
-    src[0] = a
-    src[1] = b
-    var out is MutString = uop_intern(ctx, UOP_MUL, DT_F32, 2, src, 0, 0)
-    free(src)
-    return out
+    return uop_intern2(ctx, UOP_MUL, DT_F32, a, b, 0, 0)
 
 
 def uop_relu(ctx is mut ref UOpCtx, a is MutString) returns MutString
-    var src is slice of MutString = malloc(1 * 8)
-    if src is null then
-        return null
-    src[0] = a
-    var out is MutString = uop_intern(ctx, UOP_RELU, DT_F32, 1, src, 0, 0)
-    free(src)
-    return out
+    return uop_intern1(ctx, UOP_RELU, DT_F32, a, 0, 0)
+
+
+def uop_numel(p is MutString) returns u64
+    # Element count of a lazy-graph node (1 for a broadcast CONST).
+    var u is mut ref UOp = p
+    if (*u).op == UOP_CONST then
+        return 1
+    return (*u).arg1
+
+
+def uop_is_leaf(p is MutString) returns i32
+    # CONST and BUFFER nodes are kernel inputs, never computed.
+    var u is mut ref UOp = p
+    return ((*u).op == UOP_CONST or (*u).op == UOP_BUFFER)
+
+
+def uop_const_value(p is MutString) returns f32
+    var u is mut ref UOp = p
+    var bits is u32 = (*u).arg0
+    var pu is mut ref u32 = &bits
+    var pf is mut ref f32 = pu
+    return *pf
 
 
 # ---- simplifier (local rewrite engine hook) ----
@@ -347,6 +435,8 @@ def uop_is_const_one(u is mut ref UOp) returns i32
 
 
 def uop_simplify(ctx is mut ref UOpCtx, p is MutString) returns MutString
+    # Fixed float identity/folding pass; rule-driven rewriting lives in
+    # aster_ml.uop.rewrite.
     if p is null then
         return null
     var u is mut ref UOp = p
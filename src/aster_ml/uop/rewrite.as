@@ -0,0 +1,650 @@
+# aster_ml.uop.rewrite (v0)
+#
+# Rule-driven graph rewriting over interned UOps (tinygrad's PatternMatcher +
+# graph_rewrite, without callbacks).
+#
+# A rule is a UPat plus a rewrite: a template over the pattern's bindings,
+# or constant folding of the matched node. Aster has no function pointers,
+# so rewrites are data:
+# - RW_TMPL: build the template (RwTmpl tree of bindings, new nodes and
+#   constants; new nodes take the matched node's dtype, and a rule whose
+#   constant that dtype cannot hold does not fire);
+# - RW_FOLD: evaluate the matched op over its CONST sources.
+#
+# `rewrite_compile` turns the rule list into a decision table: one bucket
+# per (root op, root dtype) listing the rules that can match there, in rule
+# order, each with the ops its first two sources must have. Matching a node
+# is one table lookup and a cheap source-op check before `upat_match` runs.
+#
+# `graph_rewrite` works bottom-up (explicit stack): a node's sources are
+# rewritten first, then rules are applied to the node until none matches.
+# Results are memoized per interned UOp (a dense table by UOp id), so shared
+# subgraphs are rewritten once and every node of a large graph costs one
+# bucket scan.
+
+use core.libc
+use core.arena
+use aster_ml.dtype
+use aster_ml.uop.ops
+use aster_ml.uop.upat
+
+const RW_TMPL is i32 = 1
+const RW_FOLD is i32 = 2
+
+# Rule guards on the matched node's dtype.
+const RW_ANY is i32 = 0
+const RW_INT is i32 = 1
+const RW_FLOAT is i32 = 2
+
+# Template nodes.
+const RWT_BIND is i32 = 1    # the node bound to `slot`
+const RWT_NODE is i32 = 2    # op(a) or op(a, b)
+const RWT_CONST is i32 = 3   # integer `value` in the matched node's dtype
+
+const RW_NDTYPES is i32 = 15      # dtype codes are 0..DT_INDEX
+const RW_MAX_BINDS is usize = 4
+const RW_MAX_DEPTH is usize = 32  # successive rewrites of one node
+const RW_RULE_BYTES is usize = 32
+const RW_TMPL_BYTES is usize = 40
+
+struct RwRule
+    var pat is MutString     # UPat*
+    var kind is i32
+    var guard is i32
+    var tmpl is MutString    # RwTmpl* (RW_TMPL)
+    var src_op0 is i32       # required op of source 0, or UPAT_ANY_OP
+    var src_op1 is i32
+
+
+struct RwTmpl
+    var kind is i32
+    var op is i32
+    var slot is i32
+    var value is i64
+    var a is MutString       # RwTmpl*
+    var b is MutString       # RwTmpl*, null for a unary op
+
+
+struct RewriteSet
+    var arena is Arena       # rules, patterns and templates
+    var rules is VecPtr      # RwRule*, in priority order
+    # Decision table (after rewrite_compile): bucket op * RW_NDTYPES + dtype
+    # holds rule indices starts[bucket]..starts[bucket + 1] of `ids`.
+    var starts is MutString  # `slice of u32`
+    var ids is MutString     # `slice of u32`
+
+
+def rewrite_set_init(rs is mut ref RewriteSet) returns i32
+    vec_ptr_init(&(*rs).rules)
+    (*rs).starts = null
+    (*rs).ids = null
+    return arena_init(&(*rs).arena, 16384)
+
+
+def rewrite_set_free(rs is mut ref RewriteSet) returns ()
+    vec_ptr_free(&(*rs).rules)
+    if (*rs).starts is not null then
+        free((*rs).starts)
+    if (*rs).ids is not null then
+        free((*rs).ids)
+    (*rs).starts = null
+    (*rs).ids = null
+    arena_free(&(*rs).arena)
+    return
+
+
+# ---- building rules ----
+
+def rw_pat(rs is mut ref RewriteSet, op is i32, bind is i32, a is MutString, b is MutString) returns MutString
+    # Pattern node `op` (UPAT_ANY_OP for any) with 0, 1 or 2 sources.
+    var p is MutString = arena_alloc(&(*rs).arena, UPAT_BYTES, 8)
+    var srcs is slice of MutString = arena_alloc(&(*rs).arena, 2 * 8, 8)
+    if p is null or srcs is null then
+        return null
+    var u is mut ref UPat = p
+    upat_init(u, op, bind)
+    srcs[0] = a
+    srcs[1] = b
+    if a is not null then
+        (*u).src = srcs
+        (*u).nsrc = 1
+        if b is not null then
+            (*u).nsrc = 2
+    return p
+
+
+def rw_var(rs is mut ref RewriteSet, bind is i32) returns MutString
+    # Any node, bound to `bind`. As a source it matches leaves and subtrees.
+    var p is MutString = rw_pat(rs, UPAT_ANY_OP, bind, null, null)
+    if p is not null then
+        var u is mut ref UPat = p
+        (*u).nsrc = UPAT_ANY_SRC
+    return p
+
+
+def rw_cvar(rs is mut ref RewriteSet, bind is i32) returns MutString
+    # Any CONST, bound to `bind`.
+    return rw_pat(rs, UOP_CONST, bind, null, null)
+
+
+def rw_cval(rs is mut ref RewriteSet, bits is u64) returns MutString
+    # The CONST whose arg0 is `bits`.
+    var p is MutString = rw_pat(rs, UOP_CONST, 0 - 1, null, null)
+    if p is not null then
+        var u is mut ref UPat = p
+        (*u).has_arg0 = 1
+        (*u).arg0 = bits
+    return p
+
+
+def rw_tmpl(rs is mut ref RewriteSet, kind is i32, op is i32, slot is i32, value is i64, a is MutString, b is MutString) returns MutString
+    var p is MutString = arena_alloc(&(*rs).arena, RW_TMPL_BYTES, 8)
+    if p is null then
+        return null
+    var t is mut ref RwTmpl = p
+    (*t).kind = kind
+    (*t).op = op
+    (*t).slot = slot
+    (*t).value = value
+    (*t).a = a
+    (*t).b = b
+    return p
+
+
+def rw_bind(rs is mut ref RewriteSet, slot is i32) returns MutString
+    return rw_tmpl(rs, RWT_BIND, 0, slot, 0, null, null)
+
+
+def rw_node(rs is mut ref RewriteSet, op is i32, a is MutString, b is MutString) returns MutString
+    if a is null then
+        return null
+    return rw_tmpl(rs, RWT_NODE, op, 0, 0, a, b)
+
+
+def rw_const(rs is mut ref RewriteSet, v is i64) returns MutString
+    return rw_tmpl(rs, RWT_CONST, 0, 0, v, null, null)
+
+
+def rw_src_op(pat is mut ref UPat, i is usize) returns i32
+    if (*pat).nsrc == UPAT_ANY_SRC or (*pat).nsrc <= i then
+        return UPAT_ANY_OP
+    var ps is slice of MutString = (*pat).src
+    var sp is mut ref UPat = ps[i]
+    return (*sp).op
+
+
+def rewrite_add(rs is mut ref RewriteSet, pat is MutString, kind is i32, guard is i32, tmpl is MutString) returns i32
+    # Appends a rule (after every rule added so far). Call rewrite_compile
+    # once all rules are in.
+    if pat is null or (kind == RW_TMPL and tmpl is null) then
+        return 1
+    var p is MutString = arena_alloc(&(*rs).arena, RW_RULE_BYTES, 8)
+    if p is null then
+        return 1
+    var r is mut ref RwRule = p
+    var up is mut ref UPat = pat
+    (*r).pat = pat
+    (*r).kind = kind
+    (*r).guard = guard
+    (*r).tmpl = tmpl
+    (*r).src_op0 = rw_src_op(up, 0)
+    (*r).src_op1 = rw_src_op(up, 1)
+    return vec_ptr_push(&(*rs).rules, p)
+
+
+def rw_rule_admits(r is mut ref RwRule, op is i32, dtype is i32) returns i32
+    var pat is mut ref UPat = (*r).pat
+    if (*pat).op != UPAT_ANY_OP and (*pat).op != op then
+        return 0
+    if (*pat).dtype != 0 and (*pat).dtype != dtype then
+        return 0
+    if (*r).guard == RW_INT and dtype_is_int(dtype) == 0 then
+        return 0
+    if (*r).guard == RW_FLOAT and dtype_is_float(dtype) == 0 then
+        return 0
+    return 1
+
+
+def rewrite_compile(rs is mut ref RewriteSet) returns i32
+    # Builds the (op, dtype) decision table: two passes, count then fill.
+    var nb is usize = UOP_NOPS * RW_NDTYPES
+    if (*rs).starts is not null then
+        free((*rs).starts)
+    if (*rs).ids is not null then
+        free((*rs).ids)
+    (*rs).ids = null
+    (*rs).starts = calloc(nb + 1, 4)
+    if (*rs).starts is null then
+        return 1
+    var starts is slice of u32 = (*rs).starts
+    var rules is slice of MutString = (*rs).rules.data
+    var total is usize = 0
+    var pass is usize = 0
+    while pass < 2 do
+        var ids is slice of u32 = (*rs).ids
+        total = 0
+        var bkt is usize = 0
+        while bkt < nb do
+            var op is i32 = bkt / RW_NDTYPES
+            var dt is i32 = bkt - (bkt / RW_NDTYPES) * RW_NDTYPES
+            starts[bkt] = total
+            var i is usize = 0
+            while i < (*rs).rules.len do
+                if rw_rule_admits(rules[i], op, dt) != 0 then
+                    if pass == 1 then
+                        ids[total] = i
+                    total = total + 1
+                i = i + 1
+            bkt = bkt + 1
+        starts[nb] = total
+        if pass == 0 then
+            (*rs).ids = malloc(total * 4 + 4)
+            if (*rs).ids is null then
+                return 1
+        pass = pass + 1
+    return 0
+
+
+# ---- applying rules ----
+
+def uop_const_bits_of(ctx is mut ref UOpCtx, dtype is i32, v is i64) returns MutString
+    # Integer value `v` as a CONST of `dtype`, or null if it has no encoding
+    # here. Float CONSTs hold f32 bits; other float dtypes only get 0, whose
+    # bits are all zero in every width.
+    if dtype_is_float(dtype) != 0 then
+        if dtype == DT_F32 then
+            var f is f32 = v
+            return uop_const_f32(ctx, f)
+        if v != 0 then
+            return null
+        return uop_const_int(ctx, dtype, 0)
+    return uop_const_int(ctx, dtype, uop_int_wrap(dtype, v))
+
+
+def uop_int_wrap(dtype is i32, v is i64) returns i64
+    # `v` reduced to the width of integer `dtype` (two's complement, sign- or
+    # zero-extended back to 64 bits).
+    var bits is u64 = dtype_itemsize(dtype) * 8
+    if bits == 0 or bits >= 64 then
+        return v
+    var one is u64 = 1
+    var u is u64 = v
+    u = u & ((one << bits) - 1)
+    if dtype_is_unsigned(dtype) == 0 and u >= (one << (bits - 1)) then
+        u = u - (one << bits)
+    var r is i64 = u
+    return r
+
+
+def uop_fold(ctx is mut ref UOpCtx, p is MutString) returns MutString
+    # CONST value of op(CONST...), or null if it cannot be folded here.
+    var u is mut ref UOp = p
+    var src is slice of MutString = (*u).src
+    var a is mut ref UOp = src[0]
+    var b is mut ref UOp = src[0]
+    if (*u).nsrc > 1 then
+        b = src[1]
+    if (*a).op != UOP_CONST or (*b).op != UOP_CONST then
+        return null
+    var op is i32 = (*u).op
+    if (*u).dtype == DT_F32 then
+        var x is f32 = uop_const_value(src[0])
+        var y is f32 = uop_const_value(src[(*u).nsrc - 1])
+        if op == UOP_ADD then
+            return uop_const_f32(ctx, x + y)
+        if op == UOP_MUL then
+            return uop_const_f32(ctx, x * y)
+        if op == UOP_RELU then
+            if x < 0.0 then
+                x = 0.0
+            return uop_const_f32(ctx, x)
+        return null
+    var dt is i32 = (*u).dtype
+    if dtype_is_int(dt) == 0 then
+        return null
+    # Operands and results wrap to the dtype's width, as the kernel would.
+    var xi is i64 = uop_int_wrap(dt, (*a).arg0)
+    var yi is i64 = uop_int_wrap(dt, (*b).arg0)
+    if op == UOP_ADD then
+        return uop_const_int(ctx, dt, uop_int_wrap(dt, xi + yi))
+    if op == UOP_MUL then
+        return uop_const_int(ctx, dt, uop_int_wrap(dt, xi * yi))
+    if op == UOP_RELU then
+        if xi < 0 and dtype_is_unsigned(dt) == 0 then
+            xi = 0
+        return uop_const_int(ctx, dt, xi)
+    if yi == 0 then
+        return null
+    if op != UOP_IDIV and op != UOP_MOD then
+        return null
+    if dt == DT_U64 then
+        # Above 2^63 as i64 these are negative; divide unsigned.
+        var xu is u64 = xi
+        var yu is u64 = yi
+        if op == UOP_IDIV then
+            return uop_const_int(ctx, dt, xu / yu)
+        return uop_const_int(ctx, dt, xu - (xu / yu) * yu)
+    # INT64_MIN / -1 overflows (and traps on x86): leave it to run time.
+    var xb is u64 = xi
+    if yi == 0 - 1 and xb == 0x8000000000000000 then
+        return null
+    if op == UOP_IDIV then
+        return uop_const_int(ctx, dt, uop_int_wrap(dt, xi / yi))
+    return uop_const_int(ctx, dt, xi - (xi / yi) * yi)
+
+
+def rw_build(ctx is mut ref UOpCtx, tp is MutString, b is mut ref Bindings, dtype is i32) returns MutString
+    var t is mut ref RwTmpl = tp
+    if (*t).kind == RWT_BIND then
+        var vars is slice of MutString = (*b).vars
+        return vars[(*t).slot]
+    if (*t).kind == RWT_CONST then
+        return uop_const_bits_of(ctx, dtype, (*t).value)
+    var a is MutString = rw_build(ctx, (*t).a, b, dtype)
+    if a is null then
+        return null
+    if (*t).b is null then
+        return uop_intern1(ctx, (*t).op, dtype, a, 0, 0)
+    var bb is MutString = rw_build(ctx, (*t).b, b, dtype)
+    if bb is null then
+        return null
+    return uop_intern2(ctx, (*t).op, dtype, a, bb, 0, 0)
+
+
+def rw_src_is(u is mut ref UOp, i is usize, op is i32) returns i32
+    if op == UPAT_ANY_OP then
+        return 1
+    if (*u).nsrc <= i then
+        return 0
+    var src is slice of MutString = (*u).src
+    var s is mut ref UOp = src[i]
+    return ((*s).op == op)
+
+
+def rewrite_apply(ctx is mut ref UOpCtx, rs is mut ref RewriteSet, b is mut ref Bindings, p is MutString) returns MutString
+    # First rule that rewrites `p`, applied once; null if none does.
+    var u is mut ref UOp = p
+    if (*u).op < 0 or (*u).op >= UOP_NOPS or (*u).dtype < 0 or (*u).dtype >= RW_NDTYPES then
+        return null
+    var starts is slice of u32 = (*rs).starts
+    var ids is slice of u32 = (*rs).ids
+    var rules is slice of MutString = (*rs).rules.data
+    var bkt is usize = (*u).op * RW_NDTYPES + (*u).dtype
+    var k is usize = starts[bkt]
+    var end is usize = starts[bkt + 1]
+    while k < end do
+        var r is mut ref RwRule = rules[ids[k]]
+        k = k + 1
+        if rw_src_is(u, 0, (*r).src_op0) == 0 or rw_src_is(u, 1, (*r).src_op1) == 0 then
+            continue
+        bindings_clear(b)
+        if upat_match((*r).pat, p, b) == 0 then
+            continue
+        var out is MutString = null
+        if (*r).kind == RW_FOLD then
+            out = uop_fold(ctx, p)
+        else
+            out = rw_build(ctx, (*r).tmpl, b, (*u).dtype)
+        if out is not null and out != p then
+            return out
+    return null
+
+
+struct RewriteCtx
+    var uops is MutString    # UOpCtx*
+    var rs is MutString      # RewriteSet*
+    var memo is MutString    # `slice of u32` by UOp id: 1 + id of its rewrite (0 = not yet)
+    var memo_cap is usize
+    var b is Bindings
+    var depth is usize
+
+
+def rw_memo_get(rc is mut ref RewriteCtx, p is MutString) returns MutString
+    # Rewritten form of `p`, or null if it has not been rewritten yet.
+    var id is usize = uop_id(p)
+    if id >= (*rc).memo_cap then
+        return null
+    var memo is slice of u32 = (*rc).memo
+    var v is usize = memo[id]
+    if v == 0 then
+        return null
+    return uop_at((*rc).uops, v - 1)
+
+
+def rw_memo_put(rc is mut ref RewriteCtx, p is MutString, to is MutString) returns i32
+    var id is usize = uop_id(p)
+    if id >= (*rc).memo_cap then
+        # Cover every id the context has handed out so far (and then some).
+        var ctx is mut ref UOpCtx = (*rc).uops
+        var cap is usize = (*ctx).cap
+        if cap <= id then
+            cap = id + 1
+        var grown is MutString = calloc(cap, 4)
+        if grown is null then
+            return 1
+        if (*rc).memo is not null then
+            memcpy(grown, (*rc).memo, (*rc).memo_cap * 4)
+            free((*rc).memo)
+        (*rc).memo = grown
+        (*rc).memo_cap = cap
+    var memo is slice of u32 = (*rc).memo
+    memo[id] = uop_id(to) + 1
+    return 0
+
+
+def rw_rebuild(rc is mut ref RewriteCtx, p is MutString) returns MutString
+    # `p` over the rewritten forms of its (already rewritten) sources.
+    var ctx is mut ref UOpCtx = (*rc).uops
+    var u is mut ref UOp = p
+    if (*u).nsrc == 0 then
+        return p
+    var srcs is slice of MutString = (*u).src
+    var a is MutString = rw_memo_get(rc, srcs[0])
+    if (*u).nsrc == 1 then
+        if a == srcs[0] then
+            return p
+        return uop_intern1(ctx, (*u).op, (*u).dtype, a, (*u).arg0, (*u).arg1)
+    if (*u).nsrc == 2 then
+        var b is MutString = rw_memo_get(rc, srcs[1])
+        if a == srcs[0] and b == srcs[1] then
+            return p
+        return uop_intern2(ctx, (*u).op, (*u).dtype, a, b, (*u).arg0, (*u).arg1)
+    var nsrcs is slice of MutString = malloc((*u).nsrc * 8)
+    if nsrcs is null then
+        return null
+    var changed is i32 = 0
+    var j is usize = 0
+    while j < (*u).nsrc do
+        nsrcs[j] = rw_memo_get(rc, srcs[j])
+        if nsrcs[j] != srcs[j] then
+            changed = 1
+        j = j + 1
+    var n is MutString = p
+    if changed != 0 then
+        n = uop_intern(ctx, (*u).op, (*u).dtype, (*u).nsrc, nsrcs, (*u).arg0, (*u).arg1)
+    free(nsrcs)
+    return n
+
+
+def rw_srcs_final(rc is mut ref RewriteCtx, p is MutString) returns i32
+    # 1 if every source of `p` is a rewrite result (maps to itself).
+    var u is mut ref UOp = p
+    var srcs is slice of MutString = (*u).src
+    var j is usize = 0
+    while j < (*u).nsrc do
+        if rw_memo_get(rc, srcs[j]) != srcs[j] then
+            return 0
+        j = j + 1
+    return 1
+
+
+def rw_node_done(rc is mut ref RewriteCtx, p is MutString) returns MutString
+    # Rewrites `p` (whose sources are final) until no rule applies.
+    var ctx is mut ref UOpCtx = (*rc).uops
+    var out is MutString = rewrite_apply(ctx, (*rc).rs, &(*rc).b, p)
+    if out is null then
+        return p
+    var fin is MutString = rw_memo_get(rc, out)
+    if fin is not null then
+        return fin
+    if (*rc).depth >= RW_MAX_DEPTH then
+        return out
+    # The result may hold new nodes (template inner nodes): rewrite it as a
+    # graph of its own; everything already final is a memo hit. The common
+    # case, a node over finals, skips the walk.
+    (*rc).depth = (*rc).depth + 1
+    var r is MutString = null
+    if rw_srcs_final(rc, out) != 0 then
+        r = rw_node_done(rc, out)
+        if r is not null and (rw_memo_put(rc, out, r) != 0 or rw_memo_put(rc, r, r) != 0) then
+            r = null
+    else
+        r = rw_graph(rc, out)
+    (*rc).depth = (*rc).depth - 1
+    return r
+
+
+def rw_graph(rc is mut ref RewriteCtx, root is MutString) returns MutString
+    # Post-order over the not-yet-rewritten part of the graph under `root`.
+    var ctx is mut ref UOpCtx = (*rc).uops
+    var fin is MutString = rw_memo_get(rc, root)
+    if fin is not null then
+        return fin
+    var stack is VecPtr
+    vec_ptr_init(&stack)
+    var cur is slice of u64 = malloc(64 * 8)
+    var cur_cap is usize = 64
+    if cur is null or vec_ptr_push(&stack, root) != 0 then
+        if cur is not null then
+            free(cur)
+        vec_ptr_free(&stack)
+        return null
+    cur[0] = 0
+    var result is MutString = null
+    var failed is i32 = 0
+    while failed == 0 and stack.len != 0 do
+        var top is usize = stack.len - 1
+        var st is slice of MutString = stack.data
+        var p is MutString = st[top]
+        var u is mut ref UOp = p
+        var next is u64 = cur[top]
+        if next < (*u).nsrc then
+            cur[top] = next + 1
+            var src is slice of MutString = (*u).src
+            if rw_memo_get(rc, src[next]) is not null then
+                continue
+            if stack.len == cur_cap then
+                var grown is slice of u64 = malloc(cur_cap * 2 * 8)
+                if grown is null then
+                    failed = 1
+                    continue
+                memcpy(grown, cur, cur_cap * 8)
+                free(cur)
+                cur = grown
+                cur_cap = cur_cap * 2
+            if vec_ptr_push(&stack, src[next]) != 0 then
+                failed = 1
+                continue
+            cur[stack.len - 1] = 0
+            continue
+
+        # Sources are final: rebuild on the rewritten ones, then apply rules.
+        stack.len = top
+        var n is MutString = rw_rebuild(rc, p)
+        if n is null then
+            failed = 1
+            continue
+        var done is MutString = null
+        if n != p then
+            done = rw_memo_get(rc, n)
+        if done is null then
+            done = rw_node_done(rc, n)
+        if done is null or rw_memo_put(rc, p, done) != 0 or rw_memo_put(rc, done, done) != 0 then
+            failed = 1
+            continue
+        if n != p and rw_memo_put(rc, n, done) != 0 then
+            failed = 1
+            continue
+        result = done
+    free(cur)
+    vec_ptr_free(&stack)
+    if failed != 0 then
+        return null
+    return result
+
+
+def graph_rewrite(ctx is mut ref UOpCtx, rs is mut ref RewriteSet, root is MutString) returns MutString
+    # `root` with every rule of the compiled set applied to a fixpoint,
+    # sources first. Returns null on allocation failure.
+    if root is null or (*rs).starts is null then
+        return null
+    var rc is RewriteCtx
+    rc.uops = ctx
+    rc.rs = rs
+    rc.depth = 0
+    rc.memo = null
+    rc.memo_cap = 0
+    if bindings_init(&rc.b, RW_MAX_BINDS) != 0 then
+        return null
+    var out is MutString = rw_graph(&rc, root)
+    bindings_free(&rc.b)
+    if rc.memo is not null then
+        free(rc.memo)
+    return out
+
+
+# ---- rule pack: symbolic algebra ----
+
+def rewrite_rules_symbolic(rs is mut ref RewriteSet) returns i32
+    # Constant folding, identity elimination and index arithmetic. Slots:
+    # x = 0, y/c1 = 1, c2 = 2. Float rules stay exact-order (no
+    # reassociation); integer (index) rules regroup constants.
+    var bad is i32 = 0
+    var x is i32 = 0
+    var c1 is i32 = 1
+    var c2 is i32 = 2
+    var one_f is u64 = 0x3f800000
+    var neg_zero_f is u64 = 0x80000000
+
+    # Folding: op(CONST, CONST) / op(CONST).
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_ADD, 0 - 1, rw_cvar(rs, c1), rw_cvar(rs, c2)), RW_FOLD, RW_ANY, null)
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_MUL, 0 - 1, rw_cvar(rs, c1), rw_cvar(rs, c2)), RW_FOLD, RW_ANY, null)
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_RELU, 0 - 1, rw_cvar(rs, c1), null), RW_FOLD, RW_ANY, null)
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_IDIV, 0 - 1, rw_cvar(rs, c1), rw_cvar(rs, c2)), RW_FOLD, RW_INT, null)
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_MOD, 0 - 1, rw_cvar(rs, c1), rw_cvar(rs, c2)), RW_FOLD, RW_INT, null)
+
+    # Identities. CONST 0 has arg0 == 0 in every dtype; 1 differs. Float
+    # identities must hold for every IEEE input: x + -0.0 is x, but x + 0.0
+    # is not (-0.0 + 0.0 = +0.0), and x * 0 is not 0 (NaN, inf, -x).
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_ADD, 0 - 1, rw_var(rs, x), rw_cval(rs, 0)), RW_TMPL, RW_INT, rw_bind(rs, x))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_ADD, 0 - 1, rw_cval(rs, 0), rw_var(rs, x)), RW_TMPL, RW_INT, rw_bind(rs, x))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_ADD, 0 - 1, rw_var(rs, x), rw_cval(rs, neg_zero_f)), RW_TMPL, RW_FLOAT, rw_bind(rs, x))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_ADD, 0 - 1, rw_cval(rs, neg_zero_f), rw_var(rs, x)), RW_TMPL, RW_FLOAT, rw_bind(rs, x))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_MUL, 0 - 1, rw_var(rs, x), rw_cval(rs, one_f)), RW_TMPL, RW_FLOAT, rw_bind(rs, x))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_MUL, 0 - 1, rw_cval(rs, one_f), rw_var(rs, x)), RW_TMPL, RW_FLOAT, rw_bind(rs, x))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_MUL, 0 - 1, rw_var(rs, x), rw_cval(rs, 1)), RW_TMPL, RW_INT, rw_bind(rs, x))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_MUL, 0 - 1, rw_cval(rs, 1), rw_var(rs, x)), RW_TMPL, RW_INT, rw_bind(rs, x))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_MUL, 0 - 1, rw_var(rs, x), rw_cval(rs, 0)), RW_TMPL, RW_INT, rw_const(rs, 0))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_MUL, 0 - 1, rw_cval(rs, 0), rw_var(rs, x)), RW_TMPL, RW_INT, rw_const(rs, 0))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_RELU, 0 - 1, rw_pat(rs, UOP_RELU, x, rw_var(rs, c1), null), null), RW_TMPL, RW_ANY, rw_bind(rs, x))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_IDIV, 0 - 1, rw_var(rs, x), rw_cval(rs, 1)), RW_TMPL, RW_INT, rw_bind(rs, x))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_MOD, 0 - 1, rw_var(rs, x), rw_cval(rs, 1)), RW_TMPL, RW_INT, rw_const(rs, 0))
+
+    # Index arithmetic: constants to the right, then regrouped.
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_ADD, 0 - 1, rw_cvar(rs, c1), rw_var(rs, x)), RW_TMPL, RW_INT, rw_node(rs, UOP_ADD, rw_bind(rs, x), rw_bind(rs, c1)))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_MUL, 0 - 1, rw_cvar(rs, c1), rw_var(rs, x)), RW_TMPL, RW_INT, rw_node(rs, UOP_MUL, rw_bind(rs, x), rw_bind(rs, c1)))
+    # (x + c1) + c2 -> x + (c1 + c2); (x * c1) * c2 -> x * (c1 * c2)
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_ADD, 0 - 1, rw_pat(rs, UOP_ADD, 0 - 1, rw_var(rs, x), rw_cvar(rs, c1)), rw_cvar(rs, c2)), RW_TMPL, RW_INT, rw_node(rs, UOP_ADD, rw_bind(rs, x), rw_node(rs, UOP_ADD, rw_bind(rs, c1), rw_bind(rs, c2))))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_MUL, 0 - 1, rw_pat(rs, UOP_MUL, 0 - 1, rw_var(rs, x), rw_cvar(rs, c1)), rw_cvar(rs, c2)), RW_TMPL, RW_INT, rw_node(rs, UOP_MUL, rw_bind(rs, x), rw_node(rs, UOP_MUL, rw_bind(rs, c1), rw_bind(rs, c2))))
+    # (x + c1) * c2 -> x * c2 + c1 * c2
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_MUL, 0 - 1, rw_pat(rs, UOP_ADD, 0 - 1, rw_var(rs, x), rw_cvar(rs, c1)), rw_cvar(rs, c2)), RW_TMPL, RW_INT, rw_node(rs, UOP_ADD, rw_node(rs, UOP_MUL, rw_bind(rs, x), rw_bind(rs, c2)), rw_node(rs, UOP_MUL, rw_bind(rs, c1), rw_bind(rs, c2))))
+    # x + x -> x * 2; x * c1 + x -> x * (c1 + 1); x * c1 + x * c2 -> x * (c1 + c2)
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_ADD, 0 - 1, rw_var(rs, x), rw_var(rs, x)), RW_TMPL, RW_INT, rw_node(rs, UOP_MUL, rw_bind(rs, x), rw_const(rs, 2)))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_ADD, 0 - 1, rw_pat(rs, UOP_MUL, 0 - 1, rw_var(rs, x), rw_cvar(rs, c1)), rw_var(rs, x)), RW_TMPL, RW_INT, rw_node(rs, UOP_MUL, rw_bind(rs, x), rw_node(rs, UOP_ADD, rw_bind(rs, c1), rw_const(rs, 1))))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_ADD, 0 - 1, rw_pat(rs, UOP_MUL, 0 - 1, rw_var(rs, x), rw_cvar(rs, c1)), rw_pat(rs, UOP_MUL, 0 - 1, rw_var(rs, x), rw_cvar(rs, c2))), RW_TMPL, RW_INT, rw_node(rs, UOP_MUL, rw_bind(rs, x), rw_node(rs, UOP_ADD, rw_bind(rs, c1), rw_bind(rs, c2))))
+    # (x * c1) // c1 -> x; (x * c1) % c1 -> 0 (c1 != 0: CONST 0 folds x * 0 first)
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_IDIV, 0 - 1, rw_pat(rs, UOP_MUL, 0 - 1, rw_var(rs, x), rw_cvar(rs, c1)), rw_cvar(rs, c1)), RW_TMPL, RW_INT, rw_bind(rs, x))
+    bad = bad + rewrite_add(rs, rw_pat(rs, UOP_MOD, 0 - 1, rw_pat(rs, UOP_MUL, 0 - 1, rw_var(rs, x), rw_cvar(rs, c1)), rw_cvar(rs, c1)), RW_TMPL, RW_INT, rw_const(rs, 0))
+    if bad != 0 then
+        return 1
+    return rewrite_compile(rs)
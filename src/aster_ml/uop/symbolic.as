@@ -7,6 +7,9 @@
 #
 # This is not a full tinygrad port yet; it's enough to represent and evaluate
 # simple expressions deterministically in the Aster ML stack.
+#
+# `codegen/c.as` renders SymInts as C expressions for fused kernels whose
+# dims are runtime arguments.
 
 use core.libc
 
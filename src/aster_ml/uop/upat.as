@@ -2,13 +2,18 @@
 #
 # Minimal pattern matching used by the UOp rewrite engine.
 #
-# This is a tiny subset of tinygrad's UPat/PatternMatcher: enough to match
-# small algebraic identities deterministically and to bind variables.
+# This is a tiny subset of tinygrad's UPat: enough to match small algebraic
+# identities deterministically and to bind variables. A bind slot that
+# occurs twice must bind the same (interned) node, so `x + x` matches only
+# equal operands. Whole rule sets are compiled and applied by
+# `aster_ml.uop.rewrite`.
 
 use core.libc
 use aster_ml.uop.ops
 
 const UPAT_ANY_OP is i32 = 0
+const UPAT_ANY_SRC is usize = 0xffffffffffffffff   # nsrc: any sources (not matched)
+const UPAT_BYTES is usize = 64   # sizeof(UPat) on 64-bit
 
 struct UPat
     var op is i32            # 0 => any op
@@ -19,6 +24,7 @@ struct UPat
     var arg0 is u64
     var has_arg1 is i32
     var arg1 is u64
+    var dtype is i32         # DT_INVALID (0) => any dtype
 
 
 struct Bindings
@@ -63,6 +69,7 @@ def upat_init(out is mut ref UPat, op is i32, bind is i32) returns ()
     (*out).arg0 = 0
     (*out).has_arg1 = 0
     (*out).arg1 = 0
+    (*out).dtype = 0
     return
 
 
@@ -94,6 +101,8 @@ def upat_match(pat is mut ref UPat, node is MutString, b is mut ref Bindings) re
 
     if (*pat).op != UPAT_ANY_OP and (*pat).op != (*u).op then
         return 0
+    if (*pat).dtype != 0 and (*pat).dtype != (*u).dtype then
+        return 0
     if (*pat).has_arg0 != 0 and (*pat).arg0 != (*u).arg0 then
         return 0
     if (*pat).has_arg1 != 0 and (*pat).arg1 != (*u).arg1 then
@@ -110,6 +119,8 @@ def upat_match(pat is mut ref UPat, node is MutString, b is mut ref Bindings) re
             if cur != node then
                 return 0
 
+    if (*pat).nsrc == UPAT_ANY_SRC then
+        return 1
     if (*pat).nsrc != (*u).nsrc then
         return 0
     if (*pat).nsrc == 0 then
@@ -0,0 +1,191 @@
+# core.arena: bump allocation for short-lived scratch memory.
+#
+# An Arena hands out memory from a chain of chunks:
+# - `arena_alloc` is a pointer bump within the current chunk; a new chunk
+#   (at least twice the previous size, up to ARENA_MAX_GROW) is chained on
+#   when the current one is full. Nothing is freed individually.
+# - `arena_mark` / `arena_reset_to` bracket a scope: everything allocated
+#   after the mark is released, chunks chained on since are freed.
+# - `arena_reset` releases everything and coalesces the chain into a single
+#   chunk, so a reused arena settles into one malloc.
+# - `arena_tls` returns the calling thread's scratch arena (runtime helper
+#   `tools/build/out/arena_rt.o`, auto-linked on import). It is freed at thread
+#   exit; callers must leave it as they found it (mark + reset_to).
+#
+# `noalloc` functions may allocate from an arena the caller passes in (see
+# docs/spec/memory_effects_ffi.md); creating or resetting one still counts as
+# allocation.
+#
+# Alignments must be powers of two no larger than ARENA_MAX_ALIGN (0 means 1);
+# `arena_alloc` returns null for any other alignment.
+
+use core.libc
+
+extern def posix_memalign(out is mut ref MutString, align is usize, n is usize) returns i32
+extern def memset(p is MutString, c is i32, n is usize) returns MutString
+extern def aster_arena_tls() returns MutString
+
+const ARENA_HDR is usize = 64            # chunk header: prev chunk, chunk size (padded)
+const ARENA_MAX_ALIGN is usize = 64
+const ARENA_MIN_CHUNK is usize = 4096
+const ARENA_MAX_GROW is usize = 67108864
+const ARENA_TLS_CHUNK is usize = 65536
+
+
+struct Arena
+    # `base`/`cap`/`off` keep the asm runtime layout (asm/macros/arena.inc).
+    var base is MutString   # current chunk (header + data), null before the first chunk
+    var cap is usize        # current chunk size in bytes
+    var off is usize        # bump offset within the current chunk
+    var chunk is usize      # minimum size of the next chunk (0 = uninitialized)
+    var nchunks is usize
+
+
+struct ArenaMark
+    var base is MutString
+    var off is usize
+
+
+def arena_chunk_push(a is mut ref Arena, need is usize) returns i32
+    # Chain on a chunk with at least `need` bytes after the header.
+    var size is usize = (*a).chunk
+    while size < need + ARENA_HDR do
+        size = size * 2
+    var p is MutString = null
+    if posix_memalign(&p, ARENA_MAX_ALIGN, size) != 0 then
+        return 1
+    var link is slice of MutString = p
+    var sizes is slice of usize = p
+    link[0] = (*a).base
+    sizes[1] = size
+    (*a).base = p
+    (*a).cap = size
+    (*a).off = ARENA_HDR
+    (*a).nchunks = (*a).nchunks + 1
+    if (*a).chunk < ARENA_MAX_GROW then
+        (*a).chunk = (*a).chunk * 2
+    return 0
+
+
+def arena_chunk_pop(a is mut ref Arena) returns ()
+    # Free the current chunk and make its predecessor current (full).
+    var link is slice of MutString = (*a).base
+    var prev is MutString = link[0]
+    free((*a).base)
+    (*a).base = prev
+    (*a).nchunks = (*a).nchunks - 1
+    (*a).cap = 0
+    (*a).off = 0
+    if prev is not null then
+        var sizes is slice of usize = prev
+        (*a).cap = sizes[1]
+        (*a).off = sizes[1]
+    return
+
+
+def arena_init(a is mut ref Arena, chunk is usize) returns i32
+    # Allocates the first chunk (`chunk` bytes, rounded up to ARENA_MIN_CHUNK).
+    (*a).base = null
+    (*a).cap = 0
+    (*a).off = 0
+    (*a).nchunks = 0
+    (*a).chunk = ARENA_MIN_CHUNK
+    while (*a).chunk < chunk do
+        (*a).chunk = (*a).chunk * 2
+    var first is usize = (*a).chunk
+    if arena_chunk_push(a, first - ARENA_HDR) != 0 then
+        return 1
+    # Keep the first chunk size as the growth base.
+    (*a).chunk = first
+    return 0
+
+
+def arena_free(a is mut ref Arena) returns ()
+    while (*a).base is not null do
+        arena_chunk_pop(a)
+    (*a).chunk = 0
+    return
+
+
+def arena_alloc_slow(a is mut ref Arena, n is usize) returns MutString
+    if (*a).chunk == 0 then
+        return null
+    if arena_chunk_push(a, n) != 0 then
+        return null
+    # ARENA_HDR is a multiple of every supported alignment.
+    (*a).off = ARENA_HDR + n
+    return (*a).base + ARENA_HDR
+
+
+def arena_alloc(a is mut ref Arena, n is usize, align is usize) returns MutString
+    # `n` bytes aligned to `align` (0 means 1), or null on allocation failure
+    # or if `align` is not a power of two up to ARENA_MAX_ALIGN.
+    var al is usize = align
+    if al == 0 then
+        al = 1
+    if al > ARENA_MAX_ALIGN or (al & (al - 1)) != 0 then
+        return null
+    var at is usize = ((*a).off + al - 1) & (0 - al)
+    if at + n > (*a).cap then
+        return arena_alloc_slow(a, n)
+    (*a).off = at + n
+    return (*a).base + at
+
+
+def arena_alloc_zeroed(a is mut ref Arena, n is usize, align is usize) returns MutString
+    var p is MutString = arena_alloc(a, n, align)
+    if p is not null then
+        memset(p, 0, n)
+    return p
+
+
+def arena_mark(a is mut ref Arena, m is mut ref ArenaMark) returns ()
+    (*m).base = (*a).base
+    (*m).off = (*a).off
+    return
+
+
+def arena_reset_to(a is mut ref Arena, m is mut ref ArenaMark) returns ()
+    # Release everything allocated since `arena_mark`.
+    while (*a).base is not null and (*a).base != (*m).base do
+        arena_chunk_pop(a)
+    (*a).off = (*m).off
+    return
+
+
+def arena_reset(a is mut ref Arena) returns ()
+    # Release everything. A chained arena is coalesced into one chunk sized
+    # for the whole chain so the next cycle does not chain again.
+    if (*a).nchunks <= 1 then
+        if (*a).base is not null then
+            (*a).off = ARENA_HDR
+        return
+    var total is usize = 0
+    while (*a).base is not null do
+        total = total + (*a).cap
+        arena_chunk_pop(a)
+    (*a).chunk = ARENA_MIN_CHUNK
+    while (*a).chunk < total do
+        (*a).chunk = (*a).chunk * 2
+    var first is usize = (*a).chunk
+    # On failure the arena is empty but usable: the next alloc retries.
+    if arena_chunk_push(a, first - ARENA_HDR) == 0 then
+        (*a).chunk = first
+    return
+
+
+def arena_used(a is mut ref Arena) returns usize
+    # Bytes handed out from the current chunk (diagnostics).
+    if (*a).base is null then
+        return 0
+    return (*a).off - ARENA_HDR
+
+
+def arena_tls() returns MutString
+    # The calling thread's scratch arena (a `mut ref Arena`), initialized on
+    # first use.
+    var a is mut ref Arena = aster_arena_tls()
+    if (*a).chunk == 0 then
+        if arena_init(a, ARENA_TLS_CHUNK) != 0 then
+            (*a).chunk = ARENA_TLS_CHUNK
+    return a
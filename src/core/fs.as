@@ -1,4 +1,7 @@
 # core.fs: filesystem traversal + attribute helpers (macOS-first).
+#
+# Memory-mapped file access lives in core.mmap, which also builds on Linux
+# (the traversal helpers here rely on macOS-only constants and structs).
 
 # Path-based metadata
 extern def stat(path is String, st is mut ref Stat) returns i32
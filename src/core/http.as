@@ -5,6 +5,7 @@
 
 use core.libc
 use core.net
+use core.str
 
 const HTTP_TLS_PORT is u16 = 443
 const HTTP_TIMEOUT_MS is i32 = 15000
@@ -143,14 +144,11 @@ def http_eq_ci(a is u8, b is u8) returns i32
 
 
 def http_starts_with_ci(s is String, n is usize, prefix is String, pn is usize) returns i32
-    if n < pn then
-        return 0
-    var i is usize = 0
-    while i < pn do
-        if http_eq_ci(s[i], prefix[i]) == 0 then
-            return 0
-        i = i + 1
-    return 1
+    var hs is Str
+    str_init(&hs, s, n)
+    var ps is Str
+    str_init(&ps, prefix, pn)
+    return str_starts_with_ci(&hs, &ps)
 
 
 def http_contains_chunked(value is String, n is usize) returns i32
@@ -275,60 +273,55 @@ def http_send_post(tls is ptr of void, host is String, path is String, accept_ss
 
 
 def http_parse_headers(s is mut ref HttpStream) returns i32
-    # Fill until we see \r\n\r\n (or \n\n).
+    # Fill until we see \r\n\r\n.
+    var crlf2 is Str
+    str_init(&crlf2, "\r\n\r\n", 4)
+    # Bytes after pos already searched (refills may compact the buffer, so
+    # this is relative to pos); the last 3 are searched again in case the
+    # terminator straddles a refill.
+    var done is usize = 0
     while 1 do
-        # Scan current buffer.
-        var i is usize = (*s).pos
-        while i + 3 < (*s).len do
-            if (*s).buf[i] == 13 and (*s).buf[i + 1] == 10 and (*s).buf[i + 2] == 13 and (*s).buf[i + 3] == 10 then
-                # header end at i+4
-                var hdr_end is usize = i + 4
-                # Parse line-by-line from start of headers to hdr_end.
-                var p is usize = 0
-                var line_no is i32 = 0
-                while p < hdr_end do
-                    # find end of line
-                    var q is usize = p
-                    while q < hdr_end and (*s).buf[q] != 10 do
-                        q = q + 1
-                    var line_len is usize = 0
-                    if q > p and (*s).buf[q - 1] == 13 then
-                        line_len = (q - 1) - p
-                    else
-                        line_len = q - p
-
-                    if line_no == 0 then
-                        (*s).status = http_parse_status_line((*s).buf + p, line_len)
-                    else
-                        # "Name: value"
-                        var k is usize = 0
-                        while k < line_len and (*s).buf[p + k] != 58 do
-                            k = k + 1
-                        if k < line_len then
-                            var name is String = (*s).buf + p
-                            var name_len is usize = k
-                            var val is String = (*s).buf + p + k + 1
-                            var val_len is usize = line_len - (k + 1)
-                            # trim leading spaces
-                            while val_len > 0 and (val[0] == 32 or val[0] == 9) do
-                                val = val + 1
-                                val_len = val_len - 1
-
-                            if http_starts_with_ci(name, name_len, "Transfer-Encoding", 17) != 0 then
-                                if http_contains_chunked(val, val_len) != 0 then
-                                    (*s).chunked = 1
-                            if http_starts_with_ci(name, name_len, "Content-Length", 14) != 0 then
-                                var n64 is u64 = http_parse_u64_dec(val, val_len)
-                                (*s).content_rem = n64
-                    line_no = line_no + 1
-                    if q >= hdr_end then
-                        break
-                    p = q + 1
-
-                # Advance pos to body start.
-                (*s).pos = hdr_end
-                return 0
-            i = i + 1
+        var avail is Str
+        str_init(&avail, (*s).buf + (*s).pos + done, (*s).len - (*s).pos - done)
+        var at is usize = str_find(&avail, &crlf2)
+        if at != STR_NPOS then
+            var hdr_end is usize = (*s).pos + done + at + 4
+            # Parse line-by-line from start of headers to hdr_end.
+            var rest is Str
+            str_init(&rest, (*s).buf, hdr_end)
+            var line is Str
+            var line_no is i32 = 0
+            while str_split_next(&rest, 10, &line) != 0 do
+                if line.len > 0 and line.data[line.len - 1] == 13 then
+                    line.len = line.len - 1
+                if line_no == 0 then
+                    (*s).status = http_parse_status_line(line.data, line.len)
+                else
+                    # "Name: value"
+                    var k is usize = str_find_byte(&line, 58)
+                    if k != STR_NPOS then
+                        var name is String = line.data
+                        var name_len is usize = k
+                        var val is String = line.data + k + 1
+                        var val_len is usize = line.len - (k + 1)
+                        # trim leading spaces
+                        while val_len > 0 and (val[0] == 32 or val[0] == 9) do
+                            val = val + 1
+                            val_len = val_len - 1
+
+                        if http_starts_with_ci(name, name_len, "Transfer-Encoding", 17) != 0 then
+                            if http_contains_chunked(val, val_len) != 0 then
+                                (*s).chunked = 1
+                        if http_starts_with_ci(name, name_len, "Content-Length", 14) != 0 then
+                            var n64 is u64 = http_parse_u64_dec(val, val_len)
+                            (*s).content_rem = n64
+                line_no = line_no + 1
+
+            # Advance pos to body start.
+            (*s).pos = hdr_end
+            return 0
+        if avail.len > 3 then
+            done = done + avail.len - 3
         # Need more bytes.
         if http_fill(s) != 0 then
             return 1
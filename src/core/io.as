@@ -1,4 +1,67 @@
+# core.io: printing helpers and a buffered fd writer.
+#
+# `println` / `print_u64` go through stdio (`printf`) and are fine for a few
+# lines. High-volume output (logs, CSV) should use a Writer:
+# - A Writer owns a byte buffer for one fd and calls write(2) only when the
+#   buffer fills or on `writer_flush`; there is no stdio locking and no format
+#   string parsing (`writer_write_u64/i64/f64` format digits directly).
+# - Writers are not shared: give each thread its own and flush explicitly.
+#   `writer_flush_many` drains several writers on the same fd with one
+#   writev(2) per IO_IOV_MAX buffers (e.g. per-thread writers at a barrier).
+# - Payloads at least as large as the buffer bypass it: the buffered bytes
+#   and the payload go out together in one writev(2).
+# - Errors are sticky: after a failed write `err` is set, later writes are
+#   dropped and every call returns 1. Output buffered in a Writer is lost if
+#   it is not flushed (`writer_close` flushes and frees).
+#
+# Do not mix a Writer on fd 1 with `println` without flushing in between:
+# the two buffers are independent.
+#
+# Input goes through a Reader:
+# - Buffered mode refills a chunk at a time with read(2) (files, pipes,
+#   stdin); the unread tail is moved to the front before each refill and the
+#   buffer doubles when one record does not fit.
+# - Mapped mode (`reader_open_mmap`) maps a whole regular file read-only
+#   through core.mmap and never copies or refills.
+# - `reader_next_line` / `reader_next_record` return borrowed core.str views
+#   into the buffer (no copy; valid until the next Reader call). Separator
+#   search is core.str's vectorized byte find, resumed where the previous
+#   search stopped after a refill.
+
 use core.libc
+use core.mmap
+use core.str
+
+extern def writev(fd is i32, iov is MutString, iovcnt is i32) returns isize
+
+const IO_WRITER_CAP is usize = 65536
+const IO_IOV_MAX is usize = 64
+const IO_NUM_MAX is usize = 24          # longest u64/i64 rendering, rounded up
+const IO_RESERVE_MAX is usize = 40      # largest writer_reserve: an f64 (sign, digits, '.', fraction)
+const IO_READER_CAP is usize = 65536
+
+const IO_O_RDONLY is i32 = 0
+
+
+struct Writer
+    var fd is i32
+    var err is i32
+    var buf is MutString
+    var len is usize
+    var cap is usize
+
+
+struct Reader
+    var fd is i32
+    var owns_fd is i32
+    var mapped is i32       # buf is a read-only mapping of the whole file
+    var eof is i32
+    var err is i32
+    var buf is MutString
+    var cap is usize        # buffer size (mapping size when mapped)
+    var pos is usize        # first unread byte
+    var len is usize        # end of valid bytes
+
 
 def println(s is String) returns ()
     printf("%s\n", s)
@@ -8,3 +71,479 @@ def println(s is String) returns ()
 def print_u64(x is u64) returns ()
     printf("%llu\n", x)
     return
+
+
+# -----------------------------
+# Writer
+# -----------------------------
+
+def writer_init(w is mut ref Writer, fd is i32, cap is usize) returns i32
+    # `cap` 0 selects IO_WRITER_CAP; other caps are raised to at least
+    # IO_RESERVE_MAX so any single number fits. Returns 1 on allocation
+    # failure.
+    (*w).fd = fd
+    (*w).err = 0
+    (*w).len = 0
+    (*w).cap = cap
+    if (*w).cap == 0 then
+        (*w).cap = IO_WRITER_CAP
+    if (*w).cap < IO_RESERVE_MAX then
+        (*w).cap = IO_RESERVE_MAX
+    (*w).buf = malloc((*w).cap)
+    if (*w).buf is null then
+        (*w).cap = 0
+        (*w).err = 1
+        return 1
+    return 0
+
+
+def writer_write_all(fd is i32, p is String, n is usize) returns i32
+    # write(2) until every byte is out (short writes are retried).
+    var off is usize = 0
+    while off < n do
+        var k is isize = write(fd, p + off, n - off)
+        if k <= 0 then
+            return 1
+        var uk is usize = k
+        off = off + uk
+    return 0
+
+
+def writer_flush(w is mut ref Writer) returns i32
+    if (*w).err != 0 then
+        return 1
+    if (*w).len == 0 then
+        return 0
+    var n is usize = (*w).len
+    (*w).len = 0
+    if writer_write_all((*w).fd, (*w).buf, n) != 0 then
+        (*w).err = 1
+        return 1
+    return 0
+
+
+def writer_close(w is mut ref Writer) returns i32
+    # Flushes, frees the buffer and returns the sticky error state.
+    var rc is i32 = writer_flush(w)
+    if (*w).buf is not null then
+        free((*w).buf)
+    (*w).buf = null
+    (*w).cap = 0
+    return rc
+
+
+def writer_writev_all(fd is i32, iov is MutString, cnt is usize) returns i32
+    # writev(2) an iovec array to completion, advancing past partial writes.
+    var v is slice of usize = iov
+    var first is usize = 0
+    while first < cnt do
+        var c is i32 = cnt - first
+        var k is isize = writev(fd, iov + first * 16, c)
+        if k <= 0 then
+            return 1
+        var left is usize = k
+        while first < cnt and left >= v[first * 2 + 1] do
+            left = left - v[first * 2 + 1]
+            first = first + 1
+        if first < cnt and left != 0 then
+            v[first * 2] = v[first * 2] + left
+            v[first * 2 + 1] = v[first * 2 + 1] - left
+    return 0
+
+
+def writer_write_large(w is mut ref Writer, p is String, n is usize) returns i32
+    # Buffered bytes + payload in one writev(2), without copying the payload.
+    var iov is MutString = malloc(32)
+    if iov is null then
+        if writer_flush(w) != 0 then
+            return 1
+        if writer_write_all((*w).fd, p, n) != 0 then
+            (*w).err = 1
+            return 1
+        return 0
+    var v is slice of MutString = iov
+    var lens is slice of usize = iov
+    v[0] = (*w).buf
+    lens[1] = (*w).len
+    v[2] = p
+    lens[3] = n
+    (*w).len = 0
+    var rc is i32 = writer_writev_all((*w).fd, iov, 2)
+    free(iov)
+    if rc != 0 then
+        (*w).err = 1
+    return rc
+
+
+def writer_write(w is mut ref Writer, p is String, n is usize) returns i32
+    if (*w).err != 0 then
+        return 1
+    if (*w).len + n <= (*w).cap then
+        if n != 0 then
+            memcpy((*w).buf + (*w).len, p, n)
+        (*w).len = (*w).len + n
+        return 0
+    if n >= (*w).cap then
+        return writer_write_large(w, p, n)
+    if writer_flush(w) != 0 then
+        return 1
+    memcpy((*w).buf, p, n)
+    (*w).len = n
+    return 0
+
+
+def writer_write_cstr(w is mut ref Writer, s is String) returns i32
+    return writer_write(w, s, strlen(s))
+
+
+def writer_write_u8(w is mut ref Writer, c is u8) returns i32
+    if (*w).len == (*w).cap then
+        if writer_flush(w) != 0 then
+            return 1
+    if (*w).err != 0 then
+        return 1
+    var b is slice of u8 = (*w).buf
+    b[(*w).len] = c
+    (*w).len = (*w).len + 1
+    return 0
+
+
+def writer_reserve(w is mut ref Writer, n is usize) returns i32
+    # Room for `n` (<= IO_RESERVE_MAX) more contiguous bytes in the buffer;
+    # returns 1 if the buffer can never hold that many.
+    if (*w).err != 0 then
+        return 1
+    if n > (*w).cap then
+        return 1
+    if (*w).len + n > (*w).cap then
+        return writer_flush(w)
+    return 0
+
+
+def io_u64_digits(x is u64) returns usize
+    var n is usize = 1
+    var v is u64 = x
+    while v >= 10000 do
+        v = v / 10000
+        n = n + 4
+    if v >= 100 then
+        if v >= 1000 then
+            return n + 3
+        return n + 2
+    if v >= 10 then
+        return n + 1
+    return n
+
+
+def io_put_u64(dst is MutString, x is u64) returns usize
+    # Decimal digits of `x` at dst (two per step from a pair table); returns
+    # the length.
+    var pairs is String = "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899"
+    var b is slice of u8 = dst
+    var n is usize = io_u64_digits(x)
+    var i is usize = n
+    var v is u64 = x
+    while v >= 100 do
+        var r is u64 = v - (v / 100) * 100
+        v = v / 100
+        b[i - 1] = pairs[r * 2 + 1]
+        b[i - 2] = pairs[r * 2]
+        i = i - 2
+    if v >= 10 then
+        b[i - 1] = pairs[v * 2 + 1]
+        b[i - 2] = pairs[v * 2]
+    else
+        b[i - 1] = 48 + v
+    return n
+
+
+def writer_write_u64(w is mut ref Writer, x is u64) returns i32
+    if writer_reserve(w, IO_NUM_MAX) != 0 then
+        return 1
+    (*w).len = (*w).len + io_put_u64((*w).buf + (*w).len, x)
+    return 0
+
+
+def writer_write_i64(w is mut ref Writer, x is i64) returns i32
+    if writer_reserve(w, IO_NUM_MAX) != 0 then
+        return 1
+    var mag is u64 = x
+    if x < 0 then
+        var b is slice of u8 = (*w).buf
+        b[(*w).len] = 45
+        (*w).len = (*w).len + 1
+        mag = 0 - mag
+    (*w).len = (*w).len + io_put_u64((*w).buf + (*w).len, mag)
+    return 0
+
+
+def writer_write_f64(w is mut ref Writer, x is f64, prec is usize) returns i32
+    # Fixed notation with `prec` (<= 9) fraction digits, rounded half away
+    # from zero on the scaled binary value. Magnitudes of 1e18 and above print
+    # their integer part's leading digits in scientific form (d.ddde+XX).
+    if writer_reserve(w, IO_RESERVE_MAX) != 0 then
+        return 1
+    var b is slice of u8 = (*w).buf
+    if x != x then
+        return writer_write(w, "nan", 3)
+    var v is f64 = x
+    # -0.0 keeps its sign, like printf.
+    if v < 0.0 or (v == 0.0 and 1.0 / v < 0.0) then
+        b[(*w).len] = 45
+        (*w).len = (*w).len + 1
+        v = 0.0 - v
+    if v - v != 0.0 then
+        return writer_write(w, "inf", 3)
+    var p is usize = prec
+    if p > 9 then
+        p = 9
+    if v >= 1000000000000000000.0 then
+        var e is u64 = 0
+        while v >= 10.0 do
+            v = v / 10.0
+            e = e + 1
+        if writer_write_f64(w, v, p) != 0 then
+            return 1
+        if writer_write(w, "e+", 2) != 0 then
+            return 1
+        return writer_write_u64(w, e)
+    var scale is u64 = 1
+    var i is usize = 0
+    while i < p do
+        scale = scale * 10
+        i = i + 1
+    # v < 1e18: the integer part is exact and so is the fraction left over.
+    var ip is u64 = v
+    var ipf is f64 = ip
+    var sf is f64 = scale
+    var fp is u64 = (v - ipf) * sf + 0.5
+    if fp >= scale then
+        ip = ip + 1
+        fp = fp - scale
+    (*w).len = (*w).len + io_put_u64((*w).buf + (*w).len, ip)
+    if p == 0 then
+        return 0
+    b[(*w).len] = 46
+    var at is usize = (*w).len + 1 + p
+    i = 0
+    while i < p do
+        var d is u64 = fp - (fp / 10) * 10
+        fp = fp / 10
+        b[at - 1 - i] = 48 + d
+        i = i + 1
+    (*w).len = at
+    return 0
+
+
+def writer_flush_many(ws is slice of MutString, n is usize) returns i32
+    # Drains `n` writers (`mut ref Writer` each) that share the first one's fd,
+    # in order, with one writev(2) per IO_IOV_MAX non-empty buffers. A failed
+    # writev marks every writer failed.
+    if n == 0 then
+        return 0
+    var iov is MutString = malloc(IO_IOV_MAX * 16)
+    if iov is null then
+        var rc0 is i32 = 0
+        var j is usize = 0
+        while j < n do
+            var wj is mut ref Writer = ws[j]
+            if writer_flush(wj) != 0 then
+                rc0 = 1
+            j = j + 1
+        return rc0
+    var v is slice of MutString = iov
+    var lens is slice of usize = iov
+    var w0 is mut ref Writer = ws[0]
+    var fd is i32 = (*w0).fd
+    var rc is i32 = 0
+    var failed is i32 = 0
+    var i is usize = 0
+    while i < n and failed == 0 do
+        var cnt is usize = 0
+        while i < n and cnt < IO_IOV_MAX do
+            var w is mut ref Writer = ws[i]
+            if (*w).err != 0 then
+                rc = 1
+            else if (*w).len != 0 then
+                v[cnt * 2] = (*w).buf
+                lens[cnt * 2 + 1] = (*w).len
+                (*w).len = 0
+                cnt = cnt + 1
+            i = i + 1
+        if cnt != 0 then
+            failed = writer_writev_all(fd, iov, cnt)
+    free(iov)
+    if failed != 0 then
+        var k is usize = 0
+        while k < n do
+            var wk is mut ref Writer = ws[k]
+            (*wk).err = 1
+            k = k + 1
+        return 1
+    return rc
+
+
+# -----------------------------
+# Reader
+# -----------------------------
+
+def reader_init_fd(r is mut ref Reader, fd is i32, cap is usize) returns i32
+    # Buffered reader over an open fd (not closed by `reader_close`).
+    # `cap` 0 selects IO_READER_CAP. Returns 1 on allocation failure.
+    (*r).fd = fd
+    (*r).owns_fd = 0
+    (*r).mapped = 0
+    (*r).eof = 0
+    (*r).err = 0
+    (*r).pos = 0
+    (*r).len = 0
+    (*r).cap = cap
+    if (*r).cap == 0 then
+        (*r).cap = IO_READER_CAP
+    (*r).buf = malloc((*r).cap)
+    if (*r).buf is null then
+        (*r).cap = 0
+        (*r).err = 1
+        return 1
+    return 0
+
+
+def reader_open(r is mut ref Reader, path is String, cap is usize) returns i32
+    # Buffered reader over a file. Returns 1 if it cannot be opened.
+    var fd is i32 = open(path, IO_O_RDONLY)
+    if fd < 0 then
+        (*r).buf = null
+        (*r).fd = 0 - 1
+        (*r).err = 1
+        return 1
+    if reader_init_fd(r, fd, cap) != 0 then
+        close(fd)
+        return 1
+    (*r).owns_fd = 1
+    return 0
+
+
+def reader_open_mmap(r is mut ref Reader, path is String) returns i32
+    # Maps a regular file read-only (sequential access hint). Files that
+    # cannot be mapped (pipes, special files) fall back to buffered mode.
+    var fd is i32 = open(path, IO_O_RDONLY)
+    if fd < 0 then
+        (*r).buf = null
+        (*r).fd = 0 - 1
+        (*r).err = 1
+        return 1
+    var fm is FileMap
+    if fmap_open_fd(&fm, fd, FMAP_READ) != 0 then
+        if reader_init_fd(r, fd, 0) != 0 then
+            close(fd)
+            return 1
+        (*r).owns_fd = 1
+        return 0
+    close(fd)
+    fmap_advise(&fm, FMAP_SEQUENTIAL)
+    (*r).fd = 0 - 1
+    (*r).owns_fd = 0
+    (*r).mapped = 1
+    (*r).eof = 1
+    (*r).err = 0
+    (*r).buf = fm.data
+    (*r).cap = fm.len
+    (*r).pos = 0
+    (*r).len = fm.len
+    return 0
+
+
+def reader_close(r is mut ref Reader) returns ()
+    if (*r).buf is not null then
+        if (*r).mapped != 0 then
+            var fm is FileMap
+            fm.data = (*r).buf
+            fm.len = (*r).cap
+            fmap_close(&fm)
+        else
+            free((*r).buf)
+    if (*r).owns_fd != 0 then
+        close((*r).fd)
+    (*r).buf = null
+    (*r).cap = 0
+    (*r).pos = 0
+    (*r).len = 0
+    (*r).owns_fd = 0
+    return
+
+
+def reader_fill(r is mut ref Reader) returns i32
+    # Reads more bytes after the unread tail (moved to the front first; the
+    # buffer doubles when the tail already fills it). Returns 0 if bytes were
+    # added, 1 at end of input or on error (`err` set).
+    if (*r).eof != 0 or (*r).err != 0 then
+        return 1
+    var tail is usize = (*r).len - (*r).pos
+    if (*r).pos != 0 then
+        if tail != 0 then
+            memmove((*r).buf, (*r).buf + (*r).pos, tail)
+        (*r).pos = 0
+        (*r).len = tail
+    if tail == (*r).cap then
+        var nb is MutString = malloc((*r).cap * 2)
+        if nb is null then
+            (*r).err = 1
+            return 1
+        memcpy(nb, (*r).buf, tail)
+        free((*r).buf)
+        (*r).buf = nb
+        (*r).cap = (*r).cap * 2
+    var k is isize = read((*r).fd, (*r).buf + (*r).len, (*r).cap - (*r).len)
+    if k < 0 then
+        (*r).err = 1
+        return 1
+    if k == 0 then
+        (*r).eof = 1
+        return 1
+    var uk is usize = k
+    (*r).len = (*r).len + uk
+    return 0
+
+
+def reader_next_record(r is mut ref Reader, sep is u8, rec is mut ref Str) returns i32
+    # Next `sep`-terminated record as a borrowed view (without `sep`); a final
+    # unterminated record is returned as is. Returns 0 at end of input.
+    var scanned is usize = 0
+    while 1 do
+        var avail is usize = (*r).len - (*r).pos
+        var at is String = (*r).buf + (*r).pos
+        var i is usize = aster_str_find_byte(at + scanned, avail - scanned, sep) + scanned
+        if i < avail then
+            (*rec).data = at
+            (*rec).len = i
+            (*r).pos = (*r).pos + i + 1
+            return 1
+        scanned = avail
+        if reader_fill(r) != 0 then
+            break
+    var rest is usize = (*r).len - (*r).pos
+    if rest == 0 then
+        (*rec).data = null
+        (*rec).len = 0
+        return 0
+    (*rec).data = (*r).buf + (*r).pos
+    (*rec).len = rest
+    (*r).pos = (*r).len
+    return 1
+
+
+def reader_next_line(r is mut ref Reader, line is mut ref Str) returns i32
+    # Next line without its "\n" (a trailing "\r" is kept).
+    return reader_next_record(r, 10, line)
+
+
+def reader_next_bytes(r is mut ref Reader, n is usize, out is mut ref Str) returns i32
+    # Next `n` bytes as a borrowed view (fixed-size binary records). Returns
+    # 0 if fewer than `n` bytes remain (they are left unread).
+    while (*r).len - (*r).pos < n do
+        if reader_fill(r) != 0 then
+            return 0
+    (*out).data = (*r).buf + (*r).pos
+    (*out).len = n
+    (*r).pos = (*r).pos + n
+    return 1
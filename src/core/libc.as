@@ -3,7 +3,11 @@
 # IO
 extern def printf(fmt is String) returns i32
 extern def write(fd is i32, buf is String, n is usize) returns isize
+extern def read(fd is i32, buf is MutString, n is usize) returns isize
+extern def open(path is String, flags is i32) returns i32
+extern def close(fd is i32) returns i32
 extern def strlen(s is String) returns usize
+extern def strcmp(a is String, b is String) returns i32
 extern def exit(code is i32) returns ()
 
 # C stdio
@@ -16,6 +20,7 @@ extern def fclose(fp is File) returns i32
 # Memory
 extern def malloc(n is usize) returns MutString
 extern def free(ptr is MutString) returns ()
+extern def memmove(dst is MutString, src is String, n is usize) returns MutString
 
 # Env
 extern def getenv(name is String) returns String
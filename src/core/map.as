@@ -0,0 +1,539 @@
+# core.map: SwissTable-style open-addressing hash maps.
+#
+# Two specializations (Aster has no generics yet):
+# - MapU64: u64 -> u64
+# - MapStr: String -> u64 (keys are borrowed NUL-terminated strings; the map
+#   stores the pointer and its hash, never a copy)
+#
+# Layout:
+# - Slots are grouped by 8. Each group has one u64 control word holding one
+#   control byte per slot: EMPTY (0x80), MOVED (0xFE), or the low 7 hash bits
+#   (H2) of a full slot. The remaining hash bits (H1) pick the home group.
+# - A probe loads one control word and matches all 8 bytes at once (SWAR
+#   byte compare), so most misses touch a single cache line of metadata.
+# - Groups are probed linearly from the home group. Every group between an
+#   element's home group and its actual group is full, which is what lets a
+#   probe stop at the first group with an EMPTY byte.
+#
+# Deletion is tombstone-free: if the slot's group still has an EMPTY byte the
+# slot is simply cleared; otherwise elements further along the probe chain are
+# shifted back into the hole (backward-shift deletion).
+#
+# Growth is incremental: past 7/8 load a table of twice the size is
+# allocated and every later mutation migrates MAP_MIGRATE_GROUPS groups of
+# the retiring table. Until migration finishes, lookups check the new table
+# then the old one. Migrated (and deleted-while-retiring) old slots are marked
+# MOVED so old-table probe chains stay intact; the retiring table is freed
+# once every group is migrated, so MOVED never appears in a live table.
+# Groups below the migration cursor hold no live entries, so old-table probes
+# start at max(home group, cursor) and skip them when wrapping: a miss costs
+# the same during migration as after it.
+#
+# All functions that allocate return 0 on success and 1 on allocation failure.
+#
+# This is not a wrapper over the assembly runtime map (asm/runtime/hash.S,
+# `aster_rt__map_*`). That map is linked into the compiler binary, not into
+# Aster programs. Its capacity is fixed (no growth, no removal), key 0 is
+# reserved, and it hashes a key by its low bits, so pointer and strided keys
+# pile into a few chains. Its x86_64 version also uses r12-r15 without saving
+# them, so compiled code cannot call it as-is.
+
+use core.libc
+
+const MAP_GROUP is usize = 8
+const MAP_MIN_GROUPS is usize = 2
+const MAP_MIGRATE_GROUPS is usize = 4
+const MAP_NONE is usize = 0xFFFFFFFFFFFFFFFF
+
+const MAP_CTRL_EMPTY is u64 = 0x80
+const MAP_CTRL_MOVED is u64 = 0xFE
+const MAP_WORD_EMPTY is u64 = 0x8080808080808080
+const MAP_WORD_MOVED is u64 = 0xFEFEFEFEFEFEFEFE
+const MAP_LSB is u64 = 0x0101010101010101
+const MAP_MSB is u64 = 0x8080808080808080
+const MAP_ONES is u64 = 0xFFFFFFFFFFFFFFFF
+
+
+# ---- hashing ----
+
+def map_hash_u64(x is u64) returns u64
+    # splitmix64 finalizer: every output bit depends on every input bit, so
+    # keys that only differ in high bits still spread over H1 and H2.
+    var z is u64 = x
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb
+    return z ^ (z >> 31)
+
+
+def map_hash_str(s is String) returns u64
+    # FNV-1a over the bytes, then the u64 finalizer to fix its weak low bits.
+    var h is u64 = 1469598103934665603
+    var p is String = s
+    while p[0] != 0 do
+        h = h ^ p[0]
+        h = h * 1099511628211
+        p = p + 1
+    return map_hash_u64(h)
+
+
+# ---- control words (8 control bytes per u64) ----
+
+def map_ctrl_match(w is u64, h2 is u64) returns u64
+    # High bit set in every byte equal to h2. May report a false positive in
+    # a full byte directly above a real match (borrow), never in EMPTY/MOVED
+    # bytes; callers compare keys anyway.
+    var x is u64 = w ^ (h2 * MAP_LSB)
+    return (x - MAP_LSB) & (x ^ MAP_ONES) & MAP_MSB
+
+
+def map_ctrl_empty(w is u64) returns u64
+    # High bit set in every EMPTY byte (0x80: bit 7 set, bit 6 clear). Exact.
+    return w & ((w << 1) ^ MAP_ONES) & MAP_MSB
+
+
+def map_ctrl_full(w is u64) returns u64
+    return (w & MAP_MSB) ^ MAP_MSB
+
+
+def map_ctrl_first(m is u64) returns usize
+    # Index of the lowest flagged byte in a non-zero match mask.
+    var low is u64 = m & (0 - m)
+    return ((low >> 7) * 0x0001020304050607) >> 56
+
+
+def map_ctrl_set(w is u64, slot is usize, b is u64) returns u64
+    var sh is u64 = slot * 8
+    return (w & ((0xFF << sh) ^ MAP_ONES)) | (b << sh)
+
+
+# ---- one table (shared by both specializations) ----
+
+struct MapTab
+    var ctrl is MutString    # `slice of u64`, one control word per group
+    var keys is MutString    # `slice of u64` (u64 key or String pointer)
+    var vals is MutString    # `slice of u64`
+    var hashes is MutString  # `slice of u64`, MapStr only (null for MapU64)
+    var ngroups is usize     # power of two (0 = no table)
+    var len is usize
+
+
+def map_tab_reset(t is mut ref MapTab) returns ()
+    (*t).ctrl = null
+    (*t).keys = null
+    (*t).vals = null
+    (*t).hashes = null
+    (*t).ngroups = 0
+    (*t).len = 0
+    return
+
+
+def map_tab_release(t is mut ref MapTab) returns ()
+    if (*t).ctrl is not null then
+        free((*t).ctrl)
+    if (*t).keys is not null then
+        free((*t).keys)
+    if (*t).vals is not null then
+        free((*t).vals)
+    if (*t).hashes is not null then
+        free((*t).hashes)
+    map_tab_reset(t)
+    return
+
+
+def map_tab_alloc(t is mut ref MapTab, ngroups is usize, with_hashes is i32) returns i32
+    map_tab_reset(t)
+    var nslots is usize = ngroups * MAP_GROUP
+    (*t).ctrl = malloc(ngroups * 8)
+    (*t).keys = malloc(nslots * 8)
+    (*t).vals = malloc(nslots * 8)
+    if with_hashes != 0 then
+        (*t).hashes = malloc(nslots * 8)
+    if (*t).ctrl is null or (*t).keys is null or (*t).vals is null or (with_hashes != 0 and (*t).hashes is null) then
+        map_tab_release(t)
+        return 1
+    var ctrl is slice of u64 = (*t).ctrl
+    var g is usize = 0
+    while g < ngroups do
+        ctrl[g] = MAP_WORD_EMPTY
+        g = g + 1
+    (*t).ngroups = ngroups
+    return 0
+
+
+def map_tab_slot_hash(t is mut ref MapTab, idx is usize) returns u64
+    if (*t).hashes is not null then
+        var hs is slice of u64 = (*t).hashes
+        return hs[idx]
+    var ks is slice of u64 = (*t).keys
+    return map_hash_u64(ks[idx])
+
+
+def map_tab_insert_new(t is mut ref MapTab, h is u64, kw is u64, v is u64) returns usize
+    # Place a key known to be absent and return its slot index. The caller
+    # guarantees a free slot.
+    var ctrl is slice of u64 = (*t).ctrl
+    var mask is usize = (*t).ngroups - 1
+    var g is usize = (h >> 7) & mask
+    var e is u64 = map_ctrl_empty(ctrl[g])
+    while e == 0 do
+        g = (g + 1) & mask
+        e = map_ctrl_empty(ctrl[g])
+    var s is usize = map_ctrl_first(e)
+    var idx is usize = g * MAP_GROUP + s
+    ctrl[g] = map_ctrl_set(ctrl[g], s, h & 0x7F)
+    var ks is slice of u64 = (*t).keys
+    var vs is slice of u64 = (*t).vals
+    ks[idx] = kw
+    vs[idx] = v
+    if (*t).hashes is not null then
+        var hs is slice of u64 = (*t).hashes
+        hs[idx] = h
+    (*t).len = (*t).len + 1
+    return idx
+
+
+def map_tab_erase(t is mut ref MapTab, idx is usize) returns ()
+    # Tombstone-free removal of a full slot in a live table.
+    var ctrl is slice of u64 = (*t).ctrl
+    var ks is slice of u64 = (*t).keys
+    var vs is slice of u64 = (*t).vals
+    var mask is usize = (*t).ngroups - 1
+    var hole_g is usize = idx >> 3
+    var hole_s is usize = idx & (MAP_GROUP - 1)
+    (*t).len = (*t).len - 1
+    if map_ctrl_empty(ctrl[hole_g]) != 0 then
+        # The group was never full, so no probe chain runs through it.
+        ctrl[hole_g] = map_ctrl_set(ctrl[hole_g], hole_s, MAP_CTRL_EMPTY)
+        return
+
+    # The hole's group was full: probe chains may pass through it. Pull back
+    # the first later element whose chain covers the hole, then repeat with the
+    # slot it left, until a group that was already non-full ends the chain.
+    var k is usize = hole_g
+    while 1 do
+        k = (k + 1) & mask
+        var wk is u64 = ctrl[k]
+        var full is u64 = map_ctrl_full(wk)
+        var moved is i32 = 0
+        while full != 0 and moved == 0 do
+            var i is usize = map_ctrl_first(full)
+            var src is usize = k * MAP_GROUP + i
+            var h is u64 = map_tab_slot_hash(t, src)
+            var home is usize = (h >> 7) & mask
+            if ((k - home) & mask) >= ((k - hole_g) & mask) then
+                var dst is usize = hole_g * MAP_GROUP + hole_s
+                ks[dst] = ks[src]
+                vs[dst] = vs[src]
+                if (*t).hashes is not null then
+                    var hs is slice of u64 = (*t).hashes
+                    hs[dst] = h
+                ctrl[hole_g] = map_ctrl_set(ctrl[hole_g], hole_s, h & 0x7F)
+                hole_g = k
+                hole_s = i
+                moved = 1
+            full = full & (full - 1)
+        if map_ctrl_empty(wk) != 0 then
+            ctrl[hole_g] = map_ctrl_set(ctrl[hole_g], hole_s, MAP_CTRL_EMPTY)
+            return
+    return
+
+
+def map_tab_retire_slot(t is mut ref MapTab, idx is usize) returns ()
+    # Remove from a retiring table: MOVED keeps old probe chains intact.
+    var ctrl is slice of u64 = (*t).ctrl
+    var g is usize = idx >> 3
+    ctrl[g] = map_ctrl_set(ctrl[g], idx & (MAP_GROUP - 1), MAP_CTRL_MOVED)
+    (*t).len = (*t).len - 1
+    return
+
+
+def map_groups_for(n is usize) returns usize
+    # Smallest power-of-two group count holding n entries under 7/8 load.
+    var g is usize = MAP_MIN_GROUPS
+    while g * MAP_GROUP * 7 < n * 8 do
+        g = g * 2
+    return g
+
+
+# ---- incremental resize (shared) ----
+
+def map_migrate(cur is mut ref MapTab, old is mut ref MapTab, cursor is mut ref usize, ngroups is usize) returns ()
+    # Move up to `ngroups` groups of the retiring table into `cur`; frees the
+    # retiring table once its last group is moved.
+    if (*old).ctrl is null then
+        return
+    var ctrl is slice of u64 = (*old).ctrl
+    var ks is slice of u64 = (*old).keys
+    var vs is slice of u64 = (*old).vals
+    var n is usize = 0
+    while n < ngroups and *cursor < (*old).ngroups do
+        var g is usize = *cursor
+        var full is u64 = map_ctrl_full(ctrl[g])
+        while full != 0 do
+            var idx is usize = g * MAP_GROUP + map_ctrl_first(full)
+            map_tab_insert_new(cur, map_tab_slot_hash(old, idx), ks[idx], vs[idx])
+            (*old).len = (*old).len - 1
+            full = full & (full - 1)
+        ctrl[g] = MAP_WORD_MOVED
+        *cursor = g + 1
+        n = n + 1
+    if *cursor >= (*old).ngroups then
+        map_tab_release(old)
+        *cursor = 0
+    return
+
+
+def map_reserve_one(cur is mut ref MapTab, old is mut ref MapTab, cursor is mut ref usize, with_hashes is i32) returns i32
+    # Make room for one more key in `cur`, starting a resize past 7/8 load.
+    var cap is usize = (*cur).ngroups * MAP_GROUP
+    if ((*cur).len + (*old).len + 1) * 8 <= cap * 7 then
+        return 0
+    # At most one retiring table: finish the current migration first.
+    map_migrate(cur, old, cursor, (*old).ngroups)
+    var next is MapTab
+    var want is usize = MAP_MIN_GROUPS
+    if (*cur).ngroups != 0 then
+        want = (*cur).ngroups * 2
+    if map_tab_alloc(&next, want, with_hashes) != 0 then
+        return 1
+    *old = *cur
+    *cur = next
+    *cursor = 0
+    if (*old).len == 0 then
+        map_tab_release(old)
+    return 0
+
+
+# -----------------------------
+# MapU64: u64 -> u64
+# -----------------------------
+
+struct MapU64
+    var cur is MapTab
+    var old is MapTab      # retiring table during incremental resize
+    var cursor is usize    # next `old` group to migrate
+
+
+def mapu64_init(m is mut ref MapU64, cap_hint is usize) returns i32
+    map_tab_reset(&(*m).old)
+    (*m).cursor = 0
+    return map_tab_alloc(&(*m).cur, map_groups_for(cap_hint), 0)
+
+
+def mapu64_free(m is mut ref MapU64) returns ()
+    map_tab_release(&(*m).cur)
+    map_tab_release(&(*m).old)
+    (*m).cursor = 0
+    return
+
+
+def mapu64_len(m is mut ref MapU64) returns usize
+    return (*m).cur.len + (*m).old.len
+
+
+def mapu64_tab_find(t is mut ref MapTab, key is u64, h is u64, from is usize) returns usize
+    if (*t).ngroups == 0 then
+        return MAP_NONE
+    var ctrl is slice of u64 = (*t).ctrl
+    var ks is slice of u64 = (*t).keys
+    var mask is usize = (*t).ngroups - 1
+    var g is usize = (h >> 7) & mask
+    if g < from then
+        g = from
+    var h2 is u64 = h & 0x7F
+    var n is usize = from
+    while n < (*t).ngroups do
+        var w is u64 = ctrl[g]
+        var m is u64 = map_ctrl_match(w, h2)
+        while m != 0 do
+            var idx is usize = g * MAP_GROUP + map_ctrl_first(m)
+            if ks[idx] == key then
+                return idx
+            m = m & (m - 1)
+        if map_ctrl_empty(w) != 0 then
+            return MAP_NONE
+        g = (g + 1) & mask
+        if g < from then
+            g = from
+        n = n + 1
+    return MAP_NONE
+
+
+def mapu64_get(m is mut ref MapU64, key is u64, out is mut ref u64) returns i32
+    # 1 and *out = value if present, else 0.
+    var h is u64 = map_hash_u64(key)
+    var idx is usize = mapu64_tab_find(&(*m).cur, key, h, 0)
+    if idx != MAP_NONE then
+        var vs is slice of u64 = (*m).cur.vals
+        *out = vs[idx]
+        return 1
+    if (*m).old.ctrl is null then
+        return 0
+    idx = mapu64_tab_find(&(*m).old, key, h, (*m).cursor)
+    if idx == MAP_NONE then
+        return 0
+    var ovs is slice of u64 = (*m).old.vals
+    *out = ovs[idx]
+    return 1
+
+
+def mapu64_contains(m is mut ref MapU64, key is u64) returns i32
+    var v is u64 = 0
+    return mapu64_get(m, key, &v)
+
+
+def mapu64_put(m is mut ref MapU64, key is u64, val is u64) returns i32
+    # Insert or overwrite.
+    map_migrate(&(*m).cur, &(*m).old, &(*m).cursor, MAP_MIGRATE_GROUPS)
+    var h is u64 = map_hash_u64(key)
+    var idx is usize = mapu64_tab_find(&(*m).cur, key, h, 0)
+    if idx != MAP_NONE then
+        var vs is slice of u64 = (*m).cur.vals
+        vs[idx] = val
+        return 0
+    if (*m).old.ctrl is not null then
+        idx = mapu64_tab_find(&(*m).old, key, h, (*m).cursor)
+        if idx != MAP_NONE then
+            var ovs is slice of u64 = (*m).old.vals
+            ovs[idx] = val
+            return 0
+    if map_reserve_one(&(*m).cur, &(*m).old, &(*m).cursor, 0) != 0 then
+        return 1
+    map_tab_insert_new(&(*m).cur, h, key, val)
+    return 0
+
+
+def mapu64_remove(m is mut ref MapU64, key is u64) returns i32
+    # 1 if the key was present.
+    map_migrate(&(*m).cur, &(*m).old, &(*m).cursor, MAP_MIGRATE_GROUPS)
+    var h is u64 = map_hash_u64(key)
+    var idx is usize = mapu64_tab_find(&(*m).cur, key, h, 0)
+    if idx != MAP_NONE then
+        map_tab_erase(&(*m).cur, idx)
+        return 1
+    if (*m).old.ctrl is null then
+        return 0
+    idx = mapu64_tab_find(&(*m).old, key, h, (*m).cursor)
+    if idx == MAP_NONE then
+        return 0
+    map_tab_retire_slot(&(*m).old, idx)
+    return 1
+
+
+# -----------------------------
+# MapStr: String -> u64
+# -----------------------------
+
+struct MapStr
+    var cur is MapTab
+    var old is MapTab
+    var cursor is usize
+
+
+def mapstr_init(m is mut ref MapStr, cap_hint is usize) returns i32
+    map_tab_reset(&(*m).old)
+    (*m).cursor = 0
+    return map_tab_alloc(&(*m).cur, map_groups_for(cap_hint), 1)
+
+
+def mapstr_free(m is mut ref MapStr) returns ()
+    map_tab_release(&(*m).cur)
+    map_tab_release(&(*m).old)
+    (*m).cursor = 0
+    return
+
+
+def mapstr_len(m is mut ref MapStr) returns usize
+    return (*m).cur.len + (*m).old.len
+
+
+def mapstr_tab_find(t is mut ref MapTab, key is String, h is u64, from is usize) returns usize
+    if (*t).ngroups == 0 then
+        return MAP_NONE
+    var ctrl is slice of u64 = (*t).ctrl
+    var ks is slice of String = (*t).keys
+    var hs is slice of u64 = (*t).hashes
+    var mask is usize = (*t).ngroups - 1
+    var g is usize = (h >> 7) & mask
+    if g < from then
+        g = from
+    var h2 is u64 = h & 0x7F
+    var n is usize = from
+    while n < (*t).ngroups do
+        var w is u64 = ctrl[g]
+        var m is u64 = map_ctrl_match(w, h2)
+        while m != 0 do
+            var idx is usize = g * MAP_GROUP + map_ctrl_first(m)
+            if hs[idx] == h and strcmp(ks[idx], key) == 0 then
+                return idx
+            m = m & (m - 1)
+        if map_ctrl_empty(w) != 0 then
+            return MAP_NONE
+        g = (g + 1) & mask
+        if g < from then
+            g = from
+        n = n + 1
+    return MAP_NONE
+
+
+def mapstr_get(m is mut ref MapStr, key is String, out is mut ref u64) returns i32
+    var h is u64 = map_hash_str(key)
+    var idx is usize = mapstr_tab_find(&(*m).cur, key, h, 0)
+    if idx != MAP_NONE then
+        var vs is slice of u64 = (*m).cur.vals
+        *out = vs[idx]
+        return 1
+    if (*m).old.ctrl is null then
+        return 0
+    idx = mapstr_tab_find(&(*m).old, key, h, (*m).cursor)
+    if idx == MAP_NONE then
+        return 0
+    var ovs is slice of u64 = (*m).old.vals
+    *out = ovs[idx]
+    return 1
+
+
+def mapstr_contains(m is mut ref MapStr, key is String) returns i32
+    var v is u64 = 0
+    return mapstr_get(m, key, &v)
+
+
+def mapstr_put(m is mut ref MapStr, key is String, val is u64) returns i32
+    # Insert or overwrite. `key` must outlive its entry.
+    map_migrate(&(*m).cur, &(*m).old, &(*m).cursor, MAP_MIGRATE_GROUPS)
+    var h is u64 = map_hash_str(key)
+    var idx is usize = mapstr_tab_find(&(*m).cur, key, h, 0)
+    if idx != MAP_NONE then
+        var vs is slice of u64 = (*m).cur.vals
+        vs[idx] = val
+        return 0
+    if (*m).old.ctrl is not null then
+        idx = mapstr_tab_find(&(*m).old, key, h, (*m).cursor)
+        if idx != MAP_NONE then
+            var ovs is slice of u64 = (*m).old.vals
+            ovs[idx] = val
+            return 0
+    if map_reserve_one(&(*m).cur, &(*m).old, &(*m).cursor, 1) != 0 then
+        return 1
+    # The shared insert writes key words as u64; store the pointer itself
+    # through a `slice of String` view of the same array.
+    var at is usize = map_tab_insert_new(&(*m).cur, h, 0, val)
+    var ks is slice of String = (*m).cur.keys
+    ks[at] = key
+    return 0
+
+
+def mapstr_remove(m is mut ref MapStr, key is String) returns i32
+    map_migrate(&(*m).cur, &(*m).old, &(*m).cursor, MAP_MIGRATE_GROUPS)
+    var h is u64 = map_hash_str(key)
+    var idx is usize = mapstr_tab_find(&(*m).cur, key, h, 0)
+    if idx != MAP_NONE then
+        map_tab_erase(&(*m).cur, idx)
+        return 1
+    if (*m).old.ctrl is null then
+        return 0
+    idx = mapstr_tab_find(&(*m).old, key, h, (*m).cursor)
+    if idx == MAP_NONE then
+        return 0
+    map_tab_retire_slot(&(*m).old, idx)
+    return 1
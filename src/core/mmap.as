@@ -0,0 +1,116 @@
+# core.mmap: memory-mapped files.
+#
+# A FileMap maps a whole regular file so its bytes can be used in place:
+# loaders parse headers and hand out views into the mapping instead of
+# malloc'ing the file size and reading a copy of it first.
+# - FMAP_READ mappings are read-only; writing through them faults.
+# - FMAP_COW mappings are writable but private: writes touch only this
+#   process's copy of the written pages, never the file.
+# - `fmap_advise` / `fmap_advise_range` pass an access hint to madvise(2).
+#   Hints are advisory: a kernel that does not know one (FMAP_HUGEPAGE is
+#   Linux-only) returns 1 and the mapping works as before.
+# - `fmap_close` unmaps. Views into the mapping are invalid afterwards.
+#
+# The fd is only needed while mapping; `fmap_open` closes it before
+# returning. Empty files map to `data == null`, `len == 0`.
+
+use core.libc
+
+extern def lseek(fd is i32, off is isize, whence is i32) returns isize
+extern def mmap(addr is MutString, n is usize, prot is i32, flags is i32, fd is i32, off is isize) returns MutString
+extern def munmap(addr is MutString, n is usize) returns i32
+extern def madvise(addr is MutString, n is usize, advice is i32) returns i32
+extern def getpagesize() returns i32
+
+# Mapping modes.
+const FMAP_READ is i32 = 0
+const FMAP_COW is i32 = 1
+
+# Access hints (madvise(2) advice values shared by Linux and macOS, plus
+# Linux's MADV_HUGEPAGE).
+const FMAP_NORMAL is i32 = 0
+const FMAP_RANDOM is i32 = 1
+const FMAP_SEQUENTIAL is i32 = 2
+const FMAP_WILLNEED is i32 = 3
+const FMAP_DONTNEED is i32 = 4
+const FMAP_HUGEPAGE is i32 = 14
+
+const FMAP_O_RDONLY is i32 = 0
+const FMAP_SEEK_SET is i32 = 0
+const FMAP_SEEK_END is i32 = 2
+const FMAP_PROT_READ is i32 = 1
+const FMAP_PROT_WRITE is i32 = 2
+const FMAP_MAP_PRIVATE is i32 = 2
+
+
+struct FileMap
+    var data is MutString   # null for an empty file or after fmap_close
+    var len is usize
+    var mode is i32
+
+
+def fmap_open_fd(m is mut ref FileMap, fd is i32, mode is i32) returns i32
+    # Maps the whole file behind `fd` (which stays open and is rewound to
+    # offset 0). Returns 1 if it cannot be mapped: not seekable (pipes,
+    # ttys) or rejected by mmap(2).
+    (*m).data = null
+    (*m).len = 0
+    (*m).mode = mode
+    var size is isize = lseek(fd, 0, FMAP_SEEK_END)
+    if size < 0 then
+        return 1
+    lseek(fd, 0, FMAP_SEEK_SET)
+    if size == 0 then
+        return 0
+    var n is usize = size
+    var prot is i32 = FMAP_PROT_READ
+    if mode == FMAP_COW then
+        prot = FMAP_PROT_READ | FMAP_PROT_WRITE
+    var p is MutString = mmap(null, n, prot, FMAP_MAP_PRIVATE, fd, 0)
+    var nul is MutString = null
+    if p - nul == 0 - 1 then
+        # MAP_FAILED
+        return 1
+    (*m).data = p
+    (*m).len = n
+    return 0
+
+
+def fmap_open(m is mut ref FileMap, path is String, mode is i32) returns i32
+    # Maps the file at `path`. Returns 1 if it cannot be opened or mapped.
+    (*m).data = null
+    (*m).len = 0
+    (*m).mode = mode
+    var fd is i32 = open(path, FMAP_O_RDONLY)
+    if fd < 0 then
+        return 1
+    var rc is i32 = fmap_open_fd(m, fd, mode)
+    close(fd)
+    return rc
+
+
+def fmap_advise_range(m is mut ref FileMap, off is usize, n is usize, hint is i32) returns i32
+    # Hint for bytes [off, off+n), widened to whole pages and clamped to the
+    # mapping. Returns 1 if the kernel rejects the hint.
+    if (*m).data is null or off >= (*m).len then
+        return 0
+    var end is usize = off + n
+    if end > (*m).len or end < off then
+        end = (*m).len
+    var page is usize = getpagesize()
+    var lo is usize = (off / page) * page
+    if madvise((*m).data + lo, end - lo, hint) != 0 then
+        return 1
+    return 0
+
+
+def fmap_advise(m is mut ref FileMap, hint is i32) returns i32
+    return fmap_advise_range(m, 0, (*m).len, hint)
+
+
+def fmap_close(m is mut ref FileMap) returns ()
+    if (*m).data is not null then
+        munmap((*m).data, (*m).len)
+    (*m).data = null
+    (*m).len = 0
+    return
@@ -3,9 +3,21 @@ use core.libc
 const PANIC_FD is i32 = 2
 const BT_CAP is i32 = 64
 
+# Both are `@noreturn`: the compiler treats them as cold, keeps them out of
+# line, and knows code after a call is dead, so a `panic` guard costs the hot
+# path one predicted branch. For checks without a message use `assert(cond)`.
+
+@noreturn
 def panic(msg is String) returns ()
+    panic_n(msg, strlen(msg))
+    return
+
+
+@noreturn
+def panic_n(msg is String, n is usize) returns ()
+    # `msg` need not be NUL-terminated (e.g. a core.str view: data, len).
     write(PANIC_FD, "panic: ", 7)
-    write(PANIC_FD, msg, strlen(msg))
+    write(PANIC_FD, msg, n)
     write(PANIC_FD, "\n", 1)
 
     # Print a best-effort stack trace.
@@ -13,9 +25,9 @@ def panic(msg is String) returns ()
     if frames is null then
         exit(1)
         return
-    var n is i32 = backtrace(frames, BT_CAP)
-    if n > 0 then
-        backtrace_symbols_fd(frames, n, PANIC_FD)
+    var nf is i32 = backtrace(frames, BT_CAP)
+    if nf > 0 then
+        backtrace_symbols_fd(frames, nf, PANIC_FD)
     free(frames)
     exit(1)
     return
@@ -0,0 +1,278 @@
+# core.str: length-carrying string views and a growable string buffer.
+#
+# - Str is a borrowed (data, len) view. It does not own its bytes and need
+#   not be NUL-terminated, so views into a larger buffer (header lines, JSON
+#   keys, split fields) are free to make and never rescan for a terminator.
+# - StrBuf owns a growable buffer. Its bytes are always NUL-terminated, so
+#   `(*b).data` can be handed to C APIs that expect a `String`.
+#
+# Searches and comparisons run on the vectorized helpers in
+# `tools/build/out/str_rt.o` (SSE2 on x86_64, NEON on arm64; auto-linked on
+# import). Searches return STR_NPOS when there is no match.
+#
+# Aster has no struct return values yet, so results are written through
+# `out` parameters. StrBuf functions that allocate return 0 on success and 1
+# on allocation failure.
+
+use core.libc
+
+extern def aster_str_find_byte(p is String, n is usize, b is u8) returns usize
+extern def aster_str_count_byte(p is String, n is usize, b is u8) returns usize
+extern def aster_str_find(h is String, hn is usize, nd is String, nn is usize) returns usize
+extern def aster_str_mismatch(a is String, b is String, n is usize) returns usize
+extern def aster_str_mismatch_ci(a is String, b is String, n is usize) returns usize
+
+const STR_NPOS is usize = 0xFFFFFFFFFFFFFFFF
+const STRBUF_MIN_CAP is usize = 32
+
+
+struct Str
+    var data is String
+    var len is usize
+
+
+struct StrBuf
+    var data is MutString   # NUL-terminated; null before the first allocation
+    var len is usize
+    var cap is usize        # usable bytes, excluding the terminator
+
+
+# -----------------------------
+# Views
+# -----------------------------
+
+def str_init(s is mut ref Str, data is String, n is usize) returns ()
+    (*s).data = data
+    (*s).len = n
+    return
+
+
+def str_from_cstr(s is mut ref Str, c is String) returns ()
+    # The one length scan a C string needs.
+    (*s).data = c
+    (*s).len = 0
+    if c is not null then
+        (*s).len = strlen(c)
+    return
+
+
+def str_sub(s is mut ref Str, from is usize, to is usize, out is mut ref Str) returns ()
+    # View of bytes [from, to), clamped to the string.
+    var hi is usize = to
+    if hi > (*s).len then
+        hi = (*s).len
+    var lo is usize = from
+    if lo > hi then
+        lo = hi
+    (*out).data = (*s).data + lo
+    (*out).len = hi - lo
+    return
+
+
+def str_trim(s is mut ref Str, out is mut ref Str) returns ()
+    # View without leading/trailing ASCII spaces, tabs, CR and LF.
+    var p is String = (*s).data
+    var lo is usize = 0
+    var hi is usize = (*s).len
+    while lo < hi and (p[lo] == 32 or p[lo] == 9 or p[lo] == 13 or p[lo] == 10) do
+        lo = lo + 1
+    while hi > lo and (p[hi - 1] == 32 or p[hi - 1] == 9 or p[hi - 1] == 13 or p[hi - 1] == 10) do
+        hi = hi - 1
+    (*out).data = p + lo
+    (*out).len = hi - lo
+    return
+
+
+# -----------------------------
+# Search
+# -----------------------------
+
+def str_find_byte(s is mut ref Str, b is u8) returns usize
+    var i is usize = aster_str_find_byte((*s).data, (*s).len, b)
+    if i == (*s).len then
+        return STR_NPOS
+    return i
+
+
+def str_count_byte(s is mut ref Str, b is u8) returns usize
+    return aster_str_count_byte((*s).data, (*s).len, b)
+
+
+def str_find(s is mut ref Str, needle is mut ref Str) returns usize
+    # First occurrence of `needle` (an empty needle matches at 0).
+    if (*needle).len > (*s).len then
+        return STR_NPOS
+    var i is usize = aster_str_find((*s).data, (*s).len, (*needle).data, (*needle).len)
+    if i == (*s).len and (*needle).len != 0 then
+        return STR_NPOS
+    return i
+
+
+def str_split_next(rest is mut ref Str, sep is u8, field is mut ref Str) returns i32
+    # Splits off the next `sep`-separated field of `rest` into `field`.
+    # Returns 0 once every field has been produced: "a,,b" yields "a", "",
+    # "b" and an empty string yields one empty field.
+    if (*rest).data is null then
+        return 0
+    var n is usize = (*rest).len
+    var i is usize = aster_str_find_byte((*rest).data, n, sep)
+    (*field).data = (*rest).data
+    (*field).len = i
+    if i == n then
+        (*rest).data = null
+        (*rest).len = 0
+    else
+        (*rest).data = (*rest).data + i + 1
+        (*rest).len = n - i - 1
+    return 1
+
+
+# -----------------------------
+# Compare
+# -----------------------------
+
+def str_equal(a is mut ref Str, b is mut ref Str) returns i32
+    if (*a).len != (*b).len then
+        return 0
+    return aster_str_mismatch((*a).data, (*b).data, (*a).len) == (*a).len
+
+
+def str_equal_ci(a is mut ref Str, b is mut ref Str) returns i32
+    # ASCII case-insensitive equality.
+    if (*a).len != (*b).len then
+        return 0
+    return aster_str_mismatch_ci((*a).data, (*b).data, (*a).len) == (*a).len
+
+
+def str_compare(a is mut ref Str, b is mut ref Str) returns i32
+    # Bytewise (unsigned) ordering: <0, 0 or >0.
+    var n is usize = (*a).len
+    if (*b).len < n then
+        n = (*b).len
+    var i is usize = aster_str_mismatch((*a).data, (*b).data, n)
+    if i < n then
+        var x is i32 = (*a).data[i]
+        var y is i32 = (*b).data[i]
+        return x - y
+    if (*a).len < (*b).len then
+        return 0 - 1
+    return (*a).len > (*b).len
+
+
+def str_starts_with(s is mut ref Str, prefix is mut ref Str) returns i32
+    if (*s).len < (*prefix).len then
+        return 0
+    return aster_str_mismatch((*s).data, (*prefix).data, (*prefix).len) == (*prefix).len
+
+
+def str_starts_with_ci(s is mut ref Str, prefix is mut ref Str) returns i32
+    if (*s).len < (*prefix).len then
+        return 0
+    return aster_str_mismatch_ci((*s).data, (*prefix).data, (*prefix).len) == (*prefix).len
+
+
+def str_ends_with(s is mut ref Str, suffix is mut ref Str) returns i32
+    if (*s).len < (*suffix).len then
+        return 0
+    var off is usize = (*s).len - (*suffix).len
+    return aster_str_mismatch((*s).data + off, (*suffix).data, (*suffix).len) == (*suffix).len
+
+
+# -----------------------------
+# StrBuf
+# -----------------------------
+
+def strbuf_init(b is mut ref StrBuf, cap is usize) returns i32
+    (*b).data = null
+    (*b).len = 0
+    (*b).cap = 0
+    return strbuf_reserve(b, cap)
+
+
+def strbuf_free(b is mut ref StrBuf) returns ()
+    if (*b).data is not null then
+        free((*b).data)
+    (*b).data = null
+    (*b).len = 0
+    (*b).cap = 0
+    return
+
+
+def strbuf_reserve(b is mut ref StrBuf, extra is usize) returns i32
+    # Room for `extra` more bytes (plus the terminator) without reallocating.
+    var need is usize = (*b).len + extra
+    if (*b).data is not null and need <= (*b).cap then
+        return 0
+    var cap is usize = (*b).cap * 2
+    if cap < STRBUF_MIN_CAP then
+        cap = STRBUF_MIN_CAP
+    while cap < need do
+        cap = cap * 2
+    var p is MutString = malloc(cap + 1)
+    if p is null then
+        return 1
+    if (*b).data is not null then
+        if (*b).len != 0 then
+            memcpy(p, (*b).data, (*b).len)
+        free((*b).data)
+    var xs is slice of u8 = p
+    xs[(*b).len] = 0
+    (*b).data = p
+    (*b).cap = cap
+    return 0
+
+
+def strbuf_append_bytes(b is mut ref StrBuf, p is String, n is usize) returns i32
+    if strbuf_reserve(b, n) != 0 then
+        return 1
+    if n != 0 then
+        memcpy((*b).data + (*b).len, p, n)
+    (*b).len = (*b).len + n
+    var xs is slice of u8 = (*b).data
+    xs[(*b).len] = 0
+    return 0
+
+
+def strbuf_append(b is mut ref StrBuf, s is mut ref Str) returns i32
+    return strbuf_append_bytes(b, (*s).data, (*s).len)
+
+
+def strbuf_append_cstr(b is mut ref StrBuf, c is String) returns i32
+    return strbuf_append_bytes(b, c, strlen(c))
+
+
+def strbuf_push_u8(b is mut ref StrBuf, c is u8) returns i32
+    if (*b).data is null or (*b).len == (*b).cap then
+        if strbuf_reserve(b, 1) != 0 then
+            return 1
+    var xs is slice of u8 = (*b).data
+    xs[(*b).len] = c
+    xs[(*b).len + 1] = 0
+    (*b).len = (*b).len + 1
+    return 0
+
+
+def strbuf_clear(b is mut ref StrBuf) returns ()
+    # Keeps the allocation.
+    (*b).len = 0
+    if (*b).data is not null then
+        var xs is slice of u8 = (*b).data
+        xs[0] = 0
+    return
+
+
+def strbuf_view(b is mut ref StrBuf, out is mut ref Str) returns ()
+    # Borrowed view; invalidated by the next append.
+    (*out).data = (*b).data
+    (*out).len = (*b).len
+    return
+
+
+def strbuf_take(b is mut ref StrBuf) returns MutString
+    # Hands the NUL-terminated buffer to the caller (who frees it) and leaves
+    # `b` empty.
+    var p is MutString = (*b).data
+    (*b).data = null
+    (*b).len = 0
+    (*b).cap = 0
+    return p
@@ -1,7 +1,247 @@
+# core.time: clocks and latency histograms.
+#
+# - `now_ns` is CLOCK_MONOTONIC: precise, comparable across processes, but a
+#   vDSO call (or worse, a syscall) every time.
+# - A TickClock reads the CPU counter directly (TSC on x86_64, CNTVCT on
+#   arm64; `tools/build/out/time_rt.o`, auto-linked on import) and converts
+#   ticks to ns with a multiply and a shift. `tick_clock_init` calibrates it
+#   once against `now_ns` (arm64 reports its frequency and skips the spin).
+#   Take `ticks()` in the hot loop and convert deltas afterwards.
+# - `now_ns_coarse` is the kernel's cached tick time: cheapest, but only as
+#   fine as the scheduler tick (1-4 ms).
+# - A LatencyHist records values in fixed memory (one allocation at init):
+#   log-linear buckets with 64 sub-buckets per power of two, so any recorded
+#   value is reported within 1/64 (~1.6%) of itself, from 0 to 2^64-1.
+#   `hist_record` does no allocation and no syscall; give each thread its own
+#   and `hist_merge` them.
+
 use core.libc
 
+extern def aster_time_ticks() returns u64
+extern def aster_time_tick_hz() returns u64
+extern def aster_time_coarse_ns() returns u64
+extern def memset(p is MutString, c is i32, n is usize) returns MutString
+
+const TIME_CALIBRATE_NS is u64 = 10000000    # TSC calibration spin (10 ms)
+
+const HIST_SUB_BITS is u64 = 6               # 64 sub-buckets per power of two
+const HIST_SUB is u64 = 64
+const HIST_BUCKETS is usize = 3776           # 128 exact + 57 * 64 log-linear
+
+
+struct TickClock
+    var mult is u64          # ns per tick, scaled by 2^shift
+    var shift is u64
+    var base_ticks is u64    # ticks at init ...
+    var base_ns is u64       # ... and the now_ns reading taken with them
+    var hz is u64            # counter frequency (measured or reported)
+
+
+struct LatencyHist
+    var counts is MutString  # HIST_BUCKETS u64 counters
+    var total is u64
+    var sum is u64
+    var min is u64
+    var max is u64
+
+
 def now_ns() returns u64
     var ts is TimeSpec
     clock_gettime(CLOCK_MONOTONIC, &ts)
     return (ts.tv_sec * 1000000000) + ts.tv_nsec
 
+
+def now_ns_coarse() returns u64
+    return aster_time_coarse_ns()
+
+
+# -----------------------------
+# Cycle-counter clock
+# -----------------------------
+
+def ticks() returns u64
+    # Raw counter value; only differences converted by a TickClock mean
+    # anything.
+    return aster_time_ticks()
+
+
+def tick_clock_init(c is mut ref TickClock) returns ()
+    var hz is u64 = aster_time_tick_hz()
+    var t0 is u64 = aster_time_ticks()
+    var n0 is u64 = now_ns()
+    if hz == 0 then
+        var n1 is u64 = n0
+        var t1 is u64 = t0
+        while n1 - n0 < TIME_CALIBRATE_NS do
+            n1 = now_ns()
+            t1 = aster_time_ticks()
+        var rate is f64 = t1 - t0
+        var span is f64 = n1 - n0
+        hz = rate * 1000000000.0 / span
+        if hz == 0 then
+            hz = 1
+    (*c).hz = hz
+    (*c).base_ticks = t0
+    (*c).base_ns = n0
+    # Largest shift that keeps mult below 2^32, so the split multiply in
+    # tick_clock_to_ns never overflows.
+    var fhz is f64 = hz
+    var per_tick is f64 = 1000000000.0 / fhz
+    var shift is u64 = 32
+    var scaled is f64 = per_tick * 4294967296.0
+    while shift > 0 and scaled >= 4294967296.0 do
+        shift = shift - 1
+        scaled = scaled / 2.0
+    (*c).shift = shift
+    (*c).mult = scaled + 0.5
+    return
+
+
+def tick_clock_to_ns(c is mut ref TickClock, dt is u64) returns u64
+    # Converts a tick delta to ns: (dt * mult) >> shift, split at the shift
+    # so neither product overflows 64 bits.
+    var sh is u64 = (*c).shift
+    var lo_mask is u64 = (1 << sh) - 1
+    return (dt >> sh) * (*c).mult + (((dt & lo_mask) * (*c).mult) >> sh)
+
+
+def tick_clock_ns(c is mut ref TickClock, t is u64) returns u64
+    # Counter value `t` on the `now_ns` timeline.
+    return (*c).base_ns + tick_clock_to_ns(c, t - (*c).base_ticks)
+
+
+def tick_clock_now_ns(c is mut ref TickClock) returns u64
+    return tick_clock_ns(c, aster_time_ticks())
+
+
+# -----------------------------
+# Latency histogram
+# -----------------------------
+
+def hist_msb(v is u64) returns u64
+    # Index of the highest set bit of a non-zero value.
+    var x is u64 = v
+    var r is u64 = 0
+    if x >= 0x100000000 then
+        x = x >> 32
+        r = r + 32
+    if x >= 0x10000 then
+        x = x >> 16
+        r = r + 16
+    if x >= 0x100 then
+        x = x >> 8
+        r = r + 8
+    if x >= 0x10 then
+        x = x >> 4
+        r = r + 4
+    if x >= 0x4 then
+        x = x >> 2
+        r = r + 2
+    if x >= 0x2 then
+        r = r + 1
+    return r
+
+
+def hist_index(v is u64) returns usize
+    # Values below 128 get their own bucket. Above, a value with its top bit
+    # at m keeps its 7 leading bits: bucket s*64 + (v >> s), s = m - 6.
+    if v < 2 * HIST_SUB then
+        return v
+    var s is u64 = hist_msb(v) - HIST_SUB_BITS
+    return s * HIST_SUB + (v >> s)
+
+
+def hist_bucket_hi(idx is usize) returns u64
+    # Largest value that lands in bucket `idx`.
+    if idx < 2 * HIST_SUB then
+        return idx
+    var s is u64 = idx / HIST_SUB - 1
+    var mant is u64 = idx - s * HIST_SUB
+    return ((mant + 1) << s) - 1
+
+
+def hist_init(h is mut ref LatencyHist) returns i32
+    # Returns 1 on allocation failure.
+    (*h).counts = malloc(HIST_BUCKETS * 8)
+    if (*h).counts is null then
+        return 1
+    hist_reset(h)
+    return 0
+
+
+def hist_free(h is mut ref LatencyHist) returns ()
+    if (*h).counts is not null then
+        free((*h).counts)
+    (*h).counts = null
+    return
+
+
+def hist_reset(h is mut ref LatencyHist) returns ()
+    memset((*h).counts, 0, HIST_BUCKETS * 8)
+    (*h).total = 0
+    (*h).sum = 0
+    (*h).min = 0xFFFFFFFFFFFFFFFF
+    (*h).max = 0
+    return
+
+
+noalloc def hist_record(h is mut ref LatencyHist, v is u64) returns ()
+    var counts is slice of u64 = (*h).counts
+    var idx is usize = hist_index(v)
+    counts[idx] = counts[idx] + 1
+    (*h).total = (*h).total + 1
+    (*h).sum = (*h).sum + v
+    if v < (*h).min then
+        (*h).min = v
+    if v > (*h).max then
+        (*h).max = v
+    return
+
+
+def hist_merge(dst is mut ref LatencyHist, src is mut ref LatencyHist) returns ()
+    var a is slice of u64 = (*dst).counts
+    var b is slice of u64 = (*src).counts
+    var i is usize = 0
+    while i < HIST_BUCKETS do
+        a[i] = a[i] + b[i]
+        i = i + 1
+    (*dst).total = (*dst).total + (*src).total
+    (*dst).sum = (*dst).sum + (*src).sum
+    if (*src).min < (*dst).min then
+        (*dst).min = (*src).min
+    if (*src).max > (*dst).max then
+        (*dst).max = (*src).max
+    return
+
+
+def hist_mean(h is mut ref LatencyHist) returns f64
+    if (*h).total == 0 then
+        return 0.0
+    var s is f64 = (*h).sum
+    var n is f64 = (*h).total
+    return s / n
+
+
+def hist_quantile(h is mut ref LatencyHist, q is f64) returns u64
+    # Value at quantile `q` (0.5 = median, 0.99 = p99): the upper bound of
+    # the bucket holding that rank, capped at the recorded max. 0 if empty.
+    if (*h).total == 0 then
+        return 0
+    var nt is f64 = (*h).total
+    var rank is u64 = q * nt + 0.5
+    if rank < 1 then
+        rank = 1
+    if rank > (*h).total then
+        rank = (*h).total
+    var counts is slice of u64 = (*h).counts
+    var seen is u64 = 0
+    var i is usize = 0
+    while i < HIST_BUCKETS do
+        seen = seen + counts[i]
+        if seen >= rank then
+            var hi is u64 = hist_bucket_hi(i)
+            if hi > (*h).max then
+                return (*h).max
+            return hi
+        i = i + 1
+    return (*h).max
@@ -0,0 +1,25 @@
+# testmods.ml_fixtures: input tensors shared by the aster_ml conformance tests.
+
+use core.libc
+use aster_ml.tensor
+use aster_ml.dtype
+use aster_ml.device
+
+
+def make_f32(t is mut ref Tensor, n is usize, period is usize, scale is f32, shift is f32) returns i32
+    # 1-D f32 tensor of `n` elements: t[i] = (i mod period) * scale - shift.
+    var dims is slice of usize = malloc(1 * 8)
+    if dims is null then
+        return 1
+    dims[0] = n
+    var rc is i32 = tensor_init_contiguous(t, DT_F32, DEV_CPU, 1, dims)
+    free(dims)
+    if rc != 0 then
+        return 1
+    var p is slice of f32 = tensor_data_ptr(t)
+    var i is usize = 0
+    while i < n do
+        var v is usize = i - (i / period) * period
+        p[i] = (0.0 + v) * scale - shift
+        i = i + 1
+    return 0
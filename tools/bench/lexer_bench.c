@@ -0,0 +1,115 @@
+// Lexer microbenchmark: drives `aster_lex__next` (asm/compiler/lexer.S) over a
+// set of `.as` files and reports throughput.
+//
+// Usage: lexer_bench <min_ms> <file.as>...
+//
+// Every file is loaded once; the whole corpus is then lexed repeatedly until
+// at least <min_ms> milliseconds have elapsed. The token checksum (kinds and
+// spans) lets two lexer builds be checked for identical output.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+  uint8_t data[568]; // LEXER_SIZE (asm/macros/lexer.inc)
+} AsterLex;
+
+typedef struct {
+  uint32_t kind;
+  uint32_t start;
+  uint32_t end;
+  uint32_t _pad;
+} AsterTok;
+
+uint64_t aster_lex__init(AsterLex* lex, const uint8_t* src, uint64_t len);
+uint64_t aster_lex__next(AsterLex* lex, AsterTok* out);
+
+typedef struct {
+  uint8_t* src;
+  size_t len;
+} SrcFile;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int load(const char* path, SrcFile* out) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return 0;
+  fseek(f, 0, SEEK_END);
+  long n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (n < 0) {
+    fclose(f);
+    return 0;
+  }
+  out->src = (uint8_t*)malloc((size_t)n + 1);
+  out->len = fread(out->src, 1, (size_t)n, f);
+  out->src[out->len] = 0;
+  fclose(f);
+  return 1;
+}
+
+// Lex one file; stops at EOF or the first TOK_UNKNOWN (the compiler rejects
+// the unit there, and some malformed inputs never advance past it).
+static uint64_t lex_file(const SrcFile* f, uint64_t* io_sum) {
+  AsterLex lex;
+  AsterTok t;
+  uint64_t n = 0;
+  uint64_t sum = *io_sum;
+  aster_lex__init(&lex, f->src, (uint64_t)f->len);
+  do {
+    aster_lex__next(&lex, &t);
+    sum = (sum ^ (((uint64_t)t.kind << 48) ^ ((uint64_t)t.start << 24) ^ t.end)) * 0x100000001b3ull;
+    n++;
+  } while (t.kind != 0 && t.kind != 255);
+  *io_sum = sum;
+  return n;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: lexer_bench <min_ms> <file.as>...\n");
+    return 2;
+  }
+  uint64_t min_ns = strtoull(argv[1], NULL, 10) * 1000000ull;
+  size_t nfiles = 0;
+  size_t bytes = 0;
+  SrcFile* files = (SrcFile*)calloc((size_t)argc, sizeof(SrcFile));
+  for (int i = 2; i < argc; i++) {
+    if (!load(argv[i], &files[nfiles])) {
+      fprintf(stderr, "lexer_bench: cannot read %s\n", argv[i]);
+      continue;
+    }
+    bytes += files[nfiles].len;
+    nfiles++;
+  }
+
+  // Warm-up pass (also yields the per-pass token count and checksum).
+  uint64_t sum = 0xcbf29ce484222325ull;
+  uint64_t toks = 0;
+  for (size_t i = 0; i < nfiles; i++) toks += lex_file(&files[i], &sum);
+  uint64_t checksum = sum;
+
+  uint64_t iters = 0;
+  uint64_t t0 = now_ns();
+  uint64_t t1 = t0;
+  do {
+    uint64_t s = 0;
+    for (size_t i = 0; i < nfiles; i++) lex_file(&files[i], &s);
+    iters++;
+    t1 = now_ns();
+  } while (t1 - t0 < min_ns);
+
+  double secs = (double)(t1 - t0) / 1e9;
+  double mb = (double)bytes * (double)iters / 1e6;
+  printf("files %zu bytes %zu tokens %llu iters %llu\n", nfiles, bytes, (unsigned long long)toks,
+         (unsigned long long)iters);
+  printf("throughput %.1f MB/s %.1f Mtok/s checksum %016llx\n", mb / secs, (double)toks * (double)iters / 1e6 / secs,
+         (unsigned long long)checksum);
+  return 0;
+}
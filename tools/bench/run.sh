@@ -72,10 +72,10 @@ needs_build() {
 }
 
 BENCH_SET="${BENCH_SET:-all}"
-BENCHES=(dot gemm stencil sort json hashmap regex async_io)
+BENCHES=(dot gemm stencil sort json hashmap regex async_io logwrite)
 
 if [[ "$BENCH_SET" == "kernels" ]]; then
-    BENCHES=(dot gemm stencil sort json hashmap regex async_io)
+    BENCHES=(dot gemm stencil sort json hashmap regex async_io logwrite)
 elif [[ "$BENCH_SET" == "fswalk" ]]; then
     if [[ -z "${FS_BENCH_ROOT:-}" ]]; then
         echo "FS_BENCH_ROOT is required for fswalk bench set" >&2
@@ -494,11 +494,11 @@ bench_set = os.environ.get("BENCH_SET", "all")
 root = os.environ.get("FS_BENCH_ROOT")
 
 if bench_set == "kernels":
-    benches = ["dot", "gemm", "stencil", "sort", "json", "hashmap", "regex", "async_io"]
+    benches = ["dot", "gemm", "stencil", "sort", "json", "hashmap", "regex", "async_io", "logwrite"]
 elif bench_set == "fswalk":
     benches = ["fswalk", "treewalk", "dircount", "fsinventory"]
 else:
-    benches = ["dot", "gemm", "stencil", "sort", "json", "hashmap", "regex", "async_io"]
+    benches = ["dot", "gemm", "stencil", "sort", "json", "hashmap", "regex", "async_io", "logwrite"]
     if root:
         benches.extend(["fswalk", "treewalk", "dircount", "fsinventory"])
 
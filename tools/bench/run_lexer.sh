@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Lexer microbenchmark over every `.as` file under src/.
+#
+#   tools/bench/run_lexer.sh                       # current lexer only
+#   LEXER_BASE_REV=HEAD~1 tools/bench/run_lexer.sh # also a baseline revision
+#
+# Knobs:
+# - LEXER_BENCH_MS: minimum measured time per lexer (default 2000)
+# - LEXER_BENCH_ROOT: directory to scan for `.as` files (default: src/)
+
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/../.." && pwd)"
+OUT_DIR="${BENCH_OUT_DIR:-$ROOT/.context/bench/out}/lexer"
+INC="$ROOT/asm/macros"
+MIN_MS="${LEXER_BENCH_MS:-2000}"
+SCAN_ROOT="${LEXER_BENCH_ROOT:-$ROOT/src}"
+
+mkdir -p "$OUT_DIR"
+
+FILES=()
+while IFS= read -r f; do
+    FILES+=("$f")
+done < <(find "$SCAN_ROOT" -name '*.as' -type f | LC_ALL=C sort)
+if [[ "${#FILES[@]}" -eq 0 ]]; then
+    echo "run_lexer: no .as files under $SCAN_ROOT" >&2
+    exit 1
+fi
+
+build_bench() {
+    local lexer_src="$1"
+    local bin="$2"
+    clang -c "$lexer_src" -O3 -I"$INC" -o "$bin.lexer.o"
+    clang -O2 "$ROOT/tools/bench/lexer_bench.c" "$bin.lexer.o" -o "$bin"
+}
+
+run_bench() {
+    local label="$1"
+    local bin="$2"
+    echo "== $label"
+    "$bin" "$MIN_MS" "${FILES[@]}"
+}
+
+build_bench "$ROOT/asm/compiler/lexer.S" "$OUT_DIR/lexer_bench_cur"
+
+if [[ -n "${LEXER_BASE_REV:-}" ]]; then
+    base_src="$OUT_DIR/lexer_base.S"
+    git -C "$ROOT" show "$LEXER_BASE_REV:asm/compiler/lexer.S" >"$base_src"
+    build_bench "$base_src" "$OUT_DIR/lexer_bench_base"
+    run_bench "base ($LEXER_BASE_REV)" "$OUT_DIR/lexer_bench_base"
+fi
+run_bench "current" "$OUT_DIR/lexer_bench_cur"
@@ -34,6 +34,12 @@ BENCHES=(
   autograd_matmul
   train_mlp
   sdpa_forward
+  fused_ewise
+  residual_chain
+  schedule_graph
+  uop_build
+  graph_rewrite
+  varlen_ewise
 )
 
 for bench in "${BENCHES[@]}"; do
@@ -0,0 +1,223 @@
+#!/usr/bin/env python3
+"""
+Offline symbolizer/folder for `aster prof` samples.
+
+Reads the raw stack file written by `asm/compiler/prof_rt.c`, symbolizes
+main-image frames against `nm -n <binary>`, demangles Aster symbols
+(`aster_<module>__<name>` -> `<module>.<name>`), and writes:
+- folded stacks (`a;b;c <count>`, root first), compatible with flamegraph.pl
+- a self-contained flame graph SVG
+- a top-N table (self/total samples per Aster function) on stdout
+
+This is NOT part of the Aster compiler/toolchain. It's a reporting helper.
+"""
+
+from __future__ import annotations
+
+import argparse
+import bisect
+import html
+import subprocess
+import sys
+import zlib
+from collections import Counter
+from dataclasses import dataclass, field
+
+
+@dataclass
+class Symtab:
+    addrs: list[int]
+    names: list[str]
+    image_base: int
+
+    def lookup(self, addr: int) -> str | None:
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return None
+        return self.names[i]
+
+
+def load_symtab(binary: str) -> Symtab:
+    out = subprocess.run(["nm", "-n", binary], check=True, capture_output=True, text=True).stdout
+    addrs: list[int] = []
+    names: list[str] = []
+    image_base = 0
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) != 3:
+            continue
+        addr_s, kind, name = parts
+        try:
+            addr = int(addr_s, 16)
+        except ValueError:
+            continue
+        # Mach-O prefixes C symbols with `_`; the image header anchors the
+        # dladdr base used by the sampler.
+        if name in ("__mh_execute_header", "__executable_start"):
+            image_base = addr
+            continue
+        if kind not in ("T", "t"):
+            continue
+        if sys.platform == "darwin" and name.startswith("_"):
+            name = name[1:]
+        addrs.append(addr)
+        names.append(name)
+    return Symtab(addrs, names, image_base)
+
+
+def demangle(name: str) -> str:
+    if name.startswith("aster_") and "__" in name[6:]:
+        mod, sym = name[6:].split("__", 1)
+        if mod == "unit":
+            return sym
+        return f"{mod}.{sym}"
+    return name
+
+
+@dataclass
+class Node:
+    name: str
+    value: int = 0
+    children: dict[str, "Node"] = field(default_factory=dict)
+
+
+def parse_raw(path: str, syms: Symtab) -> tuple[dict[str, str], list[list[str]]]:
+    meta: dict[str, str] = {}
+    stacks: list[list[str]] = []
+    cache: dict[str, str] = {}
+    with open(path, "r", encoding="utf-8", errors="replace") as fp:
+        for line in fp:
+            line = line.rstrip("\n")
+            if not line or line.startswith("#"):
+                continue
+            if not line.startswith("s "):
+                k, _, v = line.partition(" ")
+                meta[k] = v
+                continue
+            frames: list[str] = []
+            for tok in line[2:].split(" "):
+                name = cache.get(tok)
+                if name is None:
+                    if tok.startswith("m:"):
+                        sym = syms.lookup(int(tok[2:], 16) + syms.image_base)
+                        name = demangle(sym) if sym else "[unknown]"
+                    elif tok.startswith("x:"):
+                        name = tok[2:]
+                    else:
+                        name = "[unknown]"
+                    cache[tok] = name
+                frames.append(name)
+            frames.reverse()  # root first
+            # Drop the libc/dyld frames below main so stacks start at `main`.
+            if "main" in frames:
+                frames = frames[frames.index("main") :]
+            stacks.append(frames)
+    return meta, stacks
+
+
+def write_folded(path: str, folded: Counter[str]) -> None:
+    with open(path, "w", encoding="utf-8") as fp:
+        for stack, n in sorted(folded.items()):
+            fp.write(f"{stack} {n}\n")
+
+
+def frame_color(name: str) -> str:
+    h = zlib.crc32(name.encode("utf-8"))
+    r = 205 + (h % 50)
+    g = 80 + ((h >> 8) % 120)
+    b = 40 + ((h >> 16) % 40)
+    return f"rgb({r},{g},{b})"
+
+
+def write_svg(path: str, root: Node, title: str) -> None:
+    width = 1200
+    row_h = 16
+    pad = 10
+
+    def depth(n: Node) -> int:
+        return 1 + max((depth(c) for c in n.children.values()), default=0)
+
+    rows = depth(root)
+    height = rows * row_h + 3 * pad + 16
+    total = max(root.value, 1)
+    scale = (width - 2 * pad) / total
+    out: list[str] = []
+    out.append(
+        f'<svg xmlns="http://www.w3.org/2000/svg" width="{width}" height="{height}" '
+        f'font-family="monospace" font-size="11">'
+    )
+    out.append(f'<rect width="{width}" height="{height}" fill="#f8f8f8"/>')
+    out.append(f'<text x="{width // 2}" y="{pad + 10}" text-anchor="middle" font-size="14">{html.escape(title)}</text>')
+
+    def emit(n: Node, x: float, level: int) -> None:
+        w = n.value * scale
+        if w < 0.3:
+            return
+        y = height - pad - (level + 1) * row_h
+        pct = 100.0 * n.value / total
+        label = html.escape(n.name)
+        out.append("<g>")
+        out.append(f"<title>{label} ({n.value} samples, {pct:.2f}%)</title>")
+        out.append(
+            f'<rect x="{x:.2f}" y="{y}" width="{w:.2f}" height="{row_h - 1}" '
+            f'fill="{frame_color(n.name)}" rx="2"/>'
+        )
+        max_chars = int(w / 7)
+        if max_chars >= 3:
+            text = n.name if len(n.name) <= max_chars else n.name[: max_chars - 2] + ".."
+            out.append(f'<text x="{x + 3:.2f}" y="{y + row_h - 4}">{html.escape(text)}</text>')
+        out.append("</g>")
+        cx = x
+        for c in sorted(n.children.values(), key=lambda c: c.name):
+            emit(c, cx, level + 1)
+            cx += c.value * scale
+
+    emit(root, float(pad), 0)
+    out.append("</svg>")
+    with open(path, "w", encoding="utf-8") as fp:
+        fp.write("\n".join(out) + "\n")
+
+
+def main() -> int:
+    ap = argparse.ArgumentParser(description="symbolize + fold aster prof samples")
+    ap.add_argument("--raw", required=True, help="raw samples from ASTER_PROF_OUT")
+    ap.add_argument("--bin", required=True, help="profiled binary (for nm)")
+    ap.add_argument("--folded", required=True, help="folded stacks output path")
+    ap.add_argument("--svg", required=True, help="flame graph SVG output path")
+    ap.add_argument("--top", type=int, default=20, help="rows in the summary table")
+    args = ap.parse_args()
+
+    syms = load_symtab(args.bin)
+    meta, stacks = parse_raw(args.raw, syms)
+    if not stacks:
+        print("aster prof: no samples collected", file=sys.stderr)
+        return 1
+
+    folded: Counter[str] = Counter()
+    self_n: Counter[str] = Counter()
+    total_n: Counter[str] = Counter()
+    root = Node("all")
+    for frames in stacks:
+        folded[";".join(frames)] += 1
+        self_n[frames[-1]] += 1
+        for name in set(frames):
+            total_n[name] += 1
+        root.value += 1
+        n = root
+        for name in frames:
+            n = n.children.setdefault(name, Node(name))
+            n.value += 1
+
+    write_folded(args.folded, folded)
+    write_svg(args.svg, root, f"aster prof ({meta.get('mode', '?')}, {len(stacks)} samples)")
+
+    nsamp = len(stacks)
+    print(f"samples {nsamp} mode {meta.get('mode', '?')} hz {meta.get('hz', '?')} dropped {meta.get('dropped', '0')}")
+    print(f"{'self%':>7} {'total%':>7} {'self':>8}  function")
+    for name, n in self_n.most_common(args.top):
+        print(f"{100.0 * n / nsamp:6.2f}% {100.0 * total_n[name] / nsamp:6.2f}% {n:8d}  {name}")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())